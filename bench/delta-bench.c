@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "../src/git/git.h"
+
+/*
+Delta encoder benchmark:
+for each (base, target) pair, and each tuning preset
+    → createDelta throughput (target MB/s), delta size, ratio to the target
+    → applyDelta throughput, and a round-trip check: applyDelta(base, delta) == target
+
+Pairs are synthetic source-like files with scattered edits, or real files
+given on the command line:  delta-bench [<base> <target>]...
+Exit status is 1 if any round trip fails.
+*/
+
+#define BENCH_MIN_SECONDS 0.5
+
+typedef struct {
+    const char *name;
+    DeltaTuning tuning;
+} Preset;
+
+static const Preset presets[] = {
+    { "fast",     { 4, 8 } },
+    { "default",  { 1, 64 } },
+    { "thorough", { 1, 1024 } },
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng = 0x9e3779b97f4a7c15ull;
+
+static uint32_t nextRandom(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (uint32_t)rng;
+}
+
+/**
+ * @brief Build source-like text: lines of words from a small vocabulary
+ */
+static unsigned char* makeBase(size_t size) {
+    static const char *words[] = { "int", "return", "if", "else", "for", "while", "size_t", "char", "struct",
+                                   "static", "const", "void", "free", "malloc", "memcpy", "data", "len", "offset" };
+    unsigned char *data = malloc(size);
+    size_t pos = 0;
+    while (pos < size) {
+        int indent = (nextRandom() % 4) * 4;
+        for (int i = 0; i < indent && pos < size; i++) data[pos++] = ' ';
+        int count = 2 + nextRandom() % 8;
+        for (int w = 0; w < count && pos < size; w++) {
+            const char *word = words[nextRandom() % (sizeof(words) / sizeof(words[0]))];
+            for (const char *c = word; *c && pos < size; c++) data[pos++] = *c;
+            if (pos < size) data[pos++] = ' ';
+        }
+        if (pos < size) data[pos++] = '\n';
+    }
+    return data;
+}
+
+/**
+ * @brief Copy base with `edits` random inserts, deletes and rewrites of up to 64 bytes
+ */
+static unsigned char* makeTarget(const unsigned char *base, size_t baseSize, int edits, size_t *outSize) {
+    unsigned char *data = malloc(baseSize + (size_t)edits * 64 + 1);
+    size_t *cuts = malloc((size_t)edits * sizeof(size_t));
+    for (int i = 0; i < edits; i++) cuts[i] = nextRandom() % (baseSize ? baseSize : 1);
+    for (int i = 1; i < edits; i++) {
+        for (int j = i; j > 0 && cuts[j - 1] > cuts[j]; j--) {
+            size_t t = cuts[j]; cuts[j] = cuts[j - 1]; cuts[j - 1] = t;
+        }
+    }
+
+    size_t in = 0, out = 0;
+    for (int i = 0; i < edits; i++) {
+        if (cuts[i] < in) continue;
+        memcpy(data + out, base + in, cuts[i] - in);
+        out += cuts[i] - in;
+        in = cuts[i];
+
+        size_t len = 1 + nextRandom() % 64;
+        switch (nextRandom() % 3) {
+            case 0: // insert
+                for (size_t k = 0; k < len; k++) data[out++] = 'a' + nextRandom() % 26;
+                break;
+            case 1: // delete
+                in += len < baseSize - in ? len : baseSize - in;
+                break;
+            default: // rewrite
+                for (size_t k = 0; k < len && in < baseSize; k++, in++) data[out++] = 'A' + nextRandom() % 26;
+                break;
+        }
+    }
+    memcpy(data + out, base + in, baseSize - in);
+    out += baseSize - in;
+    free(cuts);
+    *outSize = out;
+    return data;
+}
+
+static unsigned char* readFile(const char *path, size_t *outSize) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not open %s\n", path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *outSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    unsigned char *data = malloc(*outSize ? *outSize : 1);
+    if (fread(data, 1, *outSize, file) != *outSize) {
+        fprintf(stderr, "Error: Could not read %s\n", path);
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+}
+
+/**
+ * @brief Run every preset on one pair and print a result row per preset
+ * @return int: 0 if every round trip matched
+ */
+static int benchPair(const char *label, const unsigned char *base, size_t baseSize,
+                     const unsigned char *target, size_t targetSize) {
+    int failed = 0;
+    for (size_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+        size_t deltaSize = 0;
+        unsigned char *delta = NULL;
+        int runs = 0;
+        double start = now();
+        do {
+            free(delta);
+            DeltaIndex *index = createDeltaIndex(base, baseSize, &presets[p].tuning);
+            delta = createDeltaFromIndex(index, target, targetSize, 0, &deltaSize);
+            freeDeltaIndex(index);
+            runs++;
+        } while (now() - start < BENCH_MIN_SECONDS);
+        double encodeSeconds = (now() - start) / runs;
+
+        size_t resultSize = 0;
+        unsigned char *result = NULL;
+        runs = 0;
+        start = now();
+        do {
+            free(result);
+            result = applyDelta(base, baseSize, delta, deltaSize, &resultSize);
+            runs++;
+        } while (result && now() - start < BENCH_MIN_SECONDS);
+        double applySeconds = (now() - start) / runs;
+
+        int ok = result && resultSize == targetSize && memcmp(result, target, targetSize) == 0;
+        failed |= !ok;
+
+        printf("%-24s %-9s %10zu %10zu %7.2f%% %9.1f %9.1f  %s\n", label, presets[p].name, targetSize, deltaSize,
+               targetSize ? 100.0 * deltaSize / targetSize : 0.0,
+               targetSize / encodeSeconds / 1e6, targetSize / applySeconds / 1e6, ok ? "ok" : "MISMATCH");
+        free(delta);
+        free(result);
+    }
+    return failed;
+}
+
+int main(int argc, char *argv[]) {
+    printf("%-24s %-9s %10s %10s %8s %9s %9s\n", "pair", "preset", "target", "delta", "ratio", "enc MB/s", "apply MB/s");
+    int failed = 0;
+
+    if (argc > 1) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            size_t baseSize, targetSize;
+            unsigned char *base = readFile(argv[i], &baseSize);
+            unsigned char *target = readFile(argv[i + 1], &targetSize);
+            if (!base || !target) return 1;
+            failed |= benchPair(argv[i + 1], base, baseSize, target, targetSize);
+            free(base);
+            free(target);
+        }
+        return failed;
+    }
+
+    static const struct { const char *label; size_t size; int edits; } cases[] = {
+        { "4KiB, 4 edits", 4096, 4 },
+        { "64KiB, 32 edits", 65536, 32 },
+        { "1MiB, 200 edits", 1 << 20, 200 },
+        { "1MiB, 5000 edits", 1 << 20, 5000 },
+        { "16MiB, 1000 edits", 16 << 20, 1000 },
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        unsigned char *base = makeBase(cases[c].size);
+        size_t targetSize;
+        unsigned char *target = makeTarget(base, cases[c].size, cases[c].edits, &targetSize);
+        failed |= benchPair(cases[c].label, base, cases[c].size, target, targetSize);
+        free(base);
+        free(target);
+    }
+    return failed;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "cmd.h"
+
+/*
+Add flow:
+path
+    → file or symlink: lstat, rehash only if the stat data changed, update its entry
+    → directory: tracked files under it that are gone are removed,
+                 then every file in it (skipping .git) is added as above
+    → missing: its entry (or every entry under it) is removed
+    → .git/index rewritten if anything changed
+*/
+
+/**
+ * @brief Turn a command line path into an index path: no "./" prefix, no trailing '/'
+ *
+ * @return int: 0 on success, -1 if the path leaves the working tree
+ */
+int normalizeIndexPath(const char *arg, char *out, size_t outSize) {
+    while (strncmp(arg, "./", 2) == 0) arg += 2;
+    if (strcmp(arg, ".") == 0) arg = "";
+    if (arg[0] == '/' || strcmp(arg, "..") == 0 || strncmp(arg, "../", 3) == 0 || strstr(arg, "/../")) {
+        fprintf(stderr, "Error: '%s' is outside the working tree\n", arg);
+        return -1;
+    }
+
+    size_t len = strlen(arg);
+    while (len > 0 && arg[len - 1] == '/') len--;
+    if (len >= outSize) {
+        fprintf(stderr, "Error: Path too long: %s\n", arg);
+        return -1;
+    }
+    memcpy(out, arg, len);
+    out[len] = '\0';
+    return 0;
+}
+
+/**
+ * @brief Drop tracked files under dir ("" = everything) that no longer exist
+ */
+static void removeVanished(Index *index, const char *dir) {
+    size_t len = strlen(dir);
+    for (uint32_t i = index->count; i-- > 0;) {
+        const char *path = index->entries[i].path;
+        if (len > 0 && (strncmp(path, dir, len) != 0 || path[len] != '/')) continue;
+
+        struct stat st;
+        if (lstat(path, &st) != 0 || S_ISDIR(st.st_mode)) {
+            indexRemovePath(index, path);
+        }
+    }
+}
+
+/**
+ * @brief Add every file under dir ("" = the top of the working tree)
+ */
+static int addDirectory(Index *index, const char *dir) {
+    DIR *handle = opendir(dir[0] ? dir : ".");
+    if (!handle) {
+        fprintf(stderr, "Error: Could not open directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    int result = 0;
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(handle)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0 ||
+            strcmp(entry->d_name, ".git") == 0) {
+            continue;
+        }
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s%s%s", dir, dir[0] ? "/" : "", entry->d_name);
+        struct stat st;
+        if (lstat(path, &st) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            result = addDirectory(index, path);
+        } else if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) {
+            result = indexAddFile(index, path, &st);
+        }
+    }
+    closedir(handle);
+    return result;
+}
+
+/**
+ * @brief Implements the add command: stage files in the index
+ *  add <path>...   ("." adds the whole working tree)
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int addCmd(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: add <path>...\n");
+        return 1;
+    }
+
+    Index index;
+    if (readIndex(&index) != 0) {
+        return 1;
+    }
+
+    int result = 0;
+    for (int i = 2; i < argc && result == 0; i++) {
+        if (strcmp(argv[i], "--") == 0) continue;
+
+        char path[4096];
+        if (normalizeIndexPath(argv[i], path, sizeof(path)) != 0) {
+            result = -1;
+            break;
+        }
+
+        struct stat st;
+        if (path[0] == '\0' || (lstat(path, &st) == 0 && S_ISDIR(st.st_mode))) {
+            removeVanished(&index, path);
+            result = addDirectory(&index, path);
+        } else if (lstat(path, &st) == 0) {
+            result = indexAddFile(&index, path, &st);
+        } else if (indexRemovePath(&index, path) == 0) {
+            fprintf(stderr, "Error: pathspec '%s' did not match any files\n", argv[i]);
+            result = -1;
+        }
+    }
+
+    if (result == 0 && (index.changed || !index.exists)) {
+        result = writeIndex(&index);
+    }
+    freeIndex(&index);
+    return result == 0 ? 0 : 1;
+}
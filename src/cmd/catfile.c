@@ -3,18 +3,167 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <errno.h>
-#include <zlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "../storage/object.h"
+#include "../git/git.h"
 
-char *buildPath(const char *hash);
+/*
+Batch mode flow (one process, many objects):
+stdin line (the whole line names the object: a SHA, HEAD, a branch, tag or ref)
+    → --batch-check:   "<name>"           → "<sha> <type> <size>" from the object header only
+    → --batch:         "<name>"           → "<sha> <type> <size>\n<content>\n", content streamed
+    → --batch-command: "info <name>"      → like --batch-check
+                       "contents <name>"  → like --batch
+                       "flush"            → write out buffered responses (with --buffer)
+    → unknown object: "<name> missing"
+
+Pack mappings, idx data and the delta-base cache live for the whole process,
+so later requests find them warm.
+*/
+
+typedef enum {
+    BATCH_NONE,
+    BATCH_CHECK,     // --batch-check
+    BATCH_CONTENTS,  // --batch
+    BATCH_COMMAND,   // --batch-command
+} BatchMode;
+
+/**
+ * @brief ObjectSink state for one --batch response
+ */
+typedef struct {
+    const char *hexSha;
+    int started;  // header line written
+} BatchSink;
+
+static int batchSinkBegin(ObjectType type, size_t size, void *arg) {
+    BatchSink *batch = arg;
+    batch->started = 1;
+    printf("%s %s %zu\n", batch->hexSha, objectTypeName(type), size);
+    return 0;
+}
+
+static int batchSinkWrite(const unsigned char *data, size_t len, void *arg) {
+    (void)arg;
+    return fwrite(data, 1, len, stdout) == len ? 0 : -1;
+}
+
+/**
+ * @brief Answer one batch request
+ *
+ * @param name: object name as read from stdin, resolved like a revision
+ * @param withContents: 1 to print the content after the header line
+ * @return int: 0 on success or a missing object, -1 if the object is corrupt (output is out of step)
+ */
+static int batchOne(const char *name, int withContents) {
+    char hexSha[41];
+    if (resolveRevision(name, hexSha) != 0) {
+        printf("%s missing\n", name);
+        return 0;
+    }
+
+    if (!withContents) {
+        ObjectType type;
+        size_t size;
+        if (odbReadObjectHeader(hexSha, &type, &size) != 0) {
+            printf("%s missing\n", name);
+            return 0;
+        }
+        printf("%s %s %zu\n", hexSha, objectTypeName(type), size);
+        return 0;
+    }
+
+    BatchSink batch = { hexSha, 0 };
+    ObjectSink sink = { batchSinkBegin, batchSinkWrite, &batch };
+    if (odbStreamObject(hexSha, &sink) != 0) {
+        if (batch.started) {
+            fprintf(stderr, "Error: Could not read object %s\n", hexSha);
+            return -1;
+        }
+        printf("%s missing\n", name);
+        return 0;
+    }
+    putchar('\n');
+    return 0;
+}
+
+/**
+ * @brief Read requests from stdin until EOF
+ *
+ * @param mode: which batch flag was given
+ * @param buffer: 1 to flush only on "flush" / exit (--buffer), 0 to flush after every response
+ * @return int: Exit status
+ */
+static int catFileBatch(BatchMode mode, int buffer) {
+    char *line = NULL;
+    size_t lineCap = 0;
+    ssize_t lineLen;
+    int result = 0;
+
+    while (result == 0 && (lineLen = getline(&line, &lineCap, stdin)) != -1) {
+        while (lineLen > 0 && (line[lineLen - 1] == '\n' || line[lineLen - 1] == '\r')) line[--lineLen] = '\0';
+
+        if (mode != BATCH_COMMAND) {
+            result = batchOne(line, mode == BATCH_CONTENTS);
+        } else if (strcmp(line, "flush") == 0) {
+            if (!buffer) {
+                fprintf(stderr, "Error: flush is only valid with --buffer\n");
+                result = -1;
+                break;
+            }
+            fflush(stdout);
+            continue;
+        } else if (strncmp(line, "info ", 5) == 0) {
+            result = batchOne(line + 5, 0);
+        } else if (strncmp(line, "contents ", 9) == 0) {
+            result = batchOne(line + 9, 1);
+        } else if (lineLen > 0) {
+            fprintf(stderr, "Error: Unknown batch command '%s'\n", line);
+            result = -1;
+            break;
+        }
+
+        if (!buffer) fflush(stdout);
+    }
+
+    free(line);
+    fflush(stdout);
+    return result == 0 ? 0 : 1;
+}
 
 /**
  * @brief Implements the cat-file command to display the content of a git object
- * 
+ *  cat-file -p <sha>
+ *  cat-file (--batch | --batch-check | --batch-command) [--buffer]   read requests from stdin
+ *
  * @param argc: Number of command line arguments
  * @param argv: Command line arguments
  * @return int: Exit status
  */
 int catFile(int argc, char *argv[]) {
+    BatchMode mode = BATCH_NONE;
+    int buffer = 0;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            mode = BATCH_CONTENTS;
+        } else if (strcmp(argv[i], "--batch-check") == 0) {
+            mode = BATCH_CHECK;
+        } else if (strcmp(argv[i], "--batch-command") == 0) {
+            mode = BATCH_COMMAND;
+        } else if (strcmp(argv[i], "--buffer") == 0) {
+            buffer = 1;
+        } else if (argv[i][0] == '-' && strcmp(argv[i], "-p") != 0) {
+            fprintf(stderr, "Error: Unknown option %s\n", argv[i]);
+            fprintf(stderr, "Usage: cat-file -p <sha>\n"
+                            "       cat-file (--batch | --batch-check | --batch-command) [--buffer]\n");
+            return 1;
+        }
+    }
+    if (mode != BATCH_NONE) {
+        return catFileBatch(mode, buffer);
+    }
+
     if (argc < 4) {
         fprintf(stderr, "Error: Not enough arguments for cat-file\n");
         return 1;
@@ -27,56 +176,12 @@ int catFile(int argc, char *argv[]) {
 
     const char *hash = argv[3];
 
-    // Build the path to the object file
-    char *path = buildPath(hash);
-
-    // Open and read compressed file
-    FILE *file = fopen(path, "rb");
-    if (file == NULL) {
-        fprintf(stderr, "Error: Could not open object %s: %s\n", hash, strerror(errno));
-        return 1;   
-    }
-
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long filesize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    // Read compressed data
-    unsigned char *compressed = malloc(filesize);
-    fread(compressed, 1, filesize, file);
-    fclose(file);
-
-    // Decompress with zlib
-    unsigned long decompressedSize = filesize * 10; // Estimate larger buffer
-    unsigned char *decompressed = malloc(decompressedSize);
-
-    // Uncompress file
-    int result = uncompress(decompressed, &decompressedSize, compressed, filesize);
-    if (result != Z_OK) {
-        fprintf(stderr, "Error: Failed to decompress object %s\n", hash);
-        free(compressed);
-        free(decompressed);
+    // Stream the object (packs first, then loose) straight to stdout
+    ObjectSink sink = { NULL, fdSinkWrite, (void *)(intptr_t)STDOUT_FILENO };
+    if (odbStreamObject(hash, &sink) != 0) {
+        fprintf(stderr, "Error: Could not read object %s\n", hash);
         return 1;
     }
 
-    // Parse header and find content: blob <size>\0<content>
-    char *nullByte = memchr(decompressed, '\0', decompressedSize);
-    if (!nullByte) {
-        fprintf(stderr, "Error: Invalid object format for %s\n", hash);
-        free(compressed);
-        free(decompressed);
-        return 1;
-    }
-    char *content = nullByte + 1;
-
-    // Print content
-    long contentLen = decompressedSize - (content - (char *)decompressed);
-    fwrite(content, 1, contentLen, stdout);
-
-    // cleanup
-    free(compressed);
-    free(decompressed);
-
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Checkout command flow:
+<commit>
+    → branch name (refs/heads/<name>): HEAD will point at the branch
+    → anything else resolving to a commit: HEAD will be detached at it
+HEAD has a commit
+    → checkoutIncremental: only paths that differ between the two trees are touched
+HEAD is unborn
+    → full checkout of the target tree
+→ HEAD updated
+*/
+
+/**
+ * @brief Implements the checkout command: switch the working tree to another commit
+ *  checkout <branch | commit>
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int checkoutCmd(int argc, char *argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: checkout <branch | commit>\n");
+        return 1;
+    }
+    const char *name = argv[2];
+
+    char branchRef[512], targetSha[41];
+    snprintf(branchRef, sizeof(branchRef), "refs/heads/%s", name);
+    int isBranch = resolveRef(branchRef, targetSha) == 0;
+    if (!isBranch && resolveRevision(name, targetSha) != 0) {
+        fprintf(stderr, "Error: pathspec '%s' did not match any commit\n", name);
+        return 1;
+    }
+
+    char headSha[41];
+    if (resolveHead(headSha) == 0) {
+        if (checkoutIncremental(headSha, targetSha) != 0) {
+            return 1;
+        }
+    } else if (checkout(".", targetSha) != 0) {
+        return 1;
+    }
+
+    int result = isBranch ? updateSymbolicRef("HEAD", branchRef) : updateRef("HEAD", targetSha);
+    if (result != 0) {
+        return 1;
+    }
+    if (isBranch) {
+        printf("Switched to branch '%s'\n", name);
+    } else {
+        printf("HEAD is now at %.7s\n", targetSha);
+    }
+    return 0;
+}
@@ -44,25 +44,30 @@ int clone(int argc, char *argv[]) {
     // Request packfile
     //    POST https://github.com/user/repo.git/git-upload-pack
     //    Body: "want <sha>\n... done\n"
-    size_t packSize;
-    unsigned char *packData = requestPackfile(repoUrl, headSha, &packSize);
-    if (!packData) {
-        fprintf(stderr, "Error: Could not request packfile from %s\n", repoUrl);
+    // The pack is indexed while it downloads and kept as received (no loose objects)
+    char packSha[41];
+    if (requestPackfile(repoUrl, headSha, packSha) != 0) {
+        fprintf(stderr, "Error: Could not fetch packfile from %s\n", repoUrl);
         free(headSha);
+        chdir(originalDir);
         return 1;
     }
-    printf("Received packfile of size %zu bytes\n", packSize);
+    odbReprepare();
+    printf("Stored pack-%s.pack\n", packSha);
 
-    // Parse and unpqck the packfile
-    unpack(packData, packSize, directory);
+    // HEAD is "ref: refs/heads/main" (see init), so point that branch at the fetched commit
+    if (updateRef("refs/heads/main", headSha) != 0) {
+        free(headSha);
+        chdir(originalDir);
+        return 1;
+    }
 
-    // checkout HEAD (read commit -> read tree -> write files)
-    checkout(".", headSha);
+    // checkout HEAD (read commit -> read tree -> write files, fill the index)
+    int result = checkout(".", headSha) == 0 ? 0 : 1;
 
     // cleanup
     free(headSha);
-    free(packData);
     chdir(originalDir);
 
-    return 0;
+    return result;
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #ifndef CMD_H
 #define CMD_H
 
+#include <stddef.h>
+#include "../git/git.h"
+
 int init(void);
 int catFile(int argc, char *argv[]);
 int hashObject(int argc, char *argv[]);
@@ -8,5 +11,23 @@ int LSTree(int argc, char *argv[]);
 char* writeTree(char *dirname);
 int commitTree(int argc, char *argv[]);
 int clone(int argc, char *argv[]);
+int indexPackCmd(int argc, char *argv[]);
+int unpackObjects(int argc, char *argv[]);
+int packObjectsCmd(int argc, char *argv[]);
+int addCmd(int argc, char *argv[]);
+int updateIndex(int argc, char *argv[]);
+int statusCmd(int argc, char *argv[]);
+int fsmonitorCmd(int argc, char *argv[]);
+int checkoutCmd(int argc, char *argv[]);
+int diffTreeCmd(int argc, char *argv[]);
+int diffCmd(int argc, char *argv[]);
+int revListCmd(int argc, char *argv[]);
+int logCmd(int argc, char *argv[]);
+int commitGraphCmd(int argc, char *argv[]);
+int mergeBaseCmd(int argc, char *argv[]);
+
+int normalizeIndexPath(const char *arg, char *out, size_t outSize);
+int parseRenameOption(const char *arg, RenameOptions *options);
+int parseRevWalkOption(int argc, char *argv[], int *i, RevWalkOptions *options);
 
 #endif // CMD_H
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Commit-graph command flow:
+write [--reachable]
+    → every ref (and HEAD) peeled to a commit and added to one RevWalk
+    → the walk runs to the end, so every reachable commit gets parsed (from the old
+      commit-graph where it has them)
+    → commits sorted by SHA; parents become indexes into that order
+    → writeCommitGraph: .git/objects/info/commit-graph, replaced atomically
+*/
+
+static int addRefTip(const char *ref, const char *sha, void *arg) {
+    (void)ref;
+    unsigned char commit[20];
+    if (peelToCommit(sha, commit) != 0) return 0;  // a ref to a tree or blob has no history
+    return revWalkAdd(arg, commit, 0) == 0 ? 0 : -1;
+}
+
+static int compareCommitShas(const void *a, const void *b) {
+    return memcmp((*(ParsedCommit *const *)a)->sha, (*(ParsedCommit *const *)b)->sha, 20);
+}
+
+/**
+ * @brief Find a commit in a SHA-sorted array
+ *
+ * @return long: its index, -1 if it isn't there
+ */
+static long findSortedCommit(ParsedCommit **commits, size_t count, const ParsedCommit *commit) {
+    size_t low = 0, high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        int cmp = memcmp(commits[mid]->sha, commit->sha, 20);
+        if (cmp == 0) return (long)mid;
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return -1;
+}
+
+/**
+ * @brief Write a commit-graph of every commit reachable from the refs and HEAD
+ *
+ * @return int: 0 on success, -1 on error
+ */
+static int writeReachableCommitGraph(void) {
+    CommitStore *store = createCommitStore();
+    RevWalk *walk = createRevWalk(store, NULL);
+    int result = forEachRef(addRefTip, walk) == 0 ? 0 : -1;
+    char headHex[41];
+    unsigned char head[20];
+    if (result == 0 && resolveHead(headHex) == 0 && peelToCommit(headHex, head) == 0) {
+        result = revWalkAdd(walk, head, 0);
+    }
+
+    size_t count = 0, capacity = 1024;
+    ParsedCommit **commits = malloc(capacity * sizeof(ParsedCommit *));
+    ParsedCommit *commit;
+    int more;
+    while (result == 0 && (more = revWalkNext(walk, &commit)) != 0) {
+        if (more < 0) {
+            result = -1;
+            break;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            commits = realloc(commits, capacity * sizeof(ParsedCommit *));
+        }
+        commits[count++] = commit;
+    }
+
+    if (result == 0) {
+        qsort(commits, count, sizeof(ParsedCommit *), compareCommitShas);
+        size_t edgeCount = 0;
+        for (size_t i = 0; i < count; i++) edgeCount += commits[i]->parentCount;
+
+        // Parents as indexes into the sorted commits, all in one array
+        CommitGraphInput *inputs = malloc((count + 1) * sizeof(CommitGraphInput));
+        uint32_t *parents = malloc((edgeCount + 1) * sizeof(uint32_t));
+        size_t edge = 0;
+        for (size_t i = 0; i < count && result == 0; i++) {
+            CommitGraphInput *input = &inputs[i];
+            memcpy(input->sha, commits[i]->sha, 20);
+            memcpy(input->tree, commits[i]->tree, 20);
+            input->date = commits[i]->date;
+            input->parentCount = commits[i]->parentCount;
+            input->parents = parents + edge;
+            for (uint32_t p = 0; p < commits[i]->parentCount; p++) {
+                long index = findSortedCommit(commits, count, commits[i]->parents[p]);
+                if (index < 0) {
+                    fprintf(stderr, "Error: Parent of a commit is missing from the walk\n");
+                    result = -1;
+                    break;
+                }
+                parents[edge++] = (uint32_t)index;
+            }
+        }
+
+        if (result == 0) {
+            mkdir(".git/objects/info", 0755);
+            result = writeCommitGraph(COMMIT_GRAPH_PATH, inputs, count);
+        }
+        free(inputs);
+        free(parents);
+    }
+
+    free(commits);
+    freeRevWalk(walk);
+    freeCommitStore(store);
+    return result;
+}
+
+/**
+ * @brief Implements the commit-graph command: write the commit-graph file
+ *  commit-graph write [--reachable]
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int commitGraphCmd(int argc, char *argv[]) {
+    if (argc < 3 || strcmp(argv[2], "write") != 0 || (argc > 3 && strcmp(argv[3], "--reachable") != 0) || argc > 4) {
+        fprintf(stderr, "Usage: commit-graph write [--reachable]\n");
+        return 1;
+    }
+    return writeReachableCommitGraph() == 0 ? 0 : 1;
+}
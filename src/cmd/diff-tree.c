@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Diff-tree command flow:
+<tree-ish> <tree-ish>
+    → both peeled to trees → diffTrees
+<commit>
+    → commit SHA printed, then diffTrees(first parent's tree, commit's tree)
+    → a root commit shows nothing, unless --root (compared with the empty tree)
+-M / -C: the changes are collected into a queue first and detectRenames pairs deleted
+(with -C, also modified) files with added ones, which then show as R/C with a score
+Output, one line per change:
+    ":<old mode> <new mode> <old sha> <new sha> <status>\t<path>"
+    --name-status: "<status>\t<path>", --name-only: "<path>"
+    renames and copies: "R<score>\t<old path>\t<new path>" in place of "<status>\t<path>"
+*/
+
+#define ZERO_SHA "0000000000000000000000000000000000000000"
+
+enum { DIFF_TREE_RAW, DIFF_TREE_NAME_ONLY, DIFF_TREE_NAME_STATUS };
+
+static int printTreeChange(const TreeChange *change, void *arg) {
+    int format = *(int *)arg;
+    if (format == DIFF_TREE_NAME_ONLY) {
+        printf("%s\n", change->path);
+    } else if (format == DIFF_TREE_NAME_STATUS) {
+        printf("%c\t%s\n", change->status, change->path);
+    } else {
+        char oldHex[41] = ZERO_SHA, newHex[41] = ZERO_SHA;
+        if (change->oldSha) rawToHex(change->oldSha, oldHex);
+        if (change->newSha) rawToHex(change->newSha, newHex);
+        printf(":%06o %06o %s %s %c\t%s\n", change->oldMode, change->newMode, oldHex, newHex,
+               change->status, change->path);
+    }
+    return 0;
+}
+
+static void printFilePair(const FilePair *pair, int format) {
+    if (format == DIFF_TREE_NAME_ONLY) {
+        printf("%s\n", pair->newPath);
+        return;
+    }
+    if (format == DIFF_TREE_RAW) {
+        char oldHex[41] = ZERO_SHA, newHex[41] = ZERO_SHA;
+        if (pair->oldMode) rawToHex(pair->oldSha, oldHex);
+        if (pair->newMode) rawToHex(pair->newSha, newHex);
+        printf(":%06o %06o %s %s ", pair->oldMode, pair->newMode, oldHex, newHex);
+    }
+    if (pair->status == 'R' || pair->status == 'C') {
+        printf("%c%03d\t%s\t%s\n", pair->status, pair->score, pair->oldPath, pair->newPath);
+    } else {
+        printf("%c\t%s\n", pair->status, pair->newPath);
+    }
+}
+
+/**
+ * @brief Parse the score of -M<n> like git: digits are a fraction ("5" = 50%, "05" = 5%),
+ *        unless followed by '%' ("5%" = 5%); a '.' is allowed ("0.5" = 50%)
+ *
+ * @param outScore: OUTPUT - score out of RENAME_SCORE_MAX, untouched if value is ""
+ * @return int: 0 on success, -1 if value isn't a score
+ */
+static int parseRenameScore(const char *value, int *outScore) {
+    if (*value == '\0') return 0;
+    long long number = 0, scale = 1;
+    int dot = 0;
+    const char *p = value;
+    for (; *p; p++) {
+        if (*p == '.' && !dot) {
+            dot = 1;
+            scale = 1;
+        } else if (*p == '%') {
+            scale = dot ? scale * 100 : 100;
+            p++;
+            break;
+        } else if (*p >= '0' && *p <= '9') {
+            if (scale < 100000) {
+                scale *= 10;
+                number = number * 10 + (*p - '0');
+            }
+        } else {
+            break;
+        }
+    }
+    if (*p != '\0') {
+        fprintf(stderr, "Error: Invalid rename score '%s'\n", value);
+        return -1;
+    }
+    *outScore = number >= scale ? RENAME_SCORE_MAX : (int)(RENAME_SCORE_MAX * number / scale);
+    return 0;
+}
+
+/**
+ * @brief Parse a rename detection option (shared by diff-tree and diff)
+ *  -M[<n>[%]], --find-renames[=<n>[%]], -C[<n>[%]], --find-copies[=<n>[%]]
+ *
+ * @param arg: command line argument
+ * @param options: OUTPUT - updated with the option's copies flag and minimum score
+ * @return int: 1 if arg was a rename option, 0 if not, -1 if its score is invalid
+ */
+int parseRenameOption(const char *arg, RenameOptions *options) {
+    const char *score;
+    int copies = 0;
+    if (strncmp(arg, "-M", 2) == 0 || strncmp(arg, "-C", 2) == 0) {
+        copies = arg[1] == 'C';
+        score = arg + 2;
+    } else if (strcmp(arg, "--find-renames") == 0 || strncmp(arg, "--find-renames=", 15) == 0) {
+        score = arg + (arg[14] ? 15 : 14);
+    } else if (strcmp(arg, "--find-copies") == 0 || strncmp(arg, "--find-copies=", 14) == 0) {
+        copies = 1;
+        score = arg + (arg[13] ? 14 : 13);
+    } else {
+        return 0;
+    }
+    if (parseRenameScore(score, &options->minScore) != 0) return -1;
+    options->findCopies |= copies;
+    return 1;
+}
+
+/**
+ * @brief Find a commit's first parent
+ *
+ * @param commitSha: 40-char hex SHA of a commit
+ * @param outParent: OUTPUT - 40-char hex SHA of its first parent
+ * @return int: 1 if it has one, 0 for a root commit, -1 if it is not a readable commit
+ */
+static int readFirstParent(const char *commitSha, char *outParent) {
+    ObjectType type;
+    unsigned char *content;
+    size_t size;
+    if (odbReadObject(commitSha, &type, &content, &size) != 0) {
+        fprintf(stderr, "Error: Could not read object %s\n", commitSha);
+        return -1;
+    }
+    if (type != OBJ_COMMIT) {
+        fprintf(stderr, "Error: %s is not a commit\n", commitSha);
+        free(content);
+        return -1;
+    }
+
+    // "tree <sha>\n" comes first, then the "parent <sha>\n" lines
+    int result = 0;
+    const char *line = memchr(content, '\n', size);
+    if (line && (size_t)((const char *)content + size - line) > 48 && strncmp(line + 1, "parent ", 7) == 0) {
+        memcpy(outParent, line + 8, 40);
+        outParent[40] = '\0';
+        result = 1;
+    }
+    free(content);
+    return result;
+}
+
+static int resolveTree(const char *name, char *outHex, unsigned char *outTree) {
+    if (resolveRevision(name, outHex) != 0) {
+        fprintf(stderr, "Error: ambiguous argument '%s': unknown revision\n", name);
+        return -1;
+    }
+    return peelToTree(outHex, outTree);
+}
+
+/**
+ * @brief Implements the diff-tree command: compare the trees of two commits (or trees)
+ *  diff-tree [-r] [--root] [-M[<n>] | -C[<n>]] [--name-only | --name-status] <tree-ish> [<tree-ish>] [--] [<path>...]
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int diffTreeCmd(int argc, char *argv[]) {
+    DiffTreeOptions options = {0};
+    int format = DIFF_TREE_RAW, showRoot = 0, findRenames = 0;
+    RenameOptions renames = { 0, RENAME_DEFAULT_SCORE };
+    const char *revisions[2];
+    int revisionCount = 0;
+    const char **pathspecs = malloc(argc * sizeof(char *));
+    size_t pathspecCount = 0;
+
+    int i = 2;
+    for (; i < argc; i++) {
+        if (strcmp(argv[i], "--") == 0) {
+            i++;
+            break;
+        } else if (strcmp(argv[i], "-r") == 0) {
+            options.recursive = 1;
+        } else if (strcmp(argv[i], "--root") == 0) {
+            showRoot = 1;
+        } else if (strcmp(argv[i], "--name-only") == 0) {
+            format = DIFF_TREE_NAME_ONLY;
+        } else if (strcmp(argv[i], "--name-status") == 0) {
+            format = DIFF_TREE_NAME_STATUS;
+        } else if (argv[i][0] == '-') {
+            int renameOption = parseRenameOption(argv[i], &renames);
+            if (renameOption <= 0) {
+                if (renameOption == 0) fprintf(stderr, "Error: Unknown option %s\n", argv[i]);
+                free(pathspecs);
+                return 1;
+            }
+            findRenames = 1;
+        } else if (revisionCount < 2) {
+            revisions[revisionCount++] = argv[i];
+        } else {
+            break;
+        }
+    }
+    for (; i < argc; i++) {
+        pathspecs[pathspecCount++] = argv[i];
+    }
+    options.pathspecs = pathspecs;
+    options.pathspecCount = pathspecCount;
+
+    if (revisionCount == 0) {
+        fprintf(stderr, "Usage: diff-tree [-r] [--root] [-M[<n>] | -C[<n>]] [--name-only | --name-status] <tree-ish> "
+                        "[<tree-ish>] [--] [<path>...]\n");
+        free(pathspecs);
+        return 1;
+    }
+
+    char oldHex[41], newHex[41];
+    unsigned char oldTree[20], newTree[20];
+    int hasOld = 1, result = 0;
+    if (revisionCount == 2) {
+        if (resolveTree(revisions[0], oldHex, oldTree) != 0 || resolveTree(revisions[1], newHex, newTree) != 0) {
+            result = -1;
+        }
+    } else if (resolveTree(revisions[0], newHex, newTree) != 0) {
+        result = -1;
+    } else {
+        // One commit: compared with its first parent
+        char parentHex[41];
+        hasOld = readFirstParent(newHex, parentHex);
+        if (hasOld < 0 || (hasOld && peelToTree(parentHex, oldTree) != 0)) {
+            result = -1;
+        } else if (hasOld || showRoot) {
+            printf("%s\n", newHex);
+        }
+    }
+
+    if (result == 0 && (hasOld || showRoot) && !findRenames) {
+        result = diffTrees(hasOld ? oldTree : NULL, newTree, &options, printTreeChange, &format);
+    } else if (result == 0 && (hasOld || showRoot)) {
+        DiffQueue queue = {0};
+        result = diffTreesToQueue(hasOld ? oldTree : NULL, newTree, &options, &queue);
+        if (result == 0) {
+            detectRenames(&queue, &renames);
+            for (size_t k = 0; k < queue.count; k++) printFilePair(&queue.pairs[k], format);
+        }
+        freeDiffQueue(&queue);
+    }
+    free(pathspecs);
+    return result == 0 ? 0 : 1;
+}
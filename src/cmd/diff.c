@@ -0,0 +1,493 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Diff command flow:
+diff [--] [<path>...]                     index → working tree (tracked files only)
+diff <tree-ish> [--] [<path>...]          tree → working tree (files in the tree or the index)
+diff <tree-ish> <tree-ish> [--] [<path>]  tree → tree, the file pairs coming from diffTrees, with
+                                          renames found by detectRenames (unless --no-renames)
+diff <blob> <blob>                        blob → blob
+diff --no-index <file> <file>             file → file, outside of any repository data
+each file pair
+    → blobs streamed from the object database into buffers of their exact size,
+      working tree files read (and hashed for the index line)
+    → "diff --git" header, mode, similarity/rename and index lines, then diffBuffers' hunks
+    → a type change (file <-> symlink) shows as a deletion and an addition, like git
+*/
+
+#define DIFF_OUTPUT_BUFFER (64 * 1024)
+
+/**
+ * @brief one side of a file pair
+ * @note
+ *      mode: 0 when the file doesn't exist on this side
+ *      sha: blob SHA (computed from the content for working tree files)
+ *      path: working tree file to read the content from; NULL = blob from the object database
+ */
+typedef struct {
+    uint32_t mode;
+    unsigned char sha[20];
+    const char *path;
+} DiffSource;
+
+/**
+ * @brief ObjectSink target: a buffer allocated once the object's size is known
+ */
+typedef struct {
+    unsigned char *data;
+    size_t size, filled;
+} BlobBuffer;
+
+static int blobBufferBegin(ObjectType type, size_t size, void *arg) {
+    BlobBuffer *buffer = arg;
+    if (type != OBJ_BLOB) return -1;
+    buffer->data = malloc(size ? size : 1);
+    buffer->size = size;
+    return 0;
+}
+
+static int blobBufferWrite(const unsigned char *data, size_t len, void *arg) {
+    BlobBuffer *buffer = arg;
+    if (len > buffer->size - buffer->filled) return -1;
+    memcpy(buffer->data + buffer->filled, data, len);
+    buffer->filled += len;
+    return 0;
+}
+
+/**
+ * @brief Read the content of one side of a file pair
+ *
+ * @param source: side to read (fills in source->sha for working tree files)
+ * @param outSize: OUTPUT - content size
+ * @return unsigned char*: content (caller frees), NULL on error
+ */
+static unsigned char* loadSource(DiffSource *source, size_t *outSize) {
+    if (source->mode == 0) {
+        *outSize = 0;
+        return malloc(1);
+    }
+
+    if (source->mode == 0160000) {
+        // Submodules show as the commit they point at
+        char hexSha[41];
+        rawToHex(source->sha, hexSha);
+        char *line = malloc(64);
+        *outSize = snprintf(line, 64, "Subproject commit %s\n", hexSha);
+        return (unsigned char *)line;
+    }
+
+    if (!source->path) {
+        char hexSha[41];
+        rawToHex(source->sha, hexSha);
+        BlobBuffer buffer = {0};
+        ObjectSink sink = { blobBufferBegin, blobBufferWrite, &buffer };
+        if (odbStreamObject(hexSha, &sink) != 0 || buffer.filled != buffer.size) {
+            fprintf(stderr, "Error: Could not read blob %s\n", hexSha);
+            free(buffer.data);
+            return NULL;
+        }
+        *outSize = buffer.size;
+        return buffer.data;
+    }
+
+    unsigned char *content;
+    if (source->mode == 0120000) {
+        struct stat st;
+        if (lstat(source->path, &st) != 0) return NULL;
+        content = malloc(st.st_size + 1);
+        ssize_t n = readlink(source->path, (char *)content, st.st_size + 1);
+        if (n < 0 || n > st.st_size) {
+            fprintf(stderr, "Error: Could not read link %s\n", source->path);
+            free(content);
+            return NULL;
+        }
+        *outSize = n;
+    } else {
+        content = readFile(source->path, outSize);
+        if (!content) {
+            fprintf(stderr, "Error: Could not read %s\n", source->path);
+            return NULL;
+        }
+    }
+    hashObjectContent("blob", content, *outSize, source->sha);
+    return content;
+}
+
+static void printSideName(const char *prefix, const char *path, const DiffSource *source) {
+    if (source->mode) printf("%s%s", prefix, path);
+    else printf("/dev/null");
+}
+
+/**
+ * @brief Write the diff of one file pair
+ *
+ * @param oldPath/newPath: names shown for the two sides (the same path except with
+ *                         --no-index, renames and copies)
+ * @param oldSource/newSource: the two sides; a missing side has mode 0
+ * @param pair: the rename or copy this is (status 'R'/'C', score), NULL for other changes
+ * @return int: 1 if the pair differs, 0 if not, -1 on error
+ */
+static int diffFilePair(const char *oldPath, const char *newPath, DiffSource oldSource, DiffSource newSource,
+                        const FilePair *pair, const DiffOptions *options) {
+    if (oldSource.mode && newSource.mode && (oldSource.mode & 0170000) != (newSource.mode & 0170000)) {
+        DiffSource none = {0};
+        int deleted = diffFilePair(oldPath, newPath, oldSource, none, NULL, options);
+        int added = diffFilePair(oldPath, newPath, none, newSource, NULL, options);
+        return deleted < 0 || added < 0 ? -1 : 1;
+    }
+
+    // Working tree sides are hashed while reading, so both are read before the header
+    size_t oldSize = 0, newSize = 0;
+    unsigned char *oldData = NULL, *newData = NULL;
+    int sameContent = !oldSource.path && !newSource.path && oldSource.mode && newSource.mode &&
+                      memcmp(oldSource.sha, newSource.sha, 20) == 0;
+    if (!sameContent) {
+        oldData = loadSource(&oldSource, &oldSize);
+        newData = oldData ? loadSource(&newSource, &newSize) : NULL;
+        if (!newData) {
+            free(oldData);
+            return -1;
+        }
+        sameContent = oldSource.mode && newSource.mode && memcmp(oldSource.sha, newSource.sha, 20) == 0;
+    }
+    if (sameContent && oldSource.mode == newSource.mode && !pair) {
+        free(oldData);
+        free(newData);
+        return 0;
+    }
+
+    printf("diff --git a/%s b/%s\n", oldPath, newPath);
+    if (!oldSource.mode) {
+        printf("new file mode %06o\n", newSource.mode);
+    } else if (!newSource.mode) {
+        printf("deleted file mode %06o\n", oldSource.mode);
+    } else if (oldSource.mode != newSource.mode) {
+        printf("old mode %06o\nnew mode %06o\n", oldSource.mode, newSource.mode);
+    }
+    if (pair) {
+        const char *kind = pair->status == 'C' ? "copy" : "rename";
+        printf("similarity index %d%%\n%s from %s\n%s to %s\n", pair->score, kind, oldPath, kind, newPath);
+    }
+    if (!sameContent) {
+        char oldHex[41] = "0000000", newHex[41] = "0000000";
+        if (oldSource.mode) rawToHex(oldSource.sha, oldHex);
+        if (newSource.mode) rawToHex(newSource.sha, newHex);
+        printf("index %.7s..%.7s", oldHex, newHex);
+        if (oldSource.mode == newSource.mode) printf(" %06o", newSource.mode);
+        putchar('\n');
+    }
+
+    if (!sameContent && (oldSize != newSize || memcmp(oldData, newData, oldSize) != 0)) {
+        if (bufferIsBinary(oldData, oldSize) || bufferIsBinary(newData, newSize)) {
+            printf("Binary files ");
+            printSideName("a/", oldPath, &oldSource);
+            printf(" and ");
+            printSideName("b/", newPath, &newSource);
+            printf(" differ\n");
+        } else {
+            printf("--- ");
+            printSideName("a/", oldPath, &oldSource);
+            printf("\n+++ ");
+            printSideName("b/", newPath, &newSource);
+            putchar('\n');
+            diffBuffers(oldData, oldSize, newData, newSize, options, stdout);
+        }
+    }
+    free(oldData);
+    free(newData);
+    return 1;
+}
+
+/**
+ * @brief Diff two trees, renames (and copies) shown as such when findRenames is set
+ */
+static int diffTreeTree(const unsigned char *oldTree, const unsigned char *newTree, const DiffTreeOptions *pathspecs,
+                        int findRenames, const RenameOptions *renames, const DiffOptions *options) {
+    DiffQueue queue = {0};
+    int result = diffTreesToQueue(oldTree, newTree, pathspecs, &queue);
+    if (result == 0 && findRenames) detectRenames(&queue, renames);
+
+    for (size_t i = 0; result == 0 && i < queue.count; i++) {
+        const FilePair *pair = &queue.pairs[i];
+        DiffSource oldSource = { pair->oldMode, {0}, NULL }, newSource = { pair->newMode, {0}, NULL };
+        memcpy(oldSource.sha, pair->oldSha, 20);
+        memcpy(newSource.sha, pair->newSha, 20);
+        int isRename = pair->status == 'R' || pair->status == 'C';
+        if (diffFilePair(pair->oldPath, pair->newPath, oldSource, newSource, isRename ? pair : NULL, options) < 0) {
+            result = -1;
+        }
+    }
+    freeDiffQueue(&queue);
+    return result;
+}
+
+static int isIndexFile(const IndexEntry *entry) {
+    return ((entry->flags >> 12) & 3) == 0 && entry->mode != 0160000;
+}
+
+/**
+ * @brief Describe the working tree file at path (mode 0 if it is missing)
+ *
+ * @param entry: its index entry (NULL = none); if the stat data still matches, its SHA
+ *               is taken as the file's, so the file needn't be read to compare it
+ * @return int: 1 if source->sha is already known, 0 if it comes from reading the file
+ */
+static int worktreeSource(const Index *index, const IndexEntry *entry, const char *path, DiffSource *source) {
+    struct stat st;
+    memset(source, 0, sizeof(*source));
+    if (lstat(path, &st) != 0 || (!S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode))) return 1;
+
+    source->mode = indexModeFromStat(&st);
+    source->path = path;
+    if (entry && indexEntryMatchesStat(index, entry, &st)) {
+        memcpy(source->sha, entry->sha, 20);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Diff the index against the working tree
+ */
+static int diffIndexWorktree(const DiffTreeOptions *pathspecs, const DiffOptions *options) {
+    Index index;
+    if (readIndex(&index) != 0) return -1;
+
+    int result = 0;
+    for (uint32_t i = 0; i < index.count; i++) {
+        const IndexEntry *entry = &index.entries[i];
+        if (!isIndexFile(entry) || !pathspecMatches(pathspecs, entry->path)) continue;
+
+        DiffSource oldSource = { entry->mode, {0}, NULL }, newSource;
+        memcpy(oldSource.sha, entry->sha, 20);
+        if (worktreeSource(&index, entry, entry->path, &newSource) && newSource.mode == entry->mode) {
+            continue;  // stat data unchanged
+        }
+        if (diffFilePair(entry->path, entry->path, oldSource, newSource, NULL, options) < 0) result = -1;
+    }
+    freeIndex(&index);
+    return result;
+}
+
+/**
+ * @brief files of a tree, collected in path order
+ */
+typedef struct {
+    char **paths;
+    uint32_t *modes;
+    unsigned char (*shas)[20];
+    size_t count, capacity;
+} TreeFileList;
+
+static int collectTreeFile(const TreeChange *change, void *arg) {
+    TreeFileList *list = arg;
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->paths = realloc(list->paths, list->capacity * sizeof(char *));
+        list->modes = realloc(list->modes, list->capacity * sizeof(uint32_t));
+        list->shas = realloc(list->shas, list->capacity * sizeof(*list->shas));
+    }
+    list->paths[list->count] = strdup(change->path);
+    list->modes[list->count] = change->newMode;
+    memcpy(list->shas[list->count], change->newSha, 20);
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Diff a tree against the working tree (paths in the tree or the index)
+ */
+static int diffTreeWorktree(const unsigned char *tree, const DiffTreeOptions *pathspecs, const DiffOptions *options) {
+    Index index;
+    if (readIndex(&index) != 0) return -1;
+
+    // Every file of the tree, as "added" changes from the empty tree; in path order
+    // like the index, since a subtree sorts as "name/"
+    DiffTreeOptions walk = *pathspecs;
+    walk.recursive = 1;
+    TreeFileList files = {0};
+    int result = diffTrees(NULL, tree, &walk, collectTreeFile, &files);
+
+    size_t t = 0;
+    uint32_t i = 0;
+    while (result == 0 && (t < files.count || i < index.count)) {
+        const IndexEntry *entry = i < index.count ? &index.entries[i] : NULL;
+        if (entry && (!isIndexFile(entry) || !pathspecMatches(pathspecs, entry->path))) {
+            i++;
+            continue;
+        }
+        int cmp = !entry ? -1 : t >= files.count ? 1 : strcmp(files.paths[t], entry->path);
+        const char *path = cmp <= 0 ? files.paths[t] : entry->path;
+
+        DiffSource oldSource = {0}, newSource;
+        if (cmp <= 0) {
+            oldSource.mode = files.modes[t];
+            memcpy(oldSource.sha, files.shas[t], 20);
+        }
+        int known = worktreeSource(&index, cmp >= 0 ? entry : NULL, path, &newSource);
+        if (!(known && newSource.mode == oldSource.mode &&
+              (!newSource.mode || memcmp(newSource.sha, oldSource.sha, 20) == 0))) {
+            if (diffFilePair(path, path, oldSource, newSource, NULL, options) < 0) result = -1;
+        }
+
+        if (cmp <= 0) t++;
+        if (cmp >= 0) i++;
+    }
+
+    for (size_t k = 0; k < files.count; k++) free(files.paths[k]);
+    free(files.paths);
+    free(files.modes);
+    free(files.shas);
+    freeIndex(&index);
+    return result;
+}
+
+/**
+ * @brief Diff two files outside of the repository's data
+ *
+ * @return int: 1 if they differ, 0 if not, -1 on error
+ */
+static int diffNoIndex(const char *oldPath, const char *newPath, const DiffOptions *options) {
+    DiffSource oldSource, newSource;
+    worktreeSource(NULL, NULL, oldPath, &oldSource);
+    worktreeSource(NULL, NULL, newPath, &newSource);
+    if (!oldSource.mode || !newSource.mode) {
+        fprintf(stderr, "Error: Could not access '%s'\n", oldSource.mode ? newPath : oldPath);
+        return -1;
+    }
+    // Shown relative like any other path: "a//tmp/x" would not apply as a patch
+    while (*oldPath == '/') oldPath++;
+    while (*newPath == '/') newPath++;
+    return diffFilePair(oldPath, newPath, oldSource, newSource, NULL, options);
+}
+
+static int parseContextLines(const char *value, long *out) {
+    char *end;
+    long lines = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0' || lines < 0) {
+        fprintf(stderr, "Error: Invalid number of context lines '%s'\n", value);
+        return -1;
+    }
+    *out = lines;
+    return 0;
+}
+
+/**
+ * @brief Implements the diff command: unified diffs between the index, the working tree,
+ *        trees and blobs
+ *  diff [--myers | --histogram] [-U<n>] [--no-renames | -M[<n>] | -C[<n>]] [<tree-ish> [<tree-ish>]] [--] [<path>...]
+ *  diff [--myers | --histogram] [-U<n>] <blob> <blob>
+ *  diff [--myers | --histogram] [-U<n>] --no-index <file> <file>
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status (--no-index: 1 if the files differ)
+ */
+int diffCmd(int argc, char *argv[]) {
+    // stdout is unbuffered for the other commands; a diff writes many small pieces
+    static char outputBuffer[DIFF_OUTPUT_BUFFER];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    DiffOptions options = { DIFF_MYERS, 3 };
+    RenameOptions renames = { 0, RENAME_DEFAULT_SCORE };
+    int noIndex = 0, dashDash = 0, findRenames = 1;
+    const char **args = malloc(argc * sizeof(char *));
+    int argCount = 0;
+    for (int i = 2; i < argc; i++) {
+        const char *arg = argv[i];
+        if (dashDash || arg[0] != '-') {
+            args[argCount++] = arg;
+        } else if (strcmp(arg, "--") == 0) {
+            dashDash = argCount + 1;  // arguments from here on are paths
+        } else if (strcmp(arg, "--histogram") == 0 || strcmp(arg, "--diff-algorithm=histogram") == 0) {
+            options.algorithm = DIFF_HISTOGRAM;
+        } else if (strcmp(arg, "--myers") == 0 || strcmp(arg, "--diff-algorithm=myers") == 0 ||
+                   strcmp(arg, "--diff-algorithm=default") == 0) {
+            options.algorithm = DIFF_MYERS;
+        } else if (strncmp(arg, "-U", 2) == 0 || strncmp(arg, "--unified=", 10) == 0) {
+            if (parseContextLines(arg + (arg[1] == 'U' ? 2 : 10), &options.context) != 0) {
+                free(args);
+                return 1;
+            }
+        } else if (strcmp(arg, "--no-index") == 0) {
+            noIndex = 1;
+        } else if (strcmp(arg, "--no-renames") == 0) {
+            findRenames = 0;
+        } else {
+            int renameOption = parseRenameOption(arg, &renames);
+            if (renameOption <= 0) {
+                if (renameOption == 0) fprintf(stderr, "Error: Unknown option %s\n", arg);
+                free(args);
+                return 1;
+            }
+            findRenames = 1;
+        }
+    }
+
+    int result;
+    if (noIndex) {
+        if (argCount != 2) {
+            fprintf(stderr, "Usage: diff --no-index <file> <file>\n");
+            free(args);
+            return 1;
+        }
+        result = diffNoIndex(args[0], args[1], &options);
+        fflush(stdout);
+        free(args);
+        return result < 0 ? 1 : result;
+    }
+
+    // Leading arguments that name a revision are revisions, the rest are paths
+    int revisionLimit = dashDash ? dashDash - 1 : argCount;
+    char revisions[2][41];
+    int revisionCount = 0;
+    while (revisionCount < 2 && revisionCount < revisionLimit &&
+           resolveRevision(args[revisionCount], revisions[revisionCount]) == 0) {
+        revisionCount++;
+    }
+    if (revisionCount < revisionLimit && !dashDash && access(args[revisionCount], F_OK) != 0) {
+        fprintf(stderr, "Error: ambiguous argument '%s': unknown revision or path\n", args[revisionCount]);
+        free(args);
+        return 1;
+    }
+    DiffTreeOptions pathspecs = { 1, args + revisionCount, argCount - revisionCount };
+
+    ObjectType types[2];
+    for (int i = 0; i < revisionCount; i++) {
+        size_t size;
+        if (odbReadObjectHeader(revisions[i], &types[i], &size) != 0) {
+            fprintf(stderr, "Error: Could not read object %s\n", revisions[i]);
+            free(args);
+            return 1;
+        }
+    }
+
+    if (revisionCount == 2 && types[0] == OBJ_BLOB && types[1] == OBJ_BLOB) {
+        DiffSource oldSource = { 0100644, {0}, NULL }, newSource = { 0100644, {0}, NULL };
+        hexToRaw(revisions[0], oldSource.sha);
+        hexToRaw(revisions[1], newSource.sha);
+        result = diffFilePair(args[0], args[1], oldSource, newSource, NULL, &options);
+    } else if (revisionCount == 2) {
+        unsigned char oldTree[20], newTree[20];
+        result = peelToTree(revisions[0], oldTree) == 0 && peelToTree(revisions[1], newTree) == 0
+                     ? diffTreeTree(oldTree, newTree, &pathspecs, findRenames, &renames, &options)
+                     : -1;
+    } else if (revisionCount == 1) {
+        unsigned char tree[20];
+        result = peelToTree(revisions[0], tree) == 0 ? diffTreeWorktree(tree, &pathspecs, &options) : -1;
+    } else {
+        result = diffIndexWorktree(&pathspecs, &options);
+    }
+
+    fflush(stdout);
+    free(args);
+    return result < 0 ? 1 : 0;
+}
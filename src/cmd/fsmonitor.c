@@ -0,0 +1,497 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "../storage/object.h"
+#include "cmd.h"
+
+/*
+Fsmonitor daemon flow:
+start
+    → inotify watch on every directory of the working tree (except .git)
+    → listen on .git/fsmonitor.sock only once every watch is in place
+loop (poll on inotify and the socket)
+    → inotify event: append "<dir>/<name>" to the change log (sequence number = log position);
+      a new directory gets watched, and everything already in it is logged
+    → query "<token>\n": drain pending events first (so every write made before the
+      query is seen), then reply "<epoch>:<sequence>\n" + each path logged since the
+      token, NUL-terminated; an unknown token gets "/" (everything)
+    → "quit\n": stop
+Tokens carry an epoch (pid, start time, generation). Overflowed events or a log that
+grew too big start a new generation, which turns every older token into "everything".
+*/
+
+#define FSMONITOR_MAX_LOG (1 << 20)
+#define FSMONITOR_EVENTS (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | \
+                          IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+/**
+ * @brief daemon state
+ * @note
+ *      watchPaths: directory of each watch descriptor ("" = top), NULL once removed
+ *      log: changed paths in the order they were seen; the sequence number of log[i] is i + 1
+ */
+typedef struct {
+    int inotifyFd;
+    int rootWatch;
+    char **watchPaths;
+    int watchCapacity;
+    char **log;
+    size_t logCount, logCapacity;
+    char epoch[64];
+    unsigned generation;
+    int failed;
+} Monitor;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void onSignal(int sig) {
+    (void)sig;
+    stopRequested = 1;
+}
+
+/**
+ * @brief Forget every logged change and move to a new epoch (older tokens become unknown)
+ */
+static void resetLog(Monitor *monitor) {
+    for (size_t i = 0; i < monitor->logCount; i++) {
+        free(monitor->log[i]);
+    }
+    monitor->logCount = 0;
+    snprintf(monitor->epoch, sizeof(monitor->epoch), "%ld.%ld.%u", (long)getpid(), (long)time(NULL), monitor->generation++);
+}
+
+static void logChange(Monitor *monitor, const char *path) {
+    if (monitor->logCount == FSMONITOR_MAX_LOG) {
+        resetLog(monitor);
+    }
+    if (monitor->logCount == monitor->logCapacity) {
+        monitor->logCapacity = monitor->logCapacity ? monitor->logCapacity * 2 : 1024;
+        monitor->log = realloc(monitor->log, monitor->logCapacity * sizeof(char *));
+    }
+    monitor->log[monitor->logCount++] = strdup(path);
+}
+
+/**
+ * @brief Watch a directory and everything under it
+ *
+ * @param path: directory relative to the top ("" = the top itself)
+ * @param logContents: 1 to log every entry found (a directory that appeared after the
+ *                     daemon started may have been filled before its watch existed)
+ * @return int: 0 on success, -1 if the inotify watch limit was hit
+ */
+static int watchDirectory(Monitor *monitor, const char *path, int logContents) {
+    int wd = inotify_add_watch(monitor->inotifyFd, path[0] ? path : ".", FSMONITOR_EVENTS);
+    if (wd < 0) {
+        if (errno == ENOSPC) {
+            fprintf(stderr, "Error: Out of inotify watches (raise fs.inotify.max_user_watches)\n");
+            return -1;
+        }
+        return 0;  // vanished, or not a directory any more: its parent's event covers it
+    }
+    if (wd >= monitor->watchCapacity) {
+        int capacity = monitor->watchCapacity ? monitor->watchCapacity : 1024;
+        while (wd >= capacity) capacity *= 2;
+        monitor->watchPaths = realloc(monitor->watchPaths, capacity * sizeof(char *));
+        memset(monitor->watchPaths + monitor->watchCapacity, 0, (capacity - monitor->watchCapacity) * sizeof(char *));
+        monitor->watchCapacity = capacity;
+    }
+    free(monitor->watchPaths[wd]);
+    monitor->watchPaths[wd] = strdup(path);
+
+    DIR *dir = opendir(path[0] ? path : ".");
+    if (!dir) return 0;
+    int result = 0;
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 ||
+            strcmp(entry->d_name, "..") == 0 ||
+            strcmp(entry->d_name, ".git") == 0) {
+            continue;
+        }
+
+        char child[4096];
+        snprintf(child, sizeof(child), "%s%s%s", path, path[0] ? "/" : "", entry->d_name);
+        if (logContents) logChange(monitor, child);
+
+        int isDir = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            isDir = lstat(child, &st) == 0 && S_ISDIR(st.st_mode);
+        }
+        if (isDir) result = watchDirectory(monitor, child, logContents);
+    }
+    closedir(dir);
+    return result;
+}
+
+/**
+ * @brief Drop the watches on a directory that moved away or was deleted, and on everything under it
+ */
+static void unwatchDirectory(Monitor *monitor, const char *path) {
+    size_t len = strlen(path);
+    for (int wd = 0; wd < monitor->watchCapacity; wd++) {
+        const char *watched = monitor->watchPaths[wd];
+        if (watched && strncmp(watched, path, len) == 0 && (watched[len] == '\0' || watched[len] == '/')) {
+            inotify_rm_watch(monitor->inotifyFd, wd);
+            free(monitor->watchPaths[wd]);
+            monitor->watchPaths[wd] = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Read and log every pending inotify event without blocking
+ *
+ * @return int: 0 to keep going, -1 if the working tree itself went away
+ */
+static int drainEvents(Monitor *monitor) {
+    char buffer[65536] __attribute__((aligned(__alignof__(struct inotify_event))));
+    for (;;) {
+        ssize_t n = read(monitor->inotifyFd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return 0;
+
+        for (char *ptr = buffer; ptr < buffer + n;) {
+            struct inotify_event *event = (struct inotify_event *)ptr;
+            ptr += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                resetLog(monitor);
+                continue;
+            }
+            if (event->wd == monitor->rootWatch && (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF))) {
+                fprintf(stderr, "Error: Working tree went away\n");
+                return -1;
+            }
+            const char *dir = event->wd >= 0 && event->wd < monitor->watchCapacity ? monitor->watchPaths[event->wd] : NULL;
+            if (!dir) continue;
+            if (event->mask & IN_IGNORED) {
+                free(monitor->watchPaths[event->wd]);
+                monitor->watchPaths[event->wd] = NULL;
+                continue;
+            }
+            if (event->len == 0) {
+                // Event on the directory itself (chmod, removal): children are reported separately
+                if (dir[0]) logChange(monitor, dir);
+                continue;
+            }
+            if (!dir[0] && strcmp(event->name, ".git") == 0) continue;
+
+            char path[4096];
+            snprintf(path, sizeof(path), "%s%s%s", dir, dir[0] ? "/" : "", event->name);
+            logChange(monitor, path);
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_MOVED_FROM | IN_DELETE))) {
+                unwatchDirectory(monitor, path);
+            }
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)) &&
+                watchDirectory(monitor, path, 1) != 0) {
+                monitor->failed = 1;
+                return -1;
+            }
+        }
+    }
+}
+
+static int compareStrings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+static int writeAll(int fd, const void *data, size_t len) {
+    const char *ptr = data;
+    while (len > 0) {
+        ssize_t n = send(fd, ptr, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        ptr += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Answer one client
+ *
+ * @return int: 1 if asked to quit, 0 otherwise, -1 if the daemon must stop
+ */
+static int serveClient(Monitor *monitor, int client) {
+    char request[256];
+    size_t len = 0;
+    while (len < sizeof(request) - 1) {
+        ssize_t n = read(client, request + len, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0 || request[len] == '\n') break;
+        len++;
+    }
+    request[len] = '\0';
+
+    if (strcmp(request, "quit") == 0) {
+        writeAll(client, "ok\n", 3);
+        return 1;
+    }
+    if (drainEvents(monitor) != 0) {
+        return -1;
+    }
+
+    // Token "<epoch>:<sequence>"; anything else (including no token) means "everything"
+    size_t since = 0;
+    int known = 0;
+    char *colon = strrchr(request, ':');
+    if (colon) {
+        *colon = '\0';
+        char *end;
+        unsigned long long sequence = strtoull(colon + 1, &end, 10);
+        known = strcmp(request, monitor->epoch) == 0 && *end == '\0' && sequence <= monitor->logCount;
+        since = known ? (size_t)sequence : 0;
+    }
+
+    char header[128];
+    int headerLen = snprintf(header, sizeof(header), "%s:%zu\n", monitor->epoch, monitor->logCount);
+    if (writeAll(client, header, headerLen) != 0) return 0;
+    if (!known) {
+        writeAll(client, "/", 2);
+        return 0;
+    }
+
+    // Each path once, however often it changed
+    size_t count = monitor->logCount - since;
+    char **paths = malloc((count ? count : 1) * sizeof(char *));
+    memcpy(paths, monitor->log + since, count * sizeof(char *));
+    qsort(paths, count, sizeof(char *), compareStrings);
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0 && strcmp(paths[i], paths[i - 1]) == 0) continue;
+        if (writeAll(client, paths[i], strlen(paths[i]) + 1) != 0) break;
+    }
+    free(paths);
+    return 0;
+}
+
+/**
+ * @brief Bind the socket, replacing a stale one left by a daemon that died
+ *
+ * @return int: listening fd, -1 on error
+ */
+static int listenSocket(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", FSMONITOR_SOCKET_PATH);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create socket: %s\n", strerror(errno));
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int probe = errno == EADDRINUSE ? socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0) : -1;
+        if (probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            fprintf(stderr, "Error: An fsmonitor daemon is already running\n");
+            close(probe);
+            close(fd);
+            return -1;
+        }
+        if (probe >= 0) close(probe);
+        if (unlink(FSMONITOR_SOCKET_PATH) != 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            fprintf(stderr, "Error: Could not bind %s: %s\n", FSMONITOR_SOCKET_PATH, strerror(errno));
+            close(fd);
+            return -1;
+        }
+    }
+    if (listen(fd, 16) != 0) {
+        fprintf(stderr, "Error: Could not listen on %s: %s\n", FSMONITOR_SOCKET_PATH, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Watch the working tree and answer queries until stopped
+ *
+ * @param readyFd: written to (then closed) once queries are served, -1 if nobody waits
+ * @return int: 0 on a clean stop, -1 on error
+ */
+static int runDaemon(int readyFd) {
+    Monitor monitor = {0};
+    resetLog(&monitor);
+    monitor.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (monitor.inotifyFd < 0) {
+        fprintf(stderr, "Error: Could not start inotify: %s\n", strerror(errno));
+        return -1;
+    }
+    if (watchDirectory(&monitor, "", 0) != 0) {
+        close(monitor.inotifyFd);
+        return -1;
+    }
+    monitor.rootWatch = -1;
+    for (int wd = 0; wd < monitor.watchCapacity; wd++) {
+        if (monitor.watchPaths[wd] && monitor.watchPaths[wd][0] == '\0') monitor.rootWatch = wd;
+    }
+
+    int listenFd = listenSocket();
+    if (listenFd < 0) {
+        close(monitor.inotifyFd);
+        return -1;
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = onSignal;
+    sigaction(SIGTERM, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGHUP, &action, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (readyFd >= 0) {
+        if (write(readyFd, "1", 1) != 1) { /* the starter went away; keep serving */ }
+        close(readyFd);
+    }
+
+    int result = 0;
+    while (!stopRequested) {
+        struct pollfd fds[2] = { { monitor.inotifyFd, POLLIN, 0 }, { listenFd, POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            result = -1;
+            break;
+        }
+        if ((fds[0].revents & POLLIN) && drainEvents(&monitor) != 0) {
+            result = monitor.failed ? -1 : 0;
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            int client = accept(listenFd, NULL, NULL);
+            if (client < 0) continue;
+            struct timeval timeout = { 1, 0 };
+            setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            int served = serveClient(&monitor, client);
+            close(client);
+            if (served != 0) {
+                result = served > 0 ? 0 : -1;
+                break;
+            }
+        }
+    }
+
+    close(listenFd);
+    unlink(FSMONITOR_SOCKET_PATH);
+    close(monitor.inotifyFd);
+    for (int wd = 0; wd < monitor.watchCapacity; wd++) free(monitor.watchPaths[wd]);
+    free(monitor.watchPaths);
+    resetLog(&monitor);
+    free(monitor.log);
+    return result;
+}
+
+/**
+ * @brief Send a request to the running daemon
+ *
+ * @return int: 0 if it answered, -1 if none is running
+ */
+static int contactDaemon(const char *request) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", FSMONITOR_SOCKET_PATH);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        send(fd, request, strlen(request), MSG_NOSIGNAL) < 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    char reply[256];
+    while (read(fd, reply, sizeof(reply)) > 0) {}
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief Start the daemon in the background and wait until it serves queries
+ */
+static int startDaemon(void) {
+    if (contactDaemon("\n") == 0) {
+        printf("fsmonitor daemon is already running\n");
+        return 0;
+    }
+
+    int ready[2];
+    if (pipe(ready) != 0) {
+        fprintf(stderr, "Error: Could not create pipe: %s\n", strerror(errno));
+        return 1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Error: Could not fork: %s\n", strerror(errno));
+        return 1;
+    }
+    if (pid == 0) {
+        close(ready[0]);
+        setsid();
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        if (null > STDERR_FILENO) close(null);
+        // stderr stays with the starter until the daemon is up, so setup errors are seen
+        int result = runDaemon(ready[1]);
+        _exit(result == 0 ? 0 : 1);
+    }
+
+    close(ready[1]);
+    char byte;
+    ssize_t n;
+    while ((n = read(ready[0], &byte, 1)) < 0 && errno == EINTR) {}
+    close(ready[0]);
+    if (n != 1) {
+        fprintf(stderr, "Error: fsmonitor daemon failed to start\n");
+        return 1;
+    }
+    printf("fsmonitor daemon started (pid %ld)\n", (long)pid);
+    return 0;
+}
+
+/**
+ * @brief Implements the fsmonitor command: manage the file system monitor daemon
+ *  fsmonitor start    watch the working tree in the background
+ *  fsmonitor run      same, in the foreground
+ *  fsmonitor stop     stop the running daemon
+ *  fsmonitor status   tell whether a daemon is running
+ *
+ * @note While it runs, status and write-tree only look at paths it reports changed.
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int fsmonitorCmd(int argc, char *argv[]) {
+    const char *action = argc >= 3 ? argv[2] : "";
+    struct stat st;
+    if (stat(".git", &st) != 0 || !S_ISDIR(st.st_mode)) {
+        fprintf(stderr, "Error: Not at the top of a working tree\n");
+        return 1;
+    }
+
+    if (strcmp(action, "start") == 0) {
+        return startDaemon();
+    } else if (strcmp(action, "run") == 0) {
+        return runDaemon(-1) == 0 ? 0 : 1;
+    } else if (strcmp(action, "stop") == 0) {
+        if (contactDaemon("quit\n") != 0) {
+            fprintf(stderr, "Error: fsmonitor daemon is not running\n");
+            return 1;
+        }
+        return 0;
+    } else if (strcmp(action, "status") == 0) {
+        int running = contactDaemon("\n") == 0;
+        printf("fsmonitor daemon is %s\n", running ? "watching the working tree" : "not running");
+        return running ? 0 : 1;
+    }
+
+    fprintf(stderr, "Usage: fsmonitor (start | run | stop | status)\n");
+    return 1;
+}
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+
+/**
+ * @brief Implements the index-pack command: build a .idx v2 for a pack
+ *  index-pack [--threads=N] <pack-file>   write <pack-file minus .pack>.idx next to it
+ *  index-pack [--threads=N] --stdin       store the pack from stdin in .git/objects/pack
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int indexPackCmd(int argc, char *argv[]) {
+    int threads = 0; // one per online CPU
+    int useStdin = 0;
+    const char *packPath = NULL;
+
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = atoi(argv[i] + 10);
+        } else if (strcmp(argv[i], "--stdin") == 0) {
+            useStdin = 1;
+        } else {
+            packPath = argv[i];
+        }
+    }
+
+    if (!useStdin && !packPath) {
+        fprintf(stderr, "Usage: index-pack [--threads=N] (--stdin | <pack-file>)\n");
+        return 1;
+    }
+
+    size_t packSize;
+    unsigned char *packData;
+
+    if (useStdin) {
+        packData = readStream(stdin, &packSize);
+
+        char packSha[41];
+        if (indexPack(packData, packSize, threads, packSha) != 0) {
+            free(packData);
+            return 1;
+        }
+        printf("%s\n", packSha);
+        free(packData);
+        return 0;
+    }
+
+    size_t pathLen = strlen(packPath);
+    if (pathLen < 5 || strcmp(packPath + pathLen - 5, ".pack") != 0) {
+        fprintf(stderr, "Error: Pack file name %s does not end in .pack\n", packPath);
+        return 1;
+    }
+
+    FILE *file = fopen(packPath, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Could not open pack %s: %s\n", packPath, strerror(errno));
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    packSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    packData = malloc(packSize);
+    fread(packData, 1, packSize, file);
+    fclose(file);
+
+    PackEntry *entries;
+    uint32_t count;
+    if (scanPack(packData, packSize, &entries, &count) != 0 ||
+        resolvePackEntries(packData, packSize, entries, count, threads) != 0) {
+        free(packData);
+        return 1;
+    }
+
+    // foo.pack -> foo.idx
+    char idxPath[4096];
+    snprintf(idxPath, sizeof(idxPath), "%.*s.idx", (int)(pathLen - 5), packPath);
+    const unsigned char *packSha = packData + packSize - SHA_DIGEST_LENGTH;
+    int result = writePackIndex(idxPath, entries, count, packSha);
+
+    if (result == 0) {
+        char packHex[41];
+        rawToHex(packSha, packHex);
+        printf("%s\n", packHex);
+    }
+
+    free(entries);
+    free(packData);
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../utils/utils.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Log command flow:
+[<rev>...] (HEAD if none)
+    → revisions added to a RevWalk, commits returned newest first with only their
+      header parsed
+    → each shown commit's text (author, message) read from the object database just
+      for printing it: "commit", "Merge:", "Author:", "Date:" and the indented message
+    → --oneline: abbreviated SHA and subject
+*/
+
+#define LOG_OUTPUT_BUFFER (64 * 1024)
+
+/**
+ * @brief Print an identity's date in its own timezone, like git's default date format
+ *
+ * @param identity: "Name <email> <time> <tz>" (authorLen bytes)
+ */
+static void printIdentityDate(const char *identity, size_t len) {
+    static const char *weekdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    const char *close = NULL;
+    for (const char *p = identity; p < identity + len; p++) {
+        if (*p == '>') close = p;
+    }
+    char *end;
+    long long when = close ? strtoll(close + 1, &end, 10) : 0;
+    int tz = close ? (int)strtol(end, NULL, 10) : 0;
+
+    // "+0130": hours and minutes east of UTC
+    int offsetMinutes = (tz / 100) * 60 + tz % 100;
+    time_t local = (time_t)(when + offsetMinutes * 60LL);
+    struct tm tm;
+    gmtime_r(&local, &tm);
+    printf("%s %s %d %02d:%02d:%02d %d %+05d", weekdays[tm.tm_wday], months[tm.tm_mon], tm.tm_mday,
+           tm.tm_hour, tm.tm_min, tm.tm_sec, tm.tm_year + 1900, tz);
+}
+
+static void printIdentityName(const char *identity, size_t len) {
+    const char *close = memchr(identity, '>', len);
+    printf("%.*s", close ? (int)(close - identity + 1) : (int)len, identity);
+}
+
+/**
+ * @brief Print a commit message, each line indented by four spaces
+ */
+static void printIndentedMessage(const char *message) {
+    while (*message == '\n') message++;  // leading blank lines are not shown
+
+    // Trailing blank lines neither
+    const char *end = message + strlen(message);
+    while (end > message && (end[-1] == '\n' || end[-1] == ' ')) end--;
+
+    while (message < end) {
+        const char *next = memchr(message, '\n', end - message);
+        if (!next) next = end;
+        printf("    %.*s\n", (int)(next - message), message);
+        message = next + 1;
+    }
+}
+
+/**
+ * @brief Print the subject: the message's first paragraph, its lines joined by spaces
+ */
+static void printSubject(const char *message) {
+    while (*message == '\n') message++;
+    int first = 1;
+    while (*message && *message != '\n') {
+        const char *next = strchr(message, '\n');
+        size_t len = next ? (size_t)(next - message) : strlen(message);
+        while (len > 0 && message[len - 1] == ' ') len--;
+        printf("%s%.*s", first ? "" : " ", (int)len, message);
+        first = 0;
+        if (!next) break;
+        message = next + 1;
+    }
+}
+
+/**
+ * @brief Show one commit
+ *
+ * @param first: no separating blank line before it
+ * @return int: 0 on success, -1 if its text can't be read
+ */
+static int showCommit(const ParsedCommit *commit, int oneline, int first) {
+    CommitText text;
+    if (readCommitText(commit, &text) != 0) return -1;
+
+    char hexSha[41];
+    rawToHex(commit->sha, hexSha);
+    if (oneline) {
+        printf("%.7s ", hexSha);
+        printSubject(text.message);
+        putchar('\n');
+        freeCommitText(&text);
+        return 0;
+    }
+
+    if (!first) putchar('\n');
+    printf("commit %s\n", hexSha);
+    if (commit->parentCount > 1) {
+        printf("Merge:");
+        for (uint32_t i = 0; i < commit->parentCount; i++) {
+            char parentHex[41];
+            rawToHex(commit->parents[i]->sha, parentHex);
+            printf(" %.7s", parentHex);
+        }
+        putchar('\n');
+    }
+    if (text.author) {
+        printf("Author: ");
+        printIdentityName(text.author, text.authorLen);
+        printf("\nDate:   ");
+        printIdentityDate(text.author, text.authorLen);
+        putchar('\n');
+    }
+    putchar('\n');
+    printIndentedMessage(text.message);
+    freeCommitText(&text);
+    return 0;
+}
+
+/**
+ * @brief Implements the log command: show the commits reachable from some revisions
+ *  log [--oneline] [--max-count=<n>] [--first-parent] [<rev>...]
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int logCmd(int argc, char *argv[]) {
+    static char outputBuffer[LOG_OUTPUT_BUFFER];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    RevWalkOptions options = { 0, -1 };
+    int oneline = 0, revisionCount = 0;
+    for (int i = 2; i < argc; i++) {
+        int walkOption = parseRevWalkOption(argc, argv, &i, &options);
+        if (walkOption < 0) return 1;
+        if (walkOption > 0) continue;
+        if (strcmp(argv[i], "--oneline") == 0) {
+            oneline = 1;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option %s\n", argv[i]);
+            return 1;
+        } else {
+            revisionCount++;
+        }
+    }
+
+    CommitStore *store = createCommitStore();
+    RevWalk *walk = createRevWalk(store, &options);
+    int result = revisionCount == 0 ? revWalkAddArgument(walk, "HEAD") : 0;
+    for (int i = 2; i < argc && result == 0; i++) {
+        if (strcmp(argv[i], "-n") == 0) i++;
+        else if (argv[i][0] != '-') result = revWalkAddArgument(walk, argv[i]);
+    }
+
+    ParsedCommit *commit;
+    int more, first = 1;
+    while (result == 0 && (more = revWalkNext(walk, &commit)) != 0) {
+        if (more < 0 || showCommit(commit, oneline, first) != 0) {
+            result = -1;
+            break;
+        }
+        first = 0;
+    }
+
+    fflush(stdout);
+    freeRevWalk(walk);
+    freeCommitStore(store);
+    return result == 0 ? 0 : 1;
+}
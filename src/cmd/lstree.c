@@ -3,8 +3,8 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <errno.h>
-#include <zlib.h>
 #include "../utils/utils.h"
+#include "../storage/object.h"
 /**
  * @brief Implements the LSTree command: ls-tree --name-only <tree_sha>
  * 
@@ -28,74 +28,30 @@ int LSTree(int argc, char *argv[]) {
         hash = argv[2];
     }
     
-    char *path = buildPath(hash);
-
-    // Decompress (similar to catfile)
-    FILE *file = fopen(path, "rb");
-    if (file == NULL) {
-        fprintf(stderr, "Error: Could not open object %s: %s\n", hash, strerror(errno));
-        return 1;   
-    }
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long filesize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    // Read compressed data
-    unsigned char *compressed = malloc(filesize);
-    fread(compressed, 1, filesize, file);
-    fclose(file);
-
-    // Decompress with zlib
-    unsigned long decompressedSize = filesize * 10; // Estimate larger buffer
-    unsigned char *decompressed = malloc(decompressedSize);
-
-    // Uncompress file
-    int result = uncompress(decompressed, &decompressedSize, compressed, filesize);
-    if (result != Z_OK) {
-        fprintf(stderr, "Error: Failed to decompress object %s\n", hash);
-        free(compressed);
-        free(decompressed);
+    // Read tree object (packs first, then loose)
+    ObjectType type;
+    unsigned char *content;
+    size_t contentSize;
+    if (odbReadObject(hash, &type, &content, &contentSize) != 0) {
+        fprintf(stderr, "Error: Could not read object %s\n", hash);
         return 1;
     }
-
-    // Skip header; find first null byte to get past tree <size>\0
-    char *nullByte = memchr(decompressed, '\0', decompressedSize);
-    if (!nullByte) {
-        fprintf(stderr, "Error: Invalid object format for %s\n", hash);
-        free(compressed);
-        free(decompressed);
+    if (type != OBJ_TREE) {
+        fprintf(stderr, "Error: %s is not a tree\n", hash);
+        free(content);
         return 1;
     }
-    unsigned char *content = nullByte + 1;
 
-    // Parse entries in a loop
-    /*
-     * for each eentry
-        * read mode until space
-        * read name until null byte
-        * read sha (20 bytes)
-        * repeat until end of data
-    */
-    for (char *ptr = content; ptr < decompressed + decompressedSize;) {
-        // read mode until space
-        unsigned char *space = memchr(ptr, ' ', (char *)decompressed + decompressedSize - ptr);
-        if (!space) break;
-        ptr = (char *)(space + 1);
-
-        // read name until null byte
-        unsigned char *nullByte = memchr(ptr, '\0', (char *)decompressed + decompressedSize - ptr);
-        if (!nullByte) break;
+    // Entries are read in place; names are already NUL-terminated in the content
+    TreeIterator it;
+    treeIteratorInit(&it, content, contentSize);
+    int more;
+    while ((more = treeIteratorNext(&it)) > 0) {
         if (nameOnly) {
-            printf("%.*s\n", (int)(nullByte - (unsigned char *)ptr), ptr);
+            printf("%s\n", it.name);
         }
-        ptr = (char *)(nullByte + 1 + 20); // move past null byte and sha
-
-        // read sha (20 bytes)
-        unsigned char sha[20];
-        memcpy(sha, nullByte + 1, 20);
-        // repeat until end of data
     }
 
-    return 0;
+    free(content);
+    return more == 0 ? 0 : 1;
 }
\ No newline at end of file
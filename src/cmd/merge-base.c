@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Merge-base command flow:
+--is-ancestor <a> <b>
+    → both resolved to commits in one CommitStore (which maps the commit-graph)
+    → isAncestor walks down from b; with generation numbers the walk stops at a's
+      generation instead of running down to the root commits
+    → exit status 0 if a is an ancestor of b, 1 if not
+*/
+
+/**
+ * @brief Implements the merge-base command (only its reachability check)
+ *  merge-base --is-ancestor <commit> <commit>
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: 0 if the first commit is an ancestor of the second, 1 if not, 128 on error
+ */
+int mergeBaseCmd(int argc, char *argv[]) {
+    if (argc != 5 || strcmp(argv[2], "--is-ancestor") != 0) {
+        fprintf(stderr, "Usage: merge-base --is-ancestor <commit> <commit>\n");
+        return 128;
+    }
+
+    unsigned char ancestorSha[20], descendantSha[20];
+    if (resolveCommit(argv[3], ancestorSha) != 0 || resolveCommit(argv[4], descendantSha) != 0) return 128;
+
+    CommitStore *store = createCommitStore();
+    int result = isAncestor(store, lookupCommit(store, ancestorSha), lookupCommit(store, descendantSha));
+    freeCommitStore(store);
+    return result < 0 ? 128 : result ? 0 : 1;
+}
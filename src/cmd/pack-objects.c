@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+
+#define DEFAULT_PACK_WINDOW 10
+#define DEFAULT_PACK_DEPTH 50
+
+/**
+ * @brief Implements the pack-objects command: pack the objects listed on stdin
+ *  pack-objects [--window=N] [--depth=N] <base-name>   write <base-name>-<sha>.pack and .idx, print <sha>
+ *  pack-objects [--window=N] [--depth=N] --stdout      write the pack to stdout
+ *
+ * @note stdin has one object per line: "<sha>" or "<sha> <path>" (the output of rev-list --objects)
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int packObjectsCmd(int argc, char *argv[]) {
+    PackOptions options = { DEFAULT_PACK_WINDOW, DEFAULT_PACK_DEPTH };
+    int toStdout = 0;
+    const char *baseName = NULL;
+
+    for (int i = 2; i < argc; i++) {
+        if (strncmp(argv[i], "--window=", 9) == 0) {
+            options.window = atoi(argv[i] + 9);
+        } else if (strncmp(argv[i], "--depth=", 8) == 0) {
+            options.depth = atoi(argv[i] + 8);
+        } else if (strcmp(argv[i], "--stdout") == 0) {
+            toStdout = 1;
+        } else {
+            baseName = argv[i];
+        }
+    }
+
+    if (toStdout == (baseName != NULL)) {
+        fprintf(stderr, "Usage: pack-objects [--window=N] [--depth=N] (--stdout | <base-name>) < <object-list>\n");
+        return 1;
+    }
+
+    // Read "<sha>[ <path>]" lines
+    uint32_t count = 0, capacity = 1024;
+    char **shas = malloc(capacity * sizeof(char *));
+    char **paths = malloc(capacity * sizeof(char *));
+    char *line = NULL;
+    size_t lineCap = 0;
+    ssize_t lineLen;
+    while ((lineLen = getline(&line, &lineCap, stdin)) != -1) {
+        while (lineLen > 0 && (line[lineLen - 1] == '\n' || line[lineLen - 1] == '\r')) line[--lineLen] = '\0';
+        if (lineLen == 0) continue;
+        if (lineLen < 40 || (lineLen > 40 && line[40] != ' ')) {
+            fprintf(stderr, "Error: Expected an object name, got '%s'\n", line);
+            free(line);
+            return 1;
+        }
+
+        if (count == capacity) {
+            capacity *= 2;
+            shas = realloc(shas, capacity * sizeof(char *));
+            paths = realloc(paths, capacity * sizeof(char *));
+        }
+        shas[count] = strndup(line, 40);
+        paths[count] = lineLen > 41 ? strdup(line + 41) : NULL;
+        count++;
+    }
+    free(line);
+
+    int fd = STDOUT_FILENO;
+    char tmpPath[4096];
+    if (!toStdout) {
+        snprintf(tmpPath, sizeof(tmpPath), "%s-tmp_XXXXXX", baseName);
+        fd = mkstemp(tmpPath);
+        if (fd < 0) {
+            fprintf(stderr, "Error: Could not create %s: %s\n", tmpPath, strerror(errno));
+            return 1;
+        }
+    }
+
+    PackEntry *entries = NULL;
+    uint32_t entryCount = 0;
+    unsigned char packSha[SHA_DIGEST_LENGTH];
+    int result = packObjects(fd, shas, paths, count, &options, &entries, &entryCount, packSha);
+
+    for (uint32_t i = 0; i < count; i++) {
+        free(shas[i]);
+        free(paths[i]);
+    }
+    free(shas);
+    free(paths);
+
+    if (toStdout) {
+        free(entries);
+        return result == 0 ? 0 : 1;
+    }
+
+    close(fd);
+    if (result != 0) {
+        unlink(tmpPath);
+        return 1;
+    }
+
+    char packHex[41];
+    rawToHex(packSha, packHex);
+    char packPath[4096 + 64], idxPath[4096 + 64];
+    snprintf(packPath, sizeof(packPath), "%s-%s.pack", baseName, packHex);
+    snprintf(idxPath, sizeof(idxPath), "%s-%s.idx", baseName, packHex);
+
+    chmod(tmpPath, 0444);
+    if (rename(tmpPath, packPath) != 0) {
+        fprintf(stderr, "Error: Could not move pack into place: %s\n", strerror(errno));
+        unlink(tmpPath);
+        free(entries);
+        return 1;
+    }
+    result = writePackIndex(idxPath, entries, entryCount, packSha);
+    free(entries);
+    if (result != 0) return 1;
+
+    printf("%s\n", packHex);
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Rev-list command flow:
+<rev>... (A..B, ^A)
+    → revisions added to a RevWalk (commits parsed only as far as their header)
+    → commits printed as the walk returns them, newest first (--count: only how many)
+*/
+
+#define REV_LIST_OUTPUT_BUFFER (64 * 1024)
+
+static int parseMaxCount(const char *value, long *out) {
+    char *end;
+    long count = strtol(value, &end, 10);
+    if (*value == '\0' || *end != '\0') {
+        fprintf(stderr, "Error: Invalid commit count '%s'\n", value);
+        return -1;
+    }
+    *out = count < 0 ? -1 : count;
+    return 0;
+}
+
+/**
+ * @brief Parse a history walk option (shared by rev-list and log)
+ *  --max-count=<n>, -n <n>, -n<n>, -<n>, --first-parent
+ *
+ * @param argv: command line arguments
+ * @param i: index of the argument; advanced past a separate value ("-n <n>")
+ * @param options: OUTPUT - updated with the option
+ * @return int: 1 if it was a walk option, 0 if not, -1 if its value is invalid
+ */
+int parseRevWalkOption(int argc, char *argv[], int *i, RevWalkOptions *options) {
+    const char *arg = argv[*i];
+    if (strcmp(arg, "--first-parent") == 0) {
+        options->firstParent = 1;
+        return 1;
+    }
+    const char *value;
+    if (strncmp(arg, "--max-count=", 12) == 0) {
+        value = arg + 12;
+    } else if (strcmp(arg, "-n") == 0) {
+        if (*i + 1 >= argc) {
+            fprintf(stderr, "Error: -n needs a value\n");
+            return -1;
+        }
+        value = argv[++*i];
+    } else if (strncmp(arg, "-n", 2) == 0) {
+        value = arg + 2;
+    } else if (arg[0] == '-' && arg[1] >= '0' && arg[1] <= '9') {
+        value = arg + 1;
+    } else {
+        return 0;
+    }
+    return parseMaxCount(value, &options->maxCount) == 0 ? 1 : -1;
+}
+
+/**
+ * @brief Implements the rev-list command: list commits reachable from some revisions
+ *  rev-list [--max-count=<n>] [--first-parent] [--count] <rev>...
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int revListCmd(int argc, char *argv[]) {
+    static char outputBuffer[REV_LIST_OUTPUT_BUFFER];
+    setvbuf(stdout, outputBuffer, _IOFBF, sizeof(outputBuffer));
+
+    RevWalkOptions options = { 0, -1 };
+    int countOnly = 0, revisionCount = 0;
+    for (int i = 2; i < argc; i++) {
+        int walkOption = parseRevWalkOption(argc, argv, &i, &options);
+        if (walkOption < 0) return 1;
+        if (walkOption > 0) continue;
+        if (strcmp(argv[i], "--count") == 0) {
+            countOnly = 1;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "Error: Unknown option %s\n", argv[i]);
+            return 1;
+        } else {
+            revisionCount++;
+        }
+    }
+    if (revisionCount == 0) {
+        fprintf(stderr, "Usage: rev-list [--max-count=<n>] [--first-parent] [--count] <rev>...\n");
+        return 1;
+    }
+
+    CommitStore *store = createCommitStore();
+    RevWalk *walk = createRevWalk(store, &options);
+    int result = 0;
+    for (int i = 2; i < argc && result == 0; i++) {
+        // Options were checked above; "-n <n>" is the only one taking the next argument
+        if (strcmp(argv[i], "-n") == 0) i++;
+        else if (argv[i][0] != '-') result = revWalkAddArgument(walk, argv[i]);
+    }
+
+    long count = 0;
+    ParsedCommit *commit;
+    int more;
+    while (result == 0 && (more = revWalkNext(walk, &commit)) != 0) {
+        if (more < 0) {
+            result = -1;
+            break;
+        }
+        count++;
+        if (!countOnly) {
+            char hexSha[41];
+            rawToHex(commit->sha, hexSha);
+            printf("%s\n", hexSha);
+        }
+    }
+    if (result == 0 && countOnly) printf("%ld\n", count);
+
+    fflush(stdout);
+    freeRevWalk(walk);
+    freeCommitStore(store);
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,632 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>  // for ntohl/htonl (cache file fields are big-endian)
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "../git/git.h"
+#include "cmd.h"
+
+/*
+Status flow:
+HEAD commit → tree ──┐
+                     ├─ staged (X): merged walk of HEAD's tree and the index; a directory
+.git/index ──────────┤     whose cache-tree SHA equals HEAD's subtree is skipped whole
+                     └─ unstaged (Y): every entry lstat()ed in parallel, only files whose
+                            stat data changed are read and hashed
+working tree ─────────── untracked (??): directory walk; a directory whose mtime still matches
+                            .git/untracked-cache is listed from the cache instead of readdir()
+With the fsmonitor daemon running, only entries under paths it reported are lstat()ed, and
+cached listings of directories it reported nothing in are used without even an lstat().
+→ "XY <path>" lines sorted by path, untracked ones last (the short format of git status)
+
+Untracked cache file:
+"UNTC" | version (2) | time written (sec, nsec) | directory count | fsmonitor token\0 ("" = none)
+per directory: path\0 | mtime sec, nsec | listing size | listing ("d" or "f" + name + \0, ...)
+SHA-1 of everything above
+*/
+
+#define UNTRACKED_CACHE_PATH ".git/untracked-cache"
+#define UNTRACKED_CACHE_SIGNATURE 0x554E5443  // "UNTC"
+
+/**
+ * @brief one line of output
+ * @note staged/unstaged: status letters (' ' = unchanged); untracked entries use '?' for both
+ */
+typedef struct {
+    char *path;
+    char staged;
+    char unstaged;
+} StatusItem;
+
+typedef struct {
+    StatusItem *items;
+    size_t count, capacity;
+} StatusList;
+
+/**
+ * @brief directory listing, cached by directory mtime
+ * @note listing: entries of the form type ('d' or 'f') + name + '\0'
+ */
+typedef struct {
+    char *path;
+    uint32_t mtimeSec, mtimeNsec;
+    char *listing;
+    size_t listingLen;
+} CachedDir;
+
+typedef struct {
+    CachedDir *dirs;
+    size_t count, capacity;
+    struct timespec written;  // when the cache file was written (0 = no cache)
+    char *token;              // fsmonitor token the listings are valid at, NULL if none
+} UntrackedCache;
+
+static void addStatus(StatusList *list, const char *path, size_t pathLen, char staged, char unstaged) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->items = realloc(list->items, list->capacity * sizeof(StatusItem));
+    }
+    list->items[list->count++] = (StatusItem){ strndup(path, pathLen), staged, unstaged };
+}
+
+/**
+ * @brief Order like git: changes to tracked paths first, then untracked ones, each by path
+ */
+static int compareStatusItems(const void *a, const void *b) {
+    const StatusItem *x = a, *y = b;
+    if ((x->staged == '?') != (y->staged == '?')) return x->staged == '?' ? 1 : -1;
+    return strcmp(x->path, y->path);
+}
+
+/**
+ * @brief Report every file of a HEAD subtree as deleted from the index
+ */
+static void addTreeDeletions(StatusList *list, const unsigned char *treeSha, const char *prefix) {
+    size_t size;
+    unsigned char *content = readTreeObject(treeSha, &size);
+    if (!content) return;
+
+    TreeIterator it;
+    treeIteratorInit(&it, content, size);
+    while (treeIteratorNext(&it) > 0) {
+        char path[4096];
+        int len = snprintf(path, sizeof(path), "%s%s", prefix, it.name);
+        if (it.mode == 040000) {
+            strcat(path, "/");
+            addTreeDeletions(list, it.sha, path);
+        } else {
+            addStatus(list, path, len, 'D', ' ');
+        }
+    }
+    free(content);
+}
+
+static const CacheTree* findCacheChild(const CacheTree *tree, const char *name, size_t nameLen) {
+    for (int i = 0; tree && i < tree->childCount; i++) {
+        if (strlen(tree->children[i]->name) == nameLen && memcmp(tree->children[i]->name, name, nameLen) == 0) {
+            return tree->children[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Compare a HEAD (sub)tree with index entries [start, end) under prefix
+ *
+ * @param treeSha: 20-byte tree SHA, NULL for an unborn HEAD
+ * @param cache: cache-tree node for this directory (may be NULL)
+ */
+static void diffTreeWithIndex(StatusList *list, const Index *index, const unsigned char *treeSha,
+                              uint32_t start, uint32_t end, const char *prefix, const CacheTree *cache) {
+    if (treeSha && cache && cache->entryCount >= 0 && (uint32_t)cache->entryCount == end - start &&
+        memcmp(cache->sha, treeSha, 20) == 0) {
+        return;
+    }
+
+    size_t size = 0;
+    unsigned char *content = treeSha ? readTreeObject(treeSha, &size) : NULL;
+    TreeIterator it;
+    treeIteratorInit(&it, content, content ? size : 0);
+    int more = treeIteratorNext(&it);
+
+    size_t prefixLen = strlen(prefix);
+    uint32_t i = start;
+    while (more > 0 || i < end) {
+        // Next index child: a file, or a directory spanning [i, j)
+        const char *name = NULL;
+        size_t nameLen = 0;
+        int indexDir = 0;
+        uint32_t j = i;
+        if (i < end) {
+            name = index->entries[i].path + prefixLen;
+            const char *slash = strchr(name, '/');
+            indexDir = slash != NULL;
+            nameLen = indexDir ? (size_t)(slash - name) : strlen(name);
+            j = i + 1;
+            while (indexDir && j < end && strncmp(index->entries[j].path + prefixLen, name, nameLen + 1) == 0) j++;
+        }
+
+        int cmp;
+        if (more <= 0) cmp = 1;
+        else if (i >= end) cmp = -1;
+        else cmp = compareTreeNames(it.name, it.nameLen, it.mode == 040000, name, nameLen, indexDir);
+
+        if (cmp < 0) {
+            // Only in HEAD: deleted
+            char path[4096];
+            int len = snprintf(path, sizeof(path), "%s%s", prefix, it.name);
+            if (it.mode == 040000) {
+                strcat(path, "/");
+                addTreeDeletions(list, it.sha, path);
+            } else {
+                addStatus(list, path, len, 'D', ' ');
+            }
+            more = treeIteratorNext(&it);
+            continue;
+        }
+
+        if (cmp > 0) {
+            // Only in the index: added
+            for (uint32_t k = i; k < j; k++) {
+                addStatus(list, index->entries[k].path, strlen(index->entries[k].path), 'A', ' ');
+            }
+        } else if (indexDir) {
+            char childPrefix[4096];
+            snprintf(childPrefix, sizeof(childPrefix), "%s%.*s/", prefix, (int)nameLen, name);
+            diffTreeWithIndex(list, index, it.sha, i, j, childPrefix, findCacheChild(cache, name, nameLen));
+        } else if (it.mode != index->entries[i].mode || memcmp(it.sha, index->entries[i].sha, 20) != 0) {
+            addStatus(list, index->entries[i].path, strlen(index->entries[i].path), 'M', ' ');
+        }
+        if (cmp == 0) more = treeIteratorNext(&it);
+        i = j;
+    }
+
+    free(content);
+}
+
+/**
+ * @brief shared state of the parallel working tree check
+ */
+typedef struct {
+    Index *index;
+    unsigned char *state;  // per entry: WORKTREE_*
+} WorktreeJob;
+
+enum { WORKTREE_CLEAN, WORKTREE_STAT, WORKTREE_MODIFIED, WORKTREE_DELETED };
+
+static void checkWorktreeEntry(size_t i, void *arg) {
+    WorktreeJob *job = arg;
+    IndexEntry *entry = &job->index->entries[i];
+    if (entry->fsmonitorValid) {
+        return;
+    }
+
+    struct stat st;
+    if (lstat(entry->path, &st) != 0 || (!S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode))) {
+        job->state[i] = WORKTREE_DELETED;
+        return;
+    }
+    if (indexEntryMatchesStat(job->index, entry, &st)) {
+        entry->fsmonitorValid = job->index->fsmonitorToken != NULL;
+        return;
+    }
+
+    unsigned char sha[20];
+    if (hashWorktreeFile(entry->path, &st, 0, sha) != 0 || memcmp(sha, entry->sha, 20) != 0 ||
+        entry->mode != indexModeFromStat(&st)) {
+        job->state[i] = WORKTREE_MODIFIED;
+        return;
+    }
+
+    // Unchanged content: keep the new stat data so the next run doesn't hash it again
+    fillIndexStat(entry, &st);
+    entry->fsmonitorValid = job->index->fsmonitorToken != NULL;
+    job->state[i] = WORKTREE_STAT;
+}
+
+static uint32_t readBe32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return ntohl(value);
+}
+
+static void putBe32(unsigned char *p, uint32_t value) {
+    value = htonl(value);
+    memcpy(p, &value, 4);
+}
+
+static int compareCachedDirs(const void *a, const void *b) {
+    return strcmp(((const CachedDir *)a)->path, ((const CachedDir *)b)->path);
+}
+
+/**
+ * @brief Load .git/untracked-cache (a missing or damaged file gives an empty cache)
+ */
+static void readUntrackedCache(UntrackedCache *cache) {
+    memset(cache, 0, sizeof(*cache));
+    size_t size;
+    unsigned char *data = readFile(UNTRACKED_CACHE_PATH, &size);
+    if (!data) return;
+
+    unsigned char sha[SHA_DIGEST_LENGTH];
+    if (size < 20 + 20 || (sha1(data, size - 20, sha), memcmp(sha, data + size - 20, 20) != 0) ||
+        readBe32(data) != UNTRACKED_CACHE_SIGNATURE || readBe32(data + 4) != 2) {
+        free(data);
+        return;
+    }
+
+    const unsigned char *end = data + size - 20;
+    const unsigned char *tokenEnd = memchr(data + 20, '\0', end - data - 20);
+    if (!tokenEnd) {
+        free(data);
+        return;
+    }
+    if (tokenEnd > data + 20) cache->token = strdup((const char *)data + 20);
+    const unsigned char *ptr = tokenEnd + 1;
+    uint32_t count = readBe32(data + 16);
+    for (uint32_t i = 0; i < count; i++) {
+        const unsigned char *nul = memchr(ptr, '\0', end - ptr);
+        if (!nul || end - nul - 1 < 12) break;
+        uint32_t listingLen = readBe32(nul + 9);
+        if ((size_t)(end - nul - 13) < listingLen) break;
+
+        if (cache->count == cache->capacity) {
+            cache->capacity = cache->capacity ? cache->capacity * 2 : 64;
+            cache->dirs = realloc(cache->dirs, cache->capacity * sizeof(CachedDir));
+        }
+        CachedDir *dir = &cache->dirs[cache->count++];
+        dir->path = strdup((const char *)ptr);
+        dir->mtimeSec = readBe32(nul + 1);
+        dir->mtimeNsec = readBe32(nul + 5);
+        dir->listingLen = listingLen;
+        dir->listing = malloc(listingLen ? listingLen : 1);
+        memcpy(dir->listing, nul + 13, listingLen);
+        ptr = nul + 13 + listingLen;
+    }
+    cache->written.tv_sec = readBe32(data + 8);
+    cache->written.tv_nsec = readBe32(data + 12);
+    free(data);
+    qsort(cache->dirs, cache->count, sizeof(CachedDir), compareCachedDirs);
+}
+
+/**
+ * @brief Save the listings gathered by this run (via a lock file and rename)
+ */
+static void writeUntrackedCache(const UntrackedCache *cache) {
+    size_t tokenLen = cache->token ? strlen(cache->token) : 0;
+    size_t size = 20 + tokenLen + 1;
+    for (size_t i = 0; i < cache->count; i++) size += strlen(cache->dirs[i].path) + 13 + cache->dirs[i].listingLen;
+    unsigned char *data = malloc(size + 20);
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    putBe32(data, UNTRACKED_CACHE_SIGNATURE);
+    putBe32(data + 4, 2);
+    putBe32(data + 8, (uint32_t)now.tv_sec);
+    putBe32(data + 12, (uint32_t)now.tv_nsec);
+    putBe32(data + 16, (uint32_t)cache->count);
+    memcpy(data + 20, cache->token ? cache->token : "", tokenLen + 1);
+    unsigned char *ptr = data + 20 + tokenLen + 1;
+    for (size_t i = 0; i < cache->count; i++) {
+        const CachedDir *dir = &cache->dirs[i];
+        size_t pathLen = strlen(dir->path) + 1;
+        memcpy(ptr, dir->path, pathLen);
+        ptr += pathLen;
+        putBe32(ptr, dir->mtimeSec);
+        putBe32(ptr + 4, dir->mtimeNsec);
+        putBe32(ptr + 8, (uint32_t)dir->listingLen);
+        memcpy(ptr + 12, dir->listing, dir->listingLen);
+        ptr += 12 + dir->listingLen;
+    }
+    sha1(data, size, data + size);
+
+    char lockPath[] = UNTRACKED_CACHE_PATH ".lock";
+    int fd = open(lockPath, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd >= 0) {
+        int ok = write(fd, data, size + 20) == (ssize_t)(size + 20);
+        if (close(fd) != 0 || !ok || rename(lockPath, UNTRACKED_CACHE_PATH) != 0) unlink(lockPath);
+    }
+    free(data);
+}
+
+static void freeUntrackedCache(UntrackedCache *cache) {
+    for (size_t i = 0; i < cache->count; i++) {
+        free(cache->dirs[i].path);
+        free(cache->dirs[i].listing);
+    }
+    free(cache->dirs);
+    free(cache->token);
+}
+
+/**
+ * @brief untracked file walk state
+ * @note
+ *      old: cache read at start; fresh: listings of every directory visited this run
+ *      monitor: fsmonitor report, or NULL when old's listings can't be checked against it
+ *      changedDirs: parents of the reported paths, sorted
+ */
+typedef struct {
+    const Index *index;
+    UntrackedCache old;
+    UntrackedCache fresh;
+    size_t cacheHits;
+    const FsmonitorChanges *monitor;
+    char **changedDirs;
+    size_t changedDirCount;
+    StatusList *list;
+} UntrackedWalk;
+
+static int compareStrings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Check whether the fsmonitor daemon vouches that a directory's entries didn't change
+ *
+ * @note Nothing may have been reported in it, nor for it or any directory above it
+ *       (a directory moved into place has someone else's cached listing).
+ */
+static int monitorVouchesFor(const UntrackedWalk *walk, const char *path) {
+    if (!walk->monitor || bsearch(&path, walk->changedDirs, walk->changedDirCount, sizeof(char *), compareStrings)) {
+        return 0;
+    }
+    char ancestor[4096];
+    snprintf(ancestor, sizeof(ancestor), "%s", path);
+    for (;;) {
+        if (fsmonitorPathChanged(walk->monitor, ancestor)) return 0;
+        char *slash = strrchr(ancestor, '/');
+        if (!slash) return 1;
+        *slash = '\0';
+    }
+}
+
+/**
+ * @brief List a directory, from the cache if its mtime hasn't moved since the cache was written
+ *
+ * @note When the fsmonitor daemon reported nothing in the directory, the cached listing
+ *       is used without even an lstat().
+ *
+ * @return const CachedDir*: listing (owned by walk->fresh), NULL if the directory can't be read
+ */
+static const CachedDir* listDirectory(UntrackedWalk *walk, const char *path) {
+    CachedDir key = { (char *)path, 0, 0, NULL, 0 };
+    const CachedDir *old = bsearch(&key, walk->old.dirs, walk->old.count, sizeof(CachedDir), compareCachedDirs);
+
+    struct stat st;
+    int trusted;
+    if (old && monitorVouchesFor(walk, path)) {
+        st.st_mtim.tv_sec = old->mtimeSec;
+        st.st_mtim.tv_nsec = old->mtimeNsec;
+        trusted = 1;
+    } else {
+        if (lstat(path[0] ? path : ".", &st) != 0) return NULL;
+        // A directory changed in the same tick the cache was written may have changed again unseen
+        trusted = old && old->mtimeSec == (uint32_t)st.st_mtim.tv_sec && old->mtimeNsec == (uint32_t)st.st_mtim.tv_nsec &&
+                  (st.st_mtim.tv_sec < walk->old.written.tv_sec ||
+                   (st.st_mtim.tv_sec == walk->old.written.tv_sec && st.st_mtim.tv_nsec < walk->old.written.tv_nsec));
+    }
+
+    UntrackedCache *fresh = &walk->fresh;
+    if (fresh->count == fresh->capacity) {
+        fresh->capacity = fresh->capacity ? fresh->capacity * 2 : 64;
+        fresh->dirs = realloc(fresh->dirs, fresh->capacity * sizeof(CachedDir));
+    }
+    CachedDir *dir = &fresh->dirs[fresh->count];
+    dir->path = strdup(path);
+    dir->mtimeSec = (uint32_t)st.st_mtim.tv_sec;
+    dir->mtimeNsec = (uint32_t)st.st_mtim.tv_nsec;
+
+    if (trusted) {
+        dir->listing = malloc(old->listingLen ? old->listingLen : 1);
+        memcpy(dir->listing, old->listing, old->listingLen);
+        dir->listingLen = old->listingLen;
+        walk->cacheHits++;
+        return &fresh->dirs[fresh->count++];
+    }
+
+    DIR *handle = opendir(path[0] ? path : ".");
+    if (!handle) {
+        free(dir->path);
+        return NULL;
+    }
+    size_t capacity = 256, len = 0;
+    char *listing = malloc(capacity);
+    struct dirent *entry;
+    while ((entry = readdir(handle)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0 || strcmp(entry->d_name, ".git") == 0) {
+            continue;
+        }
+
+        int type = entry->d_type;
+        if (type == DT_UNKNOWN) {
+            char child[4096];
+            snprintf(child, sizeof(child), "%s%s%s", path, path[0] ? "/" : "", entry->d_name);
+            struct stat childSt;
+            if (lstat(child, &childSt) != 0) continue;
+            type = S_ISDIR(childSt.st_mode) ? DT_DIR : S_ISREG(childSt.st_mode) ? DT_REG : S_ISLNK(childSt.st_mode) ? DT_LNK : DT_UNKNOWN;
+        }
+        if (type != DT_DIR && type != DT_REG && type != DT_LNK) continue;
+
+        size_t nameLen = strlen(entry->d_name) + 1;
+        while (len + 1 + nameLen > capacity) capacity *= 2;
+        listing = realloc(listing, capacity);
+        listing[len++] = type == DT_DIR ? 'd' : 'f';
+        memcpy(listing + len, entry->d_name, nameLen);
+        len += nameLen;
+    }
+    closedir(handle);
+
+    dir->listing = listing;
+    dir->listingLen = len;
+    return &fresh->dirs[fresh->count++];
+}
+
+/**
+ * @brief Check whether any index entry lives under dir/
+ */
+static int hasTrackedUnder(const Index *index, const char *dir) {
+    char prefix[4096];
+    int len = snprintf(prefix, sizeof(prefix), "%s/", dir);
+    int pos = indexFindPos(index, prefix, 0);
+    uint32_t at = pos >= 0 ? (uint32_t)pos : (uint32_t)(-pos - 1);
+    return at < index->count && strncmp(index->entries[at].path, prefix, len) == 0;
+}
+
+/**
+ * @brief Check whether an untracked directory holds any file at all (git doesn't show empty ones)
+ */
+static int containsFiles(UntrackedWalk *walk, const char *path) {
+    const CachedDir *dir = listDirectory(walk, path);
+    if (!dir) return 0;
+
+    // The listing may move when fresh->dirs grows, so copy it first
+    size_t len = dir->listingLen;
+    char *listing = malloc(len ? len : 1);
+    memcpy(listing, dir->listing, len);
+
+    int found = 0;
+    for (size_t pos = 0; pos < len && !found; pos += strlen(listing + pos) + 1) {
+        if (listing[pos] == 'f') {
+            found = 1;
+        } else {
+            char child[4096];
+            snprintf(child, sizeof(child), "%s/%s", path, listing + pos + 1);
+            found = containsFiles(walk, child);
+        }
+    }
+    free(listing);
+    return found;
+}
+
+/**
+ * @brief Report untracked files under path ("" = top of the working tree)
+ */
+static void findUntracked(UntrackedWalk *walk, const char *path) {
+    const CachedDir *dir = listDirectory(walk, path);
+    if (!dir) return;
+
+    size_t len = dir->listingLen;
+    char *listing = malloc(len ? len : 1);
+    memcpy(listing, dir->listing, len);
+
+    for (size_t pos = 0; pos < len; pos += strlen(listing + pos) + 1) {
+        char child[4096];
+        int childLen = snprintf(child, sizeof(child), "%s%s%s", path, path[0] ? "/" : "", listing + pos + 1);
+
+        if (listing[pos] == 'f') {
+            if (!indexFind(walk->index, child)) addStatus(walk->list, child, childLen, '?', '?');
+        } else if (hasTrackedUnder(walk->index, child)) {
+            findUntracked(walk, child);
+        } else if (containsFiles(walk, child)) {
+            strcat(child, "/");
+            addStatus(walk->list, child, childLen + 1, '?', '?');
+        }
+    }
+    free(listing);
+}
+
+/**
+ * @brief Implements the status command: show staged, unstaged and untracked changes
+ *  status [-s | --short | --porcelain]   (the short format is the only one)
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int statusCmd(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    Index index;
+    if (readIndex(&index) != 0) {
+        return 1;
+    }
+    StatusList list = {0};
+
+    // Staged: HEAD's tree against the index
+    char headSha[41];
+    unsigned char treeRaw[20];
+    int hasHead = resolveHead(headSha) == 0;
+    if (hasHead) {
+        char *treeSha = getTreeFromCommit(headSha);
+        if (!treeSha) {
+            freeIndex(&index);
+            return 1;
+        }
+        hexToRaw(treeSha, treeRaw);
+        free(treeSha);
+    }
+    diffTreeWithIndex(&list, &index, hasHead ? treeRaw : NULL, 0, index.count, "", index.cacheTree);
+
+    // Unstaged: the index against the working tree (only what the fsmonitor daemon reported, if it runs)
+    FsmonitorChanges changes;
+    int monitored = fsmonitorRefresh(&index, &changes) == 0;
+    if (index.count > 0) {
+        WorktreeJob job = { &index, calloc(index.count, 1) };
+        parallelFor(0, index.count, checkWorktreeEntry, &job);
+        for (uint32_t i = 0; i < index.count; i++) {
+            if (job.state[i] == WORKTREE_STAT) index.changed = 1;
+            if (job.state[i] == WORKTREE_MODIFIED || job.state[i] == WORKTREE_DELETED) {
+                addStatus(&list, index.entries[i].path, strlen(index.entries[i].path), ' ',
+                          job.state[i] == WORKTREE_MODIFIED ? 'M' : 'D');
+            }
+        }
+        free(job.state);
+    }
+
+    // Untracked
+    UntrackedWalk walk = { .index = &index, .list = &list };
+    readUntrackedCache(&walk.old);
+    // The cached listings are as of the old token only if both were saved by the same run
+    if (monitored && !changes.everything && walk.old.token && strcmp(walk.old.token, changes.sinceToken) == 0) {
+        walk.monitor = &changes;
+        walk.changedDirs = malloc((changes.count ? changes.count : 1) * sizeof(char *));
+        for (size_t i = 0; i < changes.count; i++) {
+            char *slash = strrchr(changes.paths[i], '/');
+            walk.changedDirs[i] = slash ? strndup(changes.paths[i], slash - changes.paths[i]) : strdup("");
+        }
+        walk.changedDirCount = changes.count;
+        qsort(walk.changedDirs, walk.changedDirCount, sizeof(char *), compareStrings);
+    }
+    if (index.fsmonitorToken) walk.fresh.token = strdup(index.fsmonitorToken);
+    findUntracked(&walk, "");
+    if (walk.cacheHits != walk.fresh.count || walk.fresh.count != walk.old.count ||
+        !walk.old.token != !walk.fresh.token || (walk.old.token && strcmp(walk.old.token, walk.fresh.token) != 0)) {
+        qsort(walk.fresh.dirs, walk.fresh.count, sizeof(CachedDir), compareCachedDirs);
+        writeUntrackedCache(&walk.fresh);
+    }
+    for (size_t i = 0; i < walk.changedDirCount; i++) free(walk.changedDirs[i]);
+    free(walk.changedDirs);
+    freeUntrackedCache(&walk.old);
+    freeUntrackedCache(&walk.fresh);
+    freeFsmonitorChanges(&changes);
+
+    // One line per path, staged and unstaged letters merged
+    qsort(list.items, list.count, sizeof(StatusItem), compareStatusItems);
+    for (size_t i = 0; i < list.count; i++) {
+        StatusItem *item = &list.items[i];
+        while (i + 1 < list.count && compareStatusItems(&list.items[i + 1], item) == 0) {
+            StatusItem *next = &list.items[++i];
+            if (next->staged != ' ') item->staged = next->staged;
+            if (next->unstaged != ' ') item->unstaged = next->unstaged;
+            free(next->path);
+        }
+        printf("%c%c %s\n", item->staged, item->unstaged, item->path);
+        free(item->path);
+    }
+    free(list.items);
+
+    // Refreshed stat data is saved opportunistically, like git does; a held lock just skips it
+    if (index.changed && index.exists && access(INDEX_LOCK_PATH, F_OK) != 0) {
+        writeIndex(&index);
+    }
+    freeIndex(&index);
+    return 0;
+}
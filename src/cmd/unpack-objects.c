@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+
+/**
+ * @brief Implements the unpack-objects command: explode a pack from stdin into loose objects
+ *  unpack-objects < <pack-file>
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int unpackObjects(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    size_t packSize;
+    unsigned char *packData = readStream(stdin, &packSize);
+
+    int result = unpack(packData, packSize, ".git/objects");
+    free(packData);
+
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "cmd.h"
+
+/**
+ * @brief Re-stat every entry; refresh the stat data of files whose content is unchanged
+ *
+ * @return int: 0 if everything is up to date, 1 if some file needs update
+ */
+static int refreshStatData(Index *index) {
+    int stale = 0;
+    for (uint32_t i = 0; i < index->count; i++) {
+        IndexEntry *entry = &index->entries[i];
+        struct stat st;
+        if (lstat(entry->path, &st) != 0) {
+            printf("%s: needs update\n", entry->path);
+            stale = 1;
+            continue;
+        }
+        if (indexEntryMatchesStat(index, entry, &st)) continue;
+
+        unsigned char sha[20];
+        if (entry->mode == indexModeFromStat(&st) && hashWorktreeFile(entry->path, &st, 0, sha) == 0 &&
+            memcmp(sha, entry->sha, 20) == 0) {
+            fillIndexStat(entry, &st);
+            index->changed = 1;
+        } else {
+            printf("%s: needs update\n", entry->path);
+            stale = 1;
+        }
+    }
+    return stale;
+}
+
+/**
+ * @brief Record "<mode>,<sha>,<path>" directly, without touching the working tree
+ */
+static int addCacheInfo(Index *index, const char *mode, const char *hexSha, const char *arg) {
+    IndexEntry entry = {0};
+    char path[4096];
+    entry.mode = (uint32_t)strtoul(mode, NULL, 8);
+    if ((entry.mode != 0100644 && entry.mode != 0100755 && entry.mode != 0120000 && entry.mode != 0160000) ||
+        strlen(hexSha) != 40 || hexToRaw(hexSha, entry.sha) != 0 ||
+        normalizeIndexPath(arg, path, sizeof(path)) != 0 || path[0] == '\0') {
+        fprintf(stderr, "Error: Invalid --cacheinfo %s,%s,%s\n", mode, hexSha, arg);
+        return -1;
+    }
+    entry.path = strdup(path);
+    indexAddEntry(index, &entry);
+    return 0;
+}
+
+/**
+ * @brief Implements the update-index command: low-level index edits
+ *  update-index [--add] [--remove] [--force-remove] [--refresh] [--index-version <n>]
+ *               [--cacheinfo <mode>,<sha>,<path>]... [--] <file>...
+ *
+ * @note Files not yet in the index need --add; files gone from disk need --remove.
+ *
+ * @param argc: Number of command line arguments
+ * @param argv: Command line arguments
+ * @return int: Exit status
+ */
+int updateIndex(int argc, char *argv[]) {
+    Index index;
+    if (readIndex(&index) != 0) {
+        return 1;
+    }
+
+    int allowAdd = 0, allowRemove = 0, forceRemove = 0, onlyPaths = 0;
+    int result = 0;
+    for (int i = 2; i < argc && result == 0; i++) {
+        const char *arg = argv[i];
+        if (!onlyPaths && arg[0] == '-') {
+            if (strcmp(arg, "--") == 0) {
+                onlyPaths = 1;
+            } else if (strcmp(arg, "--add") == 0) {
+                allowAdd = 1;
+            } else if (strcmp(arg, "--remove") == 0) {
+                allowRemove = 1;
+            } else if (strcmp(arg, "--force-remove") == 0) {
+                forceRemove = 1;
+            } else if (strcmp(arg, "--refresh") == 0) {
+                result = refreshStatData(&index) ? 1 : 0;
+            } else if (strcmp(arg, "--index-version") == 0 && i + 1 < argc) {
+                int version = atoi(argv[++i]);
+                if (version < 2 || version > 4) {
+                    fprintf(stderr, "Error: Index version %d is not supported\n", version);
+                    result = -1;
+                }
+                index.version = version;
+                index.changed = 1;
+            } else if (strcmp(arg, "--cacheinfo") == 0 && i + 1 < argc) {
+                char *info = strdup(argv[++i]);
+                char *sha = strchr(info, ',');
+                char *path = sha ? strchr(sha + 1, ',') : NULL;
+                if (path) {
+                    *sha++ = '\0';
+                    *path++ = '\0';
+                    result = addCacheInfo(&index, info, sha, path);
+                } else if (i + 2 < argc) {
+                    result = addCacheInfo(&index, argv[i], argv[i + 1], argv[i + 2]);
+                    i += 2;
+                } else {
+                    fprintf(stderr, "Error: --cacheinfo needs <mode>,<sha>,<path>\n");
+                    result = -1;
+                }
+                free(info);
+            } else {
+                fprintf(stderr, "Error: Unknown option %s\n", arg);
+                result = -1;
+            }
+            continue;
+        }
+
+        char path[4096];
+        if (normalizeIndexPath(arg, path, sizeof(path)) != 0 || path[0] == '\0') {
+            result = -1;
+            break;
+        }
+
+        struct stat st;
+        if (forceRemove || lstat(path, &st) != 0) {
+            if (!forceRemove && !allowRemove) {
+                fprintf(stderr, "Error: %s does not exist and --remove not passed\n", path);
+                result = -1;
+            } else {
+                indexRemovePath(&index, path);
+            }
+        } else if (S_ISDIR(st.st_mode)) {
+            fprintf(stderr, "Error: %s is a directory - add files inside instead\n", path);
+            result = -1;
+        } else if (!indexFind(&index, path) && !allowAdd) {
+            fprintf(stderr, "Error: %s cannot add to the index - missing --add option?\n", path);
+            result = -1;
+        } else {
+            result = indexAddFile(&index, path, &st);
+        }
+    }
+
+    // --refresh reporting stale files still saves the refreshed stat data
+    if (result >= 0 && (index.changed || !index.exists) && writeIndex(&index) != 0) {
+        result = -1;
+    }
+    freeIndex(&index);
+    return result == 0 ? 0 : 1;
+}
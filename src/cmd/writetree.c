@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
 #include <sys/stat.h>
 #include <errno.h>
 #include <zlib.h>
@@ -8,24 +9,164 @@
 #include "../utils/utils.h"
 #include "../storage/object.h"
 
+/*
+Write-tree flow:
+.git/index exists (files were added with add / update-index)
+    → refresh: lstat every entry in parallel (only those under paths the fsmonitor
+      daemon reported, if it runs), rehash only files whose stat data changed, drop
+      files that are gone
+    → trees built from the sorted entries, index saved with the new stat data
+no index: walk the whole directory (work-stealing pool, no blocking waits):
+directory task
+    → readdir, one entry slot per child
+    → queue a blob task per file (read, hash, deflate, write) and a directory task per subdirectory
+    → when the last child has filled its slot (remaining hits 0):
+        sort entries → build tree content → writeObject("tree")
+        → fill the parent's slot, and finish the parent if it was the last one
+The root finishing is the result; entries are sorted in git's tree order, so the SHAs
+do not depend on which thread finished first.
+*/
+
 /**
- * @brief Compare two Entry structs by name for qsort
- * 
- * @param dirname Directory name to write tree from
- * @return char* The SHA-1 hash of the written tree object
+ * @brief directory being written
+ * @note
+ *      remaining: children still to finish, plus one held while the directory is being read
+ *      parentSlot: index of this directory's entry in parent->entries
+ *      failed: set when any descendant could not be written
  */
-char* writeTree(char *dirname) {
-    Entry entries[256];
-    int entrycount = 0;
-    
-    DIR *dir = opendir(dirname);
+typedef struct TreeNode {
+    char *path;
+    struct TreeNode *parent;
+    size_t parentSlot;
+    Entry *entries;
+    size_t count;
+    atomic_size_t remaining;
+    atomic_int failed;
+    WorkPool *pool;
+    char *outHash;  // root only: where the final SHA goes
+} TreeNode;
+
+/**
+ * @brief blob task: one file of a directory
+ */
+typedef struct {
+    TreeNode *node;
+    size_t slot;
+} BlobTask;
+
+static void writeDirectory(void *arg);
+
+/**
+ * @brief Sort entries and build "<mode> <name>\0<20-byte sha>" for each
+ */
+static unsigned char* buildTreeContent(Entry *entries, size_t count, size_t *outSize) {
+    qsort(entries, count, sizeof(Entry), compareEntries);
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++) {
+        size += strlen(entries[i].mode) + 1 + strlen(entries[i].name) + 1 + 20;
+    }
+
+    unsigned char *content = malloc(size ? size : 1);
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t modeLen = strlen(entries[i].mode);
+        memcpy(content + pos, entries[i].mode, modeLen);
+        pos += modeLen;
+        content[pos++] = ' ';
+
+        size_t nameLen = strlen(entries[i].name);
+        memcpy(content + pos, entries[i].name, nameLen + 1); // +1 for null byte
+        pos += nameLen + 1;
+
+        memcpy(content + pos, entries[i].rawsha, 20);
+        pos += 20;
+    }
+
+    *outSize = size;
+    return content;
+}
+
+/**
+ * @brief Drop one outstanding child; the last one writes the tree and moves up to the parent
+ */
+static void childDone(TreeNode *node) {
+    while (node && atomic_fetch_sub(&node->remaining, 1) == 1) {
+        TreeNode *parent = node->parent;
+        char hexSha[41];
+
+        if (!atomic_load(&node->failed)) {
+            size_t treeSize;
+            unsigned char *treeContent = buildTreeContent(node->entries, node->count, &treeSize);
+            if (writeObject("tree", treeContent, treeSize, hexSha) != 0) {
+                atomic_store(&node->failed, 1);
+            }
+            free(treeContent);
+        }
+
+        if (parent) {
+            if (atomic_load(&node->failed)) {
+                atomic_store(&parent->failed, 1);
+            } else {
+                hexToRaw(hexSha, parent->entries[node->parentSlot].rawsha);
+            }
+        } else if (!atomic_load(&node->failed)) {
+            strcpy(node->outHash, hexSha);
+        } else {
+            node->outHash[0] = '\0';
+        }
+
+        free(node->entries);
+        free(node->path);
+        free(node);
+        node = parent;
+    }
+}
+
+static void writeBlobEntry(void *arg) {
+    BlobTask *task = arg;
+    TreeNode *node = task->node;
+    Entry *entry = &node->entries[task->slot];
+
+    char childPath[4096];
+    snprintf(childPath, sizeof(childPath), "%s/%s", node->path, entry->name);
+
+    size_t size;
+    unsigned char *content = readFile(childPath, &size);
+    char hexSha[41];
+    if (!content) {
+        fprintf(stderr, "Error: Could not read %s: %s\n", childPath, strerror(errno));
+        atomic_store(&node->failed, 1);
+    } else if (writeObject("blob", content, size, hexSha) != 0) {
+        atomic_store(&node->failed, 1);
+    } else {
+        hexToRaw(hexSha, entry->rawsha);
+    }
+    free(content);
+    free(task);
+
+    childDone(node);
+}
+
+/**
+ * @brief Directory task: list the directory and queue a task per child
+ */
+static void writeDirectory(void *arg) {
+    TreeNode *node = arg;
+
+    DIR *dir = opendir(node->path);
     if (dir == NULL) {
-        fprintf(stderr, "Error: Could not open directory %s: %s\n", dirname, strerror(errno));
-        return NULL;
+        fprintf(stderr, "Error: Could not open directory %s: %s\n", node->path, strerror(errno));
+        atomic_store(&node->failed, 1);
+        childDone(node);
+        return;
     }
-    struct dirent *entry;
-    // COllect entries, sort them, then build content
 
+    // Collect every entry first so slots stay put while children fill them in
+    size_t capacity = 16;
+    node->entries = malloc(capacity * sizeof(Entry));
+    unsigned char *isDir = malloc(capacity);
+    struct dirent *entry;
     while ((entry = readdir(dir)) != NULL) {
         // Skip . and .. and .git
         if (strcmp(entry->d_name, ".") == 0 ||
@@ -33,83 +174,107 @@ char* writeTree(char *dirname) {
             strcmp(entry->d_name, ".git") == 0) {
             continue;
         }
-
-        // process file or direcotry 
-        char childPath[256];
-        snprintf(childPath, sizeof(childPath), "%s/%s", dirname, entry->d_name);
-
-        char hexSha[41];
-        char rawSha[20];
-        const char *mode;
-
-        // store in entries[entryCount++]
-        if (entry->d_type == DT_REG) {
-            mode = "100644";
-            // read file content, call writeObject("blob", ...), get hexSha
-            FILE *file = fopen(childPath, "rb");
-
-            fseek(file, 0, SEEK_END);
-            long filesize = ftell(file);
-            fseek(file, 0, SEEK_SET);
-
-            char *content = malloc(filesize);
-            fread(content, 1, filesize, file);
-            fclose(file);
-
-            writeObject("blob", (unsigned char *)content, filesize, hexSha); 
-            free(content);
-        } else if (entry->d_type == DT_DIR) {
-            mode = "40000";
-            // recursive call to writeTree(childPath), get hexSha
-            char *sha = writeTree(childPath);
-            strcpy(hexSha, sha);
+        if (entry->d_type != DT_REG && entry->d_type != DT_DIR) {
+            continue;
         }
 
-        // Add entry to tree content
-        // Copy mode space name and null byte
-        // Convert hexSha to 20 raw bytes and append
-        hexToRaw(hexSha, (unsigned char *)rawSha);
-        strcpy(entries[entrycount].mode, mode);
-        strcpy(entries[entrycount].name, entry->d_name);
-        memcpy(entries[entrycount].rawsha, rawSha, 20);
-        entrycount++;
+        if (node->count == capacity) {
+            capacity *= 2;
+            node->entries = realloc(node->entries, capacity * sizeof(Entry));
+            isDir = realloc(isDir, capacity);
+        }
+        Entry *slot = &node->entries[node->count];
+        strcpy(slot->mode, entry->d_type == DT_DIR ? "40000" : "100644");
+        snprintf(slot->name, sizeof(slot->name), "%s", entry->d_name);
+        isDir[node->count] = entry->d_type == DT_DIR;
+        node->count++;
     }
     closedir(dir);
 
-    // Sort entries alphabetically by name
-    qsort(entries, entrycount, sizeof(Entry), compareEntries);
+    atomic_fetch_add(&node->remaining, node->count);
+    for (size_t i = 0; i < node->count; i++) {
+        if (isDir[i]) {
+            TreeNode *child = calloc(1, sizeof(TreeNode));
+            size_t pathLen = strlen(node->path) + 1 + strlen(node->entries[i].name) + 1;
+            child->path = malloc(pathLen);
+            snprintf(child->path, pathLen, "%s/%s", node->path, node->entries[i].name);
+            child->parent = node;
+            child->parentSlot = i;
+            child->pool = node->pool;
+            atomic_init(&child->remaining, 1);
+            atomic_init(&child->failed, 0);
+            workPoolSubmit(node->pool, writeDirectory, child);
+        } else {
+            BlobTask *task = malloc(sizeof(BlobTask));
+            task->node = node;
+            task->slot = i;
+            workPoolSubmit(node->pool, writeBlobEntry, task);
+        }
+    }
+    free(isDir);
 
-    // Build tree content from sorted entries
-    unsigned char *treeContent = malloc(1024 * 1024); // 1MB buffer
-    size_t treeSize = 0;
+    // Release the hold taken while listing
+    childDone(node);
+}
 
-    // Iterate entries with readdir
-    for (int i = 0; i < entrycount; i++) {
-        // append: mode + " " + name + "\0" + rawSha (20 bytes)
-        int modeLen = strlen(entries[i].mode);
-        memcpy(treeContent + treeSize, entries[i].mode, modeLen);
-        treeSize += modeLen;
+/**
+ * @brief Write the tree of the index after bringing it up to date with the working tree
+ *
+ * @return int: 0 on success, -1 on error
+ */
+static int writeTreeWithIndex(char *outHash) {
+    Index index;
+    if (readIndex(&index) != 0) {
+        return -1;
+    }
 
-        // append space 
-        treeContent[treeSize++] = ' ';
+    fsmonitorRefresh(&index, NULL);
+    int result = refreshIndex(&index, 0) < 0 ? -1 : 0;
+    if (result == 0) result = writeTreeFromIndex(&index, outHash);
+    if (result == 0 && index.changed) result = writeIndex(&index);
+    freeIndex(&index);
+    return result;
+}
 
-        // append name and null byte
-        int nameLen = strlen(entries[i].name);
-        memcpy(treeContent + treeSize, entries[i].name, nameLen + 1); // +1 for null byte
-        treeSize += nameLen + 1;
+/**
+ * @brief write a tree object for a directory, recursively
+ *
+ * @note With an index, it lists the files (see the flow above). Without one, files
+ *       and subdirectories are hashed, compressed and written on a pool with one
+ *       thread per online CPU.
+ *
+ * @param dirname Directory name to write tree from
+ * @return char* The SHA-1 hash of the written tree object (caller must free), NULL on error
+ */
+char* writeTree(char *dirname) {
+    char *outHash = malloc(41); // 40 chars + null terminator
+    outHash[0] = '\0';
 
-        // append rawSha (20 bytes)
-        memcpy(treeContent + treeSize, entries[i].rawsha, 20);
-        treeSize += 20;
+    // The index is a stat cache: only files that changed since it was written are read
+    struct stat st;
+    if (strcmp(dirname, ".") == 0 && stat(INDEX_PATH, &st) == 0) {
+        if (writeTreeWithIndex(outHash) != 0) {
+            free(outHash);
+            return NULL;
+        }
+        return outHash;
     }
-    // Build tree content from entries
-    // Create tree object "tree <size>\0<content>"
-    // Compute sha, compress, write to .git/objects
-    // return sha (for parent to use)
-    char *outHash = malloc(41); // 40 chars + null terminator
-    writeObject("tree", treeContent, treeSize, outHash);
-    free(treeContent);
 
+    TreeNode *root = calloc(1, sizeof(TreeNode));
+    root->path = strdup(dirname);
+    root->outHash = outHash;
+    root->pool = workPoolCreate(0);
+    atomic_init(&root->remaining, 1);
+    atomic_init(&root->failed, 0);
+
+    WorkPool *pool = root->pool;
+    workPoolSubmit(pool, writeDirectory, root);
+    workPoolWait(pool);
+    workPoolDestroy(pool);
+
+    if (outHash[0] == '\0') {
+        free(outHash);
+        return NULL;
+    }
     return outHash;
 }
-
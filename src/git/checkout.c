@@ -1,19 +1,41 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
 #include <sys/stat.h>
 #include <zlib.h>
 #include "../utils/utils.h"
 #include "../storage/object.h"
+#include "git.h"
 
 /*
 Checkout flow:
 headSha (commit)
     → parse commit, extract tree SHA
-        → read tree object
-            → for each entry:
-                - if blob: read blob, write file
-                - if tree: mkdir, recurse
+    → phase 1, one thread: walk the trees, listing every directory (parents first)
+      and every file as (path, mode, blob SHA); then mkdir the directories
+    → phase 2, a pool of workers: each takes the next file, streams its blob into
+      the file (symlink for mode 120000) and lstat()s the result
+    → every file written gets an index entry (tree SHA + fresh lstat data)
+    → .git/index written, so status and write-tree start from a clean stat cache
+Directories all exist before phase 2 starts, so workers never race on mkdir; they
+spend most of their time blocked in open/write/close, which is why there are
+several per CPU.
+
+Switching from one commit to another (checkoutIncremental):
+old tree vs new tree, walked side by side in tree order
+    → equal SHAs: skipped, subtrees included, without being read
+    → only in old: tracked files (then their directories) go on the removal list
+    → only in new: listed as in phase 1
+    → in both with a different SHA: files rewritten (removed first if the mode
+      changed), directories compared recursively
+    → nothing is touched if a path to change has local changes, an untracked
+      file is in the way of a new one, or a directory that becomes a file (or a
+      file that becomes a directory) holds something not on the removal list
+    → removals, then mkdir, then phase 2 for the new and changed files only
 
 Commit object format (text):
 tree <tree_sha>
@@ -22,11 +44,29 @@ author ...
 committer ...
 */
 
-// Forward declaration
-static void checkoutTree(const char *treeSha, const char *basePath);
+#define CHECKOUT_WORKERS_PER_CPU 4
 
 /**
- * @brief Read object from .git/objects and return decompressed content
+ * @brief file or directory to write (or remove)
+ * @note
+ *      mode: 040000 for a directory, 0160000 for a submodule (an empty directory)
+ *      st/written: filled in by the worker that wrote the file
+ */
+typedef struct {
+    char *path;
+    uint32_t mode;
+    unsigned char sha[20];
+    struct stat st;
+    int written;
+} CheckoutEntry;
+
+typedef struct {
+    CheckoutEntry *entries;
+    size_t count, capacity;
+} CheckoutList;
+
+/**
+ * @brief Read object from the object database and return its content
  * 
  * @param hexSha: 40-char hex SHA
  * @param outSize: size of decompressed content
@@ -34,62 +74,19 @@ static void checkoutTree(const char *treeSha, const char *basePath);
  * @return unsigned* decompressed content (caller must free)
  */
 static unsigned char* readObject(const char *hexSha, size_t *outSize, char *outType) {
-    char path[256];
-    snprintf(path, sizeof(path), ".git/objects/%.2s/%s", hexSha, hexSha + 2);
-
-    FILE *file = fopen(path, "rb");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open object file %s\n", path);
-        return NULL;
-    }
-
-    fseek(file, 0, SEEK_END);
-    long filesize = ftell(file);
-    fseek(file, 0, SEEK_SET);
-
-    unsigned char *compressed = malloc(filesize);
-    fread(compressed, 1, filesize, file);
-    fclose(file);
+    ObjectType type;
+    unsigned char *content;
 
-    // Decompress 
-    unsigned long decompSize = filesize * 20; // estimate
-    unsigned char *decompressed = malloc(decompSize);
-
-    if (uncompress(decompressed, &decompSize, compressed, filesize) != Z_OK) {
-        fprintf(stderr, "Error: Failed to decompress object %s\n", hexSha);
-        free(compressed);
-        free(decompressed);
-        return NULL;
-    }
-    free(compressed);
-
-    // Parse header: "<type> <size>\0content"
-    char *header = (char *)decompressed;
-    char *space = strchr(header, ' ');
-    char *nullByte = memchr(header, '\0', decompSize);
-
-    if (!space || !nullByte) {
-        fprintf(stderr, "Error: Invalid object format for %s\n", hexSha);
-        free(decompressed);
+    if (odbReadObject(hexSha, &type, &content, outSize) != 0) {
+        fprintf(stderr, "Error: Could not read object %s\n", hexSha);
         return NULL;
     }
 
     // Copy type
     if (outType) {
-        int typeLen = space - header;
-        strncpy(outType, header, typeLen);
-        outType[typeLen] = '\0';
+        strcpy(outType, objectTypeName(type));
     }
 
-    // Get content size
-    *outSize = atol(space + 1);
-
-    // Return content (after null byte)
-    size_t headerLen = (nullByte - header) + 1;
-    unsigned char *content = malloc(*outSize);
-    memcpy(content, decompressed + headerLen, *outSize);
-
-    free(decompressed);
     return content;
 }
 
@@ -99,7 +96,7 @@ static unsigned char* readObject(const char *hexSha, size_t *outSize, char *outT
  * @param commitSha: commit SHA
  * @return char* tree SHA (caller must free)
  */
-static char* getTreeFromCommit(const char *commitSha) {
+char* getTreeFromCommit(const char *commitSha) {
     size_t size;
     char type[16];
     unsigned char *content = readObject(commitSha, &size, type);
@@ -126,119 +123,510 @@ static char* getTreeFromCommit(const char *commitSha) {
     return treeSha;
 }
 
+static int requireBlob(ObjectType type, size_t size, void *arg) {
+    (void)size;
+    (void)arg;
+    return type == OBJ_BLOB ? 0 : -1;
+}
+
 /**
  * @brief write a blob to a file
- * 
- * @param blobSha 
- * @param filePath 
+ *
+ * @param blobSha: 40-char hex SHA
+ * @param filePath: file to create (replaced if it exists)
+ * @param mode: tree entry mode (0100755 executable, 0120000 symlink)
+ * @return int: 0 on success, -1 on error
  */
-static void writeBlob(const char *blobSha, const char *filePath) {
-    size_t size;
-    char type[16];
-    unsigned char *content = readObject(blobSha, &size, type);
+static int writeBlob(const char *blobSha, const char *filePath, uint32_t mode) {
+    if (mode == 0120000) {
+        size_t size;
+        char type[16];
+        unsigned char *target = readObject(blobSha, &size, type);
+        if (!target) return -1;
+        char *link = strndup((char *)target, size);
+        unlink(filePath);
+        int result = symlink(link, filePath);
+        if (result != 0) {
+            fprintf(stderr, "Error: Could not create symlink %s\n", filePath);
+        }
+        free(link);
+        free(target);
+        return result == 0 ? 0 : -1;
+    }
+
+    int fd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC, mode == 0100755 ? 0755 : 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not open file %s for writing\n", filePath);
+        return -1;
+    }
 
-    if (!content) {
+    // Streamed in fixed chunks, so large blobs never sit in memory whole
+    ObjectSink sink = { requireBlob, fdSinkWrite, (void *)(intptr_t)fd };
+    int result = odbStreamObject(blobSha, &sink);
+    if (result != 0) {
         fprintf(stderr, "Error: Could not read blob %s\n", blobSha);
-        free(content);
-        return;
     }
+    if (close(fd) != 0) result = -1;
+    return result == 0 ? 0 : -1;
+}
 
-    FILE *file = fopen(filePath, "wb");
-    if (!file) {
-        fprintf(stderr, "Error: Could not open file %s for writing\n", filePath);
-        free(content);
-        return;
+/**
+ * @brief Add an entry to a checkout list
+ */
+static CheckoutEntry* addCheckoutEntry(CheckoutList *list, const char *path, uint32_t mode, const unsigned char *sha) {
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 256;
+        list->entries = realloc(list->entries, list->capacity * sizeof(CheckoutEntry));
     }
+    CheckoutEntry *entry = &list->entries[list->count++];
+    memset(entry, 0, sizeof(*entry));
+    entry->path = strdup(path);
+    entry->mode = mode;
+    memcpy(entry->sha, sha, 20);
+    return entry;
+}
 
-    fwrite(content, 1, size, file);
-    fclose(file);
-    free(content);
+static void freeCheckoutList(CheckoutList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->entries[i].path);
+    }
+    free(list->entries);
+    memset(list, 0, sizeof(*list));
+}
+
+static int isDirectoryMode(uint32_t mode) {
+    return mode == 040000 || mode == 0160000;
+}
+
+static void joinPath(char *out, size_t outSize, const char *basePath, const char *name) {
+    if (strlen(basePath) > 0) {
+        snprintf(out, outSize, "%s/%s", basePath, name);
+    } else {
+        snprintf(out, outSize, "%s", name);
+    }
 }
 
 /**
- * @brief checkout a tree recursively
- * 
- * @param treeSha 
- * @param basePath 
+ * @brief Phase 1: list the directories and files of a tree, recursively
+ *
+ * @param treeSha: 20-byte tree SHA
+ * @param basePath: directory the tree goes into
+ * @param list: OUTPUT - directories and files, appended in tree order (a directory before its contents)
+ * @return int: 0 on success, -1 if a tree could not be read
  */
-static void checkoutTree(const char *treeSha, const char *basePath) {
+static int collectTree(const unsigned char *treeSha, const char *basePath, CheckoutList *list) {
     size_t size;
-    char type[16];
-    unsigned char *content = readObject(treeSha, &size, type);
-
-    if (!content || strcmp(type, "tree") != 0) {
-        fprintf(stderr, "Error: %s is not a tree\n", treeSha);
-        free(content);
-        return;
-    } 
-
-    // Prase tree entries
-    // Format: "<mode> <name>\0<20-byte-sha>"
-    unsigned char *ptr = content;
-    unsigned char *end = content + size;
-
-    while (ptr < end) {
-        // Read mode
-        char *mode = (char *)ptr;
-        while (*ptr != ' ') ptr++;
-        *ptr++ = '\0'; // null-terminate mode AND advance past it
-
-        // Read name (now ptr points to start of name)
-        char *name = (char *)ptr;
-        while (*ptr != '\0') ptr++;
-        ptr++; // skip null byte
-
-        // Read SHA (20 bytes)
-        unsigned char rawSha[20];
-        memcpy(rawSha, ptr, 20);
-        ptr += 20;
-
-        // Convert to hex
-        char hexSha[41];
-        rawToHex(rawSha, hexSha);
-        
-        // Build full path
-        char fullPath[512];
-        if (strlen(basePath) > 0) {
-            snprintf(fullPath, sizeof(fullPath), "%s/%s", basePath, name);
-        } else {
-            snprintf(fullPath, sizeof(fullPath), "%s", name);
+    unsigned char *content = readTreeObject(treeSha, &size);
+    if (!content) return -1;
+
+    TreeIterator it;
+    treeIteratorInit(&it, content, size);
+    int result = 0, more;
+    while (result == 0 && (more = treeIteratorNext(&it)) > 0) {
+        char fullPath[4096];
+        joinPath(fullPath, sizeof(fullPath), basePath, it.name);
+        addCheckoutEntry(list, fullPath, it.mode, it.sha);
+        if (it.mode == 040000) {
+            result = collectTree(it.sha, fullPath, list);
         }
+    }
 
-        // Check if directory (mode starts with '4') or file
-        if (mode[0] == '4') {
-            // Directory - create and recurse
-            mkdir(fullPath, 0755);
-            checkoutTree(hexSha, fullPath);
-        } else {
-            // File - write blob
-            writeBlob(hexSha, fullPath);
+    free(content);
+    return result == 0 && more == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Phase 2 worker: write one file and record its stat data
+ */
+static void checkoutEntry(size_t i, void *arg) {
+    CheckoutEntry *entry = &((CheckoutList *)arg)->entries[i];
+    if (isDirectoryMode(entry->mode)) return;
+
+    char hexSha[41];
+    rawToHex(entry->sha, hexSha);
+    entry->written = writeBlob(hexSha, entry->path, entry->mode) == 0 && lstat(entry->path, &entry->st) == 0;
+}
+
+/**
+ * @brief Create the listed directories, then write the listed files on a pool of workers
+ *
+ * @param list: directories (parents first) and files
+ * @param index: index to record the files in (NULL = none)
+ * @return int: 0 on success, -1 if anything could not be written
+ */
+static int writeCheckoutList(CheckoutList *list, Index *index) {
+    for (size_t i = 0; i < list->count; i++) {
+        if (isDirectoryMode(list->entries[i].mode)) mkdir(list->entries[i].path, 0755);
+    }
+    parallelFor(onlineCpus() * CHECKOUT_WORKERS_PER_CPU, list->count, checkoutEntry, list);
+
+    int result = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        CheckoutEntry *file = &list->entries[i];
+        if (isDirectoryMode(file->mode)) continue;
+        if (!file->written) {
+            result = -1;
+        } else if (index) {
+            IndexEntry entry = {0};
+            fillIndexStat(&entry, &file->st);
+            entry.mode = file->mode;
+            memcpy(entry.sha, file->sha, 20);
+            entry.path = strdup(strncmp(file->path, "./", 2) == 0 ? file->path + 2 : file->path);
+            indexAddEntry(index, &entry);
         }
     }
-    
-    free(content);
+    return result;
+}
+
+/**
+ * @brief checkout a tree: directories first, then every file on a pool of workers
+ *
+ * @param treeSha: 40-char hex SHA
+ * @param basePath: directory to check out into
+ * @param index: index to record the files in (NULL = none)
+ * @return int: 0 on success, -1 if anything could not be written
+ */
+static int checkoutTree(const char *treeSha, const char *basePath, Index *index) {
+    unsigned char rawSha[20];
+    hexToRaw(treeSha, rawSha);
+    CheckoutList list = {0};
+    int result = collectTree(rawSha, basePath, &list);
+    if (result == 0) {
+        result = writeCheckoutList(&list, index);
+    }
+    freeCheckoutList(&list);
+    return result;
 }
 
 /**
  * @brief checkout a commit into a directory
- * 
- * @param directory 
- * @param headSha 
+ *
+ * @note The index is only written when every file was checked out, so it never
+ *       describes a commit HEAD does not point at.
+ *
+ * @param directory: directory to check out into ("." = the repository's working tree)
+ * @param headSha: 40-char hex SHA of the commit
+ * @return int: 0 on success, -1 if the tree could not be read or a file could not be written
  */
-void checkout(char *directory, char *headSha) {
+int checkout(const char *directory, const char *headSha) {
     printf("Checking out commit %s into directory %s\n", headSha, directory);
 
     // Get tree SHA from commit
     char *treeSha = getTreeFromCommit(headSha);
     if (!treeSha) {
         fprintf(stderr, "Error: Could not get tree from commit %s\n", headSha);
-        return;
+        return -1;
     }
     printf("Tree SHA: %s\n", treeSha);
 
-    // Recursively checkout tree
-    checkoutTree(treeSha, directory);
+    // Recursively checkout tree; the index only describes the repository's own working tree
+    Index index;
+    int withIndex = strcmp(directory, ".") == 0 && readIndex(&index) == 0;
+    int result = checkoutTree(treeSha, directory, withIndex ? &index : NULL);
+    if (result != 0) {
+        fprintf(stderr, "Error: Some files could not be checked out\n");
+    }
+    if (withIndex) {
+        if (result == 0 && writeIndex(&index) != 0) result = -1;
+        freeIndex(&index);
+    }
 
     free(treeSha);
-    printf("Checkout complete.\n");
-}
\ No newline at end of file
+    if (result == 0) printf("Checkout complete.\n");
+    return result;
+}
+
+/**
+ * @brief what switching commits will do
+ * @note
+ *      removals: tracked files to delete, each directory after its contents
+ *      writes: directories to create (parents first) and files to write
+ *      replaced: new entries whose path holds a directory where a file goes, or the
+                other way round; checked once every removal is planned
+      conflicts: paths whose local state would be lost
+ */
+typedef struct {
+    const Index *index;
+    CheckoutList removals;
+    CheckoutList writes;
+    CheckoutList replaced;
+    int conflicts;
+} CheckoutPlan;
+
+/**
+ * @brief Check that a tracked file still matches the commit being left (index and working tree)
+ */
+static void checkUnchanged(CheckoutPlan *plan, const char *path, uint32_t mode, const unsigned char *sha) {
+    if (mode == 0160000) return;  // submodules are not tracked in the index
+
+    const IndexEntry *entry = indexFind(plan->index, path);
+    int clean = entry && entry->mode == mode && memcmp(entry->sha, sha, 20) == 0;
+
+    struct stat st;
+    if (clean && lstat(path, &st) == 0 && !indexEntryMatchesStat(plan->index, entry, &st)) {
+        unsigned char worktreeSha[20];
+        clean = indexModeFromStat(&st) == mode && hashWorktreeFile(path, &st, 0, worktreeSha) == 0 &&
+                memcmp(worktreeSha, sha, 20) == 0;
+    }
+    if (!clean) {
+        fprintf(stderr, "Error: Your local changes to %s would be overwritten\n", path);
+        plan->conflicts++;
+    }
+}
+
+/**
+ * @brief Check that nothing untracked sits where a new file goes (unless it already has the new content)
+ * @note A directory where a file goes (or a file where a directory goes) is only
+ *       noted in plan->replaced: whether it is tracked is known once the old tree's
+ *       removals are planned, which for "d" vs "d/" happens after the new entry.
+ */
+static void checkNotInTheWay(CheckoutPlan *plan, const CheckoutEntry *file) {
+    struct stat st;
+    if (lstat(file->path, &st) != 0) return;
+    if (!isDirectoryMode(file->mode) != !S_ISDIR(st.st_mode)) {
+        addCheckoutEntry(&plan->replaced, file->path, file->mode, file->sha);
+        return;
+    }
+    if (isDirectoryMode(file->mode)) return;
+
+    unsigned char worktreeSha[20];
+    if (indexModeFromStat(&st) == file->mode && hashWorktreeFile(file->path, &st, 0, worktreeSha) == 0 &&
+        memcmp(worktreeSha, file->sha, 20) == 0) {
+        return;
+    }
+    fprintf(stderr, "Error: Untracked file %s would be overwritten\n", file->path);
+    plan->conflicts++;
+}
+
+/**
+ * @brief Plan the removal of every tracked file of an old subtree
+ */
+static int planTreeRemoval(CheckoutPlan *plan, const unsigned char *treeSha, const char *basePath) {
+    size_t size;
+    unsigned char *content = readTreeObject(treeSha, &size);
+    if (!content) return -1;
+
+    TreeIterator it;
+    treeIteratorInit(&it, content, size);
+    int result = 0, more;
+    while (result == 0 && (more = treeIteratorNext(&it)) > 0) {
+        char fullPath[4096];
+        joinPath(fullPath, sizeof(fullPath), basePath, it.name);
+        if (it.mode == 040000) {
+            result = planTreeRemoval(plan, it.sha, fullPath);
+        } else {
+            checkUnchanged(plan, fullPath, it.mode, it.sha);
+        }
+        addCheckoutEntry(&plan->removals, fullPath, it.mode, it.sha);
+    }
+
+    free(content);
+    return result == 0 && more == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Plan the addition of a new file or subtree
+ */
+static int planAddition(CheckoutPlan *plan, const TreeIterator *item, const char *fullPath) {
+    size_t first = plan->writes.count;
+    addCheckoutEntry(&plan->writes, fullPath, item->mode, item->sha);
+    if (item->mode == 040000 && collectTree(item->sha, fullPath, &plan->writes) != 0) {
+        return -1;
+    }
+    for (size_t i = first; i < plan->writes.count; i++) {
+        checkNotInTheWay(plan, &plan->writes.entries[i]);
+    }
+    return 0;
+}
+
+static int comparePaths(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+/**
+ * @brief Check that everything under a directory about to be replaced is on the removal list
+ *
+ * @param plan: plan to count conflicts in
+ * @param removed: paths on the removal list, sorted
+ * @param count: number of removed paths
+ * @param dirPath: directory to scan
+ */
+static void checkAllRemoved(CheckoutPlan *plan, const char **removed, size_t count, const char *dirPath) {
+    DIR *dir = opendir(dirPath);
+    if (!dir) {
+        fprintf(stderr, "Error: Could not read directory %s\n", dirPath);
+        plan->conflicts++;
+        return;
+    }
+
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) continue;
+        char fullPath[4096];
+        joinPath(fullPath, sizeof(fullPath), dirPath, de->d_name);
+        const char *key = fullPath;
+        if (!bsearch(&key, removed, count, sizeof(*removed), comparePaths)) {
+            fprintf(stderr, "Error: Untracked working tree file %s would be removed\n", fullPath);
+            plan->conflicts++;
+            continue;
+        }
+        struct stat st;
+        if (lstat(fullPath, &st) == 0 && S_ISDIR(st.st_mode)) {
+            checkAllRemoved(plan, removed, count, fullPath);
+        }
+    }
+    closedir(dir);
+}
+
+/**
+ * @brief Check the paths where a directory is replaced by a file, or a file by a directory
+ *
+ * @note The old entry at such a path must be tracked and planned for removal, and a
+ *       directory must hold nothing else; otherwise the switch would stop halfway
+ *       (or, for a directory, lose untracked files), so it is a conflict.
+ */
+static void checkReplacedPaths(CheckoutPlan *plan) {
+    if (plan->replaced.count == 0) return;
+
+    const char **removed = malloc((plan->removals.count + 1) * sizeof(*removed));
+    for (size_t i = 0; i < plan->removals.count; i++) {
+        removed[i] = plan->removals.entries[i].path;
+    }
+    qsort(removed, plan->removals.count, sizeof(*removed), comparePaths);
+
+    for (size_t i = 0; i < plan->replaced.count; i++) {
+        const char *path = plan->replaced.entries[i].path;
+        if (!bsearch(&path, removed, plan->removals.count, sizeof(*removed), comparePaths)) {
+            fprintf(stderr, "Error: Untracked file %s would be overwritten\n", path);
+            plan->conflicts++;
+        } else if (!isDirectoryMode(plan->replaced.entries[i].mode)) {
+            checkAllRemoved(plan, removed, plan->removals.count, path);
+        }
+    }
+    free(removed);
+}
+
+/**
+ * @brief Walk an old and a new tree side by side and plan the differences
+ *
+ * @return int: 0 on success, -1 if a tree could not be read
+ */
+static int planTreeSwitch(CheckoutPlan *plan, const unsigned char *oldSha, const unsigned char *newSha, const char *basePath) {
+    size_t oldSize, newSize;
+    unsigned char *oldContent = readTreeObject(oldSha, &oldSize);
+    unsigned char *newContent = oldContent ? readTreeObject(newSha, &newSize) : NULL;
+    if (!newContent) {
+        free(oldContent);
+        return -1;
+    }
+
+    TreeIterator oldIt, newIt;
+    treeIteratorInit(&oldIt, oldContent, oldSize);
+    treeIteratorInit(&newIt, newContent, newSize);
+    int oldMore = treeIteratorNext(&oldIt), newMore = treeIteratorNext(&newIt);
+    int result = 0;
+    while ((oldMore > 0 || newMore > 0) && oldMore >= 0 && newMore >= 0 && result == 0) {
+        int cmp;
+        if (!oldMore) cmp = 1;
+        else if (!newMore) cmp = -1;
+        else cmp = compareTreeNames(oldIt.name, oldIt.nameLen, oldIt.mode == 040000,
+                                    newIt.name, newIt.nameLen, newIt.mode == 040000);
+
+        const TreeIterator *oldItem = cmp <= 0 ? &oldIt : NULL;
+        const TreeIterator *newItem = cmp >= 0 ? &newIt : NULL;
+        char fullPath[4096];
+        joinPath(fullPath, sizeof(fullPath), basePath, (oldItem ? oldItem : newItem)->name);
+
+        if (oldItem && newItem && memcmp(oldItem->sha, newItem->sha, 20) == 0 && oldItem->mode == newItem->mode) {
+            // Unchanged file or subtree
+        } else if (oldItem && newItem && oldItem->mode == 040000) {
+            result = planTreeSwitch(plan, oldItem->sha, newItem->sha, fullPath);
+        } else if (oldItem && newItem && oldItem->mode == newItem->mode) {
+            checkUnchanged(plan, fullPath, oldItem->mode, oldItem->sha);
+            addCheckoutEntry(&plan->writes, fullPath, newItem->mode, newItem->sha);
+        } else if (oldItem && newItem) {
+            // Same file, new mode (executable bit, file <-> symlink): replace it
+            checkUnchanged(plan, fullPath, oldItem->mode, oldItem->sha);
+            addCheckoutEntry(&plan->removals, fullPath, oldItem->mode, oldItem->sha);
+            addCheckoutEntry(&plan->writes, fullPath, newItem->mode, newItem->sha);
+        } else if (oldItem && oldItem->mode == 040000) {
+            result = planTreeRemoval(plan, oldItem->sha, fullPath);
+            addCheckoutEntry(&plan->removals, fullPath, oldItem->mode, oldItem->sha);
+        } else if (oldItem) {
+            checkUnchanged(plan, fullPath, oldItem->mode, oldItem->sha);
+            addCheckoutEntry(&plan->removals, fullPath, oldItem->mode, oldItem->sha);
+        } else {
+            result = planAddition(plan, newItem, fullPath);
+        }
+
+        if (oldItem) oldMore = treeIteratorNext(&oldIt);
+        if (newItem) newMore = treeIteratorNext(&newIt);
+    }
+
+    free(oldContent);
+    free(newContent);
+    return result == 0 && oldMore == 0 && newMore == 0 ? 0 : -1;
+}
+
+/**
+ * @brief Switch the working tree and index from one commit to another
+ *
+ * @note Only paths that differ between the two trees are touched; subtrees with
+ *       equal SHAs are skipped without being read. Nothing changes if a path to be
+ *       changed has local modifications, or an untracked file is in the way.
+ *       Untracked files in removed directories are left where they are, unless a
+ *       file takes the directory's place; then they are a conflict.
+ *
+ * @param fromCommit: 40-char hex SHA of the commit checked out now
+ * @param toCommit: 40-char hex SHA of the commit to check out
+ * @return int: 0 on success, -1 on error (including conflicts)
+ */
+int checkoutIncremental(const char *fromCommit, const char *toCommit) {
+    char *fromTree = getTreeFromCommit(fromCommit);
+    char *toTree = fromTree ? getTreeFromCommit(toCommit) : NULL;
+    Index index;
+    if (!toTree || readIndex(&index) != 0) {
+        free(fromTree);
+        free(toTree);
+        return -1;
+    }
+
+    unsigned char fromRaw[20], toRaw[20];
+    hexToRaw(fromTree, fromRaw);
+    hexToRaw(toTree, toRaw);
+    free(fromTree);
+    free(toTree);
+
+    CheckoutPlan plan = { .index = &index };
+    int result = 0;
+    if (memcmp(fromRaw, toRaw, 20) != 0) {
+        result = planTreeSwitch(&plan, fromRaw, toRaw, "");
+    }
+    if (result == 0) checkReplacedPaths(&plan);
+    if (result == 0 && plan.conflicts > 0) {
+        fprintf(stderr, "Error: Commit your changes or remove the files before you switch commits\n");
+        result = -1;
+    }
+
+    if (result == 0) {
+        for (size_t i = 0; i < plan.removals.count; i++) {
+            const CheckoutEntry *entry = &plan.removals.entries[i];
+            if (isDirectoryMode(entry->mode)) {
+                rmdir(entry->path);  // kept if untracked files are left in it
+            } else {
+                unlink(entry->path);
+                indexRemovePath(&index, entry->path);
+            }
+        }
+        // On failure the index keeps describing the old commit, which HEAD stays at
+        result = writeCheckoutList(&plan.writes, &index);
+        if (result != 0) fprintf(stderr, "Error: Some files could not be checked out\n");
+        else if (writeIndex(&index) != 0) result = -1;
+    }
+
+    freeCheckoutList(&plan.removals);
+    freeCheckoutList(&plan.writes);
+    freeCheckoutList(&plan.replaced);
+    freeIndex(&index);
+    return result;
+}
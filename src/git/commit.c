@@ -0,0 +1,388 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "git.h"
+
+/*
+Commit store flow:
+lookupCommit(sha)
+    → open-addressing hash map from SHA to commit (the SHA's first bytes are the hash)
+    → missing: a zeroed ParsedCommit is taken from the current slab (blocks of COMMIT_SLAB_SIZE,
+      never moved, so commit pointers stay valid for the store's lifetime)
+parseCommit(commit)
+    → in the commit-graph (mapped when the store is created): tree, date, generation and
+      parents straight from its row; parents get their position too, so they need no
+      search of their own
+    → otherwise the object is streamed only up to the blank line ending the header, so the message
+      is never inflated (for loose objects; a deltified one is resolved whole first)
+    → tree, parents (looked up, not parsed) and committer time are kept; parent arrays
+      come from a bump-allocated arena
+readCommitText(commit)
+    → the whole object read again when a command actually shows author or message
+*/
+
+#define COMMIT_SLAB_SIZE 1024
+#define COMMIT_ARENA_SIZE (64 * 1024)
+
+typedef struct CommitSlab {
+    struct CommitSlab *next;
+    size_t used;
+    ParsedCommit commits[COMMIT_SLAB_SIZE];
+} CommitSlab;
+
+typedef struct CommitArena {
+    struct CommitArena *next;
+    size_t used, size;
+    unsigned char data[];
+} CommitArena;
+
+struct CommitStore {
+    ParsedCommit **slots;
+    size_t capacity, count;
+    CommitSlab *slabs;
+    CommitArena *arena;
+    CommitGraph *graph;  // NULL if the repository has none
+};
+
+/**
+ * @brief Create an empty commit store, using the repository's commit-graph if it has one
+ *
+ * @return CommitStore*: free with freeCommitStore
+ */
+CommitStore* createCommitStore(void) {
+    CommitStore *store = calloc(1, sizeof(CommitStore));
+    store->capacity = 1024;
+    store->slots = calloc(store->capacity, sizeof(ParsedCommit *));
+    store->graph = openCommitGraph(COMMIT_GRAPH_PATH);
+    return store;
+}
+
+int commitStoreHasGraph(const CommitStore *store) {
+    return store->graph != NULL;
+}
+
+void freeCommitStore(CommitStore *store) {
+    if (!store) return;
+    while (store->slabs) {
+        CommitSlab *next = store->slabs->next;
+        free(store->slabs);
+        store->slabs = next;
+    }
+    while (store->arena) {
+        CommitArena *next = store->arena->next;
+        free(store->arena);
+        store->arena = next;
+    }
+    closeCommitGraph(store->graph);
+    free(store->slots);
+    free(store);
+}
+
+static size_t commitSlot(const unsigned char *sha, size_t capacity) {
+    uint32_t hash = (uint32_t)sha[0] << 24 | sha[1] << 16 | sha[2] << 8 | sha[3];
+    return hash & (capacity - 1);
+}
+
+static void growCommitMap(CommitStore *store) {
+    size_t capacity = store->capacity * 2;
+    ParsedCommit **slots = calloc(capacity, sizeof(ParsedCommit *));
+    for (size_t i = 0; i < store->capacity; i++) {
+        ParsedCommit *commit = store->slots[i];
+        if (!commit) continue;
+        size_t slot = commitSlot(commit->sha, capacity);
+        while (slots[slot]) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = commit;
+    }
+    free(store->slots);
+    store->slots = slots;
+    store->capacity = capacity;
+}
+
+/**
+ * @brief Find a commit in the store, adding it (unparsed) if it is new
+ *
+ * @param sha: 20-byte SHA
+ * @return ParsedCommit*: the store's commit for sha (valid until freeCommitStore)
+ */
+ParsedCommit* lookupCommit(CommitStore *store, const unsigned char *sha) {
+    size_t slot = commitSlot(sha, store->capacity);
+    for (; store->slots[slot]; slot = (slot + 1) & (store->capacity - 1)) {
+        if (memcmp(store->slots[slot]->sha, sha, 20) == 0) return store->slots[slot];
+    }
+
+    if (!store->slabs || store->slabs->used == COMMIT_SLAB_SIZE) {
+        CommitSlab *slab = malloc(sizeof(CommitSlab));
+        slab->next = store->slabs;
+        slab->used = 0;
+        store->slabs = slab;
+    }
+    ParsedCommit *commit = &store->slabs->commits[store->slabs->used++];
+    memset(commit, 0, sizeof(*commit));
+    memcpy(commit->sha, sha, 20);
+
+    store->slots[slot] = commit;
+    if (++store->count * 2 > store->capacity) growCommitMap(store);
+    return commit;
+}
+
+/**
+ * @brief Allocate from the store's arena (freed with the store)
+ */
+static void* arenaAlloc(CommitStore *store, size_t size) {
+    size = (size + 7) & ~(size_t)7;
+    if (!store->arena || store->arena->size - store->arena->used < size) {
+        size_t chunk = size > COMMIT_ARENA_SIZE ? size : COMMIT_ARENA_SIZE;
+        CommitArena *arena = malloc(sizeof(CommitArena) + chunk);
+        arena->next = store->arena;
+        arena->used = 0;
+        arena->size = chunk;
+        store->arena = arena;
+    }
+    void *ptr = store->arena->data + store->arena->used;
+    store->arena->used += size;
+    return ptr;
+}
+
+/**
+ * @brief ObjectSink target: a commit's bytes up to the end of its header
+ */
+typedef struct {
+    ObjectType type;
+    char *data;
+    size_t size, capacity;
+} CommitHeaderBuffer;
+
+static int commitHeaderBegin(ObjectType type, size_t size, void *arg) {
+    (void)size;
+    CommitHeaderBuffer *buffer = arg;
+    buffer->type = type;
+    return type == OBJ_COMMIT ? 0 : 1;  // not a commit: no need to read it
+}
+
+static int commitHeaderWrite(const unsigned char *data, size_t len, void *arg) {
+    CommitHeaderBuffer *buffer = arg;
+    if (buffer->size + len + 1 > buffer->capacity) {
+        while (buffer->size + len + 1 > buffer->capacity) buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 512;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    // The blank line may straddle two pieces
+    size_t from = buffer->size ? buffer->size - 1 : 0;
+    memcpy(buffer->data + buffer->size, data, len);
+    buffer->size += len;
+    buffer->data[buffer->size] = '\0';
+
+    for (const char *p = buffer->data + from; (p = memchr(p, '\n', buffer->data + buffer->size - p)); p++) {
+        if (p + 1 < buffer->data + buffer->size && p[1] == '\n') {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse the time out of a "committer Name <email> <time> <tz>" line
+ */
+static int64_t parseIdentityTime(const char *line, const char *end) {
+    const char *close = NULL;
+    for (const char *p = line; p < end; p++) {
+        if (*p == '>') close = p;
+    }
+    if (!close) return 0;
+    return strtoll(close + 1, NULL, 10);
+}
+
+/**
+ * @brief Fill a commit in from its commit-graph row
+ *
+ * @return int: 0 on success, -1 if the graph doesn't have it (or is corrupt there)
+ */
+static int parseCommitFromGraph(CommitStore *store, ParsedCommit *commit) {
+    if (!(commit->flags & COMMIT_IN_GRAPH)) {
+        if (!commitGraphFind(store->graph, commit->sha, &commit->graphPosition)) return -1;
+        commit->flags |= COMMIT_IN_GRAPH;
+    }
+
+    uint32_t positions[8];
+    int parentCount = commitGraphParents(store->graph, commit->graphPosition, positions, 8);
+    if (parentCount < 0) return -1;
+    uint32_t *parents = positions;
+    if (parentCount > 8) {
+        parents = malloc(parentCount * sizeof(uint32_t));
+        commitGraphParents(store->graph, commit->graphPosition, parents, parentCount);
+    }
+
+    CommitGraphEntry entry;
+    commitGraphEntry(store->graph, commit->graphPosition, &entry);
+    memcpy(commit->tree, entry.tree, 20);
+    commit->date = entry.date;
+    commit->generation = entry.generation;
+    commit->parents = parentCount ? arenaAlloc(store, parentCount * sizeof(ParsedCommit *)) : NULL;
+    commit->parentCount = parentCount;
+    for (int i = 0; i < parentCount; i++) {
+        ParsedCommit *parent = lookupCommit(store, commitGraphSha(store->graph, parents[i]));
+        parent->graphPosition = parents[i];
+        parent->flags |= COMMIT_IN_GRAPH;
+        commit->parents[i] = parent;
+    }
+    if (parents != positions) free(parents);
+    commit->flags |= COMMIT_PARSED;
+    return 0;
+}
+
+/**
+ * @brief Read a commit's header: tree, parents and committer time
+ *
+ * @note Taken from the commit-graph when it has the commit, else only the object's
+ *       header is inflated; does nothing if the commit is already parsed. Parents are
+ *       looked up in the store but not parsed themselves.
+ *
+ * @return int: 0 on success, -1 if the object is missing or not a commit (reported)
+ */
+int parseCommit(CommitStore *store, ParsedCommit *commit) {
+    if (commit->flags & COMMIT_PARSED) return 0;
+    if (store->graph && parseCommitFromGraph(store, commit) == 0) return 0;
+
+    char hexSha[41];
+    rawToHex(commit->sha, hexSha);
+    CommitHeaderBuffer buffer = {0};
+    ObjectSink sink = { commitHeaderBegin, commitHeaderWrite, &buffer };
+    if (odbStreamObject(hexSha, &sink) != 0) {
+        fprintf(stderr, "Error: Could not read commit %s\n", hexSha);
+        free(buffer.data);
+        return -1;
+    }
+    if (buffer.type != OBJ_COMMIT || buffer.size < 46 || memcmp(buffer.data, "tree ", 5) != 0 ||
+        hexToRaw(buffer.data + 5, commit->tree) != 0) {
+        fprintf(stderr, "Error: %s is not a commit\n", hexSha);
+        free(buffer.data);
+        return -1;
+    }
+
+    // Parents follow the tree line; they are counted first to size the array
+    const char *end = buffer.data + buffer.size;
+    const char *line = buffer.data + 46;
+    uint32_t parentCount = 0;
+    for (const char *p = line; end - p >= 48 && memcmp(p, "parent ", 7) == 0; p += 48) parentCount++;
+
+    commit->parents = parentCount ? arenaAlloc(store, parentCount * sizeof(ParsedCommit *)) : NULL;
+    commit->parentCount = 0;
+    for (; end - line >= 48 && memcmp(line, "parent ", 7) == 0; line += 48) {
+        unsigned char parentSha[20];
+        if (hexToRaw(line + 7, parentSha) != 0) break;
+        commit->parents[commit->parentCount++] = lookupCommit(store, parentSha);
+    }
+
+    while (line < end && *line != '\n') {
+        const char *next = memchr(line, '\n', end - line);
+        if (!next) next = end;
+        if (strncmp(line, "committer ", 10) == 0) commit->date = parseIdentityTime(line, next);
+        line = next + 1;
+    }
+
+    free(buffer.data);
+    commit->generation = COMMIT_GENERATION_INFINITY;
+    commit->flags |= COMMIT_PARSED;
+    return 0;
+}
+
+/**
+ * @brief Read a commit's author, committer and message (for showing it)
+ *
+ * @param text: OUTPUT - pointers into text->buffer; free with freeCommitText
+ * @return int: 0 on success, -1 if the commit can't be read (reported)
+ */
+int readCommitText(const ParsedCommit *commit, CommitText *text) {
+    memset(text, 0, sizeof(*text));
+    char hexSha[41];
+    rawToHex(commit->sha, hexSha);
+
+    ObjectType type;
+    unsigned char *content;
+    size_t size;
+    if (odbReadObject(hexSha, &type, &content, &size) != 0) {
+        fprintf(stderr, "Error: Could not read commit %s\n", hexSha);
+        return -1;
+    }
+    if (type != OBJ_COMMIT) {
+        fprintf(stderr, "Error: %s is not a commit\n", hexSha);
+        free(content);
+        return -1;
+    }
+    text->buffer = realloc(content, size + 1);
+    text->buffer[size] = '\0';
+
+    char *line = text->buffer;
+    char *end = text->buffer + size;
+    while (line < end && *line != '\n') {
+        char *next = memchr(line, '\n', end - line);
+        if (!next) next = end;
+        if (strncmp(line, "author ", 7) == 0) {
+            text->author = line + 7;
+            text->authorLen = next - line - 7;
+        } else if (strncmp(line, "committer ", 10) == 0) {
+            text->committer = line + 10;
+            text->committerLen = next - line - 10;
+        }
+        line = next + 1;
+    }
+    text->message = line < end ? line + 1 : end;
+    return 0;
+}
+
+void freeCommitText(CommitText *text) {
+    free(text->buffer);
+    memset(text, 0, sizeof(*text));
+}
+
+/**
+ * @brief Follow annotated tags from an object to the commit they point at
+ *
+ * @param hexSha: 40-char hex SHA of a commit or tag
+ * @param outSha: OUTPUT - 20-byte commit SHA
+ * @return int: 0 on success, -1 if it isn't (a tag of) a commit
+ */
+int peelToCommit(const char *hexSha, unsigned char *outSha) {
+    char current[41];
+    memcpy(current, hexSha, 41);
+    for (int depth = 0; depth < 16; depth++) {
+        ObjectType type;
+        unsigned char *content;
+        size_t size;
+        if (odbReadObject(current, &type, &content, &size) != 0) {
+            fprintf(stderr, "Error: Could not read object %s\n", current);
+            return -1;
+        }
+        int isTag = type == OBJ_TAG && size >= 47 && memcmp(content, "object ", 7) == 0;
+        if (isTag) {
+            memcpy(current, content + 7, 40);
+            current[40] = '\0';
+        }
+        free(content);
+        if (type == OBJ_COMMIT) return hexToRaw(current, outSha);
+        if (!isTag) break;
+    }
+    return -1;
+}
+
+/**
+ * @brief Resolve a revision to a commit, following annotated tags
+ *
+ * @param name: revision (SHA or ref name, see resolveRevision)
+ * @param outSha: OUTPUT - 20-byte commit SHA
+ * @return int: 0 on success, -1 if it doesn't name a commit (reported)
+ */
+int resolveCommit(const char *name, unsigned char *outSha) {
+    char hexSha[41];
+    if (resolveRevision(name, hexSha) != 0) {
+        fprintf(stderr, "Error: ambiguous argument '%s': unknown revision\n", name);
+        return -1;
+    }
+    if (peelToCommit(hexSha, outSha) != 0) {
+        fprintf(stderr, "Error: %s is not a commit\n", name);
+        return -1;
+    }
+    return 0;
+}
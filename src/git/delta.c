@@ -1,9 +1,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include "../network/network.h"
 #include "../utils/utils.h"
 #include "../storage/object.h"
+#include "git.h"
+
+#define DELTA_COPY_SLACK 32 // spare bytes after the result so short runs can be copied 16 bytes at a time
 
 /**
  * @brief Read variable-length size from delta header
@@ -22,9 +26,72 @@ size_t readDeltaSize(const unsigned char **ptr) {
     return size;
 }
 
+/**
+ * @brief readDeltaSize that stops at the end of the delta
+ *
+ * @return int: 0 on success, -1 if the size runs past end or overflows
+ */
+static int readDeltaSizeBounded(const unsigned char **ptr, const unsigned char *end, size_t *outSize) {
+    size_t size = 0;
+    int shift = 0;
+    unsigned char byte;
+
+    do {
+        if (*ptr >= end || shift > 63) return -1;
+        byte = *(*ptr)++;
+        size |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    *outSize = size;
+    return 0;
+}
+
+/**
+ * @brief Decode the offset/size operands of a copy instruction
+ * @note The caller has checked that all popcount(cmd & 0x7F) operand bytes are present.
+ *
+ * @return const unsigned char*: first byte after the operands
+ */
+static inline const unsigned char* readCopyOperands(unsigned char cmd, const unsigned char *ptr, size_t *outOffset, size_t *outSize) {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+    if (cmd & 0x01) offset = *ptr++;
+    if (cmd & 0x02) offset |= (uint32_t)*ptr++ << 8;
+    if (cmd & 0x04) offset |= (uint32_t)*ptr++ << 16;
+    if (cmd & 0x08) offset |= (uint32_t)*ptr++ << 24;
+    if (cmd & 0x10) size = *ptr++;
+    if (cmd & 0x20) size |= (uint32_t)*ptr++ << 8;
+    if (cmd & 0x40) size |= (uint32_t)*ptr++ << 16;
+
+    *outOffset = offset;
+    *outSize = size ? size : 0x10000; // size 0 means 0x10000
+    return ptr;
+}
+
+/**
+ * @brief memcpy for the short runs deltas are made of
+ * @note Runs of up to 32 bytes are moved as two fixed 16-byte blocks (unaligned
+ *       vector loads/stores) when both sides have 32 readable/writable bytes;
+ *       dst must have DELTA_COPY_SLACK spare bytes past its logical end.
+ */
+static inline void copyRun(unsigned char *dst, const unsigned char *src, size_t len, const unsigned char *srcEnd) {
+    if (len <= 32 && srcEnd - src >= 32) {
+        memcpy(dst, src, 16);
+        memcpy(dst + 16, src + 16, 16);
+        return;
+    }
+    memcpy(dst, src, len);
+}
+
 /**
  * @brief Apply delta instructions to base object
  * 
+ * @note Every instruction is checked: copies must stay inside the base, nothing
+ *       may be written past the declared result size, and the result must come
+ *       out exactly that size. A corrupt delta returns NULL instead of reading
+ *       or writing out of bounds.
+ * 
  * @param base: base object data
  * @param baseSize: size of base object
  * @param delta: decompressed delta data
@@ -35,20 +102,28 @@ size_t readDeltaSize(const unsigned char **ptr) {
 unsigned char* applyDelta(const unsigned char *base, size_t baseSize, const unsigned char *delta, size_t deltaSize, size_t *resultSize) {
     const unsigned char *ptr = delta;
     const unsigned char *deltaEnd = delta + deltaSize;
+    const unsigned char *baseEnd = base + baseSize;
 
     // Read base size
-    size_t expectedBaseSize = readDeltaSize(&ptr);
+    size_t expectedBaseSize, targetSize;
+    if (readDeltaSizeBounded(&ptr, deltaEnd, &expectedBaseSize) != 0 ||
+        readDeltaSizeBounded(&ptr, deltaEnd, &targetSize) != 0) {
+        fprintf(stderr, "Error: Truncated delta header\n");
+        return NULL;
+    }
     if (expectedBaseSize != baseSize) {
         fprintf(stderr, "Error: Base size mismatch in delta application\n");
         return NULL;
     }
 
-    // Read result size
-    *resultSize = readDeltaSize(&ptr);
-
     // Allocate result buffer
-    unsigned char *result = malloc(*resultSize);
+    unsigned char *result = malloc(targetSize + DELTA_COPY_SLACK);
+    if (!result) {
+        fprintf(stderr, "Error: Could not allocate %zu bytes for delta result\n", targetSize);
+        return NULL;
+    }
     unsigned char *out = result;
+    size_t left = targetSize; // room left in the result
 
     // Process instructions 
     while (ptr < deltaEnd) {
@@ -56,32 +131,34 @@ unsigned char* applyDelta(const unsigned char *base, size_t baseSize, const unsi
 
         if (cmd & 0x80) {
             // COPY
-            size_t offset = 0;
-            size_t size = 0;
-
-            // Read offset (little-endian, variable-length)
-            if (cmd & 0x01) offset |= (*ptr++) << 0;
-            if (cmd & 0x02) offset |= (*ptr++) << 8;
-            if (cmd & 0x04) offset |= (*ptr++) << 16;
-            if (cmd & 0x08) offset |= (*ptr++) << 24;
+            if ((size_t)(deltaEnd - ptr) < (size_t)__builtin_popcount(cmd & 0x7F)) goto truncated;
 
-            // Read size (little-endian, variable-length)
-            if (cmd & 0x10) size |= (*ptr++) << 0;
-            if (cmd & 0x20) size |= (*ptr++) << 8;
-            if (cmd & 0x40) size |= (*ptr++) << 16;
+            size_t offset, size;
+            ptr = readCopyOperands(cmd, ptr, &offset, &size);
+            if (offset > baseSize || size > baseSize - offset || size > left) {
+                fprintf(stderr, "Error: Delta copy out of bounds (offset %zu, size %zu)\n", offset, size);
+                free(result);
+                return NULL;
+            }
 
-            // If size of 0 means 0x10000
-            if (size == 0) size = 0x10000;
-
-            // Copy from base object
-            memcpy(out, base + offset, size);
+            copyRun(out, base + offset, size, baseEnd);
             out += size;
+            left -= size;
         } 
         else if (cmd > 0) {
-            // INSERT  
-            memcpy(out, ptr, cmd);
-            ptr += cmd;
-            out += cmd;
+            // INSERT
+            for (;;) {
+                if ((size_t)(deltaEnd - ptr) < cmd) goto truncated;
+                if (cmd > left) goto overflow;
+                copyRun(out, ptr, cmd, deltaEnd);
+                ptr += cmd;
+                out += cmd;
+                left -= cmd;
+
+                // Runs of inserts are handled here without going back through the dispatch
+                if (ptr == deltaEnd || *ptr == 0 || (*ptr & 0x80)) break;
+                cmd = *ptr++;
+            }
         } else {
             // cmd == 0 is reserved/invalid
             fprintf(stderr, "Error: Invalid delta instruction 0\n");
@@ -89,5 +166,564 @@ unsigned char* applyDelta(const unsigned char *base, size_t baseSize, const unsi
             return NULL;
         }
     }
+
+    if (left != 0) {
+        fprintf(stderr, "Error: Delta result is %zu bytes short\n", left);
+        free(result);
+        return NULL;
+    }
+    *resultSize = targetSize;
+    return result;
+
+truncated:
+    fprintf(stderr, "Error: Truncated delta instruction\n");
+    free(result);
+    return NULL;
+overflow:
+    fprintf(stderr, "Error: Delta writes past its result size\n");
+    free(result);
+    return NULL;
+}
+
+/*
+Delta chain composition:
+delta 1 (base → A), delta 2 (A → B), ... delta n (… → target)
+    → each delta parsed into an instruction list indexed by output offset
+    → every copy of the upper delta is rewritten in terms of the lower one:
+      the ranges it reads from the lower result become copies from the lower
+      base or slices of its inserted bytes (adjacent pieces are coalesced)
+    → one list against the base, materialized once
+No intermediate object is ever built, which pays off on deep chains of
+small edits to large objects.
+*/
+
+/**
+ * @brief one composed instruction
+ * @note literal == NULL: copy len bytes from base + source; otherwise insert len bytes from literal
+ */
+typedef struct {
+    size_t outOffset;
+    size_t len;
+    size_t source;
+    const unsigned char *literal;
+} DeltaOp;
+
+typedef struct {
+    DeltaOp *ops;
+    size_t count;
+    size_t capacity;
+    size_t baseSize;
+    size_t resultSize;
+} DeltaOps;
+
+/**
+ * @brief Append an instruction, merging it into the previous one when they are contiguous
+ */
+static void pushDeltaOp(DeltaOps *list, size_t len, size_t source, const unsigned char *literal) {
+    if (list->count > 0) {
+        DeltaOp *last = &list->ops[list->count - 1];
+        if (literal == NULL && last->literal == NULL && last->source + last->len == source) {
+            last->len += len;
+            list->resultSize += len;
+            return;
+        }
+        if (literal != NULL && last->literal != NULL && last->literal + last->len == literal) {
+            last->len += len;
+            list->resultSize += len;
+            return;
+        }
+    }
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 64;
+        list->ops = realloc(list->ops, list->capacity * sizeof(DeltaOp));
+    }
+    list->ops[list->count++] = (DeltaOp){ list->resultSize, len, source, literal };
+    list->resultSize += len;
+}
+
+/**
+ * @brief Parse and validate a delta into an instruction list
+ *
+ * @return int: 0 on success, -1 if the delta is corrupt
+ */
+static int parseDeltaOps(const unsigned char *delta, size_t deltaSize, DeltaOps *list) {
+    const unsigned char *ptr = delta;
+    const unsigned char *deltaEnd = delta + deltaSize;
+    size_t targetSize;
+    memset(list, 0, sizeof(*list));
+    if (readDeltaSizeBounded(&ptr, deltaEnd, &list->baseSize) != 0 ||
+        readDeltaSizeBounded(&ptr, deltaEnd, &targetSize) != 0) {
+        return -1;
+    }
+
+    while (ptr < deltaEnd) {
+        unsigned char cmd = *ptr++;
+        if (cmd & 0x80) {
+            if ((size_t)(deltaEnd - ptr) < (size_t)__builtin_popcount(cmd & 0x7F)) return -1;
+            size_t offset, size;
+            ptr = readCopyOperands(cmd, ptr, &offset, &size);
+            if (offset > list->baseSize || size > list->baseSize - offset) return -1;
+            pushDeltaOp(list, size, offset, NULL);
+        } else if (cmd > 0) {
+            if ((size_t)(deltaEnd - ptr) < cmd) return -1;
+            pushDeltaOp(list, cmd, 0, ptr);
+            ptr += cmd;
+        } else {
+            return -1;
+        }
+        if (list->resultSize > targetSize) return -1;
+    }
+    return list->resultSize == targetSize ? 0 : -1;
+}
+
+/**
+ * @brief Index of the lower instruction that produces byte `offset` of its result
+ */
+static size_t findDeltaOp(const DeltaOps *list, size_t offset) {
+    size_t lo = 0, hi = list->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list->ops[mid].outOffset <= offset) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief Rewrite upper (A → B) on top of lower (base → A) as one list base → B
+ */
+static void composeDeltaOps(const DeltaOps *lower, const DeltaOps *upper, DeltaOps *out) {
+    memset(out, 0, sizeof(*out));
+    out->baseSize = lower->baseSize;
+
+    for (size_t i = 0; i < upper->count; i++) {
+        const DeltaOp *op = &upper->ops[i];
+        if (op->literal) {
+            pushDeltaOp(out, op->len, 0, op->literal);
+            continue;
+        }
+
+        size_t from = op->source;
+        size_t remaining = op->len;
+        size_t j = findDeltaOp(lower, from);
+        while (remaining > 0) {
+            const DeltaOp *piece = &lower->ops[j++];
+            size_t skip = from - piece->outOffset;
+            size_t take = piece->len - skip < remaining ? piece->len - skip : remaining;
+            if (piece->literal) {
+                pushDeltaOp(out, take, 0, piece->literal + skip);
+            } else {
+                pushDeltaOp(out, take, piece->source + skip, NULL);
+            }
+            from += take;
+            remaining -= take;
+        }
+    }
+}
+
+/**
+ * @brief apply a chain of deltas without building the intermediate objects
+ *
+ * @param base: base object data
+ * @param baseSize: size of base object
+ * @param deltas: decompressed deltas, deltas[0] applies to base, each next one to the previous result
+ * @param deltaSizes: size of each delta
+ * @param count: number of deltas (at least 1)
+ * @param resultSize: OUTPUT - size of the final object
+ * @return unsigned char*: final object data (caller must free), NULL if a delta is corrupt
+ */
+unsigned char* applyDeltaChain(const unsigned char *base, size_t baseSize, const unsigned char **deltas,
+                               const size_t *deltaSizes, size_t count, size_t *resultSize) {
+    if (count == 1) {
+        return applyDelta(base, baseSize, deltas[0], deltaSizes[0], resultSize);
+    }
+
+    DeltaOps composed;
+    if (parseDeltaOps(deltas[0], deltaSizes[0], &composed) != 0 || composed.baseSize != baseSize) {
+        fprintf(stderr, "Error: Corrupt delta in chain\n");
+        free(composed.ops);
+        return NULL;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        DeltaOps upper, next;
+        if (parseDeltaOps(deltas[i], deltaSizes[i], &upper) != 0 || upper.baseSize != composed.resultSize) {
+            fprintf(stderr, "Error: Corrupt delta in chain\n");
+            free(upper.ops);
+            free(composed.ops);
+            return NULL;
+        }
+        composeDeltaOps(&composed, &upper, &next);
+        free(upper.ops);
+        free(composed.ops);
+        composed = next;
+    }
+
+    unsigned char *result = malloc(composed.resultSize + DELTA_COPY_SLACK);
+    for (size_t i = 0; i < composed.count; i++) {
+        const DeltaOp *op = &composed.ops[i];
+        memcpy(result + op->outOffset, op->literal ? op->literal : base + op->source, op->len);
+    }
+    *resultSize = composed.resultSize;
+    free(composed.ops);
     return result;
-}
\ No newline at end of file
+}
+
+#define DELTA_BLOCK 16          // bytes per indexed base block = rolling hash window
+#define DELTA_HASH_MULT 0x01000193u // polynomial base of the rolling hash
+#define DELTA_GOOD_MATCH 4096   // stop trying candidates once a match is this long
+#define DELTA_MAX_INSERT 0x7f   // longest literal run one insert instruction carries
+#define DELTA_MAX_COPY 0x10000  // longest copy one instruction carries
+
+/**
+ * @brief growable delta output buffer
+ * @note limit: give up (return -1 from emit*) once the delta would exceed it, 0 = no limit
+ */
+typedef struct {
+    unsigned char *data;
+    size_t len;
+    size_t capacity;
+    size_t limit;
+} DeltaBuffer;
+
+static int deltaReserve(DeltaBuffer *out, size_t extra) {
+    if (out->limit && out->len + extra > out->limit) return -1;
+    if (out->len + extra > out->capacity) {
+        while (out->len + extra > out->capacity) out->capacity *= 2;
+        out->data = realloc(out->data, out->capacity);
+    }
+    return 0;
+}
+
+/**
+ * @brief Append a size in the delta header varint format (see readDeltaSize)
+ */
+static int emitDeltaSize(DeltaBuffer *out, size_t size) {
+    if (deltaReserve(out, 10) != 0) return -1;
+    do {
+        unsigned char byte = size & 0x7F;
+        size >>= 7;
+        out->data[out->len++] = byte | (size ? 0x80 : 0);
+    } while (size);
+    return 0;
+}
+
+/**
+ * @brief Append literal bytes as insert instructions of at most 127 bytes each
+ */
+static int emitInsert(DeltaBuffer *out, const unsigned char *data, size_t len) {
+    while (len > 0) {
+        size_t chunk = len < DELTA_MAX_INSERT ? len : DELTA_MAX_INSERT;
+        if (deltaReserve(out, chunk + 1) != 0) return -1;
+        out->data[out->len++] = (unsigned char)chunk;
+        memcpy(out->data + out->len, data, chunk);
+        out->len += chunk;
+        data += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/**
+ * @brief Append copy instructions for base[offset, offset + len)
+ * @note Only the non-zero offset/size bytes are stored; their presence is flagged in the command byte
+ */
+static int emitCopy(DeltaBuffer *out, size_t offset, size_t len) {
+    while (len > 0) {
+        size_t chunk = len < DELTA_MAX_COPY ? len : DELTA_MAX_COPY;
+        if (deltaReserve(out, 8) != 0) return -1;
+
+        unsigned char *cmd = &out->data[out->len++];
+        *cmd = 0x80;
+        for (int i = 0; i < 4; i++) {
+            unsigned char byte = (offset >> (8 * i)) & 0xFF;
+            if (byte) {
+                *cmd |= 1 << i;
+                out->data[out->len++] = byte;
+            }
+        }
+        size_t encoded = chunk == DELTA_MAX_COPY ? 0 : chunk; // size 0 means 0x10000
+        for (int i = 0; i < 3; i++) {
+            unsigned char byte = (encoded >> (8 * i)) & 0xFF;
+            if (byte) {
+                *cmd |= 0x10 << i;
+                out->data[out->len++] = byte;
+            }
+        }
+        offset += chunk;
+        len -= chunk;
+    }
+    return 0;
+}
+
+/*
+Delta encoding:
+base
+    → hashed in DELTA_BLOCK-byte blocks (every blockStep-th block) into
+      buckets of base offsets; runs of identical blocks are indexed once and
+      overfull buckets are thinned, so a repetitive base cannot blow up the scan
+target
+    → rolling hash over a DELTA_BLOCK-byte window, advanced one byte at a time
+    → on a bucket hit the candidates are compared, the longest forward match
+      wins and is then extended backwards into the pending literal bytes
+    → copy instruction for the match, insert instructions for everything else
+
+The index depends only on the base, so it is built once and reused for every
+target tried against that base (see pack-objects' delta window).
+*/
+
+struct DeltaIndex {
+    const unsigned char *base;
+    size_t baseSize;
+    uint32_t mask;       // bucket count - 1
+    uint32_t *buckets;   // bucket i holds entries [buckets[i], buckets[i + 1])
+    uint32_t *offsets;   // base offsets of the indexed blocks
+    uint32_t *hashes;    // their full hashes, to skip most memcmp()s
+    int maxCandidates;
+};
+
+// Favors ratio; pack generation runs once and the result is read many times
+static const DeltaTuning defaultTuning = { 1, 64 };
+
+static uint32_t rollingPower(void) {
+    uint32_t power = 1;
+    for (int i = 0; i < DELTA_BLOCK - 1; i++) power *= DELTA_HASH_MULT;
+    return power; // weight of the byte leaving the window
+}
+
+/**
+ * @brief Polynomial (Rabin-Karp) hash of one DELTA_BLOCK-byte window
+ */
+static uint32_t hashBlock(const unsigned char *data) {
+    uint32_t h = 0;
+    for (int i = 0; i < DELTA_BLOCK; i++) {
+        h = h * DELTA_HASH_MULT + data[i];
+    }
+    return h;
+}
+
+/**
+ * @brief Spread the hash bits before masking (the low bits of a polynomial hash are weak)
+ */
+static uint32_t bucketOf(uint32_t h, uint32_t mask) {
+    return (h ^ (h >> 15) ^ (h >> 23)) & mask;
+}
+
+/**
+ * @brief Length of the common prefix of a and b, at most max bytes
+ * @note Compares 8 bytes at a time; the first differing byte is found from the XOR
+ */
+static size_t matchForward(const unsigned char *a, const unsigned char *b, size_t max) {
+    size_t len = 0;
+    while (len + 8 <= max) {
+        uint64_t x, y;
+        memcpy(&x, a + len, 8);
+        memcpy(&y, b + len, 8);
+        if (x != y) {
+            return len + (__builtin_ctzll(x ^ y) >> 3); // little-endian: lowest set bit = first byte
+        }
+        len += 8;
+    }
+    while (len < max && a[len] == b[len]) len++;
+    return len;
+}
+
+/**
+ * @brief index a base object for createDeltaFromIndex
+ *
+ * @param base: base object data (must outlive the index)
+ * @param baseSize: size of base object
+ * @param tuning: speed/ratio settings (NULL = defaults)
+ * @return DeltaIndex*: index (free with freeDeltaIndex), NULL if the base cannot be a delta base
+ */
+DeltaIndex* createDeltaIndex(const unsigned char *base, size_t baseSize, const DeltaTuning *tuning) {
+    if (baseSize > 0xffffffffu) return NULL; // copy offsets are 32-bit
+    if (!tuning) tuning = &defaultTuning;
+    size_t step = tuning->blockStep > 0 ? (size_t)tuning->blockStep : 1;
+
+    uint32_t blocks = (uint32_t)(baseSize / DELTA_BLOCK / step);
+    uint32_t slots = 16;
+    while (slots < blocks / 4) slots <<= 1;
+
+    DeltaIndex *index = calloc(1, sizeof(DeltaIndex));
+    index->base = base;
+    index->baseSize = baseSize;
+    index->mask = slots - 1;
+    index->maxCandidates = tuning->maxCandidates > 0 ? tuning->maxCandidates : defaultTuning.maxCandidates;
+
+    // Hash every indexed block, skipping repeats of the block just before it
+    uint32_t *blockOffsets = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    uint32_t *blockHashes = malloc((blocks ? blocks : 1) * sizeof(uint32_t));
+    uint32_t *counts = calloc(slots + 1, sizeof(uint32_t));
+    uint32_t n = 0;
+    uint32_t previous = 0;
+    for (size_t offset = 0; offset + DELTA_BLOCK <= baseSize; offset += DELTA_BLOCK * step) {
+        uint32_t h = hashBlock(base + offset);
+        if (n > 0 && h == previous && memcmp(base + offset, base + blockOffsets[n - 1], DELTA_BLOCK) == 0) {
+            continue;
+        }
+        blockOffsets[n] = (uint32_t)offset;
+        blockHashes[n] = h;
+        previous = h;
+        counts[bucketOf(h, index->mask)]++;
+        n++;
+    }
+
+    // Thin out overfull buckets: keep every k-th entry so matches stay spread over the base
+    uint32_t limit = (uint32_t)index->maxCandidates;
+    uint32_t *keepEvery = calloc(slots, sizeof(uint32_t));
+    uint32_t *seen = calloc(slots, sizeof(uint32_t));
+    for (uint32_t i = 0; i < slots; i++) {
+        keepEvery[i] = counts[i] > limit ? (counts[i] + limit - 1) / limit : 1;
+        counts[i] = (counts[i] + keepEvery[i] - 1) / keepEvery[i];
+    }
+
+    // Counting sort into bucket order
+    index->buckets = malloc((slots + 1) * sizeof(uint32_t));
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < slots; i++) {
+        index->buckets[i] = total;
+        total += counts[i];
+    }
+    index->buckets[slots] = total;
+    index->offsets = malloc((total ? total : 1) * sizeof(uint32_t));
+    index->hashes = malloc((total ? total : 1) * sizeof(uint32_t));
+
+    memset(counts, 0, (slots + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t bucket = bucketOf(blockHashes[i], index->mask);
+        if (seen[bucket]++ % keepEvery[bucket] != 0) continue;
+        uint32_t at = index->buckets[bucket] + counts[bucket]++;
+        index->offsets[at] = blockOffsets[i];
+        index->hashes[at] = blockHashes[i];
+    }
+
+    free(seen);
+    free(keepEvery);
+    free(counts);
+    free(blockHashes);
+    free(blockOffsets);
+    return index;
+}
+
+/**
+ * @brief release an index from createDeltaIndex (the base itself is not freed)
+ */
+void freeDeltaIndex(DeltaIndex *index) {
+    if (!index) return;
+    free(index->buckets);
+    free(index->offsets);
+    free(index->hashes);
+    free(index);
+}
+
+/**
+ * @brief size of the base object an index was built from
+ */
+size_t deltaIndexBaseSize(const DeltaIndex *index) {
+    return index->baseSize;
+}
+
+/**
+ * @brief Encode target as a delta against an indexed base (the inverse of applyDelta)
+ *
+ * @param index: index of the base from createDeltaIndex
+ * @param target: object to encode
+ * @param targetSize: size of target object
+ * @param maxDeltaSize: give up once the delta would be larger than this (0 = no limit)
+ * @param deltaSize: OUTPUT - size of the delta
+ * @return unsigned char*: delta data (caller must free), NULL if it would exceed maxDeltaSize
+ */
+unsigned char* createDeltaFromIndex(const DeltaIndex *index, const unsigned char *target, size_t targetSize,
+                                    size_t maxDeltaSize, size_t *deltaSize) {
+    const unsigned char *base = index->base;
+    size_t baseSize = index->baseSize;
+    uint32_t power = rollingPower();
+
+    DeltaBuffer out = {0};
+    out.capacity = 64 + targetSize / 4;
+    out.data = malloc(out.capacity);
+    out.limit = maxDeltaSize;
+
+    int failed = emitDeltaSize(&out, baseSize) != 0 || emitDeltaSize(&out, targetSize) != 0;
+
+    size_t pos = 0;
+    size_t literalStart = 0;
+    uint32_t h = targetSize >= DELTA_BLOCK ? hashBlock(target) : 0;
+    while (!failed && pos + DELTA_BLOCK <= targetSize) {
+        uint32_t bucket = bucketOf(h, index->mask);
+        size_t bestOffset = 0;
+        size_t bestLen = 0;
+        int tried = 0;
+        for (uint32_t i = index->buckets[bucket]; i < index->buckets[bucket + 1]; i++) {
+            if (index->hashes[i] != h) continue;
+            if (tried++ == index->maxCandidates) break;
+
+            size_t offset = index->offsets[i];
+            size_t max = baseSize - offset < targetSize - pos ? baseSize - offset : targetSize - pos;
+            size_t len = matchForward(base + offset, target + pos, max);
+            if (len > bestLen) {
+                bestLen = len;
+                bestOffset = offset;
+                if (len >= DELTA_GOOD_MATCH) break;
+            }
+        }
+
+        if (bestLen < DELTA_BLOCK) {
+            // No match here: slide the window one byte
+            if (pos + DELTA_BLOCK < targetSize) {
+                h = (h - target[pos] * power) * DELTA_HASH_MULT + target[pos + DELTA_BLOCK];
+            }
+            pos++;
+            continue;
+        }
+
+        // Grow the match backwards over literal bytes that also precede it in the base
+        while (bestOffset > 0 && pos > literalStart && base[bestOffset - 1] == target[pos - 1]) {
+            bestOffset--;
+            pos--;
+            bestLen++;
+        }
+
+        failed = emitInsert(&out, target + literalStart, pos - literalStart) != 0 ||
+                 emitCopy(&out, bestOffset, bestLen) != 0;
+        pos += bestLen;
+        literalStart = pos;
+        if (pos + DELTA_BLOCK <= targetSize) {
+            h = hashBlock(target + pos);
+        }
+    }
+    if (!failed) {
+        failed = emitInsert(&out, target + literalStart, targetSize - literalStart) != 0;
+    }
+
+    if (failed) {
+        free(out.data);
+        return NULL;
+    }
+    *deltaSize = out.len;
+    return out.data;
+}
+
+/**
+ * @brief Encode target as a delta against base (the inverse of applyDelta)
+ *
+ * @note One-shot helper: indexes the base with the default tuning, encodes, drops the index.
+ *
+ * @param base: base object data
+ * @param baseSize: size of base object
+ * @param target: object to encode
+ * @param targetSize: size of target object
+ * @param maxDeltaSize: give up once the delta would be larger than this (0 = no limit)
+ * @param deltaSize: OUTPUT - size of the delta
+ * @return unsigned char*: delta data (caller must free), NULL if it would exceed maxDeltaSize
+ */
+unsigned char* createDelta(const unsigned char *base, size_t baseSize, const unsigned char *target, size_t targetSize,
+                           size_t maxDeltaSize, size_t *deltaSize) {
+    DeltaIndex *index = createDeltaIndex(base, baseSize, NULL);
+    if (!index) return NULL;
+
+    unsigned char *delta = createDeltaFromIndex(index, target, targetSize, maxDeltaSize, deltaSize);
+    freeDeltaIndex(index);
+    return delta;
+}
@@ -0,0 +1,853 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <ctype.h>
+#include "../utils/utils.h"
+#include "git.h"
+
+/*
+Line diff flow (two buffers → unified hunks):
+split both buffers into lines (newline included)
+    → intern: equal lines get the same integer id, through one hash table for both
+      sides, so the algorithms below only ever compare integers
+    → lines marked changed by one of two algorithms, following git's xdiff step for
+      step so that ambiguous diffs come out the same:
+          myers: common prefix and suffix trimmed; lines missing from the other side
+              (and frequent lines amid them) marked first; then the shortest edit script
+              of the rest, in linear space (middle snake, divide and conquer), with git's
+              cut-offs for costly regions
+          histogram: on the whole files, anchor on the rarest common run of lines,
+              recurse left and right; regions where every common line is too frequent
+              fall back to myers
+    → compaction: each group of changed lines slid as far down as it goes (or next to
+      a change in the other file), as git does without its indent heuristic
+    → -U0: like git, whole 1 KiB blocks of common tail are dropped first
+    → changes grouped into hunks with `context` lines around them; hunks whose context
+      would touch are merged
+*/
+
+#define HISTOGRAM_MAX_CHAIN 64
+// Myers tuning, as in git's xdiff
+#define DIFF_MAX_COST_MIN 256
+#define DIFF_HEUR_MIN_COST 256
+#define DIFF_SNAKE_COUNT 20
+#define DIFF_K_HEUR 4
+#define DIFF_MAX_EQUAL_LIMIT 1024
+#define DIFF_SCAN_WINDOW 100
+#define DIFF_MANY_MATCHES_RUN 4
+#define FUNCNAME_MAX 80
+
+/**
+ * @brief one side of the diff
+ * @note
+ *      lines/lens: each line in place in the buffer, its length including the newline
+ *      ids: interned line ids (equal lines ⇔ equal ids)
+ *      changed: per line 1 if not in the common subsequence; changed[-1] and changed[count]
+ *          exist and stay 0, so groups can be walked without bounds checks
+ */
+typedef struct {
+    const unsigned char **lines;
+    size_t *lens;
+    uint32_t *ids;
+    char *changedBase;
+    char *changed;
+    long count;
+} DiffSide;
+
+/**
+ * @brief working state of one diff
+ */
+typedef struct {
+    DiffSide a, b;
+    // Myers: per id, occurrences in the A and B ranges being diffed
+    uint32_t *aCount, *bCount;
+    // Histogram: per id, occurrences in the current A range and the first of them;
+    // per A line, the next occurrence of the same line
+    uint32_t *idCount;
+    long *idFirst;
+    long *nextSame;
+} DiffContext;
+
+static long countLines(const unsigned char *data, size_t size) {
+    long count = 0;
+    for (const unsigned char *ptr = data, *end = data + size; ptr < end; count++) {
+        const unsigned char *newline = memchr(ptr, '\n', end - ptr);
+        ptr = newline ? newline + 1 : end;
+    }
+    return count;
+}
+
+static void splitLines(DiffSide *side, const unsigned char *data, size_t size) {
+    side->count = countLines(data, size);
+    side->lines = malloc((side->count + 1) * sizeof(*side->lines));
+    side->lens = malloc((side->count + 1) * sizeof(*side->lens));
+    side->ids = malloc((side->count + 1) * sizeof(*side->ids));
+    side->changedBase = calloc(side->count + 2, 1);
+    side->changed = side->changedBase + 1;
+
+    long i = 0;
+    for (const unsigned char *ptr = data, *end = data + size; ptr < end; i++) {
+        const unsigned char *newline = memchr(ptr, '\n', end - ptr);
+        const unsigned char *next = newline ? newline + 1 : end;
+        side->lines[i] = ptr;
+        side->lens[i] = next - ptr;
+        ptr = next;
+    }
+}
+
+static void freeSide(DiffSide *side) {
+    free(side->lines);
+    free(side->lens);
+    free(side->ids);
+    free(side->changedBase);
+}
+
+static uint64_t hashLine(const unsigned char *line, size_t len) {
+    uint64_t hash = 0xcbf29ce484222325ULL;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ line[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Give every distinct line an id, shared by both sides
+ *
+ * @return uint32_t: number of distinct lines
+ */
+static uint32_t internLines(DiffContext *ctx) {
+    size_t total = ctx->a.count + ctx->b.count;
+    size_t capacity = 16;
+    while (capacity < total * 2) capacity <<= 1;
+
+    // Open addressing: slot → (line hash, id + 1), 0 = empty
+    uint64_t *hashes = malloc(capacity * sizeof(uint64_t));
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    const unsigned char **firstLine = malloc((total + 1) * sizeof(*firstLine));
+    size_t *firstLen = malloc((total + 1) * sizeof(*firstLen));
+    uint32_t distinct = 0;
+
+    DiffSide *sides[2] = { &ctx->a, &ctx->b };
+    for (int s = 0; s < 2; s++) {
+        DiffSide *side = sides[s];
+        for (long i = 0; i < side->count; i++) {
+            uint64_t hash = hashLine(side->lines[i], side->lens[i]);
+            size_t slot = hash & (capacity - 1);
+            for (;; slot = (slot + 1) & (capacity - 1)) {
+                if (slots[slot] == 0) {
+                    slots[slot] = ++distinct;
+                    hashes[slot] = hash;
+                    firstLine[distinct - 1] = side->lines[i];
+                    firstLen[distinct - 1] = side->lens[i];
+                    break;
+                }
+                uint32_t id = slots[slot] - 1;
+                if (hashes[slot] == hash && firstLen[id] == side->lens[i] &&
+                    memcmp(firstLine[id], side->lines[i], side->lens[i]) == 0) {
+                    break;
+                }
+            }
+            side->ids[i] = slots[slot] - 1;
+        }
+    }
+
+    free(hashes);
+    free(slots);
+    free(firstLine);
+    free(firstLen);
+    return distinct;
+}
+
+static void markChanged(DiffSide *side, long start, long end) {
+    memset(side->changed + start, 1, end - start);
+}
+
+/**
+ * @brief Integer square root approximation (git's xdl_bogosqrt)
+ */
+static long bogoSqrt(long n) {
+    long root = 1;
+    for (; n > 0; n >>= 2) root <<= 1;
+    return root;
+}
+
+/**
+ * @brief Decide whether a line with many matches, at dis[i], is left out of the search
+ *
+ * @note It is, when it sits in a run of lines without a match (0) or with many (2)
+ *       that has both kinds on each side and mostly no-match lines overall.
+ *
+ * @param dis: per line 0 = no match, 1 = some, 2 = many; [start, end] is the range
+ * @return int: 1 to leave it out
+ */
+static int discardManyMatches(const char *dis, long i, long start, long end) {
+    if (i - start > DIFF_SCAN_WINDOW) start = i - DIFF_SCAN_WINDOW;
+    if (end - i > DIFF_SCAN_WINDOW) end = i + DIFF_SCAN_WINDOW;
+
+    long noneBefore = 0, manyBefore = 1;
+    for (long r = 1; i - r >= start; r++) {
+        if (dis[i - r] == 0) noneBefore++;
+        else if (dis[i - r] == 2) manyBefore++;
+        else break;
+    }
+    if (noneBefore == 0) return 0;
+
+    long noneAfter = 0, manyAfter = 1;
+    for (long r = 1; i + r <= end; r++) {
+        if (dis[i + r] == 0) noneAfter++;
+        else if (dis[i + r] == 2) manyAfter++;
+        else break;
+    }
+    if (noneAfter == 0) return 0;
+
+    long none = noneBefore + noneAfter, many = manyBefore + manyAfter;
+    return many * DIFF_MANY_MATCHES_RUN < many + none;
+}
+
+/**
+ * @brief the lines a Myers search runs on, and its furthest-reaching vectors
+ * @note
+ *      a/b: ids of the lines kept for the search; aIndex/bIndex: their line numbers
+ *      kvdf/kvdb: furthest A position per diagonal (A position - B position), forward
+ *          and backward; indexed from -(b count + 1) to a count + 1
+ */
+typedef struct {
+    const uint32_t *a, *b;
+    const long *aIndex, *bIndex;
+    DiffSide *aSide, *bSide;
+    long *kvdf, *kvdb;
+    long maxCost;
+} MyersSearch;
+
+/**
+ * @brief where to split a box, and whether each half must be diffed exactly
+ */
+typedef struct {
+    long i1, i2;
+    int minLow, minHigh;
+} MyersSplit;
+
+/**
+ * @brief Sample the diagonals that got furthest for a long enough snake to split on
+ *
+ * @note git's heuristic for costly boxes: a point counts when its distance from the
+ *       corner, less its distance from the middle diagonal, is over DIFF_K_HEUR times
+ *       the edit cost, and it ends (forward) or starts (backward) a snake of at least
+ *       DIFF_SNAKE_COUNT lines.
+ *
+ * @return int: 1 if a split was found
+ */
+static int findSnakeSplit(const MyersSearch *s, long off1, long lim1, long off2, long lim2, long fmin, long fmax,
+                          long bmin, long bmax, long cost, MyersSplit *split) {
+    const uint32_t *a = s->a, *b = s->b;
+    long fmid = off1 - off2, bmid = lim1 - lim2, best = 0;
+    for (long d = fmax; d >= fmin; d -= 2) {
+        long dd = d > fmid ? d - fmid : fmid - d;
+        long i1 = s->kvdf[d], i2 = i1 - d;
+        long v = (i1 - off1) + (i2 - off2) - dd;
+        if (v > DIFF_K_HEUR * cost && v > best && off1 + DIFF_SNAKE_COUNT <= i1 && i1 < lim1 &&
+            off2 + DIFF_SNAKE_COUNT <= i2 && i2 < lim2) {
+            for (long k = 1; a[i1 - k] == b[i2 - k]; k++) {
+                if (k == DIFF_SNAKE_COUNT) {
+                    best = v;
+                    *split = (MyersSplit){ i1, i2, 1, 0 };
+                    break;
+                }
+            }
+        }
+    }
+    if (best > 0) return 1;
+
+    for (long d = bmax; d >= bmin; d -= 2) {
+        long dd = d > bmid ? d - bmid : bmid - d;
+        long i1 = s->kvdb[d], i2 = i1 - d;
+        long v = (lim1 - i1) + (lim2 - i2) - dd;
+        if (v > DIFF_K_HEUR * cost && v > best && off1 < i1 && i1 <= lim1 - DIFF_SNAKE_COUNT &&
+            off2 < i2 && i2 <= lim2 - DIFF_SNAKE_COUNT) {
+            for (long k = 0; a[i1 + k] == b[i2 + k]; k++) {
+                if (k == DIFF_SNAKE_COUNT - 1) {
+                    best = v;
+                    *split = (MyersSplit){ i1, i2, 0, 1 };
+                    break;
+                }
+            }
+        }
+    }
+    return best > 0;
+}
+
+/**
+ * @brief Find where to split the box A[off1, lim1) x B[off2, lim2), as git's xdl_split does
+ *
+ * @note Forward and backward searches run until they overlap (the middle snake). Unless
+ *       needMin, a costly box is split early: on a long snake (findSnakeSplit), or past
+ *       maxCost edits at the point furthest from either corner.
+ */
+static void findSplit(const MyersSearch *s, long off1, long lim1, long off2, long lim2, int needMin,
+                      MyersSplit *split) {
+    const uint32_t *a = s->a, *b = s->b;
+    long *kvdf = s->kvdf, *kvdb = s->kvdb;
+    long dmin = off1 - lim2, dmax = lim1 - off2;
+    long fmid = off1 - off2, bmid = lim1 - lim2;
+    int odd = (fmid - bmid) & 1;
+    long fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+
+    kvdf[fmid] = off1;
+    kvdb[bmid] = lim1;
+
+    for (long cost = 1;; cost++) {
+        int gotSnake = 0;
+
+        // Widen the diagonal range by one, or narrow it where it hits the box
+        if (fmin > dmin) kvdf[--fmin - 1] = -1;
+        else ++fmin;
+        if (fmax < dmax) kvdf[++fmax + 1] = -1;
+        else --fmax;
+
+        for (long d = fmax; d >= fmin; d -= 2) {
+            long i1 = kvdf[d - 1] >= kvdf[d + 1] ? kvdf[d - 1] + 1 : kvdf[d + 1];
+            long start = i1, i2 = i1 - d;
+            for (; i1 < lim1 && i2 < lim2 && a[i1] == b[i2]; i1++, i2++);
+            if (i1 - start > DIFF_SNAKE_COUNT) gotSnake = 1;
+            kvdf[d] = i1;
+            if (odd && bmin <= d && d <= bmax && kvdb[d] <= i1) {
+                *split = (MyersSplit){ i1, i2, 1, 1 };
+                return;
+            }
+        }
+
+        if (bmin > dmin) kvdb[--bmin - 1] = LONG_MAX;
+        else ++bmin;
+        if (bmax < dmax) kvdb[++bmax + 1] = LONG_MAX;
+        else --bmax;
+
+        for (long d = bmax; d >= bmin; d -= 2) {
+            long i1 = kvdb[d - 1] < kvdb[d + 1] ? kvdb[d - 1] : kvdb[d + 1] - 1;
+            long start = i1, i2 = i1 - d;
+            for (; i1 > off1 && i2 > off2 && a[i1 - 1] == b[i2 - 1]; i1--, i2--);
+            if (start - i1 > DIFF_SNAKE_COUNT) gotSnake = 1;
+            kvdb[d] = i1;
+            if (!odd && fmin <= d && d <= fmax && i1 <= kvdf[d]) {
+                *split = (MyersSplit){ i1, i2, 1, 1 };
+                return;
+            }
+        }
+
+        if (needMin) continue;
+
+        if (gotSnake && cost > DIFF_HEUR_MIN_COST &&
+            findSnakeSplit(s, off1, lim1, off2, lim2, fmin, fmax, bmin, bmax, cost, split)) {
+            return;
+        }
+
+        if (cost >= s->maxCost) {
+            // Too costly to be exact: split where one of the two searches got furthest
+            long fbest = -1, fbest1 = -1;
+            for (long d = fmax; d >= fmin; d -= 2) {
+                long i1 = kvdf[d] < lim1 ? kvdf[d] : lim1, i2 = i1 - d;
+                if (lim2 < i2) {
+                    i1 = lim2 + d;
+                    i2 = lim2;
+                }
+                if (fbest < i1 + i2) {
+                    fbest = i1 + i2;
+                    fbest1 = i1;
+                }
+            }
+
+            long bbest = LONG_MAX, bbest1 = LONG_MAX;
+            for (long d = bmax; d >= bmin; d -= 2) {
+                long i1 = kvdb[d] > off1 ? kvdb[d] : off1, i2 = i1 - d;
+                if (i2 < off2) {
+                    i1 = off2 + d;
+                    i2 = off2;
+                }
+                if (i1 + i2 < bbest) {
+                    bbest = i1 + i2;
+                    bbest1 = i1;
+                }
+            }
+
+            if ((lim1 + lim2) - bbest < fbest - (off1 + off2)) {
+                *split = (MyersSplit){ fbest1, fbest - fbest1, 1, 0 };
+            } else {
+                *split = (MyersSplit){ bbest1, bbest - bbest1, 0, 1 };
+            }
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Myers diff of the kept lines A[off1, lim1) against B[off2, lim2) (divide and conquer)
+ */
+static void myersDiff(const MyersSearch *s, long off1, long lim1, long off2, long lim2, int needMin) {
+    for (; off1 < lim1 && off2 < lim2 && s->a[off1] == s->b[off2]; off1++, off2++);
+    for (; off1 < lim1 && off2 < lim2 && s->a[lim1 - 1] == s->b[lim2 - 1]; lim1--, lim2--);
+
+    if (off1 == lim1) {
+        for (; off2 < lim2; off2++) s->bSide->changed[s->bIndex[off2]] = 1;
+    } else if (off2 == lim2) {
+        for (; off1 < lim1; off1++) s->aSide->changed[s->aIndex[off1]] = 1;
+    } else {
+        MyersSplit split;
+        findSplit(s, off1, lim1, off2, lim2, needMin, &split);
+        myersDiff(s, off1, split.i1, off2, split.i2, split.minLow);
+        myersDiff(s, split.i1, lim1, split.i2, lim2, split.minHigh);
+    }
+}
+
+/**
+ * @brief Classify the lines of one side for the search: 0 = no match on the other
+ *        side, 1 = some, 2 = many (over about sqrt of this side's line count)
+ */
+static void classifyLines(const DiffSide *side, long lo, long hi, long start, long end,
+                          const uint32_t *otherCount, char *dis) {
+    long limit = bogoSqrt(hi - lo);
+    if (limit > DIFF_MAX_EQUAL_LIMIT) limit = DIFF_MAX_EQUAL_LIMIT;
+    for (long i = start; i < end; i++) {
+        uint32_t matches = otherCount[side->ids[i]];
+        dis[i - start] = matches == 0 ? 0 : matches >= (uint32_t)limit ? 2 : 1;
+    }
+}
+
+/**
+ * @brief Keep the lines worth searching, mark the others changed
+ *
+ * @return long: number of lines kept
+ */
+static long keepSearchLines(DiffSide *side, long start, long end, const char *dis, uint32_t *ids, long *index) {
+    long kept = 0;
+    for (long i = start; i < end; i++) {
+        char d = dis[i - start];
+        if (d == 1 || (d == 2 && !discardManyMatches(dis, i - start, 0, end - start - 1))) {
+            index[kept] = i;
+            ids[kept++] = side->ids[i];
+        } else {
+            side->changed[i] = 1;
+        }
+    }
+    return kept;
+}
+
+/**
+ * @brief Myers diff of A[aLo, aHi) against B[bLo, bHi), each taken as a whole file
+ *
+ * @note Same steps as git's xdiff, so ambiguous diffs come out the same: common
+ *       prefix and suffix trimmed; lines without a match on the other side, and
+ *       lines with many matches amid unmatched ones, marked changed and left out
+ *       of the search; the rest searched by findSplit.
+ */
+static void classicDiff(DiffContext *ctx, long aLo, long aHi, long bLo, long bHi) {
+    uint32_t *aCount = ctx->aCount, *bCount = ctx->bCount;
+    for (long i = aLo; i < aHi; i++) aCount[ctx->a.ids[i]]++;
+    for (long j = bLo; j < bHi; j++) bCount[ctx->b.ids[j]]++;
+
+    long aStart = aLo, bStart = bLo, aEnd = aHi, bEnd = bHi;
+    while (aStart < aEnd && bStart < bEnd && ctx->a.ids[aStart] == ctx->b.ids[bStart]) {
+        aStart++;
+        bStart++;
+    }
+    while (aStart < aEnd && bStart < bEnd && ctx->a.ids[aEnd - 1] == ctx->b.ids[bEnd - 1]) {
+        aEnd--;
+        bEnd--;
+    }
+
+    char *aDis = malloc(aEnd - aStart + 1), *bDis = malloc(bEnd - bStart + 1);
+    classifyLines(&ctx->a, aLo, aHi, aStart, aEnd, bCount, aDis);
+    classifyLines(&ctx->b, bLo, bHi, bStart, bEnd, aCount, bDis);
+    for (long i = aLo; i < aHi; i++) aCount[ctx->a.ids[i]] = 0;
+    for (long j = bLo; j < bHi; j++) bCount[ctx->b.ids[j]] = 0;
+
+    uint32_t *aIds = malloc((aEnd - aStart + 1) * sizeof(uint32_t));
+    uint32_t *bIds = malloc((bEnd - bStart + 1) * sizeof(uint32_t));
+    long *aIndex = malloc((aEnd - aStart + 1) * sizeof(long));
+    long *bIndex = malloc((bEnd - bStart + 1) * sizeof(long));
+    long n = keepSearchLines(&ctx->a, aStart, aEnd, aDis, aIds, aIndex);
+    long m = keepSearchLines(&ctx->b, bStart, bEnd, bDis, bIds, bIndex);
+    free(aDis);
+    free(bDis);
+
+    long diagonals = n + m + 3;
+    long *kvd = malloc(2 * diagonals * sizeof(long));
+    long maxCost = bogoSqrt(diagonals);
+    MyersSearch search = { aIds, bIds, aIndex, bIndex, &ctx->a, &ctx->b,
+                           kvd + m + 1, kvd + diagonals + m + 1,
+                           maxCost < DIFF_MAX_COST_MIN ? DIFF_MAX_COST_MIN : maxCost };
+    myersDiff(&search, 0, n, 0, m, 0);
+
+    free(kvd);
+    free(aIds);
+    free(bIds);
+    free(aIndex);
+    free(bIndex);
+}
+
+/**
+ * @brief longest common run found so far
+ */
+typedef struct {
+    long aStart, aEnd, bStart, bEnd;  // inclusive
+    uint32_t count;                   // rarest occurrence count of a line in it
+    int found;
+    int hasCommon;
+} HistogramAnchor;
+
+/**
+ * @brief Try the occurrences in A of line B[b] as the start of an anchor
+ *
+ * @return long: next B line worth trying
+ */
+static long tryAnchor(DiffContext *ctx, HistogramAnchor *anchor, long b, long aLo, long aHi, long bLo, long bHi) {
+    const uint32_t *aIds = ctx->a.ids, *bIds = ctx->b.ids;
+    uint32_t id = bIds[b];
+    long bNext = b + 1;
+    if (ctx->idCount[id] == 0) return bNext;
+    if (ctx->idCount[id] > anchor->count) {
+        anchor->hasCommon = 1;
+        return bNext;
+    }
+
+    for (long occurrence = ctx->idFirst[id]; occurrence >= 0;) {
+        anchor->hasCommon = 1;
+        long as = occurrence, ae = occurrence, bs = b, be = b;
+        uint32_t rarest = ctx->idCount[id];
+        while (as > aLo && bs > bLo && aIds[as - 1] == bIds[bs - 1]) {
+            as--;
+            bs--;
+            if (rarest > 1 && ctx->idCount[aIds[as]] < rarest) rarest = ctx->idCount[aIds[as]];
+        }
+        while (ae + 1 < aHi && be + 1 < bHi && aIds[ae + 1] == bIds[be + 1]) {
+            ae++;
+            be++;
+            if (rarest > 1 && ctx->idCount[aIds[ae]] < rarest) rarest = ctx->idCount[aIds[ae]];
+        }
+
+        if (bNext <= be) bNext = be + 1;
+        // Before the first anchor the bar is a run of one line (aStart == aEnd == 0)
+        if (anchor->aEnd - anchor->aStart < ae - as || rarest < anchor->count) {
+            *anchor = (HistogramAnchor){ as, ae, bs, be, rarest, 1, 1 };
+        }
+
+        // Next occurrence past this run
+        occurrence = ctx->nextSame[occurrence];
+        while (occurrence >= 0 && occurrence <= ae) occurrence = ctx->nextSame[occurrence];
+    }
+    return bNext;
+}
+
+/**
+ * @brief Histogram diff of A[aLo, aHi) against B[bLo, bHi)
+ */
+static void histogramDiff(DiffContext *ctx, long aLo, long aHi, long bLo, long bHi) {
+    for (;;) {
+        if (aLo == aHi || bLo == bHi) {
+            markChanged(&ctx->a, aLo, aHi);
+            markChanged(&ctx->b, bLo, bHi);
+            return;
+        }
+
+        // Index A's lines; walking backwards leaves each chain in ascending order
+        for (long i = aHi - 1; i >= aLo; i--) {
+            uint32_t id = ctx->a.ids[i];
+            ctx->nextSame[i] = ctx->idCount[id] ? ctx->idFirst[id] : -1;
+            ctx->idFirst[id] = i;
+            ctx->idCount[id]++;
+        }
+
+        // Lines occurring more than HISTOGRAM_MAX_CHAIN times are never anchored on
+        HistogramAnchor anchor = { .count = HISTOGRAM_MAX_CHAIN + 1 };
+        for (long b = bLo; b < bHi;) {
+            b = tryAnchor(ctx, &anchor, b, aLo, aHi, bLo, bHi);
+        }
+        for (long i = aLo; i < aHi; i++) {
+            ctx->idCount[ctx->a.ids[i]] = 0;
+        }
+
+        if (anchor.hasCommon && anchor.count > HISTOGRAM_MAX_CHAIN) {
+            // Only very frequent common lines: nothing rare enough to anchor on
+            classicDiff(ctx, aLo, aHi, bLo, bHi);
+            return;
+        }
+        if (!anchor.found) {
+            markChanged(&ctx->a, aLo, aHi);
+            markChanged(&ctx->b, bLo, bHi);
+            return;
+        }
+
+        histogramDiff(ctx, aLo, anchor.aStart, bLo, anchor.bStart);
+        aLo = anchor.aEnd + 1;
+        bLo = anchor.bEnd + 1;
+    }
+}
+
+/**
+ * @brief run of changed lines (possibly empty) in one side, used by the compaction
+ */
+typedef struct {
+    long start, end;
+} ChangeGroup;
+
+static void groupInit(const DiffSide *side, ChangeGroup *group) {
+    group->start = group->end = 0;
+    while (side->changed[group->end]) group->end++;
+}
+
+static int groupNext(const DiffSide *side, ChangeGroup *group) {
+    if (group->end == side->count) return -1;
+    group->start = group->end + 1;
+    for (group->end = group->start; side->changed[group->end]; group->end++);
+    return 0;
+}
+
+static int groupPrevious(const DiffSide *side, ChangeGroup *group) {
+    if (group->start == 0) return -1;
+    group->end = group->start - 1;
+    for (group->start = group->end; side->changed[group->start - 1]; group->start--);
+    return 0;
+}
+
+static int groupSlideDown(DiffSide *side, ChangeGroup *group) {
+    if (group->end < side->count && side->ids[group->start] == side->ids[group->end]) {
+        side->changed[group->start++] = 0;
+        side->changed[group->end++] = 1;
+        while (side->changed[group->end]) group->end++;
+        return 0;
+    }
+    return -1;
+}
+
+static int groupSlideUp(DiffSide *side, ChangeGroup *group) {
+    if (group->start > 0 && side->ids[group->start - 1] == side->ids[group->end - 1]) {
+        side->changed[--group->start] = 1;
+        side->changed[--group->end] = 0;
+        while (side->changed[group->start - 1]) group->start--;
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * @brief Move each group of changed lines to the end of the run it can slide over,
+ *        or next to a change in the other side if it can line up with one
+ *
+ * @note Same rules as git's xdiff compaction, without its indent heuristic.
+ */
+static void compactChanges(DiffSide *side, const DiffSide *other) {
+    ChangeGroup group, otherGroup;
+    groupInit(side, &group);
+    groupInit(other, &otherGroup);
+
+    for (;;) {
+        if (group.end != group.start) {
+            long size, earliestEnd, endMatchingOther;
+            do {
+                size = group.end - group.start;
+                endMatchingOther = -1;
+                while (groupSlideUp(side, &group) == 0) {
+                    groupPrevious(other, &otherGroup);
+                }
+                earliestEnd = group.end;
+                if (otherGroup.end > otherGroup.start) endMatchingOther = group.end;
+                while (groupSlideDown(side, &group) == 0) {
+                    groupNext(other, &otherGroup);
+                    if (otherGroup.end > otherGroup.start) endMatchingOther = group.end;
+                }
+            } while (size != group.end - group.start);
+
+            if (group.end != earliestEnd && endMatchingOther != -1) {
+                while (otherGroup.end == otherGroup.start) {
+                    groupSlideUp(side, &group);
+                    groupPrevious(other, &otherGroup);
+                }
+            }
+        }
+        if (groupNext(side, &group) != 0) break;
+        groupNext(other, &otherGroup);
+    }
+}
+
+/**
+ * @brief Find the function line shown after a hunk header ("@@ ... @@ <line>")
+ *
+ * @note Like git's default: the closest line above the hunk that starts with a
+ *       letter, '_' or '$', cut to 80 bytes, trailing whitespace removed.
+ *       Only lines [limit, before) are searched, so each hunk picks up where the
+ *       previous one stopped.
+ *
+ * @return long: its length, copied to out; -1 if there is none in the range
+ */
+static long findFunctionLine(const DiffSide *side, long before, long limit, char *out) {
+    for (long l = before - 1; l >= limit; l--) {
+        const unsigned char *line = side->lines[l];
+        long len = side->lens[l];
+        if (len > 0 && (isalpha(line[0]) || line[0] == '_' || line[0] == '$')) {
+            if (len > FUNCNAME_MAX) len = FUNCNAME_MAX;
+            while (len > 0 && isspace(line[len - 1])) len--;
+            memcpy(out, line, len);
+            return len;
+        }
+    }
+    return -1;
+}
+
+static void writeRange(FILE *out, long start, long count) {
+    // 1-based; an empty range names the line before it
+    fprintf(out, "%ld", count ? start + 1 : start);
+    if (count != 1) fprintf(out, ",%ld", count);
+}
+
+static void writeLine(FILE *out, char prefix, const DiffSide *side, long i) {
+    fputc(prefix, out);
+    fwrite(side->lines[i], 1, side->lens[i], out);
+    if (side->lens[i] == 0 || side->lines[i][side->lens[i] - 1] != '\n') {
+        fputs("\n\\ No newline at end of file\n", out);
+    }
+}
+
+/**
+ * @brief Find the next change at or after (i, j): lines [i, iEnd) of A replaced by [j, jEnd) of B
+ *
+ * @return int: 1 if found, 0 at the end
+ */
+static int nextChange(const DiffContext *ctx, long *i, long *j, long *iEnd, long *jEnd) {
+    while (*i < ctx->a.count && *j < ctx->b.count && !ctx->a.changed[*i] && !ctx->b.changed[*j]) {
+        (*i)++;
+        (*j)++;
+    }
+    if (*i >= ctx->a.count && *j >= ctx->b.count) return 0;
+    for (*iEnd = *i; *iEnd < ctx->a.count && ctx->a.changed[*iEnd]; (*iEnd)++);
+    for (*jEnd = *j; *jEnd < ctx->b.count && ctx->b.changed[*jEnd]; (*jEnd)++);
+    return 1;
+}
+
+/**
+ * @brief Write the changes as unified diff hunks
+ */
+static void writeHunks(const DiffContext *ctx, long context, FILE *out) {
+    char function[FUNCNAME_MAX];
+    long functionLen = 0, functionSearched = 0;
+    long i = 0, j = 0, iEnd, jEnd;
+    int more = nextChange(ctx, &i, &j, &iEnd, &jEnd);
+    while (more) {
+        // A hunk: this change plus the following ones whose context would touch it
+        long hunkA = i > context ? i - context : 0;
+        long hunkB = j - (i - hunkA);
+        long lastI = iEnd, lastJ = jEnd;
+        long ci = iEnd, cj = jEnd, ciEnd, cjEnd;
+        while (nextChange(ctx, &ci, &cj, &ciEnd, &cjEnd) && ci - lastI <= 2 * context) {
+            lastI = ciEnd;
+            lastJ = cjEnd;
+            ci = ciEnd;
+            cj = cjEnd;
+        }
+        long endA = lastI + context < ctx->a.count ? lastI + context : ctx->a.count;
+        long endB = lastJ + (endA - lastI);
+
+        long found = findFunctionLine(&ctx->a, hunkA, functionSearched, function);
+        if (found >= 0) functionLen = found;
+        functionSearched = hunkA;
+        fputs("@@ -", out);
+        writeRange(out, hunkA, endA - hunkA);
+        fputs(" +", out);
+        writeRange(out, hunkB, endB - hunkB);
+        fputs(" @@", out);
+        if (functionLen > 0) {
+            fputc(' ', out);
+            fwrite(function, 1, functionLen, out);
+        }
+        fputc('\n', out);
+
+        long a = hunkA, b = hunkB;
+        while (a < endA || b < endB) {
+            if (a < endA && b < endB && !ctx->a.changed[a] && !ctx->b.changed[b]) {
+                writeLine(out, ' ', &ctx->a, a);
+                a++;
+                b++;
+                continue;
+            }
+            long before = a + b;
+            while (a < endA && ctx->a.changed[a]) writeLine(out, '-', &ctx->a, a++);
+            while (b < endB && ctx->b.changed[b]) writeLine(out, '+', &ctx->b, b++);
+            if (a + b == before) break;
+        }
+
+        i = lastI;
+        j = lastJ;
+        more = nextChange(ctx, &i, &j, &iEnd, &jEnd);
+    }
+}
+
+/**
+ * @brief Check whether a buffer looks binary (a NUL in its first 8000 bytes, like git)
+ */
+int bufferIsBinary(const unsigned char *data, size_t size) {
+    return memchr(data, '\0', size < 8000 ? size : 8000) != NULL;
+}
+
+/**
+ * @brief Drop the common tail of two buffers in whole 1 KiB blocks, keeping the line
+ *        that straddles the cut (what git does before a diff without context)
+ */
+static void trimCommonTail(const unsigned char *a, size_t *aSize, const unsigned char *b, size_t *bSize) {
+    const size_t block = 1024;
+    size_t smaller = *aSize < *bSize ? *aSize : *bSize, trimmed = 0, recovered = 0;
+    const unsigned char *aEnd = a + *aSize, *bEnd = b + *bSize;
+    while (block + trimmed <= smaller && memcmp(aEnd - block, bEnd - block, block) == 0) {
+        trimmed += block;
+        aEnd -= block;
+        bEnd -= block;
+    }
+    while (recovered < trimmed) {
+        if (aEnd[recovered++] == '\n') break;
+    }
+    *aSize -= trimmed - recovered;
+    *bSize -= trimmed - recovered;
+}
+
+/**
+ * @brief Write the unified diff hunks between two buffers (no file header)
+ *
+ * @param options: algorithm and context lines (NULL = myers, 3 lines)
+ * @param out: stream to write to
+ * @return int: 1 if they differ, 0 if not
+ */
+int diffBuffers(const unsigned char *a, size_t aSize, const unsigned char *b, size_t bSize,
+                const DiffOptions *options, FILE *out) {
+    static const DiffOptions defaults = { DIFF_MYERS, 3 };
+    if (!options) options = &defaults;
+    if (aSize == bSize && memcmp(a, b, aSize) == 0) return 0;
+    if (options->context == 0) trimCommonTail(a, &aSize, b, &bSize);
+
+    DiffContext ctx = {0};
+    splitLines(&ctx.a, a, aSize);
+    splitLines(&ctx.b, b, bSize);
+    uint32_t distinct = internLines(&ctx);
+
+    // Histogram falls back to Myers on parts of the files, so both may need the counts
+    ctx.aCount = calloc(distinct + 1, sizeof(uint32_t));
+    ctx.bCount = calloc(distinct + 1, sizeof(uint32_t));
+    if (options->algorithm == DIFF_HISTOGRAM) {
+        ctx.idCount = calloc(distinct + 1, sizeof(uint32_t));
+        ctx.idFirst = malloc((distinct + 1) * sizeof(long));
+        ctx.nextSame = malloc((ctx.a.count + 1) * sizeof(long));
+        histogramDiff(&ctx, 0, ctx.a.count, 0, ctx.b.count);
+    } else {
+        classicDiff(&ctx, 0, ctx.a.count, 0, ctx.b.count);
+    }
+
+    compactChanges(&ctx.a, &ctx.b);
+    compactChanges(&ctx.b, &ctx.a);
+    writeHunks(&ctx, options->context, out);
+
+    free(ctx.aCount);
+    free(ctx.bCount);
+    free(ctx.idCount);
+    free(ctx.idFirst);
+    free(ctx.nextSame);
+    freeSide(&ctx.a);
+    freeSide(&ctx.b);
+    return 1;
+}
@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fnmatch.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "git.h"
+
+/*
+Tree diff flow:
+old tree, new tree (either may be missing = empty)
+    → equal SHAs: nothing to report, the trees are not even read
+    → both read, entries walked side by side in tree order (TreeIterator, in place)
+    → same name, same mode and SHA: skipped (a subtree without being read)
+    → same name, both subtrees: recursive ? walk them the same way : report M
+    → same name, both non-trees: M, or T if the type changed (file <-> symlink <-> submodule)
+    → only in old: D (recursive: every file of the subtree), only in new: A
+    → a subtree and a non-tree of the same name sort apart ("name/" vs "name"), so
+      they come out as a D and an A
+Pathspecs limit the walk: a subtree is only entered if it matches a pathspec or a
+pathspec lies inside it; subtrees that match whole are not checked any further.
+*/
+
+#define TREE_DIFF_PATH_MAX 4096
+
+/**
+ * @brief state shared by one diffTrees() walk
+ * @note path holds the directory being walked ("dir/sub/"), entry names are appended in place
+ */
+typedef struct {
+    const DiffTreeOptions *options;
+    TreeChangeCallback callback;
+    void *arg;
+    char path[TREE_DIFF_PATH_MAX];
+} TreeDiffWalk;
+
+static int isTreeMode(uint32_t mode) {
+    return mode == 040000;
+}
+
+static int hasWildcard(const char *pattern) {
+    return strpbrk(pattern, "*?[") != NULL;
+}
+
+enum { PATHSPEC_NONE, PATHSPEC_INSIDE, PATHSPEC_ALL };
+
+/**
+ * @brief Match a path against the pathspecs
+ *
+ * @param isTree: path is a subtree (so a pathspec may lie inside it)
+ * @return int: PATHSPEC_ALL if the path (and all of a subtree) matches,
+ *              PATHSPEC_INSIDE if the subtree is reported (without -r) or walked with
+ *              its files matched one by one,
+ *              PATHSPEC_NONE otherwise
+ */
+static int matchPathspecs(const DiffTreeOptions *options, const char *path, size_t len, int isTree) {
+    int result = PATHSPEC_NONE;
+    for (size_t i = 0; i < options->pathspecCount; i++) {
+        const char *spec = options->pathspecs[i];
+        size_t specLen = strlen(spec);
+        while (specLen > 1 && spec[specLen - 1] == '/') specLen--;  // "dir/" means "dir"
+        if (hasWildcard(spec)) {
+            // '*' matches across '/', like git's default pathspec magic
+            int matched = fnmatch(spec, path, 0) == 0;
+            if (matched && !isTree) return PATHSPEC_ALL;
+            size_t literal = strcspn(spec, "*?[");
+            if (!isTree) continue;
+            if (matched) {
+                // A matching directory is reported, or walked with its files matched one by one
+                result = PATHSPEC_INSIDE;
+            } else if (options->recursive) {
+                // Files further down may still match, as long as the literal prefix agrees
+                if (strncmp(spec, path, literal < len ? literal : len) == 0) result = PATHSPEC_INSIDE;
+            } else if (len < literal && memcmp(spec, path, len) == 0 && spec[len] == '/') {
+                // Without -r only a directory named by the spec itself is reported, as in git
+                result = PATHSPEC_INSIDE;
+            }
+        } else if (specLen <= len) {
+            if (memcmp(spec, path, specLen) == 0 && (specLen == len || path[specLen] == '/')) return PATHSPEC_ALL;
+        } else if (isTree && memcmp(spec, path, len) == 0 && spec[len] == '/') {
+            result = PATHSPEC_INSIDE;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Check whether a file path is selected by the pathspecs (no pathspecs = all)
+ */
+int pathspecMatches(const DiffTreeOptions *options, const char *path) {
+    return options->pathspecCount == 0 || matchPathspecs(options, path, strlen(path), 0) == PATHSPEC_ALL;
+}
+
+static int reportChange(TreeDiffWalk *walk, char status, const TreeIterator *oldEntry, const TreeIterator *newEntry) {
+    TreeChange change = {
+        .status = status,
+        .oldMode = oldEntry ? oldEntry->mode : 0,
+        .newMode = newEntry ? newEntry->mode : 0,
+        .oldSha = oldEntry ? oldEntry->sha : NULL,
+        .newSha = newEntry ? newEntry->sha : NULL,
+        .path = walk->path,
+    };
+    return walk->callback(&change, walk->arg);
+}
+
+static int walkTrees(TreeDiffWalk *walk, const unsigned char *oldSha, const unsigned char *newSha,
+                     size_t baseLen, int matchedAll);
+
+/**
+ * @brief Report one side of an entry that only exists there (a whole subtree, if recursive)
+ *
+ * @param isOld: entry is from the old tree (deleted), else from the new one (added)
+ */
+static int reportOneSide(TreeDiffWalk *walk, const TreeIterator *entry, int isOld, size_t len, int matchedAll) {
+    if (isTreeMode(entry->mode) && walk->options->recursive) {
+        walk->path[len] = '/';
+        return walkTrees(walk, isOld ? entry->sha : NULL, isOld ? NULL : entry->sha, len + 1, matchedAll);
+    }
+    return reportChange(walk, isOld ? 'D' : 'A', isOld ? entry : NULL, isOld ? NULL : entry);
+}
+
+/**
+ * @brief Walk the entries of two (sub)trees side by side
+ *
+ * @param oldSha/newSha: 20-byte tree SHAs, NULL for a missing side
+ * @param baseLen: length of the directory prefix in walk->path
+ * @param matchedAll: a pathspec already matched the whole directory
+ * @return int: 0 when done, the callback's non-zero result if it stopped the walk,
+ *              -1 if a tree could not be read
+ */
+static int walkTrees(TreeDiffWalk *walk, const unsigned char *oldSha, const unsigned char *newSha,
+                     size_t baseLen, int matchedAll) {
+    if (oldSha && newSha && memcmp(oldSha, newSha, 20) == 0) return 0;
+
+    size_t oldSize = 0, newSize = 0;
+    unsigned char *oldContent = oldSha ? readTreeObject(oldSha, &oldSize) : NULL;
+    unsigned char *newContent = newSha ? readTreeObject(newSha, &newSize) : NULL;
+    if ((oldSha && !oldContent) || (newSha && !newContent)) {
+        free(oldContent);
+        free(newContent);
+        return -1;
+    }
+
+    TreeIterator oldIt, newIt;
+    treeIteratorInit(&oldIt, oldContent, oldSize);
+    treeIteratorInit(&newIt, newContent, newSize);
+    int oldMore = treeIteratorNext(&oldIt), newMore = treeIteratorNext(&newIt);
+    int result = 0;
+    while ((oldMore > 0 || newMore > 0) && oldMore >= 0 && newMore >= 0 && result == 0) {
+        int cmp;
+        if (!oldMore) cmp = 1;
+        else if (!newMore) cmp = -1;
+        else cmp = compareTreeNames(oldIt.name, oldIt.nameLen, isTreeMode(oldIt.mode),
+                                    newIt.name, newIt.nameLen, isTreeMode(newIt.mode));
+
+        const TreeIterator *oldEntry = cmp <= 0 ? &oldIt : NULL;
+        const TreeIterator *newEntry = cmp >= 0 ? &newIt : NULL;
+        const TreeIterator *entry = oldEntry ? oldEntry : newEntry;
+
+        size_t len = baseLen + entry->nameLen;
+        if (len + 2 > sizeof(walk->path)) {
+            fprintf(stderr, "Error: Path too long under %.*s\n", (int)baseLen, walk->path);
+            result = -1;
+            break;
+        }
+        memcpy(walk->path + baseLen, entry->name, entry->nameLen + 1);
+
+        int isTree = (oldEntry && isTreeMode(oldEntry->mode)) || (newEntry && isTreeMode(newEntry->mode));
+        int match = matchedAll || walk->options->pathspecCount == 0
+                        ? PATHSPEC_ALL
+                        : matchPathspecs(walk->options, walk->path, len, isTree);
+        int childMatchedAll = match == PATHSPEC_ALL;
+
+        if (match == PATHSPEC_NONE ||
+            (oldEntry && newEntry && oldEntry->mode == newEntry->mode && memcmp(oldEntry->sha, newEntry->sha, 20) == 0)) {
+            // Not asked for, or unchanged
+        } else if (oldEntry && newEntry && isTreeMode(oldEntry->mode) && isTreeMode(newEntry->mode)) {
+            if (walk->options->recursive) {
+                walk->path[len] = '/';
+                result = walkTrees(walk, oldEntry->sha, newEntry->sha, len + 1, childMatchedAll);
+            } else {
+                result = reportChange(walk, 'M', oldEntry, newEntry);
+            }
+        } else if (oldEntry && newEntry) {
+            char status = (oldEntry->mode & 0170000) == (newEntry->mode & 0170000) ? 'M' : 'T';
+            result = reportChange(walk, status, oldEntry, newEntry);
+        } else {
+            result = reportOneSide(walk, entry, oldEntry != NULL, len, childMatchedAll);
+        }
+
+        if (oldEntry) oldMore = treeIteratorNext(&oldIt);
+        if (newEntry) newMore = treeIteratorNext(&newIt);
+    }
+    walk->path[baseLen] = '\0';
+
+    free(oldContent);
+    free(newContent);
+    if (result == 0 && (oldMore < 0 || newMore < 0)) result = -1;
+    return result;
+}
+
+/**
+ * @brief Compare two trees and report what changed, in tree order
+ *
+ * @note Subtrees with equal SHAs are skipped without being read. Entry names and
+ *       SHAs are read in place from the tree objects; the change passed to the
+ *       callback (path included) is only valid during the call.
+ *
+ * @param oldTree: 20-byte tree SHA, NULL for the empty tree
+ * @param newTree: 20-byte tree SHA, NULL for the empty tree
+ * @param options: recursive walk and pathspecs (NULL = top level, everything)
+ * @param callback: called for each change; a non-zero return stops the walk
+ * @param arg: passed to the callback
+ * @return int: 0 on success, the callback's non-zero result, or -1 if a tree could not be read
+ */
+int diffTrees(const unsigned char *oldTree, const unsigned char *newTree, const DiffTreeOptions *options,
+              TreeChangeCallback callback, void *arg) {
+    static const DiffTreeOptions defaults = {0};
+    TreeDiffWalk *walk = malloc(sizeof(TreeDiffWalk));
+    walk->options = options ? options : &defaults;
+    walk->callback = callback;
+    walk->arg = arg;
+    walk->path[0] = '\0';
+
+    int result = walkTrees(walk, oldTree, newTree, 0, 0);
+    free(walk);
+    return result;
+}
+
+static int queueTreeChange(const TreeChange *change, void *arg) {
+    DiffQueue *queue = arg;
+    FilePair *pair = diffQueueAdd(queue, change->status, change->path, change->path);
+    pair->oldMode = change->oldMode;
+    pair->newMode = change->newMode;
+    if (change->oldSha) memcpy(pair->oldSha, change->oldSha, 20);
+    if (change->newSha) memcpy(pair->newSha, change->newSha, 20);
+    return 0;
+}
+
+/**
+ * @brief Append a file pair to a queue (modes and SHAs zeroed)
+ *
+ * @return FilePair*: the new pair (valid until the next add)
+ */
+FilePair* diffQueueAdd(DiffQueue *queue, char status, const char *oldPath, const char *newPath) {
+    if (queue->count == queue->capacity) {
+        queue->capacity = queue->capacity ? queue->capacity * 2 : 64;
+        queue->pairs = realloc(queue->pairs, queue->capacity * sizeof(FilePair));
+    }
+    FilePair *pair = &queue->pairs[queue->count++];
+    memset(pair, 0, sizeof(*pair));
+    pair->status = status;
+    pair->oldPath = strdup(oldPath);
+    pair->newPath = strdup(newPath);
+    return pair;
+}
+
+/**
+ * @brief Collect the changes between two trees as file pairs (for rename detection)
+ *
+ * @return int: 0 on success, -1 if a tree could not be read
+ */
+int diffTreesToQueue(const unsigned char *oldTree, const unsigned char *newTree, const DiffTreeOptions *options,
+                     DiffQueue *queue) {
+    return diffTrees(oldTree, newTree, options, queueTreeChange, queue) == 0 ? 0 : -1;
+}
+
+void freeDiffQueue(DiffQueue *queue) {
+    for (size_t i = 0; i < queue->count; i++) {
+        free(queue->pairs[i].oldPath);
+        free(queue->pairs[i].newPath);
+    }
+    free(queue->pairs);
+    memset(queue, 0, sizeof(*queue));
+}
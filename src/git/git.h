@@ -1,11 +1,219 @@
 #ifndef GIT_H
 #define GIT_H
 
-void checkout(const char *directory, const char *headSha);
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+int checkout(const char *directory, const char *headSha);
+int checkoutIncremental(const char *fromCommit, const char *toCommit);
+char* getTreeFromCommit(const char *commitSha);
 char* discoverRefs(const char *repoUrl);
-unsigned char* requestPackfile(const char *repoUrl, const char *headSha, size_t *packSize);
+int requestPackfile(const char *repoUrl, const char *headSha, char *outPackSha);
+int resolveRef(const char *ref, char *outSha);
+int resolveHead(char *outSha);
+int resolveRevision(const char *name, char *outSha);
+int updateRef(const char *ref, const char *sha);
+int updateSymbolicRef(const char *ref, const char *target);
+
+typedef int (*RefCallback)(const char *ref, const char *sha, void *arg);
+
+int forEachRef(RefCallback callback, void *arg);
+
+/**
+ * @brief a commit as far as history walks need it (see commit.c)
+ * @note
+ *      tree/parents/parentCount/date: set once parsed (COMMIT_PARSED); parents are the
+ *          store's commits, in the commit's order, and not parsed themselves
+ *      date: committer time, seconds since the epoch
+ *      generation: topological level from the commit-graph (roots are 1); a commit
+ *          missing from it has COMMIT_GENERATION_INFINITY (its ancestors may be in it,
+ *          never the other way around)
+ *      graphPosition: position in the commit-graph, if COMMIT_IN_GRAPH
+ *      flags: COMMIT_* bits
+ */
+typedef struct ParsedCommit {
+    unsigned char sha[20];
+    unsigned char tree[20];
+    struct ParsedCommit **parents;
+    uint32_t parentCount;
+    uint32_t flags;
+    int64_t date;
+    uint32_t generation;
+    uint32_t graphPosition;
+} ParsedCommit;
+
+#define COMMIT_PARSED (1u << 0)
+#define COMMIT_SEEN (1u << 1)           // queued by a walk
+#define COMMIT_UNINTERESTING (1u << 2)  // reachable from an excluded revision
+#define COMMIT_WALKED (1u << 3)         // parents handled by a walk
+#define COMMIT_IN_GRAPH (1u << 4)       // graphPosition is known
+#define COMMIT_REACHED (1u << 5)        // visited by isAncestor
+
+#define COMMIT_GENERATION_INFINITY 0xffffffffu
+
+/**
+ * @brief a commit's text, read on demand (see readCommitText)
+ * @note
+ *      author/committer: "Name <email> <time> <tz>", not NUL-terminated
+ *      message: everything after the header, NUL-terminated
+ */
+typedef struct {
+    char *buffer;
+    const char *author, *committer;
+    size_t authorLen, committerLen;
+    const char *message;
+} CommitText;
+
+typedef struct CommitStore CommitStore;
+
+CommitStore* createCommitStore(void);
+void freeCommitStore(CommitStore *store);
+ParsedCommit* lookupCommit(CommitStore *store, const unsigned char *sha);
+int parseCommit(CommitStore *store, ParsedCommit *commit);
+int readCommitText(const ParsedCommit *commit, CommitText *text);
+void freeCommitText(CommitText *text);
+int peelToCommit(const char *hexSha, unsigned char *outSha);
+int resolveCommit(const char *name, unsigned char *outSha);
+int commitStoreHasGraph(const CommitStore *store);
+
+/**
+ * @brief history walk settings
+ * @note
+ *      firstParent: follow only the first parent of merges
+ *      maxCount: stop after this many commits (-1 = no limit)
+ */
+typedef struct {
+    int firstParent;
+    long maxCount;
+} RevWalkOptions;
+
+typedef struct RevWalk RevWalk;
+
+RevWalk* createRevWalk(CommitStore *store, const RevWalkOptions *options);
+void freeRevWalk(RevWalk *walk);
+int revWalkAdd(RevWalk *walk, const unsigned char *sha, int uninteresting);
+int revWalkAddArgument(RevWalk *walk, const char *arg);
+int revWalkNext(RevWalk *walk, ParsedCommit **out);
+int isAncestor(CommitStore *store, ParsedCommit *ancestor, ParsedCommit *descendant);
+
+/**
+ * @brief one difference between two trees (see difftree.c)
+ * @note
+ *      status: 'A' added, 'D' deleted, 'M' modified, 'T' type changed (file <-> symlink ...)
+ *      oldMode/oldSha: 0/NULL when added, newMode/newSha: 0/NULL when deleted
+ *      path: full path; it and the SHAs are only valid during the callback
+ */
+typedef struct {
+    char status;
+    uint32_t oldMode, newMode;
+    const unsigned char *oldSha, *newSha;
+    const char *path;
+} TreeChange;
+
+typedef int (*TreeChangeCallback)(const TreeChange *change, void *arg);
+
+/**
+ * @brief tree diff settings
+ * @note
+ *      recursive: report the files inside changed subtrees instead of the subtrees
+ *      pathspecs: only report paths at or under these (glob patterns allowed; none = everything)
+ */
+typedef struct {
+    int recursive;
+    const char *const *pathspecs;
+    size_t pathspecCount;
+} DiffTreeOptions;
+
+int diffTrees(const unsigned char *oldTree, const unsigned char *newTree, const DiffTreeOptions *options,
+              TreeChangeCallback callback, void *arg);
+int pathspecMatches(const DiffTreeOptions *options, const char *path);
+
+/**
+ * @brief one changed file, owning its data (see difftree.c, rename.c)
+ * @note
+ *      status: as in TreeChange, or 'R' renamed / 'C' copied from oldPath
+ *      score: similarity in percent, for 'R' and 'C'
+ *      oldPath/newPath: the same path unless renamed or copied
+ */
+typedef struct {
+    char status;
+    int score;
+    uint32_t oldMode, newMode;
+    unsigned char oldSha[20], newSha[20];
+    char *oldPath, *newPath;
+} FilePair;
+
+typedef struct {
+    FilePair *pairs;
+    size_t count, capacity;
+} DiffQueue;
+
+FilePair* diffQueueAdd(DiffQueue *queue, char status, const char *oldPath, const char *newPath);
+int diffTreesToQueue(const unsigned char *oldTree, const unsigned char *newTree, const DiffTreeOptions *options,
+                     DiffQueue *queue);
+void freeDiffQueue(DiffQueue *queue);
+
+/**
+ * @brief rename detection settings
+ * @note
+ *      findCopies: modified files are sources too, and a source may be used more than once
+ *      minScore: similarity a pair needs, out of RENAME_SCORE_MAX (exact matches score that)
+ */
+typedef struct {
+    int findCopies;
+    int minScore;
+} RenameOptions;
+
+#define RENAME_SCORE_MAX 60000
+#define RENAME_DEFAULT_SCORE (RENAME_SCORE_MAX / 2)
+
+int detectRenames(DiffQueue *queue, const RenameOptions *options);
+
+typedef enum {
+    DIFF_MYERS,
+    DIFF_HISTOGRAM,
+} DiffAlgorithm;
+
+/**
+ * @brief line diff settings (see diff.c)
+ * @note
+ *      context: unchanged lines shown around each change
+ */
+typedef struct {
+    DiffAlgorithm algorithm;
+    long context;
+} DiffOptions;
+
+int diffBuffers(const unsigned char *a, size_t aSize, const unsigned char *b, size_t bSize,
+                const DiffOptions *options, FILE *out);
+int bufferIsBinary(const unsigned char *data, size_t size);
 
 size_t readDeltaSize(const unsigned char **ptr);
 unsigned char* applyDelta(const unsigned char *base, size_t baseSize, const unsigned char *delta, size_t deltaSize, size_t *resultSize);
+unsigned char* applyDeltaChain(const unsigned char *base, size_t baseSize, const unsigned char **deltas,
+                               const size_t *deltaSizes, size_t count, size_t *resultSize);
+/**
+ * @brief delta encoder speed/ratio settings
+ * @note
+ *      blockStep: index every Nth block of the base (1 = every block, best ratio;
+ *          larger = smaller index, faster, fewer matches found)
+ *      maxCandidates: base positions compared per target position and kept per
+ *          hash bucket (smaller = faster on repetitive data)
+ */
+typedef struct {
+    int blockStep;
+    int maxCandidates;
+} DeltaTuning;
+
+typedef struct DeltaIndex DeltaIndex;
+
+DeltaIndex* createDeltaIndex(const unsigned char *base, size_t baseSize, const DeltaTuning *tuning);
+void freeDeltaIndex(DeltaIndex *index);
+size_t deltaIndexBaseSize(const DeltaIndex *index);
+unsigned char* createDeltaFromIndex(const DeltaIndex *index, const unsigned char *target, size_t targetSize,
+                                    size_t maxDeltaSize, size_t *deltaSize);
+unsigned char* createDelta(const unsigned char *base, size_t baseSize, const unsigned char *target, size_t targetSize,
+                           size_t maxDeltaSize, size_t *deltaSize);
 
 #endif // GIT_H 
\ No newline at end of file
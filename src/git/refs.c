@@ -1,9 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "../network/network.h"
 #include "../utils/utils.h"
 #include "../storage/object.h"
+#include "git.h"
 
 /**
  * @brief discover refs (HTTP GET)
@@ -64,17 +69,158 @@ char* discoverRefs(const char *repoUrl) {
     return headSha;
 }
 
+#define SIDEBAND_PACK 1
+#define SIDEBAND_PROGRESS 2
+#define SIDEBAND_ERROR 3
+
+/**
+ * @brief upload-pack response reader
+ * @note The response is pkt-lines ("NAK", "ACK ...") followed by the pack,
+ *       multiplexed with side-band-64k: every pkt-line after the negotiation
+ *       starts with a band byte (1 pack data, 2 progress, 3 fatal error).
+ *       Servers that ignore side-band send the raw pack instead.
+ *       Bytes are consumed as curl delivers them:
+ *      prefix/prefixLen: length prefix being assembled
+ *      remaining: payload bytes of the current pkt-line still to come
+ *      band: band of the current pkt-line (0 = not known yet, -1 = plain line)
+ *      message/messageLen: text of a band 3 line, reported once complete
+ *      progressLineStart: next progress byte begins a new line on stderr
+ *      inPack: raw pack ("PACK" where a length prefix was expected)
+ *      packBytes: pack bytes handed to the pack parser so far
+ */
+typedef struct {
+    PackStream *pack;
+    unsigned char prefix[4];
+    size_t prefixLen;
+    size_t remaining;
+    int band;
+    char message[512];
+    size_t messageLen;
+    int progressLineStart;
+    int inPack;
+    size_t packBytes;
+} UploadPackReader;
+
+/**
+ * @brief Relay band 2 (progress) bytes to stderr as "remote: ..." lines
+ * @note The server redraws counters with '\r', so both '\r' and '\n' end a line.
+ */
+static void reportProgress(UploadPackReader *reader, const unsigned char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (reader->progressLineStart) {
+            fputs("remote: ", stderr);
+            reader->progressLineStart = 0;
+        }
+        fputc(data[i], stderr);
+        if (data[i] == '\r' || data[i] == '\n') reader->progressLineStart = 1;
+    }
+    fflush(stderr);
+}
+
+/**
+ * @brief Report the band 3 (fatal error) message collected so far
+ * @return int: always -1, the transfer is over
+ */
+static int reportRemoteError(UploadPackReader *reader) {
+    reader->message[reader->messageLen] = '\0';
+    reader->message[strcspn(reader->message, "\n")] = '\0';
+    if (reader->message[0] == '\0') fprintf(stderr, "Error: remote reported an error without a message\n");
+    else fprintf(stderr, "Error: remote: %s\n", reader->message);
+    return -1;
+}
+
 /**
- * @brief Request packfile (HTTP POST)
+ * @brief Hand pack bytes to the pack parser
+ */
+static int feedPack(UploadPackReader *reader, const unsigned char *data, size_t len) {
+    reader->packBytes += len;
+    return packStreamWrite(reader->pack, data, len);
+}
+
+/**
+ * @brief HttpStreamCallback: demultiplex pkt-lines, pack bytes go to the pack parser
+ */
+static int onUploadPackData(const unsigned char *data, size_t len, void *userdata) {
+    UploadPackReader *reader = userdata;
+
+    while (len > 0) {
+        if (reader->inPack) {
+            return feedPack(reader, data, len);
+        }
+
+        if (reader->remaining > 0) {
+            if (reader->band == 0) {
+                // First payload byte: a band number, or text of a negotiation line
+                unsigned char first = *data;
+                if (first == SIDEBAND_PACK || first == SIDEBAND_PROGRESS || first == SIDEBAND_ERROR) {
+                    reader->band = first;
+                    data++;
+                    len--;
+                    reader->remaining--;
+                    // An empty error packet ("0005\3") is still fatal
+                    if (reader->remaining == 0 && first == SIDEBAND_ERROR) return reportRemoteError(reader);
+                    continue;
+                }
+                reader->band = -1;
+            }
+
+            size_t take = reader->remaining < len ? reader->remaining : len;
+            if (reader->band == SIDEBAND_PACK) {
+                if (feedPack(reader, data, take) != 0) return -1;
+            } else if (reader->band == SIDEBAND_PROGRESS) {
+                reportProgress(reader, data, take);
+            } else if (reader->band == SIDEBAND_ERROR) {
+                size_t room = sizeof(reader->message) - 1 - reader->messageLen;
+                size_t keep = take < room ? take : room;
+                memcpy(reader->message + reader->messageLen, data, keep);
+                reader->messageLen += keep;
+            }
+            // plain lines (NAK / ACK) need no action
+            reader->remaining -= take;
+            data += take;
+            len -= take;
+
+            if (reader->remaining == 0 && reader->band == SIDEBAND_ERROR) return reportRemoteError(reader);
+            continue;
+        }
+
+        reader->prefix[reader->prefixLen++] = *data++;
+        len--;
+        if (reader->prefixLen < 4) continue;
+        reader->prefixLen = 0;
+
+        if (memcmp(reader->prefix, "PACK", 4) == 0) {
+            reader->inPack = 1;
+            if (feedPack(reader, reader->prefix, 4) != 0) return -1;
+            continue;
+        }
+
+        int pktLen = pktLineLength(reader->prefix);
+        if (pktLen < 0 || (pktLen > 0 && pktLen < 4)) {
+            fprintf(stderr, "Error: Invalid pkt-line in upload-pack response\n");
+            return -1;
+        }
+        reader->remaining = pktLen > 0 ? pktLen - 4 : 0; // flush packets carry no payload
+        reader->band = 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Request packfile (HTTP POST) and store it as it downloads
  * 
  * @note POST https://github.com/user/repo.git/git-upload-pack
  * @note Body: "want <sha>\n... done\n"
+ * @note The pack is parsed, inflated and hashed while it streams in, and
+ *       lands in .git/objects/pack with its .idx; it is never held in memory.
+ *       Its trailer is checked against the running checksum as the last byte arrives.
  * 
  * @param repoUrl: repository URL
  * @param headSha: HEAD SHA
- * @return char: raw packfile data
+ * @param outPackSha: OUTPUT - 40-char hex checksum of the stored pack (must be 41 bytes)
+ * @return int: 0 on success, -1 on error
  */
-unsigned char* requestPackfile(char *repoUrl, char *headSha, size_t *packSize) {
+int requestPackfile(const char *repoUrl, const char *headSha, char *outPackSha) {
     // Build url
     char fullUrl[512];
     if (strstr(repoUrl, ".git") == NULL) {
@@ -92,7 +238,7 @@ unsigned char* requestPackfile(char *repoUrl, char *headSha, size_t *packSize) {
 
     // "want <sha> <capabilites>\n"
     char wantLine[128];
-    snprintf(wantLine, sizeof(wantLine), "want %s multi_ack\n", headSha);
+    snprintf(wantLine, sizeof(wantLine), "want %s multi_ack side-band-64k ofs-delta\n", headSha);
     offset += pktLineEncode(wantLine, body + offset, sizeof(body) - offset);
 
     // Flush
@@ -102,48 +248,260 @@ unsigned char* requestPackfile(char *repoUrl, char *headSha, size_t *packSize) {
     // "done\n"
     offset += pktLineEncode("done\n", body + offset, sizeof(body) - offset);
 
-    for (int i = 0; i < offset; i++) {
-        fprintf(stderr, "%02x ", (unsigned char)body[i]);
+    UploadPackReader reader = {0};
+    reader.pack = packStreamBegin(0);
+    if (!reader.pack) {
+        return -1;
     }
-    fprintf(stderr, "\n");
 
-    // Post request
-    HttpResponse response;
-    if (httpPost(fullUrl, "application/x-git-upload-pack-request", (unsigned char *)body, offset, &response)!= 0) {
-        return NULL;
-    };
+    // Post request; the pack is consumed chunk by chunk inside onUploadPackData
+    if (httpPostStream(fullUrl, "application/x-git-upload-pack-request", (unsigned char *)body, offset,
+                       onUploadPackData, &reader) != 0) {
+        packStreamAbort(reader.pack);
+        return -1;
+    }
 
-    // Skip NAK line, return packfile data
-    // Response: "0008NAK\n"<packfile data>
-    unsigned char *ptr = response.data;
-    size_t remaining = response.size;
+    if (reader.packBytes == 0) {
+        fprintf(stderr, "Error: upload-pack response contained no pack\n");
+        packStreamAbort(reader.pack);
+        return -1;
+    }
 
-    while (remaining > 4) {
-        // Check if we've reached PACK data
-        if (memcmp(ptr, "PACK", 4) == 0) {
+    return packStreamFinish(reader.pack, outPackSha);
+}
+
+/**
+ * @brief Look a ref up in .git/packed-refs ("<sha> <ref>" lines)
+ *
+ * @return int: 0 if found, -1 otherwise
+ */
+static int readPackedRef(const char *ref, char *outSha) {
+    FILE *file = fopen(".git/packed-refs", "r");
+    if (!file) return -1;
+
+    char line[1024];
+    int result = -1;
+    size_t refLen = strlen(ref);
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '^' || strlen(line) < 42) continue;
+        if (strncmp(line + 41, ref, refLen) == 0 && (line[41 + refLen] == '\n' || line[41 + refLen] == '\0')) {
+            memcpy(outSha, line, 40);
+            outSha[40] = '\0';
+            result = 0;
             break;
         }
+    }
+    fclose(file);
+    return result;
+}
 
-        // Check for sideband: if first byte after length is \1, \2, or \3
-        // Skip the pkt-line
-        char line[512];
-        int consumed = pktLineDecode(ptr, remaining, line, sizeof(line));
+/**
+ * @brief resolve a ref name (e.g. "refs/heads/main") to a commit SHA
+ *
+ * @note Symbolic refs ("ref: <target>") are followed, loose refs win over packed-refs.
+ *
+ * @param ref: ref name relative to .git, or "HEAD"
+ * @param outSha: OUTPUT - 40-char hex SHA (41 bytes)
+ * @return int: 0 on success, -1 if the ref doesn't exist (e.g. an unborn branch)
+ */
+int resolveRef(const char *ref, char *outSha) {
+    char name[512];
+    snprintf(name, sizeof(name), "%s", ref);
 
-        if (consumed <= 0) {
-            // Not a valid pkt-line, maybe we're at PACK data
-            break;
+    for (int depth = 0; depth < 5; depth++) {
+        char path[600];
+        snprintf(path, sizeof(path), ".git/%s", name);
+        FILE *file = fopen(path, "r");
+        if (!file) {
+            return readPackedRef(name, outSha);
         }
 
-        ptr += consumed;
-        remaining -= consumed;
+        char line[600];
+        int got = fgets(line, sizeof(line), file) != NULL;
+        fclose(file);
+        if (!got) return -1;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if (strncmp(line, "ref: ", 5) == 0) {
+            int nameLen = snprintf(name, sizeof(name), "%s", line + 5);
+            if (nameLen < 0 || (size_t)nameLen >= sizeof(name)) {
+                fprintf(stderr, "Error: Symbolic ref %s points at a too long name\n", ref);
+                return -1;
+            }
+            continue;
+        }
+
+        unsigned char raw[20];
+        if (strlen(line) != 40 || hexToRaw(line, raw) != 0) {
+            fprintf(stderr, "Error: Ref %s is corrupt\n", name);
+            return -1;
+        }
+        memcpy(outSha, line, 41);
+        return 0;
     }
 
-    // Now ptr should point to PACK data
-    unsigned char *packData = malloc(remaining);
-    memcpy(packData, ptr, remaining);
-    *packSize = remaining;
+    fprintf(stderr, "Error: Too many levels of symbolic refs at %s\n", ref);
+    return -1;
+}
 
-    free(response.data);
-    return packData;
+/**
+ * @brief resolve HEAD to the commit it points at
+ *
+ * @param outSha: OUTPUT - 40-char hex SHA (41 bytes)
+ * @return int: 0 on success, -1 if HEAD has no commit yet
+ */
+int resolveHead(char *outSha) {
+    return resolveRef("HEAD", outSha);
+}
+
+/**
+ * @brief resolve what a user typed to a commit SHA
+ * @note Tried in order: a full 40-char SHA, then <name>, refs/<name>,
+ *       refs/tags/<name> and refs/heads/<name>, as git does.
+ *
+ * @param name: SHA, "HEAD", branch, tag or full ref name
+ * @param outSha: OUTPUT - 40-char hex SHA (41 bytes)
+ * @return int: 0 on success, -1 if nothing matches
+ */
+int resolveRevision(const char *name, char *outSha) {
+    unsigned char raw[20];
+    if (strlen(name) == 40 && hexToRaw(name, raw) == 0) {
+        memcpy(outSha, name, 41);
+        return 0;
+    }
+
+    // Only refs/... and HEAD-like names are looked up as given (not .git/config and friends)
+    int pseudoRef = strncmp(name, "refs/", 5) == 0 || strspn(name, "ABCDEFGHIJKLMNOPQRSTUVWXYZ_") == strlen(name);
+    static const char *patterns[] = { "%s", "refs/%s", "refs/tags/%s", "refs/heads/%s" };
+    for (size_t i = pseudoRef ? 0 : 1; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+        char ref[512];
+        snprintf(ref, sizeof(ref), patterns[i], name);
+        if (resolveRef(ref, outSha) == 0) return 0;
+    }
+    return -1;
 }
 
+/**
+ * @brief Write a ref file atomically (via "<ref>.lock" and rename)
+ *
+ * @return int: 0 on success, -1 on error
+ */
+static int writeRefFile(const char *ref, const char *content) {
+    char path[600], lockPath[620];
+    snprintf(path, sizeof(path), ".git/%s", ref);
+    snprintf(lockPath, sizeof(lockPath), "%s.lock", path);
+
+    // Create the leading directories (refs/heads/feature/x)
+    for (char *slash = strchr(path + 5, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        mkdir(path, 0755);
+        *slash = '/';
+    }
+
+    FILE *file = fopen(lockPath, "wx");
+    if (!file) {
+        fprintf(stderr, "Error: Could not lock %s\n", path);
+        return -1;
+    }
+    fprintf(file, "%s\n", content);
+    if (fclose(file) != 0 || rename(lockPath, path) != 0) {
+        fprintf(stderr, "Error: Could not update %s\n", path);
+        unlink(lockPath);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief point a ref at a commit (written atomically via "<ref>.lock")
+ *
+ * @param ref: ref name relative to .git, e.g. "refs/heads/main" ("HEAD" detaches HEAD)
+ * @param sha: 40-char hex SHA
+ * @return int: 0 on success, -1 on error
+ */
+int updateRef(const char *ref, const char *sha) {
+    return writeRefFile(ref, sha);
+}
+
+/**
+ * @brief make a ref symbolic, e.g. HEAD → refs/heads/main
+ *
+ * @param ref: ref name relative to .git
+ * @param target: ref it points at
+ * @return int: 0 on success, -1 on error
+ */
+int updateSymbolicRef(const char *ref, const char *target) {
+    char content[600];
+    snprintf(content, sizeof(content), "ref: %s", target);
+    return writeRefFile(ref, content);
+}
+
+/**
+ * @brief Call back for every loose ref under dir (recursively)
+ *
+ * @param dir: directory relative to .git, e.g. "refs"
+ * @return int: 0 when done, the callback's non-zero result if it stopped
+ */
+static int forEachLooseRef(const char *dir, RefCallback callback, void *arg) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), ".git/%s", dir);
+    DIR *handle = opendir(path);
+    if (!handle) return 0;
+
+    int result = 0;
+    struct dirent *entry;
+    while (result == 0 && (entry = readdir(handle))) {
+        if (entry->d_name[0] == '.') continue;
+        size_t len = strlen(entry->d_name);
+        if (len > 5 && strcmp(entry->d_name + len - 5, ".lock") == 0) continue;
+
+        // A truncated name would be looked up as a different ref
+        char ref[PATH_MAX];
+        int refLen = snprintf(ref, sizeof(ref), "%s/%s", dir, entry->d_name);
+        int pathLen = snprintf(path, sizeof(path), ".git/%s", ref);
+        if (refLen < 0 || (size_t)refLen >= sizeof(ref) || pathLen < 0 || (size_t)pathLen >= sizeof(path)) {
+            fprintf(stderr, "Error: Ref name %s/%s is too long, skipping it\n", dir, entry->d_name);
+            continue;
+        }
+        struct stat st;
+        if (stat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            result = forEachLooseRef(ref, callback, arg);
+        } else {
+            char sha[41];
+            if (resolveRef(ref, sha) == 0) result = callback(ref, sha, arg);
+        }
+    }
+    closedir(handle);
+    return result;
+}
+
+/**
+ * @brief Call back for every ref: loose refs under .git/refs, then those only in
+ *        .git/packed-refs
+ *
+ * @param callback: gets the ref name ("refs/heads/main") and its 40-char hex SHA;
+ *                  a non-zero return stops the iteration
+ * @return int: 0 when done, the callback's non-zero result if it stopped
+ */
+int forEachRef(RefCallback callback, void *arg) {
+    int result = forEachLooseRef("refs", callback, arg);
+
+    FILE *file = result == 0 ? fopen(".git/packed-refs", "r") : NULL;
+    if (!file) return result;
+    char line[1024];
+    while (result == 0 && fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '^' || strlen(line) < 42) continue;
+        line[strcspn(line, "\r\n")] = '\0';
+        line[40] = '\0';
+
+        // A loose ref of the same name has been reported already
+        char path[PATH_MAX];
+        int pathLen = snprintf(path, sizeof(path), ".git/%s", line + 41);
+        if (pathLen < 0 || (size_t)pathLen >= sizeof(path)) continue;  // too long to be a loose ref
+        if (access(path, F_OK) == 0) continue;
+        result = callback(line + 41, line, arg);
+    }
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../utils/utils.h"
+#include "../storage/object.h"
+#include "git.h"
+
+/*
+Rename detection flow (on the file pairs of a tree diff):
+deleted files (with findCopies, modified files too) are sources, added files destinations
+    → exact: sources go into a hash map keyed by blob SHA, and each destination looks
+      its SHA up there, so a move of thousands of unchanged files costs O(n)
+    → inexact, for the regular files left over:
+        every blob fingerprinted once (in parallel) into a sorted array of
+        (chunk hash, bytes); a chunk ends at a newline or after 64 bytes
+        every destination scored against every source (in parallel): bytes in common
+        come from merging the two arrays; pairs whose sizes alone rule out the minimum
+        score are skipped without looking at them
+        the best pairs win: sorted by score, each destination taken once, each source
+        once as a rename (with findCopies, used sources are tried again as copies)
+    → queue rebuilt in its order: a paired destination becomes R/C in its place, a
+      deleted source that was used disappears; of several uses of one deleted source the
+      last is the rename, the others are copies (a modified source only gives copies)
+Scores use git's scale (RENAME_SCORE_MAX = identical), so percentages come out the same.
+*/
+
+#define CHUNK_MAX 64
+#define CHUNK_HASH_BASE 107927
+#define RENAME_CANDIDATES 4
+
+/**
+ * @brief content summary of one blob
+ * @note hashes ascending, counts[i]: bytes in chunks hashing to hashes[i]
+ */
+typedef struct {
+    uint32_t *hashes;
+    uint32_t *counts;
+    size_t count;
+    size_t size;
+    int failed;
+} Fingerprint;
+
+typedef struct {
+    size_t pair;        // index in the queue
+    int uses;           // destinations given to it, + 1 for a modified file (it stays)
+    Fingerprint print;
+} RenameSource;
+
+typedef struct {
+    int score;
+    long source;
+} RenameCandidate;
+
+typedef struct {
+    size_t pair;
+    long source;        // -1 until paired
+    int score;
+    Fingerprint print;
+    RenameCandidate candidates[RENAME_CANDIDATES];
+} RenameDestination;
+
+/**
+ * @brief state of one detectRenames() run
+ */
+typedef struct {
+    DiffQueue *queue;
+    RenameSource *sources;
+    size_t sourceCount;
+    RenameDestination *destinations;
+    size_t destinationCount;
+    int minScore;
+    // Blobs to fingerprint: for each, its SHA and where the result goes
+    const unsigned char **printShas;
+    Fingerprint **prints;
+    size_t printCount;
+} RenameState;
+
+static int isRegularMode(uint32_t mode) {
+    return (mode & 0170000) == 0100000;
+}
+
+static const char* baseName(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static int sameBaseName(const char *a, const char *b) {
+    return strcmp(baseName(a), baseName(b)) == 0;
+}
+
+static int compareChunks(const void *a, const void *b) {
+    const uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief Summarize a blob as (chunk hash, bytes) pairs, in the way git's diffcore-delta does
+ */
+static void fingerprintBuffer(const unsigned char *data, size_t size, Fingerprint *print) {
+    int isText = !bufferIsBinary(data, size);
+
+    // Each chunk as (hash << 32 | bytes), sorted and then folded per hash
+    size_t count = 0, capacity = 64;
+    uint64_t *chunks = malloc(capacity * sizeof(uint64_t));
+    uint32_t accum1 = 0, accum2 = 0, bytes = 0;
+    for (size_t i = 0; i < size; i++) {
+        unsigned int c = data[i];
+        if (isText && c == '\r' && i + 1 < size && data[i + 1] == '\n') continue;
+        uint32_t old1 = accum1;
+        accum1 = (accum1 << 7) ^ (accum2 >> 25);
+        accum2 = (accum2 << 7) ^ (old1 >> 25);
+        accum1 += c;
+        if (++bytes < CHUNK_MAX && c != '\n' && i + 1 < size) continue;
+
+        if (count == capacity) {
+            capacity *= 2;
+            chunks = realloc(chunks, capacity * sizeof(uint64_t));
+        }
+        uint32_t hash = (accum1 + accum2 * 0x61) % CHUNK_HASH_BASE;
+        chunks[count++] = (uint64_t)hash << 32 | bytes;
+        accum1 = accum2 = bytes = 0;
+    }
+    qsort(chunks, count, sizeof(uint64_t), compareChunks);
+
+    print->hashes = malloc((count + 1) * sizeof(uint32_t));
+    print->counts = malloc((count + 1) * sizeof(uint32_t));
+    print->count = 0;
+    print->size = size;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t hash = chunks[i] >> 32, chunkBytes = (uint32_t)chunks[i];
+        if (print->count > 0 && print->hashes[print->count - 1] == hash) {
+            print->counts[print->count - 1] += chunkBytes;
+        } else {
+            print->hashes[print->count] = hash;
+            print->counts[print->count++] = chunkBytes;
+        }
+    }
+    free(chunks);
+}
+
+static void freeFingerprint(Fingerprint *print) {
+    free(print->hashes);
+    free(print->counts);
+}
+
+static void fingerprintBlob(size_t i, void *arg) {
+    RenameState *state = arg;
+    char hexSha[41];
+    rawToHex(state->printShas[i], hexSha);
+
+    ObjectType type;
+    unsigned char *content;
+    size_t size;
+    if (odbReadObject(hexSha, &type, &content, &size) != 0) {
+        state->prints[i]->failed = 1;
+        return;
+    }
+    fingerprintBuffer(content, size, state->prints[i]);
+    free(content);
+}
+
+/**
+ * @brief Score how much of src survives in dst
+ *
+ * @return int: 0..RENAME_SCORE_MAX, 0 if it can't reach minScore
+ */
+static int similarity(const Fingerprint *src, const Fingerprint *dst, int minScore) {
+    if (src->failed || dst->failed || dst->size == 0) return 0;
+    size_t maxSize = src->size > dst->size ? src->size : dst->size;
+    size_t minSize = src->size < dst->size ? src->size : dst->size;
+    if ((double)(maxSize - minSize) * RENAME_SCORE_MAX > (double)(RENAME_SCORE_MAX - minScore) * maxSize) return 0;
+
+    // Bytes of src found again in dst
+    uint64_t copied = 0;
+    size_t s = 0, d = 0;
+    while (s < src->count && d < dst->count) {
+        if (src->hashes[s] < dst->hashes[d]) {
+            s++;
+        } else if (src->hashes[s] > dst->hashes[d]) {
+            d++;
+        } else {
+            copied += src->counts[s] < dst->counts[d] ? src->counts[s] : dst->counts[d];
+            s++;
+            d++;
+        }
+    }
+    return (int)(copied * RENAME_SCORE_MAX / maxSize);
+}
+
+/**
+ * @brief Worker: the best few sources for one destination
+ */
+static void scoreDestination(size_t i, void *arg) {
+    RenameState *state = arg;
+    RenameDestination *dst = &state->destinations[i];
+    for (int k = 0; k < RENAME_CANDIDATES; k++) {
+        dst->candidates[k] = (RenameCandidate){ -1, -1 };
+    }
+    if (dst->source >= 0 || !isRegularMode(state->queue->pairs[dst->pair].newMode)) return;
+
+    for (size_t s = 0; s < state->sourceCount; s++) {
+        const RenameSource *src = &state->sources[s];
+        if (!isRegularMode(state->queue->pairs[src->pair].oldMode)) continue;
+        int score = similarity(&src->print, &dst->print, state->minScore);
+        if (score < state->minScore) continue;
+
+        // Keep the list sorted, best first
+        int k = RENAME_CANDIDATES;
+        while (k > 0 && dst->candidates[k - 1].score < score) k--;
+        if (k == RENAME_CANDIDATES) continue;
+        memmove(&dst->candidates[k + 1], &dst->candidates[k], (RENAME_CANDIDATES - k - 1) * sizeof(RenameCandidate));
+        dst->candidates[k] = (RenameCandidate){ score, (long)s };
+    }
+}
+
+/**
+ * @brief Pair destinations with sources of the same SHA through a hash map
+ */
+static void findExactRenames(RenameState *state, int allowUsed) {
+    size_t capacity = 16;
+    while (capacity < state->sourceCount * 2) capacity <<= 1;
+    long *slots = malloc(capacity * sizeof(long));
+    for (size_t i = 0; i < capacity; i++) slots[i] = -1;
+
+    const FilePair *pairs = state->queue->pairs;
+    for (size_t s = 0; s < state->sourceCount; s++) {
+        const unsigned char *sha = pairs[state->sources[s].pair].oldSha;
+        size_t slot = ((uint32_t)sha[0] << 24 | sha[1] << 16 | sha[2] << 8 | sha[3]) & (capacity - 1);
+        while (slots[slot] >= 0) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = (long)s;
+    }
+
+    for (size_t d = 0; d < state->destinationCount; d++) {
+        RenameDestination *dst = &state->destinations[d];
+        const FilePair *target = &pairs[dst->pair];
+        const unsigned char *sha = target->newSha;
+        size_t slot = ((uint32_t)sha[0] << 24 | sha[1] << 16 | sha[2] << 8 | sha[3]) & (capacity - 1);
+
+        // Unused sources first, then ones with the same file name
+        long best = -1;
+        int bestRank = -1;
+        for (; slots[slot] >= 0; slot = (slot + 1) & (capacity - 1)) {
+            RenameSource *src = &state->sources[slots[slot]];
+            const FilePair *source = &pairs[src->pair];
+            if (memcmp(source->oldSha, sha, 20) != 0 || (source->oldMode & 0170000) != (target->newMode & 0170000)) {
+                continue;
+            }
+            if (src->uses > 0 && !allowUsed) continue;
+            int rank = (src->uses == 0) + sameBaseName(source->oldPath, target->newPath);
+            if (rank > bestRank) {
+                best = slots[slot];
+                bestRank = rank;
+            }
+        }
+        if (best >= 0) {
+            dst->source = best;
+            dst->score = RENAME_SCORE_MAX;
+            state->sources[best].uses++;
+        }
+    }
+    free(slots);
+}
+
+static int compareCandidateEntries(const void *a, const void *b) {
+    const long *x = a, *y = b;  // { score, destination, source }
+    if (x[0] != y[0]) return x[0] > y[0] ? -1 : 1;
+    if (x[1] != y[1]) return x[1] < y[1] ? -1 : 1;
+    return (x[2] > y[2]) - (x[2] < y[2]);
+}
+
+/**
+ * @brief Hand out the scored candidates, best first
+ *
+ * @param allowUsed: sources already given to a destination may be used again (copies)
+ */
+static void assignCandidates(RenameState *state, long (*entries)[3], size_t count, int allowUsed) {
+    for (size_t i = 0; i < count; i++) {
+        RenameDestination *dst = &state->destinations[entries[i][1]];
+        RenameSource *src = &state->sources[entries[i][2]];
+        if (dst->source >= 0 || (src->uses > 0 && !allowUsed)) continue;
+        dst->source = entries[i][2];
+        dst->score = (int)entries[i][0];
+        src->uses++;
+    }
+}
+
+static void findInexactRenames(RenameState *state, int findCopies) {
+    // Fingerprint every regular-file blob still in play, once
+    state->printShas = malloc((state->sourceCount + state->destinationCount) * sizeof(unsigned char *));
+    state->prints = malloc((state->sourceCount + state->destinationCount) * sizeof(Fingerprint *));
+    size_t left = 0;
+    for (size_t d = 0; d < state->destinationCount; d++) {
+        RenameDestination *dst = &state->destinations[d];
+        const FilePair *pair = &state->queue->pairs[dst->pair];
+        if (dst->source >= 0 || !isRegularMode(pair->newMode)) continue;
+        state->printShas[state->printCount] = pair->newSha;
+        state->prints[state->printCount++] = &dst->print;
+        left++;
+    }
+    if (left == 0) return;
+    for (size_t s = 0; s < state->sourceCount; s++) {
+        const FilePair *pair = &state->queue->pairs[state->sources[s].pair];
+        if (!isRegularMode(pair->oldMode)) continue;
+        state->printShas[state->printCount] = pair->oldSha;
+        state->prints[state->printCount++] = &state->sources[s].print;
+    }
+    parallelFor(onlineCpus(), state->printCount, fingerprintBlob, state);
+    parallelFor(onlineCpus(), state->destinationCount, scoreDestination, state);
+
+    size_t count = 0;
+    long (*entries)[3] = malloc((state->destinationCount * RENAME_CANDIDATES + 1) * sizeof(*entries));
+    for (size_t d = 0; d < state->destinationCount; d++) {
+        const RenameDestination *dst = &state->destinations[d];
+        for (int k = 0; k < RENAME_CANDIDATES && dst->candidates[k].source >= 0; k++) {
+            entries[count][0] = dst->candidates[k].score;
+            entries[count][1] = (long)d;
+            entries[count][2] = dst->candidates[k].source;
+            count++;
+        }
+    }
+    qsort(entries, count, sizeof(*entries), compareCandidateEntries);
+    assignCandidates(state, entries, count, 0);
+    if (findCopies) assignCandidates(state, entries, count, 1);
+    free(entries);
+}
+
+/**
+ * @brief Turn deleted + added pairs into renames (and copies) where the content says so
+ *
+ * @note Exact renames are found first through a hash map on the blob SHA; only what is
+ *       left is fingerprinted and compared, in parallel. Destinations keep their place
+ *       in the queue, as 'R' or 'C' with the similarity in percent.
+ *
+ * @param queue: file pairs of a tree diff (rewritten in place)
+ * @param options: copies and minimum score (NULL = renames only, RENAME_DEFAULT_SCORE)
+ * @return int: number of renames and copies found
+ */
+int detectRenames(DiffQueue *queue, const RenameOptions *options) {
+    RenameOptions defaults = { 0, RENAME_DEFAULT_SCORE };
+    if (!options) options = &defaults;
+
+    RenameState state = { .queue = queue, .minScore = options->minScore };
+    state.sources = calloc(queue->count + 1, sizeof(RenameSource));
+    state.destinations = calloc(queue->count + 1, sizeof(RenameDestination));
+    for (size_t i = 0; i < queue->count; i++) {
+        const FilePair *pair = &queue->pairs[i];
+        if (pair->status == 'A' && pair->newMode != 0160000) {
+            state.destinations[state.destinationCount++] = (RenameDestination){ .pair = i, .source = -1 };
+        } else if ((pair->status == 'D' || (options->findCopies && pair->status == 'M')) && pair->oldMode != 0160000) {
+            state.sources[state.sourceCount++] = (RenameSource){ .pair = i, .uses = pair->status == 'M' };
+        }
+    }
+
+    int found = 0;
+    if (state.sourceCount > 0 && state.destinationCount > 0) {
+        findExactRenames(&state, options->findCopies);
+        if (options->minScore < RENAME_SCORE_MAX) findInexactRenames(&state, options->findCopies);
+
+        // Rebuild the queue: destinations become renames or copies, used deletions go
+        DiffQueue result = {0};
+        long *sourceOf = malloc((queue->count + 1) * sizeof(long));
+        long *destinationAt = malloc((queue->count + 1) * sizeof(long));
+        int *usedSource = calloc(queue->count + 1, sizeof(int));
+        for (size_t i = 0; i < queue->count; i++) destinationAt[i] = -1;
+        for (size_t d = 0; d < state.destinationCount; d++) destinationAt[state.destinations[d].pair] = (long)d;
+        for (size_t s = 0; s < state.sourceCount; s++) {
+            usedSource[state.sources[s].pair] = state.sources[s].uses > 0 && queue->pairs[state.sources[s].pair].status == 'D';
+        }
+
+        for (size_t i = 0; i < queue->count; i++) {
+            FilePair *pair = &queue->pairs[i];
+            long d = destinationAt[i];
+            if (d >= 0 && state.destinations[d].source >= 0) {
+                const RenameDestination *dst = &state.destinations[d];
+                const FilePair *source = &queue->pairs[state.sources[dst->source].pair];
+                FilePair *renamed = diffQueueAdd(&result, 'R', source->oldPath, pair->newPath);
+                renamed->score = dst->score * 100 / RENAME_SCORE_MAX;
+                renamed->oldMode = source->oldMode;
+                memcpy(renamed->oldSha, source->oldSha, 20);
+                renamed->newMode = pair->newMode;
+                memcpy(renamed->newSha, pair->newSha, 20);
+                sourceOf[result.count - 1] = dst->source;
+                found++;
+            } else if (!usedSource[i]) {
+                FilePair *kept = diffQueueAdd(&result, pair->status, pair->oldPath, pair->newPath);
+                char *oldPath = kept->oldPath, *newPath = kept->newPath;
+                *kept = *pair;
+                kept->oldPath = oldPath;
+                kept->newPath = newPath;
+                sourceOf[result.count - 1] = -1;
+            }
+        }
+
+        // All but the last use of a source are copies
+        for (size_t i = 0; i < result.count; i++) {
+            if (sourceOf[i] >= 0 && --state.sources[sourceOf[i]].uses > 0) result.pairs[i].status = 'C';
+        }
+
+        free(sourceOf);
+        free(destinationAt);
+        free(usedSource);
+        freeDiffQueue(queue);
+        *queue = result;
+    }
+
+    for (size_t s = 0; s < state.sourceCount; s++) freeFingerprint(&state.sources[s].print);
+    for (size_t d = 0; d < state.destinationCount; d++) freeFingerprint(&state.destinations[d].print);
+    free(state.printShas);
+    free(state.prints);
+    free(state.sources);
+    free(state.destinations);
+    return found;
+}
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../utils/utils.h"
+#include "git.h"
+
+/*
+History walk flow:
+revisions added: included ones (B) and excluded ones (^A, or A in A..B)
+    → each parsed (header only) and queued in a binary heap ordered by committer date,
+      newest first; ties go to the commit queued first (git's default order)
+    → nothing excluded: commits come out as they are popped, their parents queued once
+      (COMMIT_SEEN), so --max-count stops the walk after that many commits
+    → something excluded (a limited walk): popping goes on until the queue only holds
+      excluded commits (and a few pops more, for commits with skewed clocks); excluded
+      commits pass COMMIT_UNINTERESTING on to their parents, down through commits
+      already walked; included commits are collected, and those still included at the
+      end come out in the order they were popped
+--first-parent: only parents[0] of a merge is followed
+isAncestor(a, b): depth-first from b; a commit whose generation is not above a's
+can't lead to a (unless it is a), so its parents are never read
+*/
+
+#define REV_WALK_SLOP 5
+
+typedef struct {
+    ParsedCommit *commit;
+    uint64_t order;
+} QueuedCommit;
+
+struct RevWalk {
+    CommitStore *store;
+    RevWalkOptions options;
+    QueuedCommit *heap;
+    size_t heapCount, heapCapacity;
+    uint64_t nextOrder;
+    int limited;        // an excluded revision was added
+    int prepared;       // limited walk done, results in list
+    ParsedCommit **list;
+    size_t listCount, listCapacity, listNext;
+    ParsedCommit **stack;  // for markUninteresting
+    size_t stackCapacity;
+    long returned;
+};
+
+/**
+ * @brief Start a history walk
+ *
+ * @param store: commits are looked up and parsed there (must outlive the walk)
+ * @param options: NULL = all parents, no limit
+ * @return RevWalk*: free with freeRevWalk
+ */
+RevWalk* createRevWalk(CommitStore *store, const RevWalkOptions *options) {
+    RevWalk *walk = calloc(1, sizeof(RevWalk));
+    walk->store = store;
+    walk->options.maxCount = -1;
+    if (options) walk->options = *options;
+    return walk;
+}
+
+void freeRevWalk(RevWalk *walk) {
+    if (!walk) return;
+    free(walk->heap);
+    free(walk->list);
+    free(walk->stack);
+    free(walk);
+}
+
+static int queuedBefore(const QueuedCommit *a, const QueuedCommit *b) {
+    if (a->commit->date != b->commit->date) return a->commit->date > b->commit->date;
+    return a->order < b->order;
+}
+
+static void heapPush(RevWalk *walk, ParsedCommit *commit) {
+    if (walk->heapCount == walk->heapCapacity) {
+        walk->heapCapacity = walk->heapCapacity ? walk->heapCapacity * 2 : 64;
+        walk->heap = realloc(walk->heap, walk->heapCapacity * sizeof(QueuedCommit));
+    }
+    QueuedCommit item = { commit, walk->nextOrder++ };
+    size_t i = walk->heapCount++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!queuedBefore(&item, &walk->heap[parent])) break;
+        walk->heap[i] = walk->heap[parent];
+        i = parent;
+    }
+    walk->heap[i] = item;
+}
+
+static ParsedCommit* heapPop(RevWalk *walk) {
+    ParsedCommit *top = walk->heap[0].commit;
+    QueuedCommit last = walk->heap[--walk->heapCount];
+    size_t i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= walk->heapCount) break;
+        if (child + 1 < walk->heapCount && queuedBefore(&walk->heap[child + 1], &walk->heap[child])) child++;
+        if (!queuedBefore(&walk->heap[child], &last)) break;
+        walk->heap[i] = walk->heap[child];
+        i = child;
+    }
+    if (walk->heapCount > 0) walk->heap[i] = last;
+    return top;
+}
+
+static uint32_t followedParents(const RevWalk *walk, const ParsedCommit *commit) {
+    return walk->options.firstParent && commit->parentCount > 1 ? 1 : commit->parentCount;
+}
+
+/**
+ * @brief Exclude a commit, and everything below it that the walk already went through
+ */
+static void markUninteresting(RevWalk *walk, ParsedCommit *commit) {
+    size_t depth = 0;
+    if (commit->flags & COMMIT_UNINTERESTING) return;
+    commit->flags |= COMMIT_UNINTERESTING;
+    if (!(commit->flags & COMMIT_WALKED)) return;
+
+    if (walk->stackCapacity == 0) {
+        walk->stackCapacity = 64;
+        walk->stack = malloc(walk->stackCapacity * sizeof(ParsedCommit *));
+    }
+    walk->stack[depth++] = commit;
+    while (depth > 0) {
+        ParsedCommit *current = walk->stack[--depth];
+        for (uint32_t i = 0; i < followedParents(walk, current); i++) {
+            ParsedCommit *parent = current->parents[i];
+            if (parent->flags & COMMIT_UNINTERESTING) continue;
+            parent->flags |= COMMIT_UNINTERESTING;
+            if (!(parent->flags & COMMIT_WALKED)) continue;
+            if (depth == walk->stackCapacity) {
+                walk->stackCapacity *= 2;
+                walk->stack = realloc(walk->stack, walk->stackCapacity * sizeof(ParsedCommit *));
+            }
+            walk->stack[depth++] = parent;
+        }
+    }
+}
+
+static int queueCommit(RevWalk *walk, ParsedCommit *commit) {
+    if (commit->flags & COMMIT_SEEN) return 0;
+    if (parseCommit(walk->store, commit) != 0) return -1;
+    commit->flags |= COMMIT_SEEN;
+    heapPush(walk, commit);
+    return 0;
+}
+
+/**
+ * @brief Queue a popped commit's parents (excluding them too if it is excluded)
+ */
+static int walkParents(RevWalk *walk, ParsedCommit *commit) {
+    int excluded = (commit->flags & COMMIT_UNINTERESTING) != 0;
+    for (uint32_t i = 0; i < followedParents(walk, commit); i++) {
+        ParsedCommit *parent = commit->parents[i];
+        if (excluded) markUninteresting(walk, parent);
+        if (queueCommit(walk, parent) != 0) return -1;
+    }
+    commit->flags |= COMMIT_WALKED;
+    return 0;
+}
+
+/**
+ * @brief Start the walk at a commit
+ *
+ * @param sha: 20-byte commit SHA
+ * @param uninteresting: exclude it and its ancestors instead
+ * @return int: 0 on success, -1 if it isn't a readable commit (reported)
+ */
+int revWalkAdd(RevWalk *walk, const unsigned char *sha, int uninteresting) {
+    ParsedCommit *commit = lookupCommit(walk->store, sha);
+    if (uninteresting) {
+        markUninteresting(walk, commit);
+        walk->limited = 1;
+    }
+    return queueCommit(walk, commit);
+}
+
+/**
+ * @brief Start the walk at a revision argument: "<rev>", "^<rev>" or "<rev>..<rev>"
+ *        (a missing side of ".." is HEAD)
+ *
+ * @return int: 0 on success, -1 if a revision doesn't name a commit (reported)
+ */
+int revWalkAddArgument(RevWalk *walk, const char *arg) {
+    unsigned char sha[20];
+    const char *dots = strstr(arg, "..");
+    if (!dots) {
+        int excluded = arg[0] == '^';
+        if (resolveCommit(arg + excluded, sha) != 0) return -1;
+        return revWalkAdd(walk, sha, excluded);
+    }
+    if (dots[2] == '.') {
+        fprintf(stderr, "Error: Symmetric differences (A...B) are not supported\n");
+        return -1;
+    }
+
+    char from[256];
+    size_t fromLen = dots - arg;
+    if (fromLen >= sizeof(from)) fromLen = sizeof(from) - 1;
+    memcpy(from, arg, fromLen);
+    from[fromLen] = '\0';
+    const char *to = dots + 2;
+
+    if (resolveCommit(fromLen ? from : "HEAD", sha) != 0 || revWalkAdd(walk, sha, 1) != 0) return -1;
+    if (resolveCommit(*to ? to : "HEAD", sha) != 0) return -1;
+    return revWalkAdd(walk, sha, 0);
+}
+
+/**
+ * @brief Decide whether a limited walk must go on after popping an excluded commit
+ *
+ * @param lastDate: date of the last included commit popped
+ * @return int: the new slop (0 = stop)
+ */
+static int stillInteresting(const RevWalk *walk, int64_t lastDate, int slop) {
+    if (walk->heapCount == 0) return 0;
+    if (lastDate <= walk->heap[0].commit->date) return REV_WALK_SLOP;
+    for (size_t i = 0; i < walk->heapCount; i++) {
+        if (!(walk->heap[i].commit->flags & COMMIT_UNINTERESTING)) return REV_WALK_SLOP;
+    }
+    return slop - 1;
+}
+
+/**
+ * @brief Walk a limited range to its end, collecting the included commits
+ */
+static int limitWalk(RevWalk *walk) {
+    int64_t lastDate = INT64_MAX;
+    int slop = REV_WALK_SLOP;
+    while (walk->heapCount > 0) {
+        ParsedCommit *commit = heapPop(walk);
+        if (walkParents(walk, commit) != 0) return -1;
+        if (commit->flags & COMMIT_UNINTERESTING) {
+            slop = stillInteresting(walk, lastDate, slop);
+            if (slop == 0) break;
+            continue;
+        }
+        lastDate = commit->date;
+        if (walk->listCount == walk->listCapacity) {
+            walk->listCapacity = walk->listCapacity ? walk->listCapacity * 2 : 256;
+            walk->list = realloc(walk->list, walk->listCapacity * sizeof(ParsedCommit *));
+        }
+        walk->list[walk->listCount++] = commit;
+    }
+    walk->prepared = 1;
+    return 0;
+}
+
+/**
+ * @brief Get the next commit of the walk
+ *
+ * @param out: OUTPUT - the commit (parsed)
+ * @return int: 1 if a commit was returned, 0 at the end, -1 on error (reported)
+ */
+int revWalkNext(RevWalk *walk, ParsedCommit **out) {
+    if (walk->options.maxCount >= 0 && walk->returned >= walk->options.maxCount) return 0;
+
+    if (walk->limited) {
+        if (!walk->prepared && limitWalk(walk) != 0) return -1;
+        while (walk->listNext < walk->listCount) {
+            ParsedCommit *commit = walk->list[walk->listNext++];
+            if (commit->flags & COMMIT_UNINTERESTING) continue;
+            walk->returned++;
+            *out = commit;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (walk->heapCount == 0) return 0;
+    ParsedCommit *commit = heapPop(walk);
+    if (walkParents(walk, commit) != 0) return -1;
+    walk->returned++;
+    *out = commit;
+    return 1;
+}
+
+/**
+ * @brief Check whether one commit is reachable from another
+ *
+ * @note Generation numbers from the commit-graph cut the search short: a parent
+ *       always has a lower generation than its child, so nothing at or below the
+ *       ancestor's generation needs to be walked.
+ *
+ * @return int: 1 if ancestor is reachable from descendant (or the same), 0 if not,
+ *              -1 if a commit can't be read (reported)
+ */
+int isAncestor(CommitStore *store, ParsedCommit *ancestor, ParsedCommit *descendant) {
+    if (parseCommit(store, ancestor) != 0 || parseCommit(store, descendant) != 0) return -1;
+    uint32_t cutoff = ancestor->generation;
+
+    size_t depth = 0, stackCapacity = 64, visitedCount = 0, visitedCapacity = 64;
+    ParsedCommit **stack = malloc(stackCapacity * sizeof(ParsedCommit *));
+    ParsedCommit **visited = malloc(visitedCapacity * sizeof(ParsedCommit *));
+    stack[depth++] = descendant;
+    descendant->flags |= COMMIT_REACHED;
+    visited[visitedCount++] = descendant;
+
+    int result = 0;
+    while (depth > 0 && result == 0) {
+        ParsedCommit *commit = stack[--depth];
+        if (commit == ancestor) {
+            result = 1;
+            break;
+        }
+        if (commit->generation < cutoff || (commit->generation == cutoff && cutoff != COMMIT_GENERATION_INFINITY)) {
+            continue;
+        }
+        for (uint32_t i = 0; i < commit->parentCount; i++) {
+            ParsedCommit *parent = commit->parents[i];
+            if (parent->flags & COMMIT_REACHED) continue;
+            if (parseCommit(store, parent) != 0) {
+                result = -1;
+                break;
+            }
+            parent->flags |= COMMIT_REACHED;
+            if (visitedCount == visitedCapacity) {
+                visitedCapacity *= 2;
+                visited = realloc(visited, visitedCapacity * sizeof(ParsedCommit *));
+            }
+            visited[visitedCount++] = parent;
+            if (depth == stackCapacity) {
+                stackCapacity *= 2;
+                stack = realloc(stack, stackCapacity * sizeof(ParsedCommit *));
+            }
+            stack[depth++] = parent;
+        }
+    }
+
+    for (size_t i = 0; i < visitedCount; i++) visited[i]->flags &= ~COMMIT_REACHED;
+    free(stack);
+    free(visited);
+    return result;
+}
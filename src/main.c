@@ -40,6 +40,34 @@ int main(int argc, char *argv[]) {
         return commitTree(argc, argv);
     } if (strcmp(command, "clone") == 0) {
         return clone(argc, argv);
+    } if (strcmp(command, "index-pack") == 0) {
+        return indexPackCmd(argc, argv);
+    } if (strcmp(command, "unpack-objects") == 0) {
+        return unpackObjects(argc, argv);
+    } if (strcmp(command, "pack-objects") == 0) {
+        return packObjectsCmd(argc, argv);
+    } if (strcmp(command, "add") == 0) {
+        return addCmd(argc, argv);
+    } if (strcmp(command, "update-index") == 0) {
+        return updateIndex(argc, argv);
+    } if (strcmp(command, "status") == 0) {
+        return statusCmd(argc, argv);
+    } if (strcmp(command, "fsmonitor") == 0) {
+        return fsmonitorCmd(argc, argv);
+    } if (strcmp(command, "checkout") == 0) {
+        return checkoutCmd(argc, argv);
+    } if (strcmp(command, "diff-tree") == 0) {
+        return diffTreeCmd(argc, argv);
+    } if (strcmp(command, "diff") == 0) {
+        return diffCmd(argc, argv);
+    } if (strcmp(command, "rev-list") == 0) {
+        return revListCmd(argc, argv);
+    } if (strcmp(command, "log") == 0) {
+        return logCmd(argc, argv);
+    } if (strcmp(command, "commit-graph") == 0) {
+        return commitGraphCmd(argc, argv);
+    } if (strcmp(command, "merge-base") == 0) {
+        return mergeBaseCmd(argc, argv);
     } else {
         fprintf(stderr, "Unknown command %s\n", command);
         return 1;
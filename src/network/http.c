@@ -17,15 +17,21 @@ static size_t writeCallback(void *contents, size_t size, size_t nmemb, void *use
     size_t totalSize = size * nmemb;
     HttpResponse *response = (HttpResponse *)userp;
 
-    // Reallocate memory to hold the new data
-    unsigned char *newData = realloc(response->data, response->size + totalSize);
-    if (newData == NULL) {
-        // Memory allocation failed
-        fprintf(stderr, "Error: Failed to alloate memory for HTTP response\n");
-        return 0; // curl will abort the request
+    // Grow geometrically so a large response costs O(n) copying overall
+    if (response->size + totalSize > response->capacity) {
+        size_t capacity = response->capacity ? response->capacity : 16384;
+        while (capacity < response->size + totalSize) capacity *= 2;
+
+        unsigned char *newData = realloc(response->data, capacity);
+        if (newData == NULL) {
+            // Memory allocation failed
+            fprintf(stderr, "Error: Failed to alloate memory for HTTP response\n");
+            return 0; // curl will abort the request
+        }
+        response->data = newData;
+        response->capacity = capacity;
     }
 
-    response->data = newData;
     memcpy(&(response->data[response->size]), contents, totalSize);
     response->size += totalSize;
 
@@ -46,6 +52,7 @@ int httpGet(const char *url, HttpResponse *response) {
     // Init response
     response->data = NULL;
     response->size = 0;
+    response->capacity = 0;
 
     curl = curl_easy_init();
     if (!curl) {
@@ -92,6 +99,7 @@ int httpPost(const char *url, const char *contentType, const unsigned char *body
     // Init response
     response->data = NULL;
     response->size = 0;
+    response->capacity = 0;
 
     curl = curl_easy_init();
     if (!curl) {
@@ -128,4 +136,74 @@ int httpPost(const char *url, const char *contentType, const unsigned char *body
     }
 
     return 0;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief curl state for a streamed response
+ */
+typedef struct {
+    HttpStreamCallback callback;
+    void *userdata;
+} HttpStream;
+
+/**
+ * @brief Write callback for curl forwarding each chunk to an HttpStreamCallback
+ */
+static size_t streamCallback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t totalSize = size * nmemb;
+    HttpStream *stream = (HttpStream *)userp;
+
+    if (stream->callback((const unsigned char *)contents, totalSize, stream->userdata) != 0) {
+        return 0; // curl will abort the request
+    }
+    return totalSize;
+}
+
+/**
+ * @brief POST request whose response is consumed as it arrives
+ * 
+ * @param url: URL to post to
+ * @param contentType: Content-Type header value
+ * @param body: POST body data
+ * @param bodyLen: length of POST body
+ * @param callback: receives the response chunk by chunk (nothing is buffered)
+ * @param userdata: passed through to callback
+ * @return int: 0 on success, -1 on failure (including an abort from callback)
+ */
+int httpPostStream(const char *url, const char *contentType, const unsigned char *body, size_t bodyLen,
+                   HttpStreamCallback callback, void *userdata) {
+    CURL *curl = curl_easy_init();
+    if (!curl) {
+        fprintf(stderr, "Error: Failed to initialize curl\n");
+        return -1;
+    }
+
+    // set content-type header
+    char contentTypeHeader[128];
+    snprintf(contentTypeHeader, sizeof(contentTypeHeader), "Content-Type: %s", contentType);
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, contentTypeHeader);
+
+    HttpStream stream = { callback, userdata };
+
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, bodyLen);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, streamCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L); // follow redirects
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "git/codecrafters"); // "libcurl-agent/1.0"
+
+    CURLcode res = curl_easy_perform(curl);
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    if (res != CURLE_OK) {
+        fprintf(stderr, "Error: curl POST failed : %s\n", curl_easy_strerror(res));
+        return -1;
+    }
+
+    return 0;
+}
@@ -7,8 +7,12 @@
 typedef struct {
     unsigned char *data;
     size_t size;
+    size_t capacity;
 } HttpResponse;
 
+// Receives response bytes as they arrive; return 0 to continue, -1 to abort
+typedef int (*HttpStreamCallback)(const unsigned char *data, size_t len, void *userdata);
+
 // Generic GET request
 int httpGet(const char *repoUrl, HttpResponse *response);
 
@@ -17,6 +21,11 @@ int httpPost(const char *repoUrl, const char *contentType,
             const unsigned char *body, size_t bodyLen,
             HttpResponse *response);
 
+// POST request whose response is handed to a callback chunk by chunk
+int httpPostStream(const char *repoUrl, const char *contentType,
+            const unsigned char *body, size_t bodyLen,
+            HttpStreamCallback callback, void *userdata);
+
 // Encode a line with 4-char hex length prefix
 // "want <sha>\n" -> "0032want <sha>\n"
 int pktLineEncode(const char *line, char *output, size_t outputSize);
@@ -26,6 +35,9 @@ int pktLineEncode(const char *line, char *output, size_t outputSize);
 int pktLineDecode(const unsigned char *data, size_t dataLen, 
                 char *line, size_t lineSize);
 
+// Parse the 4-char hex length prefix of a pkt-line; -1 if invalid
+int pktLineLength(const unsigned char *prefix);
+
 // Create flush packet "0000"
 void pktLineFlush(char *output);
 
@@ -78,6 +78,26 @@ int pktLineDecode(const unsigned char *data, size_t dataLen, char *line, size_t
     return (int)pktLen;
 };
 
+/**
+ * @brief Parse the 4-char hex length prefix of a pkt-line
+ * 
+ * @param prefix: 4 bytes, e.g. "0032"
+ * @return length including the prefix itself (0 for flush); -1 if not hex
+ */
+int pktLineLength(const unsigned char *prefix) {
+    int length = 0;
+    for (int i = 0; i < 4; i++) {
+        unsigned char c = prefix[i];
+        int digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return -1;
+        length = (length << 4) | digit;
+    }
+    return length;
+}
+
 /**
  * @brief Create flush packet "0000"
  * 
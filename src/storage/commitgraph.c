@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "object.h"
+#include "../utils/utils.h"
+
+/*
+Commit-graph file (.git/objects/info/commit-graph), integers big-endian:
+header: "CGPH", version 1, hash version 1 (SHA-1), chunk count, 0 base graphs
+chunk table: (chunk count + 1) x { 4-byte id, 8-byte offset }; id 0 marks the end
+    OIDF: 256 cumulative counts of commits by first SHA byte
+    OIDL: the commits' SHAs, sorted; a commit's index here is its position
+    CDAT: per position: tree SHA, first and second parent position (0x70000000 = none;
+          a second one with the top bit set is where the rest start in EDGE), then
+          generation (30 bits) and commit time (34 bits) in 8 bytes
+    EDGE: parents of octopus merges past the first; the last of each list has the top bit set
+trailer: SHA-1 of everything before it
+A reader maps the file; a commit is found through OIDF and a binary search in OIDL,
+and from then on everything (parents included) is a position indexing CDAT.
+Generations here are topological levels: 1 for a root, else 1 + the highest parent's.
+*/
+
+#define GRAPH_SIGNATURE 0x43475048  // "CGPH"
+#define GRAPH_CHUNK_OIDF 0x4f494446
+#define GRAPH_CHUNK_OIDL 0x4f49444c
+#define GRAPH_CHUNK_CDAT 0x43444154
+#define GRAPH_CHUNK_EDGE 0x45444745
+#define GRAPH_HEADER_SIZE 8
+#define GRAPH_CDAT_WIDTH 36
+#define GRAPH_PARENT_NONE 0x70000000
+#define GRAPH_EDGE_FLAG 0x80000000
+#define GRAPH_EDGE_MASK 0x7fffffff
+#define GRAPH_GENERATION_MAX 0x3fffffff
+#define GRAPH_DATE_MAX 0x3ffffffffLL
+
+/**
+ * @brief mapped commit-graph file
+ * @note Pointers into the mapping:
+ *      fanout: 256 cumulative counts
+ *      shas: count x 20-byte sorted SHAs
+ *      data: count x GRAPH_CDAT_WIDTH rows
+ *      edges/edgeCount: extra parent positions (NULL if no octopus merges)
+ */
+struct CommitGraph {
+    const unsigned char *map;
+    size_t mapSize;
+    uint32_t count;
+    const unsigned char *fanout;
+    const unsigned char *shas;
+    const unsigned char *data;
+    const unsigned char *edges;
+    size_t edgeCount;
+};
+
+static uint32_t readBe32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+static void putBe32(unsigned char *p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static uint64_t readBe64(const unsigned char *p) {
+    return (uint64_t)readBe32(p) << 32 | readBe32(p + 4);
+}
+
+static void putBe64(unsigned char *p, uint64_t value) {
+    putBe32(p, value >> 32);
+    putBe32(p + 4, (uint32_t)value);
+}
+
+/**
+ * @brief Map a commit-graph file and check its layout
+ *
+ * @param path: e.g. ".git/objects/info/commit-graph"
+ * @return CommitGraph*: the graph, NULL if there is none or it is unusable (reported)
+ */
+CommitGraph* openCommitGraph(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < GRAPH_HEADER_SIZE + 12 + 20) {
+        close(fd);
+        fprintf(stderr, "Error: Commit-graph %s is too small\n", path);
+        return NULL;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    CommitGraph *graph = calloc(1, sizeof(CommitGraph));
+    graph->map = map;
+    graph->mapSize = st.st_size;
+
+    const unsigned char *header = graph->map;
+    int chunkCount = header[6];
+    size_t end = graph->mapSize - 20;
+    const char *problem = NULL;
+    if (readBe32(header) != GRAPH_SIGNATURE || header[4] != 1 || header[5] != 1) {
+        problem = "is not a version 1 SHA-1 commit-graph";
+    } else if (GRAPH_HEADER_SIZE + (size_t)(chunkCount + 1) * 12 > end) {
+        problem = "is truncated";
+    }
+
+    size_t oidlSize = 0, cdatSize = 0, edgeSize = 0;
+    for (int i = 0; i < chunkCount && !problem; i++) {
+        const unsigned char *entry = header + GRAPH_HEADER_SIZE + i * 12;
+        uint64_t offset = readBe64(entry + 4), next = readBe64(entry + 16);
+        if (offset > next || next > end) {
+            problem = "has a bad chunk table";
+            break;
+        }
+        const unsigned char *chunk = graph->map + offset;
+        size_t size = next - offset;
+        switch (readBe32(entry)) {
+        case GRAPH_CHUNK_OIDF:
+            if (size != 256 * 4) problem = "has a bad fanout";
+            graph->fanout = chunk;
+            break;
+        case GRAPH_CHUNK_OIDL:
+            graph->shas = chunk;
+            oidlSize = size;
+            break;
+        case GRAPH_CHUNK_CDAT:
+            graph->data = chunk;
+            cdatSize = size;
+            break;
+        case GRAPH_CHUNK_EDGE:
+            graph->edges = chunk;
+            edgeSize = size;
+            break;
+        default:
+            break;  // chunks this reader doesn't use
+        }
+    }
+    if (!problem && (!graph->fanout || !graph->shas || !graph->data)) problem = "is missing a required chunk";
+    if (!problem) {
+        graph->count = readBe32(graph->fanout + 255 * 4);
+        graph->edgeCount = edgeSize / 4;
+        if (oidlSize != (size_t)graph->count * 20 || cdatSize != (size_t)graph->count * GRAPH_CDAT_WIDTH) {
+            problem = "has chunks of the wrong size";
+        }
+        for (int byte = 1; byte < 256 && !problem; byte++) {
+            if (readBe32(graph->fanout + byte * 4) < readBe32(graph->fanout + (byte - 1) * 4)) problem = "has a bad fanout";
+        }
+    }
+    if (problem) {
+        fprintf(stderr, "Error: Commit-graph %s %s\n", path, problem);
+        closeCommitGraph(graph);
+        return NULL;
+    }
+    return graph;
+}
+
+void closeCommitGraph(CommitGraph *graph) {
+    if (!graph) return;
+    munmap((void *)graph->map, graph->mapSize);
+    free(graph);
+}
+
+uint32_t commitGraphCount(const CommitGraph *graph) {
+    return graph->count;
+}
+
+const unsigned char* commitGraphSha(const CommitGraph *graph, uint32_t position) {
+    return graph->shas + (size_t)position * 20;
+}
+
+/**
+ * @brief Find a commit's position in the graph
+ *
+ * @param sha: 20-byte commit SHA
+ * @param outPosition: OUTPUT - its position
+ * @return int: 1 if the graph has it, 0 if not
+ */
+int commitGraphFind(const CommitGraph *graph, const unsigned char *sha, uint32_t *outPosition) {
+    uint32_t low = sha[0] ? readBe32(graph->fanout + (sha[0] - 1) * 4) : 0;
+    uint32_t high = readBe32(graph->fanout + sha[0] * 4);
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        int cmp = memcmp(graph->shas + (size_t)mid * 20, sha, 20);
+        if (cmp == 0) {
+            *outPosition = mid;
+            return 1;
+        }
+        if (cmp < 0) low = mid + 1;
+        else high = mid;
+    }
+    return 0;
+}
+
+/**
+ * @brief Read the tree, generation and commit time at a position
+ */
+void commitGraphEntry(const CommitGraph *graph, uint32_t position, CommitGraphEntry *out) {
+    const unsigned char *row = graph->data + (size_t)position * GRAPH_CDAT_WIDTH;
+    uint32_t high = readBe32(row + 28);
+    out->tree = row;
+    out->generation = high >> 2;
+    out->date = (int64_t)(high & 3) << 32 | readBe32(row + 32);
+}
+
+/**
+ * @brief Read the parent positions at a position
+ *
+ * @param outParents: OUTPUT - up to max positions, in the commit's parent order
+ * @return int: number of parents (may be more than max), -1 if the graph is corrupt (reported)
+ */
+int commitGraphParents(const CommitGraph *graph, uint32_t position, uint32_t *outParents, uint32_t max) {
+    const unsigned char *row = graph->data + (size_t)position * GRAPH_CDAT_WIDTH;
+    uint32_t first = readBe32(row + 20), second = readBe32(row + 24);
+    int count = 0;
+    if (first == GRAPH_PARENT_NONE) return 0;
+    if (first >= graph->count) goto corrupt;
+    if ((uint32_t)count < max) outParents[count] = first;
+    count++;
+    if (second == GRAPH_PARENT_NONE) return count;
+    if (!(second & GRAPH_EDGE_FLAG)) {
+        if (second >= graph->count) goto corrupt;
+        if ((uint32_t)count < max) outParents[count] = second;
+        return count + 1;
+    }
+
+    for (size_t edge = second & GRAPH_EDGE_MASK;; edge++) {
+        if (edge >= graph->edgeCount) goto corrupt;
+        uint32_t value = readBe32(graph->edges + edge * 4);
+        if ((value & GRAPH_EDGE_MASK) >= graph->count) goto corrupt;
+        if ((uint32_t)count < max) outParents[count] = value & GRAPH_EDGE_MASK;
+        count++;
+        if (value & GRAPH_EDGE_FLAG) return count;
+    }
+
+corrupt:
+    fprintf(stderr, "Error: Commit-graph has a bad parent for commit %u\n", position);
+    return -1;
+}
+
+static const CommitGraphInput *sortedCommits;
+
+static int compareInputShas(const void *a, const void *b) {
+    return memcmp(sortedCommits[*(const uint32_t *)a].sha, sortedCommits[*(const uint32_t *)b].sha, 20);
+}
+
+/**
+ * @brief Topological level of every commit, parents before children (iteratively,
+ *        so long histories can't overflow the stack)
+ */
+static uint32_t* computeGenerations(const CommitGraphInput *commits, size_t count) {
+    uint32_t *generations = calloc(count + 1, sizeof(uint32_t));
+    uint32_t *stack = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t *nextParent = calloc(count + 1, sizeof(uint32_t));
+    for (size_t start = 0; start < count; start++) {
+        if (generations[start]) continue;
+        size_t depth = 0;
+        stack[depth++] = (uint32_t)start;
+        while (depth > 0) {
+            uint32_t top = stack[depth - 1];
+            const CommitGraphInput *commit = &commits[top];
+            // Descend into the next parent that has no level yet
+            while (nextParent[top] < commit->parentCount && generations[commit->parents[nextParent[top]]]) {
+                nextParent[top]++;
+            }
+            if (nextParent[top] < commit->parentCount) {
+                stack[depth++] = commit->parents[nextParent[top]++];
+                continue;
+            }
+            uint32_t level = 0;
+            for (uint32_t i = 0; i < commit->parentCount; i++) {
+                if (generations[commit->parents[i]] > level) level = generations[commit->parents[i]];
+            }
+            generations[top] = level < GRAPH_GENERATION_MAX ? level + 1 : GRAPH_GENERATION_MAX;
+            depth--;
+        }
+    }
+    free(stack);
+    free(nextParent);
+    return generations;
+}
+
+/**
+ * @brief Write a commit-graph file (via "<path>.lock" and rename)
+ *
+ * @param path: e.g. ".git/objects/info/commit-graph"
+ * @param commits: the commits, in any order; every parent must be among them
+ * @param count: number of commits
+ * @return int: 0 on success, -1 on error (reported)
+ */
+int writeCommitGraph(const char *path, const CommitGraphInput *commits, size_t count) {
+    if (count >= GRAPH_PARENT_NONE) {
+        fprintf(stderr, "Error: Too many commits for a commit-graph\n");
+        return -1;
+    }
+
+    // Positions: commits sorted by SHA
+    uint32_t *order = malloc((count + 1) * sizeof(uint32_t));
+    uint32_t *positions = malloc((count + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < count; i++) order[i] = (uint32_t)i;
+    sortedCommits = commits;
+    qsort(order, count, sizeof(uint32_t), compareInputShas);
+    for (size_t i = 0; i < count; i++) positions[order[i]] = (uint32_t)i;
+    uint32_t *generations = computeGenerations(commits, count);
+
+    size_t edgeCount = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (commits[i].parentCount > 2) edgeCount += commits[i].parentCount - 1;
+    }
+    int chunkCount = edgeCount ? 4 : 3;
+    size_t tableSize = (size_t)(chunkCount + 1) * 12;
+    size_t oidfOffset = GRAPH_HEADER_SIZE + tableSize;
+    size_t oidlOffset = oidfOffset + 256 * 4;
+    size_t cdatOffset = oidlOffset + count * 20;
+    size_t edgeOffset = cdatOffset + count * GRAPH_CDAT_WIDTH;
+    size_t endOffset = edgeOffset + edgeCount * 4;
+    unsigned char *buffer = calloc(endOffset + 20, 1);
+
+    putBe32(buffer, GRAPH_SIGNATURE);
+    buffer[4] = 1;
+    buffer[5] = 1;
+    buffer[6] = (unsigned char)chunkCount;
+    uint32_t ids[] = { GRAPH_CHUNK_OIDF, GRAPH_CHUNK_OIDL, GRAPH_CHUNK_CDAT, GRAPH_CHUNK_EDGE, 0 };
+    size_t offsets[] = { oidfOffset, oidlOffset, cdatOffset, edgeOffset, endOffset };
+    for (int i = 0; i <= chunkCount; i++) {
+        int chunk = i == chunkCount ? 4 : i;  // the terminating entry points at the end
+        putBe32(buffer + GRAPH_HEADER_SIZE + i * 12, ids[chunk]);
+        putBe64(buffer + GRAPH_HEADER_SIZE + i * 12 + 4, offsets[chunk]);
+    }
+
+    size_t edge = 0;
+    for (size_t position = 0; position < count; position++) {
+        const CommitGraphInput *commit = &commits[order[position]];
+        memcpy(buffer + oidlOffset + position * 20, commit->sha, 20);
+
+        unsigned char *row = buffer + cdatOffset + position * GRAPH_CDAT_WIDTH;
+        memcpy(row, commit->tree, 20);
+        uint32_t first = commit->parentCount > 0 ? positions[commit->parents[0]] : GRAPH_PARENT_NONE;
+        uint32_t second = commit->parentCount > 1 ? positions[commit->parents[1]] : GRAPH_PARENT_NONE;
+        if (commit->parentCount > 2) {
+            second = GRAPH_EDGE_FLAG | (uint32_t)edge;
+            for (uint32_t i = 1; i < commit->parentCount; i++) {
+                uint32_t value = positions[commit->parents[i]];
+                if (i == commit->parentCount - 1) value |= GRAPH_EDGE_FLAG;
+                putBe32(buffer + edgeOffset + edge++ * 4, value);
+            }
+        }
+        putBe32(row + 20, first);
+        putBe32(row + 24, second);
+        int64_t date = commit->date < 0 ? 0 : commit->date > GRAPH_DATE_MAX ? GRAPH_DATE_MAX : commit->date;
+        putBe32(row + 28, generations[order[position]] << 2 | (uint32_t)(date >> 32));
+        putBe32(row + 32, (uint32_t)date);
+    }
+    free(order);
+    free(positions);
+    free(generations);
+
+    // Fanout: how many of the sorted SHAs start with each byte value or a lower one
+    uint32_t total = 0;
+    size_t position = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        while (position < count && buffer[oidlOffset + position * 20] == byte) {
+            position++;
+            total++;
+        }
+        putBe32(buffer + oidfOffset + byte * 4, total);
+    }
+    sha1(buffer, endOffset, buffer + endOffset);
+
+    char lockPath[600];
+    snprintf(lockPath, sizeof(lockPath), "%s.lock", path);
+    int fd = open(lockPath, O_WRONLY | O_CREAT | O_EXCL, 0444);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", lockPath, strerror(errno));
+        free(buffer);
+        return -1;
+    }
+    int result = 0;
+    size_t written = 0;
+    while (written < endOffset + 20) {
+        ssize_t n = write(fd, buffer + written, endOffset + 20 - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "Error: Could not write %s: %s\n", lockPath, strerror(errno));
+            result = -1;
+            break;
+        }
+        written += n;
+    }
+    free(buffer);
+    if (close(fd) != 0) result = -1;
+    if (result == 0 && rename(lockPath, path) != 0) {
+        fprintf(stderr, "Error: Could not move %s into place: %s\n", path, strerror(errno));
+        result = -1;
+    }
+    if (result != 0) unlink(lockPath);
+    return result;
+}
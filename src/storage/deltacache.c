@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "object.h"
+
+/*
+Delta-base cache:
+(pack, offset) → inflated object, kept while its bytes fit in the budget.
+
+Objects land here when they served as the base of a delta. Deltas cluster
+around a few hot bases (the newest version of a file), so keeping those
+resident turns "inflate the whole chain for every child" into "apply one
+delta". Least recently used objects are evicted first.
+*/
+
+#define DELTA_CACHE_BUCKETS 4096
+#define DEFAULT_DELTA_CACHE_LIMIT (96 * 1024 * 1024) // same default as git's core.deltaBaseCacheLimit
+
+/**
+ * @brief cached base object
+ * @note Linked both into its hash bucket (chain) and into the LRU list
+ *      (lruPrev/lruNext, most recently used at the head).
+ */
+typedef struct CachedBase {
+    const void *pack;
+    size_t offset;
+    ObjectType type;
+    unsigned char *data;
+    size_t size;
+    struct CachedBase *chain;
+    struct CachedBase *lruPrev;
+    struct CachedBase *lruNext;
+} CachedBase;
+
+static CachedBase *buckets[DELTA_CACHE_BUCKETS];
+static CachedBase *lruHead = NULL;
+static CachedBase *lruTail = NULL;
+static size_t cachedBytes = 0;
+static size_t cacheLimit = 0; // 0 = not initialized yet
+static pthread_mutex_t cacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Budget from GIT_DELTA_BASE_CACHE_LIMIT (bytes, k/m/g suffix allowed) or the default
+ * @note 0 disables the cache; it is stored as 1 byte (nothing fits), since
+ *       cacheLimit 0 means "not read yet".
+ */
+static size_t defaultLimit(void) {
+    const char *env = getenv("GIT_DELTA_BASE_CACHE_LIMIT");
+    if (!env || !*env) return DEFAULT_DELTA_CACHE_LIMIT;
+
+    char *end;
+    unsigned long long value = strtoull(env, &end, 10);
+    switch (*end) {
+        case 'g': case 'G': value <<= 30; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'k': case 'K': value <<= 10; break;
+        default: break;
+    }
+    return value ? (size_t)value : 1;
+}
+
+static size_t bucketOf(const void *pack, size_t offset) {
+    uint64_t key = (uint64_t)(uintptr_t)pack ^ ((uint64_t)offset * 0x9e3779b97f4a7c15ull);
+    return (size_t)(key >> 32 ^ key) % DELTA_CACHE_BUCKETS;
+}
+
+static void lruUnlink(CachedBase *entry) {
+    if (entry->lruPrev) entry->lruPrev->lruNext = entry->lruNext;
+    else lruHead = entry->lruNext;
+    if (entry->lruNext) entry->lruNext->lruPrev = entry->lruPrev;
+    else lruTail = entry->lruPrev;
+    entry->lruPrev = entry->lruNext = NULL;
+}
+
+static void lruPushFront(CachedBase *entry) {
+    entry->lruPrev = NULL;
+    entry->lruNext = lruHead;
+    if (lruHead) lruHead->lruPrev = entry;
+    lruHead = entry;
+    if (!lruTail) lruTail = entry;
+}
+
+/**
+ * @brief Unlink an entry from its bucket and the LRU list, and free it
+ */
+static void evict(CachedBase *entry) {
+    CachedBase **link = &buckets[bucketOf(entry->pack, entry->offset)];
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+
+    lruUnlink(entry);
+    cachedBytes -= entry->size;
+    free(entry->data);
+    free(entry);
+}
+
+/**
+ * @brief whether bases are worth materializing for the cache at all
+ *
+ * @return int: 1 if the budget can hold objects, 0 if the cache is disabled
+ */
+int deltaBaseCacheEnabled(void) {
+    pthread_mutex_lock(&cacheLock);
+    if (cacheLimit == 0) cacheLimit = defaultLimit();
+    int enabled = cacheLimit > 1;
+    pthread_mutex_unlock(&cacheLock);
+    return enabled;
+}
+
+/**
+ * @brief look up a cached base object
+ *
+ * @param pack: pack the object lives in (identity only)
+ * @param offset: offset of the object in that pack
+ * @param outType: OUTPUT - object type
+ * @param outData: OUTPUT - copy of the object content (caller must free)
+ * @param outSize: OUTPUT - object size
+ * @return int: 1 on hit, 0 on miss
+ */
+int deltaBaseCacheGet(const void *pack, size_t offset, ObjectType *outType, unsigned char **outData, size_t *outSize) {
+    pthread_mutex_lock(&cacheLock);
+
+    CachedBase *entry = buckets[bucketOf(pack, offset)];
+    while (entry && (entry->pack != pack || entry->offset != offset)) {
+        entry = entry->chain;
+    }
+    if (!entry) {
+        pthread_mutex_unlock(&cacheLock);
+        return 0;
+    }
+
+    lruUnlink(entry);
+    lruPushFront(entry);
+
+    *outType = entry->type;
+    *outSize = entry->size;
+    *outData = malloc(entry->size ? entry->size : 1);
+    memcpy(*outData, entry->data, entry->size);
+
+    pthread_mutex_unlock(&cacheLock);
+    return 1;
+}
+
+/**
+ * @brief remember an object that served as a delta base
+ *
+ * @note The data is copied. Objects larger than the whole budget are not kept.
+ *
+ * @param pack: pack the object lives in (identity only)
+ * @param offset: offset of the object in that pack
+ * @param type: object type
+ * @param data: object content
+ * @param size: object size
+ */
+void deltaBaseCachePut(const void *pack, size_t offset, ObjectType type, const unsigned char *data, size_t size) {
+    pthread_mutex_lock(&cacheLock);
+    if (cacheLimit == 0) cacheLimit = defaultLimit();
+
+    if (size > cacheLimit) {
+        pthread_mutex_unlock(&cacheLock);
+        return;
+    }
+
+    size_t bucket = bucketOf(pack, offset);
+    for (CachedBase *entry = buckets[bucket]; entry; entry = entry->chain) {
+        if (entry->pack == pack && entry->offset == offset) {
+            // Another reader got here first
+            lruUnlink(entry);
+            lruPushFront(entry);
+            pthread_mutex_unlock(&cacheLock);
+            return;
+        }
+    }
+
+    while (lruTail && cachedBytes + size > cacheLimit) {
+        evict(lruTail);
+    }
+
+    CachedBase *entry = calloc(1, sizeof(CachedBase));
+    entry->pack = pack;
+    entry->offset = offset;
+    entry->type = type;
+    entry->size = size;
+    entry->data = malloc(size ? size : 1);
+    memcpy(entry->data, data, size);
+
+    entry->chain = buckets[bucket];
+    buckets[bucket] = entry;
+    lruPushFront(entry);
+    cachedBytes += size;
+
+    pthread_mutex_unlock(&cacheLock);
+}
+
+/**
+ * @brief drop every cached object (packs are about to be unmapped)
+ */
+void deltaBaseCacheClear(void) {
+    pthread_mutex_lock(&cacheLock);
+    while (lruTail) {
+        evict(lruTail);
+    }
+    pthread_mutex_unlock(&cacheLock);
+}
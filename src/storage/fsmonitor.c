@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "object.h"
+
+/*
+Fsmonitor query (client side of the fsmonitor daemon, see cmd/fsmonitor.c):
+connect to .git/fsmonitor.sock
+    → send "<token of the index>\n" (empty line without one)
+    → read "<new token>\n" + changed paths, each NUL-terminated ("/" = everything)
+    → entries at or under a changed path lose fsmonitorValid; the index keeps the new token
+no daemon
+    → token dropped, every entry unchecked: callers fall back to lstat()ing everything
+*/
+
+static int compareStrings(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Send the request and read the whole reply
+ *
+ * @return char*: reply (NUL-terminated, caller frees), NULL if no daemon answered
+ */
+static char* queryDaemon(const char *token, size_t *outSize) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return NULL;
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", FSMONITOR_SOCKET_PATH);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    char request[256];
+    int len = snprintf(request, sizeof(request), "%s\n", token ? token : "");
+    if (len >= (int)sizeof(request) || send(fd, request, len, MSG_NOSIGNAL) != len) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = 0, capacity = 4096;
+    char *reply = malloc(capacity);
+    for (;;) {
+        if (size + 1 == capacity) {
+            capacity *= 2;
+            reply = realloc(reply, capacity);
+        }
+        ssize_t n = read(fd, reply + size, capacity - size - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) {
+            free(reply);
+            close(fd);
+            return NULL;
+        }
+        if (n == 0) break;
+        size += n;
+    }
+    close(fd);
+    reply[size] = '\0';
+    *outSize = size;
+    return reply;
+}
+
+/**
+ * @brief Ask the fsmonitor daemon what changed since the index's token
+ *
+ * @note Entries at or under a reported path are marked for checking; the others keep
+ *       fsmonitorValid and need no lstat(). Callers set fsmonitorValid again on entries
+ *       they find clean. Without a daemon every entry is marked for checking.
+ *
+ * @param index: index to update (its token is replaced, so it is marked changed)
+ * @param outChanges: OUTPUT (optional) - reported paths (free with freeFsmonitorChanges)
+ * @return int: 0 if the daemon answered, -1 if there is none
+ */
+int fsmonitorRefresh(Index *index, FsmonitorChanges *outChanges) {
+    FsmonitorChanges changes = { index->fsmonitorToken, NULL, 0, 1 };
+    index->fsmonitorToken = NULL;
+
+    size_t size;
+    char *reply = queryDaemon(changes.sinceToken, &size);
+    char *newline = reply ? memchr(reply, '\n', size) : NULL;
+    if (!newline) {
+        for (uint32_t i = 0; i < index->count; i++) index->entries[i].fsmonitorValid = 0;
+        if (changes.sinceToken) index->changed = 1;
+        free(reply);
+        if (outChanges) *outChanges = changes;
+        else free(changes.sinceToken);
+        return -1;
+    }
+
+    index->fsmonitorToken = strndup(reply, newline - reply);
+    index->changed = 1;
+
+    // Paths follow the token, each NUL-terminated
+    size_t capacity = 0;
+    changes.everything = changes.sinceToken == NULL;
+    for (char *path = newline + 1; path < reply + size; path += strlen(path) + 1) {
+        if (strcmp(path, "/") == 0) {
+            changes.everything = 1;
+            continue;
+        }
+        if (changes.count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            changes.paths = realloc(changes.paths, capacity * sizeof(char *));
+        }
+        changes.paths[changes.count++] = strdup(path);
+    }
+    free(reply);
+    qsort(changes.paths, changes.count, sizeof(char *), compareStrings);
+
+    if (changes.everything) {
+        for (uint32_t i = 0; i < index->count; i++) index->entries[i].fsmonitorValid = 0;
+    } else {
+        for (size_t i = 0; i < changes.count; i++) {
+            const char *path = changes.paths[i];
+            size_t len = strlen(path);
+            // The path itself (every stage), then everything under "path/"
+            int pos = indexFindPos(index, path, 0);
+            for (uint32_t at = pos >= 0 ? (uint32_t)pos : (uint32_t)(-pos - 1);
+                 at < index->count && strcmp(index->entries[at].path, path) == 0; at++) {
+                index->entries[at].fsmonitorValid = 0;
+            }
+            char prefix[4096];
+            snprintf(prefix, sizeof(prefix), "%s/", path);
+            pos = indexFindPos(index, prefix, 0);
+            for (uint32_t at = (uint32_t)(-pos - 1);
+                 at < index->count && strncmp(index->entries[at].path, prefix, len + 1) == 0; at++) {
+                index->entries[at].fsmonitorValid = 0;
+            }
+        }
+    }
+
+    if (outChanges) *outChanges = changes;
+    else freeFsmonitorChanges(&changes);
+    return 0;
+}
+
+/**
+ * @brief Check whether the daemon reported path itself as changed
+ */
+int fsmonitorPathChanged(const FsmonitorChanges *changes, const char *path) {
+    if (changes->everything) return 1;
+    return bsearch(&path, changes->paths, changes->count, sizeof(char *), compareStrings) != NULL;
+}
+
+void freeFsmonitorChanges(FsmonitorChanges *changes) {
+    for (size_t i = 0; i < changes->count; i++) {
+        free(changes->paths[i]);
+    }
+    free(changes->paths);
+    free(changes->sinceToken);
+    memset(changes, 0, sizeof(*changes));
+}
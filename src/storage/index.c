@@ -0,0 +1,1015 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <arpa/inet.h>  // for ntohl/htonl (index fields are big-endian)
+#include "object.h"
+#include "../utils/utils.h"
+
+/*
+Index file (.git/index), versions 2-4:
+"DIRC" | version | entry count
+entry (sorted by path, then stage):
+    ctime sec/nsec | mtime sec/nsec | dev | ino | mode | uid | gid | size   (32-bit each)
+    → 20-byte blob SHA → 16-bit flags (stage, name length) [→ 16-bit extended flags, v3+]
+    → v2/v3: path, NUL padded to a multiple of 8 bytes
+      v4:    varint (bytes to drop from the previous path) + NUL-terminated suffix
+extensions: 4-byte signature | 32-bit size | data   (optional if the signature starts A-Z)
+    TREE (cache-tree), one record per directory, depth first:
+        "<name>\0<entry count> <subtree count>\n" [+ 20-byte tree SHA unless the count is -1]
+    FSMN (fsmonitor), version 2:
+        version | "<daemon token>\0" | bitmap size | EWAH bitmap, one bit per entry (1 = check it)
+SHA-1 of everything above
+
+The stat fields let callers skip rehashing a file whose lstat() still matches; the
+cache-tree lets write-tree skip every directory nothing changed under. With the
+fsmonitor daemon running, entries it reported no change for are not even lstat()ed.
+*/
+
+#define INDEX_SIGNATURE 0x44495243  // "DIRC"
+#define INDEX_ENTRY_FIXED 62        // stat fields + SHA + flags
+#define INDEX_FLAG_EXTENDED 0x4000
+#define INDEX_FLAG_STAGE_MASK 0x3000
+#define INDEX_FLAG_NAME_MASK 0x0FFF
+#define INDEX_EXT_TREE 0x54524545   // "TREE"
+#define INDEX_EXT_FSMN 0x46534D4E   // "FSMN"
+#define EWAH_MAX_RUN 0xFFFFFFFFULL  // 32-bit running length
+#define EWAH_MAX_LITERALS 0x7FFFFFFFULL  // 31-bit literal word count
+
+static uint32_t readBe32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return ntohl(value);
+}
+
+static void putBe32(unsigned char *p, uint32_t value) {
+    value = htonl(value);
+    memcpy(p, &value, 4);
+}
+
+static uint64_t readBe64(const unsigned char *p) {
+    return ((uint64_t)readBe32(p) << 32) | readBe32(p + 4);
+}
+
+static void putBe64(unsigned char *p, uint64_t value) {
+    putBe32(p, (uint32_t)(value >> 32));
+    putBe32(p + 4, (uint32_t)value);
+}
+
+/**
+ * @brief Order index entries the way git does: path bytes, then stage
+ */
+static int compareIndexPaths(const char *a, size_t aLen, int aStage, const char *b, size_t bLen, int bStage) {
+    size_t len = aLen < bLen ? aLen : bLen;
+    int cmp = memcmp(a, b, len);
+    if (cmp) return cmp;
+    if (aLen != bLen) return aLen < bLen ? -1 : 1;
+    return aStage - bStage;
+}
+
+static int entryStage(const IndexEntry *entry) {
+    return (entry->flags & INDEX_FLAG_STAGE_MASK) >> 12;
+}
+
+/**
+ * @brief Binary search for path at stage
+ *
+ * @return int: position if found, otherwise -(insert position) - 1
+ */
+int indexFindPos(const Index *index, const char *path, int stage) {
+    size_t len = strlen(path);
+    uint32_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const IndexEntry *entry = &index->entries[mid];
+        int cmp = compareIndexPaths(entry->path, strlen(entry->path), entryStage(entry), path, len, stage);
+        if (cmp == 0) return (int)mid;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -(int)lo - 1;
+}
+
+/**
+ * @brief look up the stage-0 entry for a path
+ *
+ * @return IndexEntry*: the entry, NULL if the path isn't tracked
+ */
+IndexEntry* indexFind(const Index *index, const char *path) {
+    int pos = indexFindPos(index, path, 0);
+    return pos >= 0 ? &index->entries[pos] : NULL;
+}
+
+/**
+ * @brief Free a cache-tree node and everything below it
+ */
+static void freeCacheTree(CacheTree *tree) {
+    if (!tree) return;
+    for (int i = 0; i < tree->childCount; i++) {
+        freeCacheTree(tree->children[i]);
+    }
+    free(tree->children);
+    free(tree->name);
+    free(tree);
+}
+
+static CacheTree* newCacheTree(const char *name, size_t nameLen) {
+    CacheTree *tree = calloc(1, sizeof(CacheTree));
+    tree->name = strndup(name, nameLen);
+    tree->entryCount = -1;
+    return tree;
+}
+
+/**
+ * @brief Find (or, with create, add) the child of tree called name
+ */
+static CacheTree* cacheTreeChild(CacheTree *tree, const char *name, size_t nameLen, int create) {
+    for (int i = 0; i < tree->childCount; i++) {
+        CacheTree *child = tree->children[i];
+        if (strlen(child->name) == nameLen && memcmp(child->name, name, nameLen) == 0) return child;
+    }
+    if (!create) return NULL;
+
+    tree->children = realloc(tree->children, (tree->childCount + 1) * sizeof(CacheTree *));
+    tree->children[tree->childCount] = newCacheTree(name, nameLen);
+    return tree->children[tree->childCount++];
+}
+
+/**
+ * @brief Mark every directory containing path as changed
+ *
+ * @note Only the directories on the way down are touched, so the next write-tree
+ *       rebuilds O(depth) trees and reuses the rest.
+ */
+static void invalidateCacheTree(Index *index, const char *path) {
+    CacheTree *tree = index->cacheTree;
+    while (tree) {
+        tree->entryCount = -1;
+        const char *slash = strchr(path, '/');
+        if (!slash) break;
+        tree = cacheTreeChild(tree, path, slash - path, 0);
+        path = slash + 1;
+    }
+}
+
+/**
+ * @brief Parse one TREE record and, recursively, its subtrees
+ *
+ * @return CacheTree*: the node, NULL if the data is malformed
+ */
+static CacheTree* parseCacheTree(const unsigned char **ptr, const unsigned char *end) {
+    const unsigned char *nul = memchr(*ptr, '\0', end - *ptr);
+    if (!nul) return NULL;
+    const unsigned char *newline = memchr(nul, '\n', end - nul);
+    if (!newline) return NULL;
+
+    CacheTree *tree = newCacheTree((const char *)*ptr, nul - *ptr);
+    char counts[64];
+    size_t countsLen = newline - nul - 1;
+    if (countsLen >= sizeof(counts)) goto bad;
+    memcpy(counts, nul + 1, countsLen);
+    counts[countsLen] = '\0';
+
+    int subtrees;
+    if (sscanf(counts, "%d %d", &tree->entryCount, &subtrees) != 2 || subtrees < 0) goto bad;
+    *ptr = newline + 1;
+    if (tree->entryCount >= 0) {
+        if (end - *ptr < 20) goto bad;
+        memcpy(tree->sha, *ptr, 20);
+        *ptr += 20;
+    }
+
+    for (int i = 0; i < subtrees; i++) {
+        CacheTree *child = parseCacheTree(ptr, end);
+        if (!child) goto bad;
+        tree->children = realloc(tree->children, (tree->childCount + 1) * sizeof(CacheTree *));
+        tree->children[tree->childCount++] = child;
+    }
+    return tree;
+
+bad:
+    freeCacheTree(tree);
+    return NULL;
+}
+
+/**
+ * @brief Parse an FSMN extension: the token, and the EWAH bitmap of entries to check
+ *
+ * @note EWAH: 64-bit words, each run-length word holding the running bit (bit 0), the
+ *       number of all-0/all-1 words it stands for (bits 1-32) and the number of literal
+ *       words after it (bits 33-63). Bit i of the expanded bitmap is entry i.
+ *
+ * @return int: 0 on success, -1 if malformed (the caller then treats every entry as unchecked)
+ */
+static int parseFsmonitor(Index *index, const unsigned char *ptr, size_t size) {
+    const unsigned char *end = ptr + size;
+    if (size < 4 || readBe32(ptr) != 2) return -1;
+    const unsigned char *nul = memchr(ptr + 4, '\0', size - 4);
+    if (!nul || end - nul - 1 < 4 + 12) return -1;
+    const unsigned char *bitmap = nul + 5;
+    uint32_t bitCount = readBe32(bitmap);
+    uint32_t wordCount = readBe32(bitmap + 4);
+    if (bitCount != index->count || (size_t)(end - bitmap - 12) / 8 < wordCount) return -1;
+
+    for (uint32_t i = 0; i < index->count; i++) index->entries[i].fsmonitorValid = 1;
+    const unsigned char *words = bitmap + 8;
+    uint64_t bit = 0;
+    for (uint32_t pos = 0; pos < wordCount;) {
+        uint64_t marker = readBe64(words + 8 * pos++);
+        uint64_t run = (marker >> 1) & EWAH_MAX_RUN;
+        uint64_t literals = marker >> 33;
+        if (marker & 1) {
+            for (uint64_t i = bit; i < bit + run * 64 && i < index->count; i++) index->entries[i].fsmonitorValid = 0;
+        }
+        bit += run * 64;
+        if (literals > wordCount - pos) return -1;
+        for (; literals > 0; literals--, bit += 64) {
+            uint64_t word = readBe64(words + 8 * pos++);
+            for (int j = 0; j < 64; j++) {
+                if ((word >> j & 1) && bit + j < index->count) index->entries[bit + j].fsmonitorValid = 0;
+            }
+        }
+    }
+
+    index->fsmonitorToken = strndup((const char *)ptr + 4, nul - ptr - 4);
+    return 0;
+}
+
+/**
+ * @brief Parse the index file into memory
+ *
+ * @note A missing index reads as empty (index->exists stays 0).
+ *
+ * @param index: OUTPUT - parsed index (free with freeIndex)
+ * @return int: 0 on success, -1 if the file is corrupt or unsupported
+ */
+int readIndex(Index *index) {
+    memset(index, 0, sizeof(*index));
+    index->version = 2;
+
+    int fd = open(INDEX_PATH, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 12 + 20) {
+        fprintf(stderr, "Error: Index file is too short\n");
+        close(fd);
+        return -1;
+    }
+    size_t size = st.st_size;
+    unsigned char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map index: %s\n", strerror(errno));
+        return -1;
+    }
+
+    int result = -1;
+    unsigned char sha[SHA_DIGEST_LENGTH];
+    sha1(data, size - 20, sha);
+    if (memcmp(sha, data + size - 20, 20) != 0) {
+        fprintf(stderr, "Error: Index checksum mismatch\n");
+        goto done;
+    }
+
+    uint32_t version = readBe32(data + 4);
+    if (readBe32(data) != INDEX_SIGNATURE || version < 2 || version > 4) {
+        fprintf(stderr, "Error: Unsupported index version %u\n", version);
+        goto done;
+    }
+
+    index->version = version;
+    index->exists = 1;
+    index->mtime = st.st_mtim;
+    index->count = readBe32(data + 8);
+    index->capacity = index->count ? index->count : 1;
+    index->entries = calloc(index->capacity, sizeof(IndexEntry));
+
+    const unsigned char *ptr = data + 12;
+    const unsigned char *end = data + size - 20;
+    const char *previous = "";
+    size_t previousLen = 0;
+    for (uint32_t i = 0; i < index->count; i++) {
+        IndexEntry *entry = &index->entries[i];
+        if ((size_t)(end - ptr) < INDEX_ENTRY_FIXED) goto truncated;
+
+        entry->ctimeSec = readBe32(ptr);
+        entry->ctimeNsec = readBe32(ptr + 4);
+        entry->mtimeSec = readBe32(ptr + 8);
+        entry->mtimeNsec = readBe32(ptr + 12);
+        entry->dev = readBe32(ptr + 16);
+        entry->ino = readBe32(ptr + 20);
+        entry->mode = readBe32(ptr + 24);
+        entry->uid = readBe32(ptr + 28);
+        entry->gid = readBe32(ptr + 32);
+        entry->size = readBe32(ptr + 36);
+        memcpy(entry->sha, ptr + 40, 20);
+        entry->flags = (uint16_t)((ptr[60] << 8) | ptr[61]);
+        const unsigned char *name = ptr + INDEX_ENTRY_FIXED;
+
+        if (entry->flags & INDEX_FLAG_EXTENDED) {
+            if (version < 3 || end - name < 2) goto truncated;
+            entry->extendedFlags = (uint16_t)((name[0] << 8) | name[1]);
+            name += 2;
+        }
+
+        if (version == 4) {
+            // Prefix compression: drop `strip` bytes from the previous path, append the suffix
+            size_t strip = 0;
+            unsigned char byte;
+            do {
+                if (name >= end) goto truncated;
+                byte = *name++;
+                strip = (strip << 7) | (byte & 0x7F);
+                if (byte & 0x80) strip++;
+            } while (byte & 0x80);
+            const unsigned char *nul = memchr(name, '\0', end - name);
+            if (!nul || strip > previousLen) goto truncated;
+
+            size_t keep = previousLen - strip;
+            size_t suffixLen = nul - name;
+            entry->path = malloc(keep + suffixLen + 1);
+            memcpy(entry->path, previous, keep);
+            memcpy(entry->path + keep, name, suffixLen + 1);
+            ptr = nul + 1;
+        } else {
+            const unsigned char *nul = memchr(name, '\0', end - name);
+            if (!nul) goto truncated;
+            entry->path = strndup((const char *)name, nul - name);
+            size_t entryLen = (name - ptr) + (nul - name);
+            ptr += (entryLen + 8) & ~(size_t)7;  // 1-8 NULs of padding
+            if (ptr > end) goto truncated;
+        }
+        previous = entry->path;
+        previousLen = strlen(entry->path);
+    }
+
+    // Extensions until the trailer; optional ones (A-Z) we don't know are skipped
+    while (end - ptr >= 8) {
+        uint32_t extensionSize = readBe32(ptr + 4);
+        if ((size_t)(end - ptr - 8) < extensionSize) goto truncated;
+        if (readBe32(ptr) == INDEX_EXT_TREE) {
+            // A damaged cache-tree only costs a full rebuild, so it is dropped rather than fatal
+            const unsigned char *tree = ptr + 8;
+            freeCacheTree(index->cacheTree);
+            index->cacheTree = parseCacheTree(&tree, tree + extensionSize);
+        } else if (readBe32(ptr) == INDEX_EXT_FSMN) {
+            free(index->fsmonitorToken);
+            index->fsmonitorToken = NULL;
+            if (parseFsmonitor(index, ptr + 8, extensionSize) != 0) {
+                for (uint32_t i = 0; i < index->count; i++) index->entries[i].fsmonitorValid = 0;
+            }
+        } else if (ptr[0] < 'A' || ptr[0] > 'Z') {
+            fprintf(stderr, "Error: Index uses unsupported extension '%.4s'\n", (const char *)ptr);
+            goto done;
+        }
+        ptr += 8 + extensionSize;
+    }
+    result = 0;
+    goto done;
+
+truncated:
+    fprintf(stderr, "Error: Index file is truncated\n");
+done:
+    munmap(data, size);
+    if (result != 0) {
+        freeIndex(index);
+    }
+    return result;
+}
+
+/**
+ * @brief free the entries of an index
+ */
+void freeIndex(Index *index) {
+    for (uint32_t i = 0; i < index->count; i++) {
+        free(index->entries[i].path);
+    }
+    free(index->entries);
+    index->entries = NULL;
+    index->count = index->capacity = 0;
+    freeCacheTree(index->cacheTree);
+    index->cacheTree = NULL;
+    free(index->fsmonitorToken);
+    index->fsmonitorToken = NULL;
+}
+
+/**
+ * @brief growable output buffer with a running SHA-1
+ */
+typedef struct {
+    unsigned char *data;
+    size_t len, capacity;
+} IndexBuffer;
+
+static void bufferAppend(IndexBuffer *buffer, const void *data, size_t len) {
+    if (buffer->len + len > buffer->capacity) {
+        while (buffer->len + len > buffer->capacity) buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 65536;
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+    memcpy(buffer->data + buffer->len, data, len);
+    buffer->len += len;
+}
+
+/**
+ * @brief Serialize one entry
+ *
+ * @note Racy-git: a file modified in the same second the index is written could
+ *       change again without its mtime moving, so such entries are written with
+ *       size 0. The next stat comparison then fails and the content is rehashed.
+ */
+static void appendEntry(IndexBuffer *buffer, const IndexEntry *entry, uint32_t version, time_t now,
+                        const char *previous) {
+    unsigned char fixed[INDEX_ENTRY_FIXED + 2];
+    int racy = (time_t)entry->mtimeSec >= now;
+    size_t pathLen = strlen(entry->path);
+    uint16_t flags = (entry->flags & ~INDEX_FLAG_NAME_MASK) |
+                     (pathLen < INDEX_FLAG_NAME_MASK ? pathLen : INDEX_FLAG_NAME_MASK);
+    if (entry->extendedFlags && version >= 3) flags |= INDEX_FLAG_EXTENDED;
+    else flags &= ~INDEX_FLAG_EXTENDED;
+
+    putBe32(fixed, entry->ctimeSec);
+    putBe32(fixed + 4, entry->ctimeNsec);
+    putBe32(fixed + 8, entry->mtimeSec);
+    putBe32(fixed + 12, entry->mtimeNsec);
+    putBe32(fixed + 16, entry->dev);
+    putBe32(fixed + 20, entry->ino);
+    putBe32(fixed + 24, entry->mode);
+    putBe32(fixed + 28, entry->uid);
+    putBe32(fixed + 32, entry->gid);
+    putBe32(fixed + 36, racy ? 0 : entry->size);
+    memcpy(fixed + 40, entry->sha, 20);
+    fixed[60] = flags >> 8;
+    fixed[61] = flags & 0xFF;
+    size_t fixedLen = INDEX_ENTRY_FIXED;
+    if (flags & INDEX_FLAG_EXTENDED) {
+        fixed[62] = entry->extendedFlags >> 8;
+        fixed[63] = entry->extendedFlags & 0xFF;
+        fixedLen += 2;
+    }
+    bufferAppend(buffer, fixed, fixedLen);
+
+    if (version == 4) {
+        size_t common = 0;
+        while (previous[common] && previous[common] == entry->path[common]) common++;
+        size_t strip = strlen(previous) - common;
+
+        unsigned char varint[16];
+        size_t pos = sizeof(varint) - 1;
+        varint[pos] = strip & 0x7F;
+        while (strip >>= 7) {
+            varint[--pos] = 0x80 | (--strip & 0x7F);
+        }
+        bufferAppend(buffer, varint + pos, sizeof(varint) - pos);
+        bufferAppend(buffer, entry->path + common, pathLen - common + 1);
+    } else {
+        static const unsigned char padding[8];
+        size_t entryLen = fixedLen + pathLen;
+        bufferAppend(buffer, entry->path, pathLen);
+        bufferAppend(buffer, padding, 8 - (entryLen & 7));
+    }
+}
+
+/**
+ * @brief Serialize a cache-tree node and its subtrees (TREE extension record)
+ */
+static void appendCacheTree(IndexBuffer *buffer, const CacheTree *tree) {
+    char counts[64];
+    int len = snprintf(counts, sizeof(counts), "%d %d\n", tree->entryCount, tree->childCount);
+    bufferAppend(buffer, tree->name, strlen(tree->name) + 1);
+    bufferAppend(buffer, counts, len);
+    if (tree->entryCount >= 0) bufferAppend(buffer, tree->sha, 20);
+    for (int i = 0; i < tree->childCount; i++) {
+        appendCacheTree(buffer, tree->children[i]);
+    }
+}
+
+/**
+ * @brief Serialize the fsmonitor token and dirty bitmap (FSMN extension, version 2)
+ *
+ * @note Runs of clean entries become single run-length words, so a large tree with
+ *       few changes costs a few bytes (see parseFsmonitor() for the encoding).
+ */
+static void appendFsmonitor(IndexBuffer *buffer, const Index *index) {
+    size_t bitWords = (index->count + 63) / 64;
+    uint64_t *bits = calloc(bitWords ? bitWords : 1, sizeof(uint64_t));
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (!index->entries[i].fsmonitorValid) bits[i / 64] |= 1ULL << (i % 64);
+    }
+
+    // Worst case one marker per literal word
+    uint64_t *encoded = malloc((2 * bitWords + 1) * sizeof(uint64_t));
+    size_t count = 0, lastMarker = 0;
+    for (size_t i = 0; i < bitWords || count == 0;) {
+        uint64_t runBit = i < bitWords && bits[i] == ~0ULL;
+        uint64_t run = 0, literals = 0;
+        while (i < bitWords && bits[i] == (runBit ? ~0ULL : 0) && run < EWAH_MAX_RUN) {
+            run++;
+            i++;
+        }
+        lastMarker = count++;
+        while (i + literals < bitWords && bits[i + literals] != 0 && bits[i + literals] != ~0ULL &&
+               literals < EWAH_MAX_LITERALS) {
+            encoded[count++] = bits[i + literals];
+            literals++;
+        }
+        i += literals;
+        encoded[lastMarker] = runBit | (run << 1) | (literals << 33);
+    }
+
+    unsigned char field[8];
+    putBe32(field, 2);
+    bufferAppend(buffer, field, 4);
+    bufferAppend(buffer, index->fsmonitorToken, strlen(index->fsmonitorToken) + 1);
+    putBe32(field, (uint32_t)(12 + 8 * count));
+    bufferAppend(buffer, field, 4);
+    putBe32(field, index->count);
+    putBe32(field + 4, (uint32_t)count);
+    bufferAppend(buffer, field, 8);
+    for (size_t i = 0; i < count; i++) {
+        putBe64(field, encoded[i]);
+        bufferAppend(buffer, field, 8);
+    }
+    putBe32(field, (uint32_t)lastMarker);
+    bufferAppend(buffer, field, 4);
+    free(encoded);
+    free(bits);
+}
+
+/**
+ * @brief Write the index to .git/index (via .git/index.lock and rename)
+ *
+ * @param index: entries to write, already sorted
+ * @return int: 0 on success, -1 on error
+ */
+int writeIndex(Index *index) {
+    int fd = open(INDEX_LOCK_PATH, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", INDEX_LOCK_PATH, strerror(errno));
+        return -1;
+    }
+
+    uint32_t version = index->version >= 2 && index->version <= 4 ? index->version : 2;
+    IndexBuffer buffer = {0};
+    unsigned char header[12];
+    putBe32(header, INDEX_SIGNATURE);
+    putBe32(header + 4, version);
+    putBe32(header + 8, index->count);
+    bufferAppend(&buffer, header, sizeof(header));
+
+    time_t now = time(NULL);
+    const char *previous = "";
+    for (uint32_t i = 0; i < index->count; i++) {
+        appendEntry(&buffer, &index->entries[i], version, now, previous);
+        previous = index->entries[i].path;
+    }
+
+    for (int ext = 0; ext < 2; ext++) {
+        IndexBuffer extension = {0};
+        uint32_t signature = ext == 0 ? INDEX_EXT_TREE : INDEX_EXT_FSMN;
+        if (ext == 0 && index->cacheTree) appendCacheTree(&extension, index->cacheTree);
+        else if (ext == 1 && index->fsmonitorToken) appendFsmonitor(&extension, index);
+        else continue;
+
+        unsigned char extensionHeader[8];
+        putBe32(extensionHeader, signature);
+        putBe32(extensionHeader + 4, (uint32_t)extension.len);
+        bufferAppend(&buffer, extensionHeader, sizeof(extensionHeader));
+        bufferAppend(&buffer, extension.data, extension.len);
+        free(extension.data);
+    }
+
+    unsigned char sha[SHA_DIGEST_LENGTH];
+    sha1(buffer.data, buffer.len, sha);
+    bufferAppend(&buffer, sha, sizeof(sha));
+
+    int result = 0;
+    size_t written = 0;
+    while (written < buffer.len) {
+        ssize_t n = write(fd, buffer.data + written, buffer.len - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "Error: Could not write index: %s\n", strerror(errno));
+            result = -1;
+            break;
+        }
+        written += n;
+    }
+    free(buffer.data);
+
+    if (close(fd) != 0) result = -1;
+    if (result == 0 && rename(INDEX_LOCK_PATH, INDEX_PATH) != 0) {
+        fprintf(stderr, "Error: Could not move index into place: %s\n", strerror(errno));
+        result = -1;
+    }
+    if (result != 0) {
+        unlink(INDEX_LOCK_PATH);
+        return -1;
+    }
+    index->exists = 1;
+    index->changed = 0;
+    return 0;
+}
+
+/**
+ * @brief Remove the entry at pos
+ */
+static void removeEntryAt(Index *index, uint32_t pos) {
+    invalidateCacheTree(index, index->entries[pos].path);
+    free(index->entries[pos].path);
+    memmove(&index->entries[pos], &index->entries[pos + 1], (index->count - pos - 1) * sizeof(IndexEntry));
+    index->count--;
+    index->changed = 1;
+}
+
+/**
+ * @brief remove a path, or every path under it if it names a directory
+ *
+ * @return int: number of entries removed
+ */
+int indexRemovePath(Index *index, const char *path) {
+    int removed = 0;
+    int pos = indexFindPos(index, path, 0);
+    if (pos >= 0) {
+        while ((uint32_t)pos < index->count && strcmp(index->entries[pos].path, path) == 0) {
+            removeEntryAt(index, pos);
+            removed++;
+        }
+        return removed;
+    }
+
+    // Directory: entries "path/..." sort together, at or right after the insert position
+    size_t len = strlen(path);
+    uint32_t at = -pos - 1;
+    while (at < index->count && strncmp(index->entries[at].path, path, len) == 0) {
+        if (index->entries[at].path[len] == '/') {
+            removeEntryAt(index, at);
+            removed++;
+        } else {
+            at++;
+        }
+    }
+    return removed;
+}
+
+/**
+ * @brief insert or replace the stage-0 entry for entry->path
+ *
+ * @note Takes ownership of entry->path. A file replacing a directory drops the
+ *       directory's entries, and a file inside what used to be a file drops that file.
+ */
+void indexAddEntry(Index *index, IndexEntry *entry) {
+    invalidateCacheTree(index, entry->path);
+    int pos = indexFindPos(index, entry->path, 0);
+    if (pos >= 0) {
+        free(index->entries[pos].path);
+        index->entries[pos] = *entry;
+        index->changed = 1;
+        return;
+    }
+
+    indexRemovePath(index, entry->path);
+    for (char *slash = strchr(entry->path, '/'); slash; slash = strchr(slash + 1, '/')) {
+        *slash = '\0';
+        int parent = indexFindPos(index, entry->path, 0);
+        if (parent >= 0) removeEntryAt(index, parent);
+        *slash = '/';
+    }
+
+    pos = -indexFindPos(index, entry->path, 0) - 1;
+    if (index->count == index->capacity) {
+        index->capacity = index->capacity ? index->capacity * 2 : 64;
+        index->entries = realloc(index->entries, index->capacity * sizeof(IndexEntry));
+    }
+    memmove(&index->entries[pos + 1], &index->entries[pos], (index->count - pos) * sizeof(IndexEntry));
+    index->entries[pos] = *entry;
+    index->count++;
+    index->changed = 1;
+}
+
+/**
+ * @brief Index mode for a file: regular, executable or symlink
+ */
+uint32_t indexModeFromStat(const struct stat *st) {
+    if (S_ISLNK(st->st_mode)) return 0120000;
+    return (st->st_mode & S_IXUSR) ? 0100755 : 0100644;
+}
+
+/**
+ * @brief copy the lstat() data into an entry
+ */
+void fillIndexStat(IndexEntry *entry, const struct stat *st) {
+    entry->ctimeSec = (uint32_t)st->st_ctim.tv_sec;
+    entry->ctimeNsec = (uint32_t)st->st_ctim.tv_nsec;
+    entry->mtimeSec = (uint32_t)st->st_mtim.tv_sec;
+    entry->mtimeNsec = (uint32_t)st->st_mtim.tv_nsec;
+    entry->dev = (uint32_t)st->st_dev;
+    entry->ino = (uint32_t)st->st_ino;
+    entry->mode = indexModeFromStat(st);
+    entry->uid = (uint32_t)st->st_uid;
+    entry->gid = (uint32_t)st->st_gid;
+    entry->size = (uint32_t)st->st_size;
+}
+
+/**
+ * @brief check whether a file can be trusted to still match its entry without reading it
+ *
+ * @note Entries modified no earlier than the index itself are "racily clean":
+ *       the file may have changed within the same timestamp tick, so they never match.
+ *
+ * @return int: 1 if the stat data is unchanged, 0 if the file must be rehashed
+ */
+int indexEntryMatchesStat(const Index *index, const IndexEntry *entry, const struct stat *st) {
+    if (entry->mode != indexModeFromStat(st) ||
+        entry->size != (uint32_t)st->st_size ||
+        entry->mtimeSec != (uint32_t)st->st_mtim.tv_sec ||
+        entry->mtimeNsec != (uint32_t)st->st_mtim.tv_nsec ||
+        entry->ctimeSec != (uint32_t)st->st_ctim.tv_sec ||
+        entry->ctimeNsec != (uint32_t)st->st_ctim.tv_nsec ||
+        entry->ino != (uint32_t)st->st_ino ||
+        entry->dev != (uint32_t)st->st_dev) {
+        return 0;
+    }
+
+    if (index->exists && ((time_t)entry->mtimeSec > index->mtime.tv_sec ||
+                          ((time_t)entry->mtimeSec == index->mtime.tv_sec &&
+                           (long)entry->mtimeNsec >= index->mtime.tv_nsec))) {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief hash a working tree file (or symlink target) as a blob
+ *
+ * @param path: file path
+ * @param st: its lstat() data
+ * @param store: 1 to also write the blob to the object database
+ * @param outSha: OUTPUT - 20-byte blob SHA
+ * @return int: 0 on success, -1 on error
+ */
+int hashWorktreeFile(const char *path, const struct stat *st, int store, unsigned char *outSha) {
+    unsigned char *content;
+    size_t size;
+    if (S_ISLNK(st->st_mode)) {
+        content = malloc(st->st_size + 1);
+        ssize_t n = readlink(path, (char *)content, st->st_size + 1);
+        if (n < 0 || n > st->st_size) {
+            fprintf(stderr, "Error: Could not read link %s\n", path);
+            free(content);
+            return -1;
+        }
+        size = n;
+    } else {
+        content = readFile(path, &size);
+        if (!content) {
+            fprintf(stderr, "Error: Could not read %s: %s\n", path, strerror(errno));
+            return -1;
+        }
+    }
+
+    int result = 0;
+    if (store) {
+        char hexSha[41];
+        result = writeObject("blob", content, size, hexSha);
+        if (result == 0) hexToRaw(hexSha, outSha);
+    } else {
+        hashObjectContent("blob", content, size, outSha);
+    }
+    free(content);
+    return result == 0 ? 0 : -1;
+}
+
+/**
+ * @brief add (or refresh) one working tree file, rehashing only if its stat data changed
+ *
+ * @param index: index to update
+ * @param path: file path relative to the top of the working tree
+ * @param st: its lstat() data
+ * @return int: 0 on success, -1 on error
+ */
+int indexAddFile(Index *index, const char *path, const struct stat *st) {
+    IndexEntry *existing = indexFind(index, path);
+    if (existing && indexEntryMatchesStat(index, existing, st)) {
+        return 0;
+    }
+
+    IndexEntry entry = {0};
+    if (hashWorktreeFile(path, st, 1, entry.sha) != 0) {
+        return -1;
+    }
+    if (existing && memcmp(existing->sha, entry.sha, 20) == 0) {
+        // Same content, new stat data (touched, or racily clean before)
+        if (existing->mode != indexModeFromStat(st)) invalidateCacheTree(index, path);
+        fillIndexStat(existing, st);
+        index->changed = 1;
+        return 0;
+    }
+    fillIndexStat(&entry, st);
+    entry.path = strdup(path);
+    indexAddEntry(index, &entry);
+    return 0;
+}
+
+/**
+ * @brief shared state of one refreshIndex() run
+ */
+typedef struct {
+    Index *index;
+    unsigned char *state;  // per entry: REFRESH_*
+    int failed;
+} RefreshJob;
+
+enum { REFRESH_CLEAN, REFRESH_STAT, REFRESH_UPDATED, REFRESH_DELETED, REFRESH_FAILED };
+
+static void refreshEntry(size_t i, void *arg) {
+    RefreshJob *job = arg;
+    IndexEntry *entry = &job->index->entries[i];
+    if (entry->fsmonitorValid) {
+        return;
+    }
+
+    struct stat st;
+    if (lstat(entry->path, &st) != 0 || (!S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode))) {
+        job->state[i] = REFRESH_DELETED;
+        return;
+    }
+    if (indexEntryMatchesStat(job->index, entry, &st)) {
+        entry->fsmonitorValid = job->index->fsmonitorToken != NULL;
+        return;
+    }
+
+    unsigned char sha[20];
+    if (hashWorktreeFile(entry->path, &st, 1, sha) != 0) {
+        job->state[i] = REFRESH_FAILED;
+        return;
+    }
+    int sameContent = memcmp(entry->sha, sha, 20) == 0 && entry->mode == indexModeFromStat(&st);
+    memcpy(entry->sha, sha, 20);
+    entry->fsmonitorValid = job->index->fsmonitorToken != NULL;
+    fillIndexStat(entry, &st);
+    job->state[i] = sameContent ? REFRESH_STAT : REFRESH_UPDATED;
+}
+
+/**
+ * @brief bring every entry up to date with the working tree
+ *
+ * @note Entries are lstat()ed in parallel; only files whose stat data changed
+ *       are read and hashed. Tracked files that are gone are dropped. Entries the
+ *       fsmonitor daemon vouched for (see fsmonitorRefresh()) are skipped.
+ *
+ * @param index: index to refresh
+ * @param threads: threads to use (0 = one per online CPU)
+ * @return int: number of entries changed or removed, -1 on error
+ */
+int refreshIndex(Index *index, int threads) {
+    if (index->count == 0) return 0;
+
+    RefreshJob job = { index, calloc(index->count, 1), 0 };
+    parallelFor(threads, index->count, refreshEntry, &job);
+
+    int changed = 0, failed = 0;
+    for (uint32_t i = index->count; i-- > 0;) {
+        if (job.state[i] == REFRESH_FAILED) failed = 1;
+        if (job.state[i] == REFRESH_STAT) changed++;
+        if (job.state[i] == REFRESH_UPDATED) {
+            invalidateCacheTree(index, index->entries[i].path);
+            changed++;
+        }
+        if (job.state[i] == REFRESH_DELETED) {
+            removeEntryAt(index, i);
+            changed++;
+        }
+    }
+    free(job.state);
+
+    if (changed) index->changed = 1;
+    return failed ? -1 : changed;
+}
+
+/**
+ * @brief Write the tree for entries [start, end), which all share a prefix of prefixLen bytes
+ *
+ * @note A subdirectory whose cache-tree node is still valid is skipped whole: its
+ *       entry count says where it ends and its SHA goes straight into the parent.
+ *       Rebuilt nodes get their new SHA and count; nodes for directories that are
+ *       gone are dropped.
+ *
+ * @return int: 0 on success, -1 on error
+ */
+static int writeIndexTree(const Index *index, CacheTree *tree, uint32_t start, uint32_t end, size_t prefixLen) {
+    IndexBuffer content = {0};
+    CacheTree **seen = calloc(tree->childCount + 1, sizeof(CacheTree *));
+    int seenCount = 0;
+    uint32_t i = start;
+    while (i < end) {
+        const IndexEntry *entry = &index->entries[i];
+        const char *name = entry->path + prefixLen;
+        const char *slash = strchr(name, '/');
+        char mode[16];
+        const unsigned char *sha;
+        size_t nameLen;
+
+        if (!slash) {
+            snprintf(mode, sizeof(mode), "%o", entry->mode);
+            sha = entry->sha;
+            nameLen = strlen(name);
+            i++;
+        } else {
+            // Subdirectory: every following entry with the same "name/" prefix
+            nameLen = slash - name;
+            CacheTree *child = cacheTreeChild(tree, name, nameLen, 1);
+            uint32_t j = i + (child->entryCount > 0 ? (uint32_t)child->entryCount : 1);
+            int reusable = child->entryCount > 0 && j <= end &&
+                           strncmp(index->entries[j - 1].path + prefixLen, name, nameLen + 1) == 0 &&
+                           (j == end || strncmp(index->entries[j].path + prefixLen, name, nameLen + 1) != 0);
+            if (reusable) {
+                char hexSha[41];
+                rawToHex(child->sha, hexSha);
+                reusable = odbHasObject(hexSha);
+            }
+            if (!reusable) {
+                j = i + 1;
+                while (j < end && strncmp(index->entries[j].path + prefixLen, name, nameLen + 1) == 0) j++;
+                if (writeIndexTree(index, child, i, j, prefixLen + nameLen + 1) != 0) {
+                    free(content.data);
+                    free(seen);
+                    return -1;
+                }
+            }
+
+            seen = realloc(seen, (seenCount + 1) * sizeof(CacheTree *));
+            seen[seenCount++] = child;
+            strcpy(mode, "40000");
+            sha = child->sha;
+            i = j;
+        }
+
+        bufferAppend(&content, mode, strlen(mode));
+        bufferAppend(&content, " ", 1);
+        bufferAppend(&content, name, nameLen);
+        bufferAppend(&content, "", 1);
+        bufferAppend(&content, sha, 20);
+    }
+
+    // Keep only the subtrees that still exist
+    for (int c = 0; c < tree->childCount; c++) {
+        int found = 0;
+        for (int k = 0; k < seenCount && !found; k++) found = seen[k] == tree->children[c];
+        if (!found) freeCacheTree(tree->children[c]);
+    }
+    free(tree->children);
+    tree->children = seen;
+    tree->childCount = seenCount;
+
+    char hexSha[41];
+    int result = writeObject("tree", content.data ? content.data : (const unsigned char *)"", content.len, hexSha);
+    free(content.data);
+    if (result != 0) return -1;
+    hexToRaw(hexSha, tree->sha);
+    tree->entryCount = (int)(end - start);
+    return 0;
+}
+
+/**
+ * @brief write the tree objects for the whole index
+ *
+ * @note Index order is git's tree order (a directory sorts as "name/"), so the
+ *       entries can be emitted as they come. Trees still valid in the cache-tree
+ *       are reused; the cache-tree is updated (index->changed is set if it was).
+ *
+ * @param index: index to write (stage 0 only)
+ * @param outHash: OUTPUT - 40-char hex SHA of the root tree (41 bytes)
+ * @return int: 0 on success, -1 on error
+ */
+int writeTreeFromIndex(Index *index, char *outHash) {
+    for (uint32_t i = 0; i < index->count; i++) {
+        if (entryStage(&index->entries[i]) != 0) {
+            fprintf(stderr, "Error: %s has unresolved conflicts\n", index->entries[i].path);
+            return -1;
+        }
+    }
+
+    if (!index->cacheTree) {
+        index->cacheTree = newCacheTree("", 0);
+    }
+    CacheTree *root = index->cacheTree;
+    char hexSha[41];
+    rawToHex(root->sha, hexSha);
+    if (root->entryCount < 0 || (uint32_t)root->entryCount != index->count || !odbHasObject(hexSha)) {
+        if (writeIndexTree(index, root, 0, index->count, 0) != 0) {
+            return -1;
+        }
+        index->changed = 1;
+    }
+    rawToHex(root->sha, outHash);
+    return 0;
+}
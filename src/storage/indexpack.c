@@ -0,0 +1,680 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <arpa/inet.h>  // for htonl (host to network byte order)
+#include "object.h"
+#include "../utils/utils.h"
+#include "../git/git.h"
+
+/*
+index-pack flow:
+pack bytes (as received)
+    → scanPack (sequential): walk every entry once, record offsets, types, CRC32s
+    → resolvePackEntries (worker pool): one work item per base object,
+        which is inflated, hashed, then all its deltas are applied from memory
+    → writePackIndex: fanout + sorted SHAs + CRC32s + offsets (.idx v2)
+    → pack stored untouched as .git/objects/pack/pack-<checksum>.pack
+
+Nothing is recompressed and no loose object is written.
+*/
+
+#define PACK_IDX_SIGNATURE 0xff744f63 // "\377tOc"
+#define PACK_IDX_VERSION 2
+
+/**
+ * @brief Inflate the zlib stream of a pack entry
+ *
+ * @param packData: raw pack data
+ * @param packSize: size of pack data
+ * @param entry: entry whose data should be inflated
+ * @param compressedUsed: OUTPUT - number of compressed bytes consumed (may be NULL)
+ * @return unsigned char*: inflated data of entry->size bytes (caller must free)
+ */
+static unsigned char* inflateEntry(const unsigned char *packData, size_t packSize, const PackEntry *entry, size_t *compressedUsed) {
+    // malloc(0) may legitimately return NULL, keep at least one byte around
+    unsigned char *data = malloc(entry->size ? entry->size : 1);
+    size_t used;
+    int inflated = zlibDecompress(packData + entry->dataOffset, packSize - entry->dataOffset, data, entry->size, &used);
+    if (inflated < 0 || (size_t)inflated != entry->size) {
+        fprintf(stderr, "Error: Failed to inflate pack entry at offset %zu\n", entry->offset);
+        free(data);
+        return NULL;
+    }
+    if (compressedUsed) *compressedUsed = used;
+    return data;
+}
+
+/**
+ * @brief Inflate a zlib stream into a small scratch window, only to learn where it ends
+ *
+ * @param compressed: start of the zlib stream
+ * @param compLen: bytes available
+ * @param expectedSize: inflated size announced by the entry header
+ * @param compressedUsed: OUTPUT - length of the zlib stream
+ * @return int: 0 on success, -1 if the stream is corrupt or the size does not match
+ */
+static int skipZlibStream(const unsigned char *compressed, size_t compLen, size_t expectedSize, size_t *compressedUsed) {
+    unsigned char scratch[16384];
+    z_stream stream = {0};
+    stream.next_in = (unsigned char *)compressed;
+    stream.avail_in = compLen;
+
+    if (inflateInit(&stream) != Z_OK) return -1;
+
+    int ret;
+    do {
+        stream.next_out = scratch;
+        stream.avail_out = sizeof(scratch);
+        ret = inflate(&stream, Z_NO_FLUSH);
+    } while (ret == Z_OK);
+    inflateEnd(&stream);
+
+    if (ret != Z_STREAM_END || stream.total_out != expectedSize) return -1;
+
+    *compressedUsed = stream.total_in;
+    return 0;
+}
+
+/**
+ * @brief scan a pack: record every entry's boundaries, type and CRC32
+ *
+ * @note This is the sequential first pass of index-pack. Objects are inflated
+ *       into a scratch window only to find where they end; naming them is
+ *       left to resolvePackEntries().
+ *
+ * @param packData: raw pack data (header, entries, 20-byte trailer)
+ * @param packSize: size of pack data
+ * @param outEntries: OUTPUT - entries in pack order (caller must free)
+ * @param outCount: OUTPUT - number of entries
+ * @return int: 0 on success, -1 on error
+ */
+int scanPack(const unsigned char *packData, size_t packSize, PackEntry **outEntries, uint32_t *outCount) {
+    PackHeader header = readPackHeader(packData, packSize);
+    if (header.version == 0) {
+        return -1;
+    }
+
+    if (packSize < 12 + SHA_DIGEST_LENGTH) {
+        fprintf(stderr, "Error: Pack is too small to hold its trailer\n");
+        return -1;
+    }
+
+    // Verify trailer: SHA-1 over everything before it
+    unsigned char checksum[SHA_DIGEST_LENGTH];
+    sha1(packData, packSize - SHA_DIGEST_LENGTH, checksum);
+    if (memcmp(checksum, packData + packSize - SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH) != 0) {
+        fprintf(stderr, "Error: Pack checksum mismatch\n");
+        return -1;
+    }
+
+    uint32_t count = (uint32_t)header.objects;
+    size_t end = packSize - SHA_DIGEST_LENGTH;
+    size_t pos = 12; // skip header
+
+    // Every entry takes at least two bytes (a header byte and some zlib data)
+    if (count > (end - pos) / 2) {
+        fprintf(stderr, "Error: Pack claims %u objects but is only %zu bytes\n", count, packSize);
+        return -1;
+    }
+    PackEntry *entries = calloc(count ? count : 1, sizeof(PackEntry));
+    if (!entries) {
+        fprintf(stderr, "Error: Out of memory for %u pack entries\n", count);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        PackEntry *entry = &entries[i];
+        if (pos >= end) {
+            fprintf(stderr, "Error: Pack truncated at object %u\n", i);
+            free(entries);
+            return -1;
+        }
+
+        entry->offset = pos;
+
+        // Type and size, as readTypeAndSize reads them, but bounded by the pack
+        unsigned char byte = packData[pos++];
+        int type = (byte >> 4) & 0x07;
+        size_t size = byte & 0x0F;
+        for (int shift = 4; byte & 0x80; shift += 7) {
+            if (pos >= end || shift > 57) goto truncated;
+            byte = packData[pos++];
+            size |= (size_t)(byte & 0x7F) << shift;
+        }
+        entry->type = type;
+        entry->size = size;
+
+        if (type == OBJ_REF_DELTA) {
+            if (end - pos < 20) goto truncated;
+            memcpy(entry->basesha, packData + pos, 20);
+            pos += 20;
+        } else if (type == OBJ_OFS_DELTA) {
+            // read offset (variable-length)
+            if (pos >= end) goto truncated;
+            byte = packData[pos++];
+            size_t offset = byte & 0x7F;
+            while (byte & 0x80) {
+                if (pos >= end || offset > (SIZE_MAX >> 7) - 1) goto truncated;
+                byte = packData[pos++];
+                offset = ((offset + 1) << 7) | (byte & 0x7F);
+            }
+            // The base must be an earlier entry: not this one, not the pack header
+            if (offset == 0 || offset > entry->offset - 12) {
+                fprintf(stderr, "Error: Bad delta base offset in object %u\n", i);
+                free(entries);
+                return -1;
+            }
+            entry->baseoffset = entry->offset - offset;
+        } else if (type < OBJ_COMMIT || type > OBJ_TAG) {
+            fprintf(stderr, "Error: Unknown object type %d in pack\n", type);
+            free(entries);
+            return -1;
+        }
+        entry->dataOffset = pos;
+
+        // Inflate to find where the entry ends
+        size_t compressedUsed;
+        if (skipZlibStream(packData + pos, end - pos, entry->size, &compressedUsed) != 0) {
+            fprintf(stderr, "Error: Failed to inflate pack entry at offset %zu\n", entry->offset);
+            free(entries);
+            return -1;
+        }
+        pos += compressedUsed;
+
+        entry->crc32 = crc32(0L, packData + entry->offset, pos - entry->offset);
+    }
+
+    if (pos != end) {
+        fprintf(stderr, "Error: Pack has %zu bytes of garbage after the last object\n", end - pos);
+        free(entries);
+        return -1;
+    }
+
+    *outEntries = entries;
+    *outCount = count;
+    return 0;
+
+truncated:
+    fprintf(stderr, "Error: Truncated entry header at offset %zu\n", pos);
+    free(entries);
+    return -1;
+}
+
+/**
+ * @brief delta families of a scanned pack
+ * @note Children of a base are found by binary search over two sorted views:
+ *      ofsChildren: OFS_DELTA entries ordered by base offset
+ *      refChildren: REF_DELTA entries ordered by base SHA
+ *      bases: every non-delta entry (each one roots a family)
+ */
+typedef struct {
+    const unsigned char *packData;
+    size_t packSize;
+    PackEntry *entries;
+    PackEntry **ofsChildren;
+    uint32_t ofsCount;
+    PackEntry **refChildren;
+    uint32_t refCount;
+    PackEntry **bases;
+    uint32_t baseCount;
+    PackObjectCallback onObject;
+    void *arg;
+    atomic_int failed;
+} DeltaFamilies;
+
+static int compareBaseOffsets(const void *a, const void *b) {
+    size_t x = (*(PackEntry **)a)->baseoffset, y = (*(PackEntry **)b)->baseoffset;
+    return (x > y) - (x < y);
+}
+
+static int compareBaseShas(const void *a, const void *b) {
+    return memcmp((*(PackEntry **)a)->basesha, (*(PackEntry **)b)->basesha, 20);
+}
+
+/**
+ * @brief Find the run of children in a sorted view whose key matches
+ *
+ * @param view: sorted children
+ * @param count: number of children in view
+ * @param match: returns <0, 0, >0 comparing a child's key to the wanted key
+ * @param key: wanted key (base offset or base SHA)
+ * @param outFirst: OUTPUT - index of the first matching child
+ * @return uint32_t: number of matching children
+ */
+static uint32_t findChildren(PackEntry **view, uint32_t count, int (*match)(const PackEntry *, const void *),
+                             const void *key, uint32_t *outFirst) {
+    uint32_t lo = 0, hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (match(view[mid], key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    uint32_t n = 0;
+    while (lo + n < count && match(view[lo + n], key) == 0) n++;
+    *outFirst = lo;
+    return n;
+}
+
+static int matchBaseOffset(const PackEntry *child, const void *key) {
+    size_t want = *(const size_t *)key;
+    return (child->baseoffset > want) - (child->baseoffset < want);
+}
+
+static int matchBaseSha(const PackEntry *child, const void *key) {
+    return memcmp(child->basesha, key, 20);
+}
+
+/**
+ * @brief Apply every child delta of a resolved base, then recurse into grandchildren
+ *
+ * @note The base stays in memory while its children are built, so each
+ *       object in a family is inflated exactly once.
+ */
+static void resolveChildren(DeltaFamilies *families, const PackEntry *base, const unsigned char *baseData, size_t baseSize) {
+    for (int pass = 0; pass < 2; pass++) {
+        PackEntry **view = pass == 0 ? families->ofsChildren : families->refChildren;
+        uint32_t viewCount = pass == 0 ? families->ofsCount : families->refCount;
+        uint32_t first, n;
+        if (pass == 0) {
+            n = findChildren(view, viewCount, matchBaseOffset, &base->offset, &first);
+        } else {
+            n = findChildren(view, viewCount, matchBaseSha, base->sha, &first);
+        }
+
+        for (uint32_t i = 0; i < n; i++) {
+            PackEntry *child = view[first + i];
+            // A REF child can already be done if the same base SHA appears twice
+            if (child->resolved) continue;
+
+            unsigned char *delta = inflateEntry(families->packData, families->packSize, child, NULL);
+            if (!delta) {
+                atomic_store(&families->failed, 1);
+                continue;
+            }
+
+            size_t size;
+            unsigned char *data = applyDelta(baseData, baseSize, delta, child->size, &size);
+            free(delta);
+            if (!data) {
+                fprintf(stderr, "Error: Could not apply delta at offset %zu\n", child->offset);
+                atomic_store(&families->failed, 1);
+                continue;
+            }
+
+            child->realType = base->realType;
+            hashObjectContent(objectTypeName(child->realType), data, size, child->sha);
+            child->resolved = 1;
+            if (families->onObject) families->onObject(child, data, size, families->arg);
+
+            resolveChildren(families, child, data, size);
+            free(data);
+        }
+    }
+}
+
+/**
+ * @brief Check whether any delta in the pack uses this entry as its base
+ */
+static int hasChildren(DeltaFamilies *families, const PackEntry *base) {
+    uint32_t first;
+    return findChildren(families->ofsChildren, families->ofsCount, matchBaseOffset, &base->offset, &first) > 0 ||
+           findChildren(families->refChildren, families->refCount, matchBaseSha, base->sha, &first) > 0;
+}
+
+/**
+ * @brief Work item: inflate one base object, name it, and resolve its whole family
+ */
+static void resolveFamily(size_t index, void *arg) {
+    DeltaFamilies *families = arg;
+    PackEntry *base = families->bases[index];
+
+    // Already named while streaming in and nothing builds on it: no need to inflate again
+    if (base->resolved && !families->onObject && !hasChildren(families, base)) {
+        return;
+    }
+
+    unsigned char *data = inflateEntry(families->packData, families->packSize, base, NULL);
+    if (!data) {
+        atomic_store(&families->failed, 1);
+        return;
+    }
+
+    base->realType = base->type;
+    hashObjectContent(objectTypeName(base->type), data, base->size, base->sha);
+    base->resolved = 1;
+    if (families->onObject) families->onObject(base, data, base->size, families->arg);
+
+    resolveChildren(families, base, data, base->size);
+    free(data);
+}
+
+/**
+ * @brief Resolve REF_DELTA children whose base is not in the pack (thin packs)
+ *
+ * @note The base is read once from the object database and its whole family
+ *       resolved from memory, like any in-pack base.
+ */
+static void resolveExternalBases(DeltaFamilies *families) {
+    for (uint32_t i = 0; i < families->refCount; i++) {
+        PackEntry *child = families->refChildren[i];
+        if (child->resolved) continue;
+        // refChildren is sorted by base SHA: handle each missing base once
+        if (i > 0 && memcmp(families->refChildren[i - 1]->basesha, child->basesha, 20) == 0) continue;
+
+        char hexSha[41];
+        rawToHex(child->basesha, hexSha);
+
+        PackEntry base = {0};
+        memcpy(base.sha, child->basesha, 20);
+        base.offset = SIZE_MAX; // never matches an OFS_DELTA base
+        unsigned char *data;
+        size_t size;
+        if (odbReadObject(hexSha, &base.realType, &data, &size) != 0) {
+            continue;
+        }
+
+        resolveChildren(families, &base, data, size);
+        free(data);
+    }
+}
+
+/**
+ * @brief resolve every entry of a pack and hand each object to a callback
+ *
+ * @note Second pass of index-pack. Every non-delta object roots a family
+ *       (itself plus all OFS/REF deltas built on it, transitively); families
+ *       are independent, so they are spread across a worker pool. Within a
+ *       family each base is inflated once and its children are applied from
+ *       memory, so chain depth costs nothing extra. Each entry is written by
+ *       exactly one worker, and the resulting SHAs do not depend on
+ *       scheduling, so the output matches a single-threaded run.
+ *
+ * @param packData: raw pack data
+ * @param packSize: size of pack data
+ * @param entries: entries from scanPack
+ * @param count: number of entries
+ * @param threads: worker threads (0 = one per online CPU, 1 = no threads)
+ * @param onObject: called (from worker threads) with each resolved object, may be NULL
+ * @param arg: passed through to onObject
+ * @return int: 0 on success, -1 if some object could not be resolved
+ */
+int resolvePackObjects(const unsigned char *packData, size_t packSize, PackEntry *entries, uint32_t count, int threads,
+                       PackObjectCallback onObject, void *arg) {
+    DeltaFamilies families = { .packData = packData, .packSize = packSize, .entries = entries, .onObject = onObject, .arg = arg };
+    atomic_init(&families.failed, 0);
+
+    families.ofsChildren = malloc((count ? count : 1) * sizeof(PackEntry *));
+    families.refChildren = malloc((count ? count : 1) * sizeof(PackEntry *));
+    families.bases = malloc((count ? count : 1) * sizeof(PackEntry *));
+    for (uint32_t i = 0; i < count; i++) {
+        if (entries[i].type == OBJ_OFS_DELTA) {
+            families.ofsChildren[families.ofsCount++] = &entries[i];
+        } else if (entries[i].type == OBJ_REF_DELTA) {
+            families.refChildren[families.refCount++] = &entries[i];
+        } else {
+            families.bases[families.baseCount++] = &entries[i];
+        }
+    }
+    qsort(families.ofsChildren, families.ofsCount, sizeof(PackEntry *), compareBaseOffsets);
+    qsort(families.refChildren, families.refCount, sizeof(PackEntry *), compareBaseShas);
+
+    parallelFor(threads, families.baseCount, resolveFamily, &families);
+    resolveExternalBases(&families);
+
+    uint32_t unresolved = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!entries[i].resolved) unresolved++;
+    }
+    if (unresolved > 0 && !atomic_load(&families.failed)) {
+        fprintf(stderr, "Error: %u delta objects reference missing bases\n", unresolved);
+    }
+
+    free(families.ofsChildren);
+    free(families.refChildren);
+    free(families.bases);
+    return (unresolved > 0 || atomic_load(&families.failed)) ? -1 : 0;
+}
+
+/**
+ * @brief compute the SHA and real type of every entry (see resolvePackObjects)
+ *
+ * @param packData: raw pack data
+ * @param packSize: size of pack data
+ * @param entries: entries from scanPack
+ * @param count: number of entries
+ * @param threads: worker threads (0 = one per online CPU, 1 = no threads)
+ * @return int: 0 on success, -1 if some object could not be resolved
+ */
+int resolvePackEntries(const unsigned char *packData, size_t packSize, PackEntry *entries, uint32_t count, int threads) {
+    return resolvePackObjects(packData, packSize, entries, count, threads, NULL, NULL);
+}
+
+/**
+ * @brief Compare two PackEntry pointers by SHA for qsort
+ */
+static int compareEntryShas(const void *a, const void *b) {
+    return memcmp((*(PackEntry **)a)->sha, (*(PackEntry **)b)->sha, 20);
+}
+
+/**
+ * @brief Write big-endian uint32 to buffer
+ */
+static unsigned char* putBE32(unsigned char *out, uint32_t value) {
+    uint32_t be = htonl(value);
+    memcpy(out, &be, 4);
+    return out + 4;
+}
+
+/**
+ * @brief write a version 2 pack index
+ *
+ * @note .idx v2 layout:
+ *      4-byte signature "\377tOc", 4-byte version (2)
+ *      256 x 4-byte fanout: number of objects whose first SHA byte is <= i
+ *      N x 20-byte SHAs, sorted
+ *      N x 4-byte CRC32 of the packed entry data
+ *      N x 4-byte offsets (MSB set: index into the 8-byte offset table)
+ *      M x 8-byte offsets for entries beyond 2GB
+ *      20-byte pack checksum, 20-byte checksum of the index itself
+ *
+ * @param idxPath: path to write the index to
+ * @param entries: resolved entries
+ * @param count: number of entries
+ * @param packSha: 20-byte pack trailer checksum
+ * @return int: 0 on success, -1 on error
+ */
+int writePackIndex(const char *idxPath, PackEntry *entries, uint32_t count, const unsigned char *packSha) {
+    PackEntry **sorted = malloc((count ? count : 1) * sizeof(PackEntry *));
+    uint32_t largeCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        sorted[i] = &entries[i];
+        if (entries[i].offset >= 0x80000000u) largeCount++;
+    }
+    qsort(sorted, count, sizeof(PackEntry *), compareEntryShas);
+
+    size_t idxSize = 8 + 256 * 4 + (size_t)count * (20 + 4 + 4) + (size_t)largeCount * 8 + 2 * SHA_DIGEST_LENGTH;
+    unsigned char *idx = malloc(idxSize);
+    unsigned char *out = idx;
+
+    out = putBE32(out, PACK_IDX_SIGNATURE);
+    out = putBE32(out, PACK_IDX_VERSION);
+
+    // Fanout table
+    uint32_t n = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        while (n < count && sorted[n]->sha[0] == byte) n++;
+        out = putBE32(out, n);
+    }
+
+    // Sorted SHAs
+    for (uint32_t i = 0; i < count; i++) {
+        if (i > 0 && memcmp(sorted[i - 1]->sha, sorted[i]->sha, 20) == 0) {
+            char hexSha[41];
+            rawToHex(sorted[i]->sha, hexSha);
+            fprintf(stderr, "Error: Duplicate object %s in pack\n", hexSha);
+            free(idx);
+            free(sorted);
+            return -1;
+        }
+        memcpy(out, sorted[i]->sha, 20);
+        out += 20;
+    }
+
+    // CRC32s
+    for (uint32_t i = 0; i < count; i++) {
+        out = putBE32(out, sorted[i]->crc32);
+    }
+
+    // Offsets, with large ones redirected to the 64-bit table
+    uint32_t largeIndex = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (sorted[i]->offset >= 0x80000000u) {
+            out = putBE32(out, 0x80000000u | largeIndex++);
+        } else {
+            out = putBE32(out, (uint32_t)sorted[i]->offset);
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (sorted[i]->offset >= 0x80000000u) {
+            out = putBE32(out, (uint32_t)((uint64_t)sorted[i]->offset >> 32));
+            out = putBE32(out, (uint32_t)sorted[i]->offset);
+        }
+    }
+
+    // Trailer: pack checksum followed by checksum of the index so far
+    memcpy(out, packSha, SHA_DIGEST_LENGTH);
+    out += SHA_DIGEST_LENGTH;
+    sha1(idx, out - idx, out);
+    free(sorted);
+
+    FILE *file = fopen(idxPath, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Could not create index file %s: %s\n", idxPath, strerror(errno));
+        free(idx);
+        return -1;
+    }
+    size_t written = fwrite(idx, 1, idxSize, file);
+    if (fclose(file) != 0 || written != idxSize) {
+        fprintf(stderr, "Error: Could not write index file %s\n", idxPath);
+        free(idx);
+        return -1;
+    }
+
+    free(idx);
+    return 0;
+}
+
+/**
+ * @brief Write a whole buffer to a freshly created temp file in .git/objects/pack
+ */
+static int writeTempPack(const unsigned char *packData, size_t packSize, char *tmpPath, size_t tmpPathSize) {
+    snprintf(tmpPath, tmpPathSize, ".git/objects/pack/tmp_pack_XXXXXX");
+    int fd = mkstemp(tmpPath);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", tmpPath, strerror(errno));
+        return -1;
+    }
+
+    size_t written = 0;
+    while (written < packSize) {
+        ssize_t n = write(fd, packData + written, packSize - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Could not write %s: %s\n", tmpPath, strerror(errno));
+            close(fd);
+            unlink(tmpPath);
+            return -1;
+        }
+        written += n;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * @brief move a fully written temp pack into place next to a freshly built .idx
+ *
+ * @param tmpPackPath: temp pack written inside .git/objects/pack
+ * @param entries: resolved entries
+ * @param count: number of entries
+ * @param packSha: 20-byte pack trailer checksum
+ * @param outPackSha: OUTPUT - 40-char hex pack checksum (must be 41 bytes, may be NULL)
+ * @return int: 0 on success, -1 on error (the temp pack is removed)
+ */
+int storePack(const char *tmpPackPath, PackEntry *entries, uint32_t count, const unsigned char *packSha, char *outPackSha) {
+    char packHex[41];
+    rawToHex(packSha, packHex);
+
+    char packPath[256], idxPath[256], tmpIdxPath[512];
+    snprintf(packPath, sizeof(packPath), ".git/objects/pack/pack-%s.pack", packHex);
+    snprintf(idxPath, sizeof(idxPath), ".git/objects/pack/pack-%s.idx", packHex);
+
+    // Index goes next to the temp pack first so readers never see a half-written .idx
+    snprintf(tmpIdxPath, sizeof(tmpIdxPath), "%s.idx", tmpPackPath);
+    if (writePackIndex(tmpIdxPath, entries, count, packSha) != 0) {
+        unlink(tmpPackPath);
+        return -1;
+    }
+    chmod(tmpPackPath, 0444);
+    chmod(tmpIdxPath, 0444);
+
+    // .pack first: an .idx must never point at a pack that is not there yet
+    if (rename(tmpPackPath, packPath) != 0 || rename(tmpIdxPath, idxPath) != 0) {
+        fprintf(stderr, "Error: Could not move pack into place: %s\n", strerror(errno));
+        unlink(tmpPackPath);
+        unlink(tmpIdxPath);
+        return -1;
+    }
+
+    if (outPackSha) {
+        strcpy(outPackSha, packHex);
+    }
+    return 0;
+}
+
+/**
+ * @brief store a received pack in .git/objects/pack and build its .idx
+ *
+ * @note The pack is kept exactly as received: pack-<checksum>.pack, where
+ *       <checksum> is the pack trailer, next to a generated pack-<checksum>.idx
+ *
+ * @param packData: raw pack data
+ * @param packSize: size of pack data
+ * @param threads: worker threads for delta resolution (0 = one per online CPU)
+ * @param outPackSha: OUTPUT - 40-char hex pack checksum (must be 41 bytes, may be NULL)
+ * @return int: 0 on success, -1 on error
+ */
+int indexPack(const unsigned char *packData, size_t packSize, int threads, char *outPackSha) {
+    PackEntry *entries;
+    uint32_t count;
+    if (scanPack(packData, packSize, &entries, &count) != 0) {
+        return -1;
+    }
+
+    if (resolvePackEntries(packData, packSize, entries, count, threads) != 0) {
+        free(entries);
+        return -1;
+    }
+
+    if (mkdir(".git/objects/pack", 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Could not create directory .git/objects/pack: %s\n", strerror(errno));
+        free(entries);
+        return -1;
+    }
+
+    char tmpPath[256];
+    if (writeTempPack(packData, packSize, tmpPath, sizeof(tmpPath)) != 0) {
+        free(entries);
+        return -1;
+    }
+
+    int result = storePack(tmpPath, entries, count, packData + packSize - SHA_DIGEST_LENGTH, outPackSha);
+    free(entries);
+    return result;
+}
@@ -4,11 +4,106 @@
 #include <sys/stat.h>
 #include <zlib.h>
 #include <errno.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <unistd.h>
 #include "../utils/utils.h"
+#include "object.h"
+
+/**
+ * @brief Map a pack object type to its loose object type name
+ * 
+ * @param type: OBJ_COMMIT, OBJ_TREE, OBJ_BLOB or OBJ_TAG
+ * @return const char*: "commit", "tree", "blob", "tag" (NULL for deltas)
+ */
+const char* objectTypeName(ObjectType type) {
+    switch (type) {
+        case OBJ_COMMIT: return "commit";
+        case OBJ_TREE:   return "tree";
+        case OBJ_BLOB:   return "blob";
+        case OBJ_TAG:    return "tag";
+        default:         return NULL;
+    }
+}
+
+// Fan-out directories .git/objects/00 .. ff known to exist, one bit each
+static atomic_uint_least64_t fanoutCreated[4];
+
+/**
+ * @brief Make sure .git/objects/<xx> exists; mkdir is attempted once per directory per process
+ */
+static int ensureFanoutDir(unsigned char firstByte, const char *hexSha) {
+    uint64_t bit = 1ull << (firstByte & 63);
+    atomic_uint_least64_t *word = &fanoutCreated[firstByte >> 6];
+    if (atomic_load_explicit(word, memory_order_relaxed) & bit) return 0;
+
+    char dirPath[256];
+    snprintf(dirPath, sizeof(dirPath), ".git/objects/%c%c", hexSha[0], hexSha[1]);
+    if (mkdir(dirPath, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Could not create directory %s: %s\n", dirPath, strerror(errno));
+        return -1;
+    }
+    atomic_fetch_or_explicit(word, bit, memory_order_relaxed);
+    return 0;
+}
+
+/**
+ * @brief Deflate header + content into fd as one zlib stream, without joining them
+ */
+static int deflateObject(int fd, const char *header, size_t headerLength, const unsigned char *content, size_t size) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK) return -1;
+
+    unsigned char out[65536];
+    const unsigned char *inputs[2] = { (const unsigned char *)header, content };
+    size_t lengths[2] = { headerLength, size };
+    int result = 0;
+
+    for (int part = 0; part < 2 && result == 0; part++) {
+        const unsigned char *next = inputs[part];
+        size_t left = lengths[part];
+        int flush;
+        do {
+            // zlib takes at most 4GB per call
+            uInt chunk = left > 0x40000000u ? 0x40000000u : (uInt)left;
+            stream.next_in = (unsigned char *)next;
+            stream.avail_in = chunk;
+            next += chunk;
+            left -= chunk;
+            flush = (part == 1 && left == 0) ? Z_FINISH : Z_NO_FLUSH;
+
+            int ret;
+            do {
+                stream.next_out = out;
+                stream.avail_out = sizeof(out);
+                ret = deflate(&stream, flush);
+                size_t produced = sizeof(out) - stream.avail_out;
+                for (size_t written = 0; written < produced;) {
+                    ssize_t n = write(fd, out + written, produced - written);
+                    if (n < 0) {
+                        if (errno == EINTR) continue;
+                        result = -1;
+                        break;
+                    }
+                    written += n;
+                }
+            } while (result == 0 && stream.avail_out == 0 && ret != Z_STREAM_END);
+        } while (result == 0 && left > 0);
+    }
+
+    deflateEnd(&stream);
+    return result;
+}
 
 /**
  * @brief Write a git object to .git/objects and return its SHA-1 hash
  * 
+ * @note Header and content are hashed and deflated where they are, never
+ *       copied together. An object already in the database (loose or
+ *       packed) is not compressed or written again. New objects go through
+ *       a temp file renamed into place, so readers never see a partial one.
+ * 
  * @param type: "blob", "tree", "commit"
  * @param content: object content
  * @param size: size of content
@@ -20,47 +115,42 @@ int writeObject(const char *type, const unsigned char *content, size_t size, cha
     char header[64];
     int headerLength = snprintf(header, sizeof(header), "%s %zu", type, size) + 1;
 
-    int blobSize = headerLength + size; 
-    unsigned char *buffer = malloc(blobSize);
-    memcpy(buffer, header, headerLength);
-    memcpy(buffer + headerLength, content, size);
+    unsigned char rawSha[SHA_DIGEST_LENGTH];
+    hashObjectContent(type, content, size, rawSha);
+    rawToHex(rawSha, outHash);
 
-    // Compute sha-1: hash entire blob (header + content) 
-    char hashOutput[SHA_DIGEST_LENGTH * 2 + 1];
-    hash((const char *)buffer, blobSize, hashOutput);
+    if (odbHasObject(outHash)) {
+        return 0;
+    }
 
-    // Compress with zlib 
-    unsigned long compressedSize = compressBound(blobSize);
-    unsigned char *compressed = malloc(compressedSize);
+    if (ensureFanoutDir(rawSha[0], outHash) != 0) {
+        return 1;
+    }
 
-    compress(compressed, &compressedSize, buffer, blobSize);
+    // ./git/objects/xx/tmp_obj_XXXXXX, renamed to ./git/objects/xx/yy... once complete
+    char tmpPath[256];
+    snprintf(tmpPath, sizeof(tmpPath), ".git/objects/%c%c/tmp_obj_XXXXXX", outHash[0], outHash[1]);
+    int fd = mkstemp(tmpPath);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", tmpPath, strerror(errno));
+        return 1;
+    }
 
-    // Create the directory - ./git/objects/xx/ (first 2 chars of hash)
-    char dirPath[256];
-    snprintf(dirPath, sizeof(dirPath), ".git/objects/%c%c", hashOutput[0], hashOutput[1]);
-    if (mkdir(dirPath, 0755) != 0 && errno != EEXIST) {
-        fprintf(stderr, "Error: Could not create directory %s: %s\n", dirPath, strerror(errno));
-        free(buffer);
+    if (deflateObject(fd, header, headerLength, content, size) != 0) {
+        fprintf(stderr, "Error: Could not write object %s: %s\n", outHash, strerror(errno));
+        close(fd);
+        unlink(tmpPath);
         return 1;
     }
+    fchmod(fd, 0444);
+    close(fd);
 
-    // Write the file to ./git/objects/xx/yy... (rest of hash)
-    char *filePath = buildPath(hashOutput);
-    FILE *outFile = fopen(filePath, "wb");
-    if (outFile == NULL) {
+    char *filePath = buildPath(outHash);
+    if (rename(tmpPath, filePath) != 0) {
         fprintf(stderr, "Error: Could not create object file %s: %s\n", filePath, strerror(errno));
-        free(buffer);
+        unlink(tmpPath);
         return 1;
     }
-    fwrite(compressed, 1, compressedSize, outFile);
-    fclose(outFile);
-    
-    // Copy hash to output parameter
-    strcpy(outHash, hashOutput);
-
-    // Cleanup
-    free(compressed);
-    free(buffer);
 
     return 0;
-}
\ No newline at end of file
+}
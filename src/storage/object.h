@@ -2,7 +2,9 @@
 #define OBJECT_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/types.h>
+#include <time.h>
 /* 
  * Will Implement later. This is for structure purposes
  * This will cover generic object operations (read any object type, decompress, parse header) 
@@ -122,10 +124,250 @@ typedef struct {
     size_t packOffset;  // Position in pack (for OFS_DELTA)
 } UnpackedObject;
 
+/**
+ * @brief pack index entry
+ * @note One record per object found while scanning a pack:
+ *      sha: SHA-1 of the resolved object (filled once its content is known)
+ *      offset: position of the object's type/size header in the pack
+ *      dataOffset: position of the zlib stream following the header
+ *      size: inflated size recorded in the entry header
+ *      type: type as stored in the pack (may be a delta)
+ *      realType: type of the resolved object
+ *      basesha: For REF_DELTA: SHA of base object
+ *      baseoffset: For OFS_DELTA: absolute offset of base object
+ *      crc32: CRC32 of the raw entry bytes (header + compressed data)
+ */
+typedef struct {
+    unsigned char sha[20];
+    size_t offset;
+    size_t dataOffset;
+    size_t size;
+    ObjectType type;
+    ObjectType realType;
+    unsigned char basesha[20];
+    size_t baseoffset;
+    uint32_t crc32;
+    int resolved;
+} PackEntry;
+
+const char* objectTypeName(ObjectType type);
+
+// Receives each object as soon as resolvePackObjects() has rebuilt it
+typedef void (*PackObjectCallback)(const PackEntry *entry, const unsigned char *data, size_t size, void *arg);
+
 PackHeader readPackHeader(const unsigned char *data, size_t dataLen);
-void unpack(unsigned char *packData, size_t packSize, const char *directory);
-static size_t readDeltaSize(const unsigned char **ptr);
+int unpack(unsigned char *packData, size_t packSize, const char *directory);
+size_t readDeltaSize(const unsigned char **ptr);
 unsigned char* applyDelta(const unsigned char *base, size_t baseSize, const unsigned char *delta, size_t deltaSize, size_t *resultSize);
 int readTypeAndSize(const unsigned char *data, int * type, size_t *size);
+int zlibDecompress(const unsigned char *compressed, size_t compLen, unsigned char *decompressed, size_t decompSize, size_t *compressedUsed);
+
+int scanPack(const unsigned char *packData, size_t packSize, PackEntry **outEntries, uint32_t *outCount);
+int resolvePackObjects(const unsigned char *packData, size_t packSize, PackEntry *entries, uint32_t count, int threads,
+                       PackObjectCallback onObject, void *arg);
+int resolvePackEntries(const unsigned char *packData, size_t packSize, PackEntry *entries, uint32_t count, int threads);
+int writePackIndex(const char *idxPath, PackEntry *entries, uint32_t count, const unsigned char *packSha);
+int storePack(const char *tmpPackPath, PackEntry *entries, uint32_t count, const unsigned char *packSha, char *outPackSha);
+int indexPack(const unsigned char *packData, size_t packSize, int threads, char *outPackSha);
+
+/**
+ * @brief pack generation settings
+ * @note
+ *      window: objects tried as delta bases for each object (0 = no deltas)
+ *      depth: longest delta chain allowed
+ */
+typedef struct {
+    int window;
+    int depth;
+} PackOptions;
+
+int packObjects(int fd, char **hexShas, char **paths, uint32_t count, const PackOptions *options,
+                PackEntry **outEntries, uint32_t *outCount, unsigned char *outPackSha);
+
+// Incremental pack parser fed while a pack is being received (see packstream.c)
+typedef struct PackStream PackStream;
+
+PackStream* packStreamBegin(int threads);
+int packStreamWrite(PackStream *stream, const unsigned char *data, size_t len);
+int packStreamFinish(PackStream *stream, char *outPackSha);
+void packStreamAbort(PackStream *stream);
+
+/**
+ * @brief consumer of a streamed object (see odbStreamObject)
+ * @note Callbacks return 0 to continue, < 0 on error, > 0 to stop early without error.
+ *      begin: called once with the type and exact size before any content (may be NULL)
+ *      write: called with consecutive pieces of the content
+ */
+typedef struct {
+    int (*begin)(ObjectType type, size_t size, void *arg);
+    int (*write)(const unsigned char *data, size_t len, void *arg);
+    void *arg;
+} ObjectSink;
+
+int odbReadObject(const char *hexSha, ObjectType *outType, unsigned char **outData, size_t *outSize);
+int odbReadObjectHeader(const char *hexSha, ObjectType *outType, size_t *outSize);
+int odbStreamObject(const char *hexSha, const ObjectSink *sink);
+int odbHasObject(const char *hexSha);
+int fdSinkWrite(const unsigned char *data, size_t len, void *arg);
+void odbReprepare(void);
+
+/**
+ * @brief in-place cursor over the entries of a tree object (see tree.c)
+ * @note name and sha point into the tree content; name is NUL-terminated there
+ */
+typedef struct {
+    const unsigned char *ptr, *end;
+    const char *name;
+    size_t nameLen;
+    uint32_t mode;
+    const unsigned char *sha;
+} TreeIterator;
+
+void treeIteratorInit(TreeIterator *it, const unsigned char *content, size_t size);
+int treeIteratorNext(TreeIterator *it);
+unsigned char* readTreeObject(const unsigned char *sha, size_t *outSize);
+int peelToTree(const char *hexSha, unsigned char *outTree);
+
+int deltaBaseCacheGet(const void *pack, size_t offset, ObjectType *outType, unsigned char **outData, size_t *outSize);
+void deltaBaseCachePut(const void *pack, size_t offset, ObjectType type, const unsigned char *data, size_t size);
+int deltaBaseCacheEnabled(void);
+void deltaBaseCacheClear(void);
+
+#define INDEX_PATH ".git/index"
+#define INDEX_LOCK_PATH ".git/index.lock"
+#define FSMONITOR_SOCKET_PATH ".git/fsmonitor.sock"
+
+/**
+ * @brief one path in the index (see index.c for the on-disk layout)
+ * @note
+ *      stat fields: truncated to 32 bits, as git stores them
+ *      mode: 0100644, 0100755 or 0120000
+ *      flags: stage in bits 12-13; the name length is recomputed on write
+ *      path: relative to the top of the working tree, '/' separated
+ *      fsmonitorValid: the fsmonitor daemon reported no change since the entry was last
+ *                      checked, so it needs no lstat() (FSMN extension on disk)
+ */
+typedef struct {
+    uint32_t ctimeSec, ctimeNsec;
+    uint32_t mtimeSec, mtimeNsec;
+    uint32_t dev, ino;
+    uint32_t mode;
+    uint32_t uid, gid;
+    uint32_t size;
+    unsigned char sha[20];
+    uint16_t flags;
+    uint16_t extendedFlags;
+    char *path;
+    unsigned char fsmonitorValid;
+} IndexEntry;
+
+/**
+ * @brief cache-tree node: the tree SHA last written for one directory of the index
+ * @note
+ *      name: path component ("" for the root)
+ *      entryCount: index entries under this directory, -1 once something under it changed
+ */
+typedef struct CacheTree {
+    char *name;
+    int entryCount;
+    unsigned char sha[20];
+    struct CacheTree **children;
+    int childCount;
+} CacheTree;
+
+/**
+ * @brief in-memory index
+ * @note
+ *      entries: sorted by path, then stage
+ *      mtime: of the index file when it was read (racy-git check)
+ *      cacheTree: TREE extension, NULL if there is none
+ *      fsmonitorToken: fsmonitor daemon token the valid bits are relative to, NULL if none
+ *      exists: 1 if read from disk or written
+ *      changed: entries differ from what is on disk
+ */
+typedef struct {
+    uint32_t version;
+    IndexEntry *entries;
+    uint32_t count;
+    uint32_t capacity;
+    struct timespec mtime;
+    CacheTree *cacheTree;
+    char *fsmonitorToken;
+    int exists;
+    int changed;
+} Index;
+
+struct stat;
+
+int readIndex(Index *index);
+int writeIndex(Index *index);
+void freeIndex(Index *index);
+int indexFindPos(const Index *index, const char *path, int stage);
+IndexEntry* indexFind(const Index *index, const char *path);
+void indexAddEntry(Index *index, IndexEntry *entry);
+int indexRemovePath(Index *index, const char *path);
+uint32_t indexModeFromStat(const struct stat *st);
+void fillIndexStat(IndexEntry *entry, const struct stat *st);
+int indexEntryMatchesStat(const Index *index, const IndexEntry *entry, const struct stat *st);
+int hashWorktreeFile(const char *path, const struct stat *st, int store, unsigned char *outSha);
+int indexAddFile(Index *index, const char *path, const struct stat *st);
+int refreshIndex(Index *index, int threads);
+int writeTreeFromIndex(Index *index, char *outHash);
+
+/**
+ * @brief what the fsmonitor daemon reported for one query
+ * @note
+ *      sinceToken: token the changes are relative to (the index's previous one), NULL if none
+ *      paths: changed paths (files or directories), sorted
+ *      everything: the daemon could not tell (unknown token, event overflow); assume all changed
+ */
+typedef struct {
+    char *sinceToken;
+    char **paths;
+    size_t count;
+    int everything;
+} FsmonitorChanges;
+
+int fsmonitorRefresh(Index *index, FsmonitorChanges *outChanges);
+int fsmonitorPathChanged(const FsmonitorChanges *changes, const char *path);
+void freeFsmonitorChanges(FsmonitorChanges *changes);
+
+#define COMMIT_GRAPH_PATH ".git/objects/info/commit-graph"
+
+typedef struct CommitGraph CommitGraph;
+
+/**
+ * @brief one commit's row in a commit-graph (see commitgraph.c)
+ * @note
+ *      tree: 20-byte tree SHA, pointing into the mapped file
+ *      generation: topological level (roots are 1)
+ *      date: committer time
+ */
+typedef struct {
+    const unsigned char *tree;
+    uint32_t generation;
+    int64_t date;
+} CommitGraphEntry;
+
+/**
+ * @brief a commit to write into a commit-graph
+ * @note parents: parentCount indexes into the same array as the commit
+ */
+typedef struct {
+    unsigned char sha[20];
+    unsigned char tree[20];
+    int64_t date;
+    uint32_t parentCount;
+    const uint32_t *parents;
+} CommitGraphInput;
+
+CommitGraph* openCommitGraph(const char *path);
+void closeCommitGraph(CommitGraph *graph);
+uint32_t commitGraphCount(const CommitGraph *graph);
+const unsigned char* commitGraphSha(const CommitGraph *graph, uint32_t position);
+int commitGraphFind(const CommitGraph *graph, const unsigned char *sha, uint32_t *outPosition);
+void commitGraphEntry(const CommitGraph *graph, uint32_t position, CommitGraphEntry *out);
+int commitGraphParents(const CommitGraph *graph, uint32_t position, uint32_t *outParents, uint32_t max);
+int writeCommitGraph(const char *path, const CommitGraphInput *commits, size_t count);
 
 #endif // OBJECT_H
\ No newline at end of file
@@ -0,0 +1,927 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <arpa/inet.h>  // for ntohl (network to host byte order)
+#include "object.h"
+#include "../utils/utils.h"
+#include "../git/git.h"
+
+/*
+Object lookup flow:
+hexSha
+    → for each mapped pack/idx pair:
+        fanout[first byte] narrows the range, binary search the sorted SHAs
+        → hit: inflate the entry straight out of the mapped pack (resolving deltas)
+    → miss everywhere: .git/objects/xx/yyyy... (loose object)
+
+Packs are discovered once per process and stay mapped.
+*/
+
+#define PACK_DIR ".git/objects/pack"
+#define PACK_MAX_DELTA_DEPTH 10000 // far beyond git's 4095 limit; deeper means a REF_DELTA cycle
+
+/**
+ * @brief mapped pack/idx pair
+ * @note Pointers into the mapped .idx (all big-endian):
+ *      fanout: 256 cumulative counts
+ *      shas: count x 20-byte sorted SHAs
+ *      offsets: count x 4-byte offsets
+ *      largeOffsets: largeCount 8-byte offsets referenced by offsets with the MSB set
+ */
+typedef struct {
+    const unsigned char *pack;
+    size_t packSize;
+    const unsigned char *idx;
+    size_t idxSize;
+    uint32_t count;
+    const uint32_t *fanout;
+    const unsigned char *shas;
+    const uint32_t *offsets;
+    const unsigned char *largeOffsets;
+    size_t largeCount;
+} PackFile;
+
+static PackFile *packs = NULL;
+static int packCount = 0;
+static atomic_int packsPrepared = 0;
+static pthread_mutex_t packsLock = PTHREAD_MUTEX_INITIALIZER; // guards the first scan (readers may run on worker pools)
+
+/**
+ * @brief mmap a whole file read-only
+ */
+static int mapFile(const char *path, const unsigned char **outData, size_t *outSize) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return -1;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+
+    *outData = data;
+    *outSize = st.st_size;
+    return 0;
+}
+
+/**
+ * @brief Map an .idx and its .pack and check they belong together
+ *
+ * @param idxPath: path to pack-<sha>.idx
+ * @param pack: OUTPUT - mapped pack
+ * @return int: 0 on success, -1 on error
+ */
+static int openPack(const char *idxPath, PackFile *pack) {
+    memset(pack, 0, sizeof(*pack));
+    if (mapFile(idxPath, &pack->idx, &pack->idxSize) != 0) {
+        return -1;
+    }
+
+    const uint32_t *header = (const uint32_t *)pack->idx;
+    if (pack->idxSize < 8 + 256 * 4 + 40 || ntohl(header[0]) != 0xff744f63 || ntohl(header[1]) != 2) {
+        fprintf(stderr, "Error: %s is not a version 2 pack index\n", idxPath);
+        munmap((void *)pack->idx, pack->idxSize);
+        return -1;
+    }
+
+    pack->fanout = header + 2;
+    pack->count = ntohl(pack->fanout[255]);
+    pack->shas = pack->idx + 8 + 256 * 4;
+    pack->offsets = (const uint32_t *)(pack->shas + (size_t)pack->count * (20 + 4));
+    pack->largeOffsets = (const unsigned char *)(pack->offsets + pack->count);
+
+    size_t tablesEnd = 8 + 256 * 4 + (size_t)pack->count * 28;
+    if (pack->idxSize < tablesEnd + 40 || (pack->idxSize - tablesEnd - 40) % 8 != 0) {
+        fprintf(stderr, "Error: Pack index %s is truncated\n", idxPath);
+        munmap((void *)pack->idx, pack->idxSize);
+        return -1;
+    }
+    pack->largeCount = (pack->idxSize - tablesEnd - 40) / 8;
+
+    // Lookups trust the fanout to bound their binary search
+    for (int i = 1; i < 256; i++) {
+        if (ntohl(pack->fanout[i]) < ntohl(pack->fanout[i - 1])) {
+            fprintf(stderr, "Error: Pack index %s has a corrupt fanout table\n", idxPath);
+            munmap((void *)pack->idx, pack->idxSize);
+            return -1;
+        }
+    }
+
+    // pack-<sha>.idx -> pack-<sha>.pack
+    char packPath[512];
+    snprintf(packPath, sizeof(packPath), "%.*s.pack", (int)(strlen(idxPath) - 4), idxPath);
+    if (mapFile(packPath, &pack->pack, &pack->packSize) != 0) {
+        fprintf(stderr, "Error: Could not open pack %s\n", packPath);
+        munmap((void *)pack->idx, pack->idxSize);
+        return -1;
+    }
+
+    // The .idx trailer starts with the checksum of the pack it describes
+    const unsigned char *idxPackSha = pack->idx + pack->idxSize - 40;
+    if (pack->packSize < 32 || memcmp(idxPackSha, pack->pack + pack->packSize - 20, 20) != 0) {
+        fprintf(stderr, "Error: %s does not match its pack\n", idxPath);
+        munmap((void *)pack->idx, pack->idxSize);
+        munmap((void *)pack->pack, pack->packSize);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Discover and map every pack in .git/objects/pack (once per process)
+ */
+static void preparePacks(void) {
+    if (atomic_load_explicit(&packsPrepared, memory_order_acquire)) return;
+
+    pthread_mutex_lock(&packsLock);
+    if (packsPrepared) {
+        pthread_mutex_unlock(&packsLock);
+        return;
+    }
+
+    DIR *dir = opendir(PACK_DIR);
+    if (!dir) {
+        atomic_store_explicit(&packsPrepared, 1, memory_order_release);
+        pthread_mutex_unlock(&packsLock);
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t len = strlen(entry->d_name);
+        if (len < 5 || strncmp(entry->d_name, "pack-", 5) != 0 || strcmp(entry->d_name + len - 4, ".idx") != 0) {
+            continue;
+        }
+
+        char idxPath[512];
+        snprintf(idxPath, sizeof(idxPath), "%s/%s", PACK_DIR, entry->d_name);
+
+        PackFile pack;
+        if (openPack(idxPath, &pack) != 0) continue;
+
+        packs = realloc(packs, (packCount + 1) * sizeof(PackFile));
+        packs[packCount++] = pack;
+    }
+    closedir(dir);
+
+    atomic_store_explicit(&packsPrepared, 1, memory_order_release);
+    pthread_mutex_unlock(&packsLock);
+}
+
+/**
+ * @brief drop all mapped packs so the next lookup rescans .git/objects/pack
+ *
+ * @note Call after adding a pack (index-pack) in the same process, while no
+ *       other thread is reading objects.
+ */
+void odbReprepare(void) {
+    pthread_mutex_lock(&packsLock);
+    deltaBaseCacheClear();
+    for (int i = 0; i < packCount; i++) {
+        munmap((void *)packs[i].idx, packs[i].idxSize);
+        munmap((void *)packs[i].pack, packs[i].packSize);
+    }
+    free(packs);
+    packs = NULL;
+    packCount = 0;
+    packsPrepared = 0;
+    pthread_mutex_unlock(&packsLock);
+}
+
+/**
+ * @brief Look up a raw SHA in one pack's index
+ *
+ * @param pack: mapped pack
+ * @param rawSha: 20-byte SHA
+ * @param outOffset: OUTPUT - offset of the entry in the pack
+ * @return int: 1 if found, 0 otherwise
+ */
+static int findInPack(const PackFile *pack, const unsigned char *rawSha, size_t *outOffset) {
+    uint32_t lo = rawSha[0] ? ntohl(pack->fanout[rawSha[0] - 1]) : 0;
+    uint32_t hi = ntohl(pack->fanout[rawSha[0]]);
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(pack->shas + (size_t)mid * 20, rawSha, 20);
+        if (cmp == 0) {
+            uint32_t offset = ntohl(pack->offsets[mid]);
+            if (offset & 0x80000000u) {
+                if ((offset & 0x7fffffffu) >= pack->largeCount) {
+                    fprintf(stderr, "Error: Corrupt large offset for an object in a pack index\n");
+                    return 0;
+                }
+                const unsigned char *large = pack->largeOffsets + (size_t)(offset & 0x7fffffffu) * 8;
+                uint64_t value = 0;
+                for (int i = 0; i < 8; i++) value = (value << 8) | large[i];
+                *outOffset = (size_t)value;
+            } else {
+                *outOffset = offset;
+            }
+            return 1;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return 0;
+}
+
+static int readLooseObject(const char *hexSha, ObjectType *outType, unsigned char **outData, size_t *outSize);
+static int readRawObject(const unsigned char *rawSha, ObjectType *outType, unsigned char **outData, size_t *outSize);
+
+/**
+ * @brief Parse a pack entry's type/size header (and delta base reference)
+ *
+ * @note Every header byte is read within the pack's object data, and an OFS_DELTA
+ *       base must come strictly before the entry, so a corrupt pack is rejected
+ *       here rather than read past its end.
+ *
+ * @param pack: mapped pack
+ * @param offset: entry offset in the pack
+ * @param outType: OUTPUT - type as stored (may be a delta)
+ * @param outSize: OUTPUT - inflated size of the entry data
+ * @param outBaseOffset: OUTPUT - for OFS_DELTA: absolute base offset
+ * @param outBaseSha: OUTPUT - for REF_DELTA: 20-byte base SHA
+ * @return const unsigned char*: start of the entry's zlib stream, NULL if the header is corrupt
+ */
+static const unsigned char* parsePackEntryHeader(const PackFile *pack, size_t offset, int *outType, size_t *outSize,
+                                                 size_t *outBaseOffset, unsigned char *outBaseSha) {
+    const unsigned char *ptr = pack->pack + offset;
+    const unsigned char *end = pack->pack + pack->packSize - 20;
+    if (offset < 12 || ptr >= end) goto corrupt;
+
+    // Same encoding as readTypeAndSize, bounded by the pack
+    unsigned char byte = *ptr++;
+    int type = (byte >> 4) & 0x07;
+    size_t size = byte & 0x0F;
+    int shift = 4;
+    while (byte & 0x80) {
+        if (ptr >= end || shift > 57) goto corrupt;
+        byte = *ptr++;
+        size |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    }
+    *outType = type;
+    *outSize = size;
+
+    if (type == OBJ_OFS_DELTA) {
+        if (ptr >= end) goto corrupt;
+        byte = *ptr++;
+        size_t delta = byte & 0x7F;
+        while (byte & 0x80) {
+            if (ptr >= end || delta > (SIZE_MAX >> 7) - 1) goto corrupt;
+            byte = *ptr++;
+            delta = ((delta + 1) << 7) | (byte & 0x7F);
+        }
+        if (delta == 0 || delta > offset) {
+            fprintf(stderr, "Error: Bad delta base offset at offset %zu\n", offset);
+            return NULL;
+        }
+        *outBaseOffset = offset - delta;
+    } else if (type == OBJ_REF_DELTA) {
+        if (end - ptr < 20) goto corrupt;
+        memcpy(outBaseSha, ptr, 20);
+        ptr += 20;
+    } else if (type < OBJ_COMMIT || type > OBJ_TAG) {
+        fprintf(stderr, "Error: Unknown object type %d at pack offset %zu\n", type, offset);
+        return NULL;
+    }
+    return ptr;
+
+corrupt:
+    fprintf(stderr, "Error: Corrupt pack entry header at offset %zu\n", offset);
+    return NULL;
+}
+
+/**
+ * @brief Parse a pack entry header and inflate its data
+ *
+ * @param pack: mapped pack
+ * @param offset: entry offset in the pack
+ * @param outType: OUTPUT - type as stored (may be a delta)
+ * @param outBaseOffset: OUTPUT - for OFS_DELTA: absolute base offset
+ * @param outBaseSha: OUTPUT - for REF_DELTA: 20-byte base SHA
+ * @param outData: OUTPUT - inflated data (caller must free)
+ * @param outSize: OUTPUT - inflated size
+ * @return int: 0 on success, -1 on error
+ */
+static int readPackEntry(const PackFile *pack, size_t offset, int *outType, size_t *outBaseOffset,
+                         unsigned char *outBaseSha, unsigned char **outData, size_t *outSize) {
+    const unsigned char *end = pack->pack + pack->packSize - 20;
+    size_t size;
+    const unsigned char *ptr = parsePackEntryHeader(pack, offset, outType, &size, outBaseOffset, outBaseSha);
+    if (!ptr) return -1;
+
+    unsigned char *data = malloc(size ? size : 1);
+    size_t compressedUsed;
+    int inflated = zlibDecompress(ptr, end - ptr, data, size, &compressedUsed);
+    if (inflated < 0 || (size_t)inflated != size) {
+        fprintf(stderr, "Error: Failed to inflate packed object at offset %zu\n", offset);
+        free(data);
+        return -1;
+    }
+
+    *outData = data;
+    *outSize = size;
+    return 0;
+}
+
+/**
+ * @brief pending delta on the way down a chain
+ */
+typedef struct {
+    size_t offset;
+    unsigned char *delta;
+    size_t deltaSize;
+} ChainLink;
+
+/**
+ * @brief Read and fully resolve the pack entry at offset
+ *
+ * @note Walks down the delta chain (any depth, no recursion) until it hits
+ *       a non-delta object, a base outside this pack, or a base already in
+ *       the delta-base cache, then applies the deltas back up. Every
+ *       intermediate object that served as a base is offered to the cache.
+ *
+ * @param pack: mapped pack
+ * @param offset: entry offset in the pack
+ * @param outType: OUTPUT - resolved object type
+ * @param outData: OUTPUT - object content (caller must free)
+ * @param outSize: OUTPUT - object size
+ * @return int: 0 on success, -1 on error
+ */
+static int readPackedObject(const PackFile *pack, size_t offset, ObjectType *outType, unsigned char **outData, size_t *outSize) {
+    ChainLink *chain = NULL;
+    size_t depth = 0, capacity = 0;
+
+    ObjectType type;
+    unsigned char *data = NULL;
+    size_t size = 0;
+    size_t cur = offset;
+    int baseFromCache = 0;
+
+    for (;;) {
+        // A cached base ends the walk (the object asked for is never looked up here)
+        if (depth > 0 && deltaBaseCacheGet(pack, cur, &type, &data, &size)) {
+            baseFromCache = 1;
+            break;
+        }
+
+        int entryType;
+        size_t baseOffset = 0;
+        unsigned char baseSha[20];
+        unsigned char *entryData;
+        size_t entrySize;
+        if (readPackEntry(pack, cur, &entryType, &baseOffset, baseSha, &entryData, &entrySize) != 0) {
+            goto fail;
+        }
+
+        if (entryType != OBJ_OFS_DELTA && entryType != OBJ_REF_DELTA) {
+            type = entryType;
+            data = entryData;
+            size = entrySize;
+            break;
+        }
+
+        if (depth == PACK_MAX_DELTA_DEPTH) {
+            fprintf(stderr, "Error: Delta chain at pack offset %zu is too deep\n", offset);
+            free(entryData);
+            goto fail;
+        }
+        if (depth == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            chain = realloc(chain, capacity * sizeof(ChainLink));
+        }
+        chain[depth++] = (ChainLink){ cur, entryData, entrySize };
+
+        if (entryType == OBJ_OFS_DELTA) {
+            cur = baseOffset;
+        } else if (!findInPack(pack, baseSha, &cur)) {
+            // Base lives in another pack or loose
+            if (readRawObject(baseSha, &type, &data, &size) != 0) goto fail;
+            baseFromCache = 1; // no offset in this pack to cache it under
+            break;
+        }
+    }
+
+    // Without a cache the intermediate objects would be thrown away: fold the
+    // whole chain into one delta against the base and build only the result
+    if (depth > 1 && !deltaBaseCacheEnabled()) {
+        const unsigned char **deltas = malloc(depth * sizeof(unsigned char *));
+        size_t *deltaSizes = malloc(depth * sizeof(size_t));
+        for (size_t i = 0; i < depth; i++) {
+            deltas[i] = chain[depth - 1 - i].delta;
+            deltaSizes[i] = chain[depth - 1 - i].deltaSize;
+        }
+
+        size_t resultSize;
+        unsigned char *result = applyDeltaChain(data, size, deltas, deltaSizes, depth, &resultSize);
+        free(deltas);
+        free(deltaSizes);
+        free(data);
+        data = NULL;
+        if (!result) goto fail;
+
+        while (depth > 0) free(chain[--depth].delta);
+        data = result;
+        size = resultSize;
+    }
+
+    // Apply deltas from the innermost back up to the object asked for
+    while (depth > 0) {
+        if (!baseFromCache) {
+            deltaBaseCachePut(pack, cur, type, data, size);
+        }
+        baseFromCache = 0;
+
+        ChainLink link = chain[--depth];
+        size_t resultSize;
+        unsigned char *result = applyDelta(data, size, link.delta, link.deltaSize, &resultSize);
+        free(link.delta);
+        free(data);
+        if (!result) {
+            data = NULL;
+            goto fail;
+        }
+        data = result;
+        size = resultSize;
+        cur = link.offset;
+    }
+
+    free(chain);
+    *outType = type;
+    *outData = data;
+    *outSize = size;
+    return 0;
+
+fail:
+    while (depth > 0) free(chain[--depth].delta);
+    free(chain);
+    free(data);
+    return -1;
+}
+
+/**
+ * @brief Parse "<type> <size>\0" at the start of a loose object
+ *
+ * @return int: header length including the NUL, -1 if malformed
+ */
+static int parseLooseHeader(const unsigned char *data, size_t len, ObjectType *outType, size_t *outSize) {
+    const unsigned char *nullByte = memchr(data, '\0', len < 64 ? len : 64);
+    const unsigned char *space = memchr(data, ' ', len < 64 ? len : 64);
+    if (!nullByte || !space || space > nullByte) {
+        return -1;
+    }
+
+    size_t typeLen = space - data;
+    if (typeLen == 4 && memcmp(data, "blob", 4) == 0) {
+        *outType = OBJ_BLOB;
+    } else if (typeLen == 4 && memcmp(data, "tree", 4) == 0) {
+        *outType = OBJ_TREE;
+    } else if (typeLen == 6 && memcmp(data, "commit", 6) == 0) {
+        *outType = OBJ_COMMIT;
+    } else if (typeLen == 3 && memcmp(data, "tag", 3) == 0) {
+        *outType = OBJ_TAG;
+    } else {
+        return -1;
+    }
+
+    *outSize = strtoull((const char *)space + 1, NULL, 10);
+    return (int)(nullByte - data) + 1;
+}
+
+#define STREAM_CHUNK 65536
+
+/**
+ * @brief Inflate a loose object into a sink: header first, then the content in STREAM_CHUNK pieces
+ *
+ * @note Memory use is bounded by the buffers here, whatever the object size.
+ *       A sink callback returning > 0 stops early (e.g. once the header is known).
+ *
+ * @return int: 0 on success, 1 if the object is not loose, -1 if it is corrupt or the sink failed
+ */
+static int streamLooseObject(const char *hexSha, const ObjectSink *sink) {
+    int fd = open(buildPath(hexSha), O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit(&stream) != Z_OK) {
+        close(fd);
+        return -1;
+    }
+
+    unsigned char in[8192];
+    unsigned char *out = malloc(STREAM_CHUNK);
+    char header[64];
+    size_t headerLen = 0;
+    int headerDone = 0;
+    size_t size = 0, delivered = 0;
+    int result = 0, ret = Z_OK;
+
+    while (result == 0 && ret != Z_STREAM_END) {
+        if (stream.avail_in == 0) {
+            ssize_t n = read(fd, in, sizeof(in));
+            if (n <= 0) {
+                result = -1; // truncated
+                break;
+            }
+            stream.next_in = in;
+            stream.avail_in = (uInt)n;
+        }
+
+        // Until the header is complete, inflate only as far as it can reach
+        stream.next_out = out;
+        stream.avail_out = headerDone ? STREAM_CHUNK : (uInt)(sizeof(header) - headerLen);
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            result = -1;
+            break;
+        }
+        size_t produced = stream.next_out - out;
+        const unsigned char *content = out;
+
+        if (!headerDone && produced > 0) {
+            memcpy(header + headerLen, out, produced);
+            headerLen += produced;
+
+            ObjectType type;
+            int parsed = parseLooseHeader((unsigned char *)header, headerLen, &type, &size);
+            if (parsed < 0) {
+                if (memchr(header, '\0', headerLen) || headerLen == sizeof(header)) result = -1;
+                continue;
+            }
+            headerDone = 1;
+            content = out + (parsed - (headerLen - produced));
+            produced = headerLen - parsed;
+            if (sink->begin) result = sink->begin(type, size, sink->arg);
+        }
+
+        if (headerDone && produced > 0 && result == 0) {
+            if (delivered + produced > size) {
+                result = -1;
+                break;
+            }
+            delivered += produced;
+            result = sink->write ? sink->write(content, produced, sink->arg) : 0;
+        }
+    }
+
+    if (result == 0 && (!headerDone || delivered != size)) {
+        result = -1;
+    }
+    if (result < 0) {
+        fprintf(stderr, "Error: Corrupt loose object %s\n", hexSha);
+    }
+
+    inflateEnd(&stream);
+    free(out);
+    close(fd);
+    return result < 0 ? -1 : 0;
+}
+
+/**
+ * @brief ObjectSink that collects an object into one exactly sized buffer
+ */
+typedef struct {
+    ObjectType type;
+    unsigned char *data;
+    size_t size;
+    size_t filled;
+} BufferSink;
+
+static int bufferSinkBegin(ObjectType type, size_t size, void *arg) {
+    BufferSink *buffer = arg;
+    buffer->type = type;
+    buffer->size = size;
+    buffer->data = malloc(size ? size : 1);
+    return buffer->data ? 0 : -1;
+}
+
+static int bufferSinkWrite(const unsigned char *data, size_t len, void *arg) {
+    BufferSink *buffer = arg;
+    memcpy(buffer->data + buffer->filled, data, len);
+    buffer->filled += len;
+    return 0;
+}
+
+/**
+ * @brief Read a loose object (.git/objects/xx/yyyy...)
+ *
+ * @note The header is inflated first, so the content buffer is allocated at its exact size.
+ *
+ * @return int: 0 on success, -1 if missing or corrupt
+ */
+static int readLooseObject(const char *hexSha, ObjectType *outType, unsigned char **outData, size_t *outSize) {
+    BufferSink buffer = {0};
+    ObjectSink sink = { bufferSinkBegin, bufferSinkWrite, &buffer };
+    if (streamLooseObject(hexSha, &sink) != 0) {
+        free(buffer.data);
+        return -1;
+    }
+
+    *outType = buffer.type;
+    *outData = buffer.data;
+    *outSize = buffer.size;
+    return 0;
+}
+
+/**
+ * @brief Read an object by raw SHA: packs first, loose objects on a miss
+ */
+static int readRawObject(const unsigned char *rawSha, ObjectType *outType, unsigned char **outData, size_t *outSize) {
+    preparePacks();
+
+    for (int i = 0; i < packCount; i++) {
+        size_t offset;
+        if (findInPack(&packs[i], rawSha, &offset)) {
+            return readPackedObject(&packs[i], offset, outType, outData, outSize);
+        }
+    }
+
+    char hexSha[41];
+    rawToHex(rawSha, hexSha);
+    return readLooseObject(hexSha, outType, outData, outSize);
+}
+
+/**
+ * @brief read an object from the object database (packs, then loose)
+ *
+ * @param hexSha: 40-char hex SHA
+ * @param outType: OUTPUT - object type (OBJ_COMMIT, OBJ_TREE, OBJ_BLOB, OBJ_TAG)
+ * @param outData: OUTPUT - object content without header (caller must free)
+ * @param outSize: OUTPUT - size of content
+ * @return int: 0 on success, -1 if missing or corrupt
+ */
+int odbReadObject(const char *hexSha, ObjectType *outType, unsigned char **outData, size_t *outSize) {
+    unsigned char rawSha[20];
+    if (strlen(hexSha) != 40 || hexToRaw(hexSha, rawSha) != 0) {
+        return -1;
+    }
+    return readRawObject(rawSha, outType, outData, outSize);
+}
+
+/**
+ * @brief Find the final type and size of the pack entry at offset without inflating it
+ *
+ * @note A delta's size is the result size at the start of its delta data, so only
+ *       those few bytes are inflated; the type comes from the end of the base chain.
+ *
+ * @return int: 0 on success, -1 on error
+ */
+static int readPackedHeader(const PackFile *pack, size_t offset, ObjectType *outType, size_t *outSize) {
+    const unsigned char *end = pack->pack + pack->packSize - 20;
+    int sizeKnown = 0;
+
+    for (int depth = 0;; depth++) {
+        if (depth > PACK_MAX_DELTA_DEPTH) {
+            fprintf(stderr, "Error: Delta chain at pack offset %zu is too deep\n", offset);
+            return -1;
+        }
+        int type;
+        size_t size, baseOffset = 0;
+        unsigned char baseSha[20];
+        const unsigned char *ptr = parsePackEntryHeader(pack, offset, &type, &size, &baseOffset, baseSha);
+        if (!ptr) return -1;
+
+        if (type != OBJ_OFS_DELTA && type != OBJ_REF_DELTA) {
+            *outType = type;
+            if (!sizeKnown) *outSize = size;
+            return 0;
+        }
+
+        if (!sizeKnown) {
+            // Two varints (base size, result size) fit in 20 bytes
+            unsigned char prefix[20] = {0};
+            z_stream stream;
+            memset(&stream, 0, sizeof(stream));
+            stream.next_in = (unsigned char *)ptr;
+            stream.avail_in = end - ptr;
+            stream.next_out = prefix;
+            stream.avail_out = size < sizeof(prefix) ? size : sizeof(prefix);
+            if (inflateInit(&stream) != Z_OK) return -1;
+            int ret = inflate(&stream, Z_SYNC_FLUSH);
+            size_t got = stream.next_out - prefix;
+            inflateEnd(&stream);
+            if (ret != Z_OK && ret != Z_STREAM_END) {
+                fprintf(stderr, "Error: Failed to inflate packed object at offset %zu\n", offset);
+                return -1;
+            }
+
+            const unsigned char *delta = prefix;
+            readDeltaSize(&delta);
+            if (delta >= prefix + got) return -1;
+            *outSize = readDeltaSize(&delta);
+            sizeKnown = 1;
+        }
+
+        if (type == OBJ_OFS_DELTA) {
+            offset = baseOffset;
+            continue;
+        }
+
+        // REF_DELTA: the base may be in another pack or loose
+        if (findInPack(pack, baseSha, &offset)) continue;
+        char baseHex[41];
+        rawToHex(baseSha, baseHex);
+        size_t baseSize;
+        return odbReadObjectHeader(baseHex, outType, &baseSize);
+    }
+}
+
+static int headerSinkBegin(ObjectType type, size_t size, void *arg) {
+    BufferSink *header = arg;
+    header->type = type;
+    header->size = size;
+    return 1; // stop: the content isn't needed
+}
+
+/**
+ * @brief read only the type and size of an object
+ *
+ * @note Loose objects inflate just their header; packed objects read the entry
+ *       header (and, for deltas, the first bytes of the delta).
+ *
+ * @param hexSha: 40-char hex SHA
+ * @param outType: OUTPUT - object type
+ * @param outSize: OUTPUT - content size
+ * @return int: 0 on success, -1 if missing or corrupt
+ */
+int odbReadObjectHeader(const char *hexSha, ObjectType *outType, size_t *outSize) {
+    unsigned char rawSha[20];
+    if (strlen(hexSha) != 40 || hexToRaw(hexSha, rawSha) != 0) {
+        return -1;
+    }
+    preparePacks();
+
+    for (int i = 0; i < packCount; i++) {
+        size_t offset;
+        if (findInPack(&packs[i], rawSha, &offset)) {
+            return readPackedHeader(&packs[i], offset, outType, outSize);
+        }
+    }
+
+    BufferSink header = {0};
+    ObjectSink sink = { headerSinkBegin, NULL, &header };
+    if (streamLooseObject(hexSha, &sink) != 0) {
+        return -1;
+    }
+    *outType = header.type;
+    *outSize = header.size;
+    return 0;
+}
+
+/**
+ * @brief Inflate a non-delta pack entry into a sink in STREAM_CHUNK pieces
+ *
+ * @return int: 0 on success, -1 on error
+ */
+static int streamPackEntry(const PackFile *pack, size_t offset, const unsigned char *ptr, size_t size,
+                           const ObjectSink *sink) {
+    const unsigned char *end = pack->pack + pack->packSize - 20;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.next_in = (unsigned char *)ptr;
+    stream.avail_in = end - ptr;
+    if (inflateInit(&stream) != Z_OK) return -1;
+
+    unsigned char *out = malloc(STREAM_CHUNK);
+    size_t delivered = 0;
+    int result = 0, ret = Z_OK;
+    while (result == 0 && ret != Z_STREAM_END) {
+        stream.next_out = out;
+        stream.avail_out = STREAM_CHUNK;
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            result = -1;
+            break;
+        }
+        size_t produced = stream.next_out - out;
+        if (delivered + produced > size) {
+            result = -1;
+            break;
+        }
+        delivered += produced;
+        if (produced > 0 && sink->write) result = sink->write(out, produced, sink->arg);
+    }
+    if (result == 0 && delivered != size) result = -1;
+    if (result < 0) {
+        fprintf(stderr, "Error: Failed to inflate packed object at offset %zu\n", offset);
+    }
+
+    inflateEnd(&stream);
+    free(out);
+    return result < 0 ? -1 : 0;
+}
+
+/**
+ * @brief stream an object's content to a sink without holding it all in memory
+ *
+ * @note Loose objects and whole (non-delta) packed objects are inflated in fixed
+ *       chunks. Deltified objects are resolved in memory first, since a delta
+ *       copies from anywhere in its base.
+ *
+ * @param hexSha: 40-char hex SHA
+ * @param sink: receives the type/size, then the content
+ * @return int: 0 on success (including an early stop), -1 if missing, corrupt or the sink failed
+ */
+int odbStreamObject(const char *hexSha, const ObjectSink *sink) {
+    unsigned char rawSha[20];
+    if (strlen(hexSha) != 40 || hexToRaw(hexSha, rawSha) != 0) {
+        return -1;
+    }
+    preparePacks();
+
+    for (int i = 0; i < packCount; i++) {
+        size_t offset;
+        if (!findInPack(&packs[i], rawSha, &offset)) continue;
+
+        int type;
+        size_t size, baseOffset;
+        unsigned char baseSha[20];
+        const unsigned char *ptr = parsePackEntryHeader(&packs[i], offset, &type, &size, &baseOffset, baseSha);
+        if (!ptr) return -1;
+        if (type != OBJ_OFS_DELTA && type != OBJ_REF_DELTA) {
+            int result = sink->begin ? sink->begin(type, size, sink->arg) : 0;
+            if (result != 0) return result < 0 ? -1 : 0;
+            return streamPackEntry(&packs[i], offset, ptr, size, sink);
+        }
+
+        ObjectType resolvedType;
+        unsigned char *data;
+        if (readPackedObject(&packs[i], offset, &resolvedType, &data, &size) != 0) return -1;
+        int result = sink->begin ? sink->begin(resolvedType, size, sink->arg) : 0;
+        for (size_t pos = 0; result == 0 && pos < size && sink->write; pos += STREAM_CHUNK) {
+            size_t len = size - pos < STREAM_CHUNK ? size - pos : STREAM_CHUNK;
+            result = sink->write(data + pos, len, sink->arg);
+        }
+        free(data);
+        return result < 0 ? -1 : 0;
+    }
+
+    return streamLooseObject(hexSha, sink) == 0 ? 0 : -1;
+}
+
+/**
+ * @brief ObjectSink write callback that copies the content to a file descriptor
+ *
+ * @param arg: the descriptor, as (void *)(intptr_t)fd
+ * @return int: 0 on success, -1 on a write error
+ */
+int fdSinkWrite(const unsigned char *data, size_t len, void *arg) {
+    int fd = (int)(intptr_t)arg;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Could not write object: %s\n", strerror(errno));
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * @brief check whether an object exists, without reading it
+ *
+ * @param hexSha: 40-char hex SHA
+ * @return int: 1 if present in a pack or loose, 0 otherwise
+ */
+int odbHasObject(const char *hexSha) {
+    unsigned char rawSha[20];
+    if (strlen(hexSha) != 40 || hexToRaw(hexSha, rawSha) != 0) {
+        return 0;
+    }
+    preparePacks();
+
+    for (int i = 0; i < packCount; i++) {
+        size_t offset;
+        if (findInPack(&packs[i], rawSha, &offset)) return 1;
+    }
+
+    struct stat st;
+    return stat(buildPath(hexSha), &st) == 0;
+}
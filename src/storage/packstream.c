@@ -0,0 +1,387 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include <arpa/inet.h>  // for ntohl (network to host byte order)
+#include "object.h"
+#include "../utils/utils.h"
+
+/*
+Streaming pack ingestion:
+bytes as they arrive (any chunking)
+    → appended to .git/objects/pack/tmp_pack_XXXXXX
+    → header (12 bytes), then for each entry:
+        type/size (+ base offset or base SHA) header, assembled byte by byte
+        → zlib stream inflated chunk by chunk into a scratch window
+            non-delta objects are hashed as they inflate
+            CRC32 runs over the raw entry bytes
+    → 20-byte trailer, checked against a SHA-1 kept running over every byte before it
+packStreamFinish: mmap the temp pack, resolve the deltas, write the .idx
+
+The pack is never held in memory as a whole.
+*/
+
+#define ENTRY_HEADER_MAX 32 // type/size varint + 20-byte base SHA fits easily
+
+typedef enum {
+    STREAM_PACK_HEADER,
+    STREAM_ENTRY_HEADER,
+    STREAM_ENTRY_DATA,
+    STREAM_TRAILER,
+    STREAM_DONE,
+    STREAM_FAILED,
+} PackStreamState;
+
+/**
+ * @brief incremental pack parser state
+ * @note
+ *      fd/tmpPath: temp pack the raw bytes are appended to
+ *      offset: pack bytes consumed so far (= offset of the next byte)
+ *      buffer/bufferLen: partially received fixed-size parts (pack header,
+ *          entry header, trailer)
+ *      zstream/objectHash: state of the entry currently being inflated
+ */
+struct PackStream {
+    PackStreamState state;
+    int threads;
+    int fd;
+    char tmpPath[256];
+    size_t offset;
+
+    unsigned char buffer[ENTRY_HEADER_MAX];
+    size_t bufferLen;
+
+    PackEntry *entries;
+    uint32_t count;
+    uint32_t current;
+
+    z_stream zstream;
+    int zstreamActive;
+    Sha1Context objectHash;
+    size_t inflated;
+
+    Sha1Context packHash;
+};
+
+/**
+ * @brief start receiving a pack into .git/objects/pack
+ *
+ * @param threads: worker threads for delta resolution at the end (0 = one per online CPU)
+ * @return PackStream*: stream to feed with packStreamWrite(), NULL on error
+ */
+PackStream* packStreamBegin(int threads) {
+    if (mkdir(".git/objects/pack", 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Could not create directory .git/objects/pack: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    PackStream *stream = calloc(1, sizeof(PackStream));
+    stream->threads = threads;
+    snprintf(stream->tmpPath, sizeof(stream->tmpPath), ".git/objects/pack/tmp_pack_XXXXXX");
+    stream->fd = mkstemp(stream->tmpPath);
+    if (stream->fd < 0) {
+        fprintf(stderr, "Error: Could not create %s: %s\n", stream->tmpPath, strerror(errno));
+        free(stream);
+        return NULL;
+    }
+    sha1Init(&stream->packHash);
+    stream->state = STREAM_PACK_HEADER;
+    return stream;
+}
+
+/**
+ * @brief Mark the stream as failed (the temp pack is removed by abort/finish)
+ */
+static int streamFail(PackStream *stream) {
+    stream->state = STREAM_FAILED;
+    return -1;
+}
+
+/**
+ * @brief Try to parse the buffered entry header
+ *
+ * @return int: header length once complete, 0 if more bytes are needed, -1 if invalid
+ */
+static int parseEntryHeader(PackStream *stream, PackEntry *entry) {
+    const unsigned char *buf = stream->buffer;
+    size_t len = stream->bufferLen;
+
+    // type/size varint must be complete before readTypeAndSize can run
+    size_t pos = 0;
+    while (pos < len && (buf[pos] & 0x80)) pos++;
+    if (pos == len) return 0;
+
+    int type;
+    size_t consumed = readTypeAndSize(buf, &type, &entry->size);
+    entry->type = type;
+
+    if (type == OBJ_REF_DELTA) {
+        if (len < consumed + 20) return 0;
+        memcpy(entry->basesha, buf + consumed, 20);
+        return (int)(consumed + 20);
+    }
+    if (type == OBJ_OFS_DELTA) {
+        pos = consumed;
+        while (pos < len && (buf[pos] & 0x80)) pos++;
+        if (pos == len) return 0;
+
+        unsigned char byte = buf[consumed++];
+        size_t offset = byte & 0x7F;
+        while (byte & 0x80) {
+            byte = buf[consumed++];
+            offset = ((offset + 1) << 7) | (byte & 0x7F);
+        }
+        if (offset > entry->offset) return -1;
+        entry->baseoffset = entry->offset - offset;
+        return (int)consumed;
+    }
+    if (type < OBJ_COMMIT || type > OBJ_TAG) return -1;
+    return (int)consumed;
+}
+
+/**
+ * @brief Set up inflation (and hashing, for non-delta objects) of the current entry
+ */
+static int beginEntryData(PackStream *stream, PackEntry *entry) {
+    memset(&stream->zstream, 0, sizeof(stream->zstream));
+    if (inflateInit(&stream->zstream) != Z_OK) return -1;
+    stream->zstreamActive = 1;
+    stream->inflated = 0;
+
+    if (entry->type != OBJ_OFS_DELTA && entry->type != OBJ_REF_DELTA) {
+        char header[64];
+        int headerLength = snprintf(header, sizeof(header), "%s %zu", objectTypeName(entry->type), entry->size) + 1;
+        sha1Init(&stream->objectHash);
+        sha1Update(&stream->objectHash, header, headerLength);
+    }
+    return 0;
+}
+
+/**
+ * @brief Feed compressed bytes of the current entry to zlib
+ *
+ * @return size_t: compressed bytes consumed; sets stream->state when the entry ends
+ */
+static size_t feedEntryData(PackStream *stream, PackEntry *entry, const unsigned char *data, size_t len) {
+    unsigned char scratch[65536];
+    int hashing = entry->type != OBJ_OFS_DELTA && entry->type != OBJ_REF_DELTA;
+
+    stream->zstream.next_in = (unsigned char *)data;
+    stream->zstream.avail_in = len;
+
+    int ret;
+    do {
+        stream->zstream.next_out = scratch;
+        stream->zstream.avail_out = sizeof(scratch);
+        ret = inflate(&stream->zstream, Z_NO_FLUSH);
+        size_t produced = sizeof(scratch) - stream->zstream.avail_out;
+        stream->inflated += produced;
+        if (hashing && produced > 0) {
+            sha1Update(&stream->objectHash, scratch, produced);
+        }
+    } while (ret == Z_OK && (stream->zstream.avail_in > 0 || stream->zstream.avail_out == 0));
+
+    size_t consumed = len - stream->zstream.avail_in;
+    entry->crc32 = crc32(entry->crc32, data, consumed);
+
+    if (ret == Z_STREAM_END) {
+        inflateEnd(&stream->zstream);
+        stream->zstreamActive = 0;
+        if (stream->inflated != entry->size) {
+            fprintf(stderr, "Error: Pack entry at offset %zu inflates to the wrong size\n", entry->offset);
+            streamFail(stream);
+            return consumed;
+        }
+
+        if (hashing) {
+            sha1Final(&stream->objectHash, entry->sha);
+            entry->realType = entry->type;
+            entry->resolved = 1;
+        }
+
+        stream->current++;
+        stream->state = stream->current == stream->count ? STREAM_TRAILER : STREAM_ENTRY_HEADER;
+    } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        fprintf(stderr, "Error: Failed to inflate pack entry at offset %zu\n", entry->offset);
+        streamFail(stream);
+    }
+    return consumed;
+}
+
+/**
+ * @brief feed the next chunk of pack bytes, as received
+ *
+ * @param stream: stream from packStreamBegin()
+ * @param data: received bytes
+ * @param len: number of bytes
+ * @return int: 0 on success, -1 if the pack is corrupt or cannot be stored
+ */
+int packStreamWrite(PackStream *stream, const unsigned char *data, size_t len) {
+    if (stream->state == STREAM_FAILED) return -1;
+
+    // Keep the raw bytes: the stored pack is exactly what was received
+    size_t written = 0;
+    while (written < len) {
+        ssize_t n = write(stream->fd, data + written, len - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Could not write %s: %s\n", stream->tmpPath, strerror(errno));
+            return streamFail(stream);
+        }
+        written += n;
+    }
+
+    while (len > 0) {
+        switch (stream->state) {
+        case STREAM_PACK_HEADER: {
+            size_t take = 12 - stream->bufferLen < len ? 12 - stream->bufferLen : len;
+            memcpy(stream->buffer + stream->bufferLen, data, take);
+            sha1Update(&stream->packHash, data, take);
+            stream->bufferLen += take;
+            stream->offset += take;
+            data += take;
+            len -= take;
+            if (stream->bufferLen < 12) break;
+
+            PackHeader header = readPackHeader(stream->buffer, 12);
+            if (header.version == 0) return streamFail(stream);
+            stream->count = (uint32_t)header.objects;
+            stream->entries = calloc(stream->count ? stream->count : 1, sizeof(PackEntry));
+            if (!stream->entries) {
+                fprintf(stderr, "Error: Out of memory for %u pack entries\n", stream->count);
+                return streamFail(stream);
+            }
+            stream->bufferLen = 0;
+            stream->state = stream->count ? STREAM_ENTRY_HEADER : STREAM_TRAILER;
+            break;
+        }
+        case STREAM_ENTRY_HEADER: {
+            PackEntry *entry = &stream->entries[stream->current];
+            if (stream->bufferLen == 0) {
+                entry->offset = stream->offset;
+            }
+            if (stream->bufferLen == ENTRY_HEADER_MAX) {
+                fprintf(stderr, "Error: Oversized entry header at offset %zu\n", entry->offset);
+                return streamFail(stream);
+            }
+
+            sha1Update(&stream->packHash, data, 1);
+            stream->buffer[stream->bufferLen++] = *data++;
+            stream->offset++;
+            len--;
+
+            int headerLen = parseEntryHeader(stream, entry);
+            if (headerLen < 0) {
+                fprintf(stderr, "Error: Invalid entry header at offset %zu\n", entry->offset);
+                return streamFail(stream);
+            }
+            if (headerLen == 0) break;
+
+            entry->dataOffset = stream->offset;
+            entry->crc32 = crc32(0L, stream->buffer, headerLen);
+            stream->bufferLen = 0;
+            if (beginEntryData(stream, entry) != 0) return streamFail(stream);
+            stream->state = STREAM_ENTRY_DATA;
+            break;
+        }
+        case STREAM_ENTRY_DATA: {
+            size_t consumed = feedEntryData(stream, &stream->entries[stream->current], data, len);
+            if (stream->state == STREAM_FAILED) return -1;
+            sha1Update(&stream->packHash, data, consumed);
+            stream->offset += consumed;
+            data += consumed;
+            len -= consumed;
+            break;
+        }
+        case STREAM_TRAILER: {
+            size_t take = 20 - stream->bufferLen < len ? 20 - stream->bufferLen : len;
+            memcpy(stream->buffer + stream->bufferLen, data, take);
+            stream->bufferLen += take;
+            stream->offset += take;
+            data += take;
+            len -= take;
+            if (stream->bufferLen < 20) break;
+
+            // The checksum has been running over every byte before the trailer
+            unsigned char checksum[20];
+            sha1Final(&stream->packHash, checksum);
+            if (memcmp(checksum, stream->buffer, 20) != 0) {
+                fprintf(stderr, "Error: Pack checksum mismatch\n");
+                return streamFail(stream);
+            }
+            stream->state = STREAM_DONE;
+            break;
+        }
+        case STREAM_DONE:
+            fprintf(stderr, "Error: %zu unexpected bytes after pack trailer\n", len);
+            return streamFail(stream);
+        case STREAM_FAILED:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Release everything but the temp pack itself
+ */
+static void packStreamFree(PackStream *stream) {
+    if (stream->zstreamActive) inflateEnd(&stream->zstream);
+    if (stream->fd >= 0) close(stream->fd);
+    free(stream->entries);
+    free(stream);
+}
+
+/**
+ * @brief give up on a stream and remove its temp pack
+ *
+ * @param stream: stream from packStreamBegin()
+ */
+void packStreamAbort(PackStream *stream) {
+    unlink(stream->tmpPath);
+    packStreamFree(stream);
+}
+
+/**
+ * @brief finish a received pack: resolve deltas, write the .idx, move both into place
+ *
+ * @note Non-delta objects were named while streaming; only deltas are
+ *       rebuilt here, from the temp pack mapped read-only.
+ *
+ * @param stream: stream from packStreamBegin() (always freed)
+ * @param outPackSha: OUTPUT - 40-char hex pack checksum (must be 41 bytes, may be NULL)
+ * @return int: 0 on success, -1 on error
+ */
+int packStreamFinish(PackStream *stream, char *outPackSha) {
+    if (stream->state != STREAM_DONE) {
+        if (stream->state != STREAM_FAILED) {
+            fprintf(stderr, "Error: Pack ended early (%u of %u objects)\n", stream->current, stream->count);
+        }
+        packStreamAbort(stream);
+        return -1;
+    }
+
+    void *packData = mmap(NULL, stream->offset, PROT_READ, MAP_PRIVATE, stream->fd, 0);
+    if (packData == MAP_FAILED) {
+        fprintf(stderr, "Error: Could not map %s: %s\n", stream->tmpPath, strerror(errno));
+        packStreamAbort(stream);
+        return -1;
+    }
+
+    int result = resolvePackEntries(packData, stream->offset, stream->entries, stream->count, stream->threads);
+    if (result == 0) {
+        result = storePack(stream->tmpPath, stream->entries, stream->count, stream->buffer, outPackSha);
+    } else {
+        unlink(stream->tmpPath);
+    }
+
+    munmap(packData, stream->offset);
+    packStreamFree(stream);
+    return result;
+}
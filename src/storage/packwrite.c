@@ -0,0 +1,373 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <arpa/inet.h>  // for htonl (host to network byte order)
+#include "object.h"
+#include "../utils/utils.h"
+#include "../git/git.h"
+
+/*
+Pack generation:
+object list (SHA + optional path)
+    → type and size of every object, from its header only (no inflating)
+    → sorted by type, then name hash (files at the same path end up next
+      to each other), then size, largest first
+    → sliding window: each object is delta-encoded against the previous
+      `window` objects of its type; the smallest delta whose chain stays
+      within `depth` wins, otherwise the object is stored whole
+    → written in sorted order, so every OFS_DELTA base precedes its delta
+*/
+
+/**
+ * @brief object queued for packing
+ * @note
+ *      nameHash: hash of the path the object was found at (0 if none)
+ *      order: position in the input, last sort key
+ *      offset: position in the pack once written
+ *      depth: length of its delta chain (0 = stored whole)
+ */
+typedef struct {
+    unsigned char sha[20];
+    ObjectType type;
+    size_t size;
+    uint32_t nameHash;
+    uint32_t order;
+    size_t offset;
+    int depth;
+} PackCandidate;
+
+/**
+ * @brief recently written object kept in memory as a delta base candidate
+ * @note index is built the first time the object is tried as a base and
+ *       then reused for every later object in the window
+ */
+typedef struct {
+    PackCandidate *object;
+    unsigned char *data;
+    DeltaIndex *index;
+} WindowSlot;
+
+/**
+ * @brief buffered pack output with a running SHA-1 for the trailer
+ */
+typedef struct {
+    int fd;
+    Sha1Context hash;
+    unsigned char buffer[65536];
+    size_t len;
+    size_t offset;  // bytes written so far
+    int failed;
+} PackWriter;
+
+/**
+ * @brief Hash path names so that files with the same basename sort together
+ * @note Later characters weigh the most, so "a/Makefile" and "b/Makefile" land close.
+ */
+static uint32_t packNameHash(const char *name) {
+    uint32_t hash = 0;
+    if (!name) return 0;
+
+    for (const unsigned char *c = (const unsigned char *)name; *c; c++) {
+        if (isspace(*c)) continue;
+        hash = (hash >> 2) + ((uint32_t)*c << 24);
+    }
+    return hash;
+}
+
+/**
+ * @brief Sort: type, name hash, size (largest first), input order
+ */
+static int compareCandidates(const void *a, const void *b) {
+    const PackCandidate *x = a;
+    const PackCandidate *y = b;
+    if (x->type != y->type) return x->type < y->type ? -1 : 1;
+    if (x->nameHash != y->nameHash) return x->nameHash > y->nameHash ? -1 : 1;
+    if (x->size != y->size) return x->size > y->size ? -1 : 1;
+    return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static int compareCandidateShas(const void *a, const void *b) {
+    return memcmp(((const PackCandidate *)a)->sha, ((const PackCandidate *)b)->sha, 20);
+}
+
+static void writeAll(PackWriter *writer, const unsigned char *data, size_t len) {
+    size_t written = 0;
+    while (!writer->failed && written < len) {
+        ssize_t n = write(writer->fd, data + written, len - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error: Could not write pack: %s\n", strerror(errno));
+            writer->failed = 1;
+            break;
+        }
+        written += n;
+    }
+}
+
+static void packFlush(PackWriter *writer) {
+    sha1Update(&writer->hash, writer->buffer, writer->len);
+    writeAll(writer, writer->buffer, writer->len);
+    writer->len = 0;
+}
+
+static void packWrite(PackWriter *writer, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    writer->offset += len;
+    while (len > 0) {
+        size_t take = sizeof(writer->buffer) - writer->len;
+        if (take > len) take = len;
+        memcpy(writer->buffer + writer->len, bytes, take);
+        writer->len += take;
+        bytes += take;
+        len -= take;
+        if (writer->len == sizeof(writer->buffer)) packFlush(writer);
+    }
+}
+
+/**
+ * @brief Encode an entry's type/size header (see readTypeAndSize)
+ */
+static size_t encodeEntryHeader(unsigned char *out, ObjectType type, size_t size) {
+    size_t n = 0;
+    unsigned char byte = (unsigned char)((type << 4) | (size & 0x0F));
+    size >>= 4;
+    while (size) {
+        out[n++] = byte | 0x80;
+        byte = size & 0x7F;
+        size >>= 7;
+    }
+    out[n++] = byte;
+    return n;
+}
+
+/**
+ * @brief Encode the distance back to an OFS_DELTA base
+ * @note Big-endian 7-bit groups, each continuation adding one (so no value has two encodings)
+ */
+static size_t encodeBaseOffset(unsigned char *out, size_t distance) {
+    unsigned char bytes[16];
+    size_t pos = sizeof(bytes) - 1;
+    bytes[pos] = distance & 0x7F;
+    while (distance >>= 7) {
+        bytes[--pos] = 0x80 | (--distance & 0x7F);
+    }
+    memcpy(out, bytes + pos, sizeof(bytes) - pos);
+    return sizeof(bytes) - pos;
+}
+
+/**
+ * @brief Deflate one entry's data and append header + data to the pack
+ */
+static int writePackEntry(PackWriter *writer, PackEntry *entry, ObjectType type, size_t baseOffset,
+                          const unsigned char *data, size_t size) {
+    unsigned char header[32];
+    size_t headerLen = encodeEntryHeader(header, type, size);
+    if (type == OBJ_OFS_DELTA) {
+        headerLen += encodeBaseOffset(header + headerLen, entry->offset - baseOffset);
+    }
+
+    uLongf compressedSize = compressBound(size);
+    unsigned char *compressed = malloc(compressedSize);
+    if (compress2(compressed, &compressedSize, data, size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        fprintf(stderr, "Error: Failed to compress pack entry\n");
+        free(compressed);
+        return -1;
+    }
+
+    entry->crc32 = crc32(crc32(0L, header, headerLen), compressed, compressedSize);
+    packWrite(writer, header, headerLen);
+    packWrite(writer, compressed, compressedSize);
+    free(compressed);
+    return writer->failed ? -1 : 0;
+}
+
+/**
+ * @brief Find the smallest delta for an object among the window
+ *
+ * @return unsigned char*: delta (caller must free) or NULL to store the object whole
+ */
+static unsigned char* findBestDelta(WindowSlot *window, int windowSize, const PackCandidate *object,
+                                    const unsigned char *data, int maxDepth, size_t *outDeltaSize, int *outBase) {
+    // A delta must at least halve the object to be worth the chain
+    if (object->size < 64) return NULL;
+    size_t bestSize = object->size / 2 - 20;
+    unsigned char *best = NULL;
+
+    for (int i = 0; i < windowSize; i++) {
+        const PackCandidate *base = window[i].object;
+        if (!base || base->type != object->type || base->depth >= maxDepth) continue;
+        if (object->size < base->size / 32) continue;
+
+        size_t sizeDiff = base->size > object->size ? base->size - object->size : object->size - base->size;
+        if (sizeDiff >= bestSize) continue;
+
+        if (!window[i].index) {
+            window[i].index = createDeltaIndex(window[i].data, base->size, NULL);
+            if (!window[i].index) continue;
+        }
+
+        size_t deltaSize;
+        unsigned char *delta = createDeltaFromIndex(window[i].index, data, object->size, bestSize - 1, &deltaSize);
+        if (!delta) continue;
+
+        free(best);
+        best = delta;
+        bestSize = deltaSize;
+        *outDeltaSize = deltaSize;
+        *outBase = i;
+    }
+    return best;
+}
+
+/**
+ * @brief write a version 2 pack of the given objects
+ *
+ * @param fd: where the pack goes
+ * @param hexShas: objects to pack
+ * @param paths: path each object was found at, used to group similar files (NULL / NULL entries allowed)
+ * @param count: number of objects
+ * @param options: delta window and depth
+ * @param outEntries: OUTPUT - packed entries (sha, offset, crc32) for writePackIndex (caller must free)
+ * @param outCount: OUTPUT - number of entries (duplicates in the input are packed once)
+ * @param outPackSha: OUTPUT - 20-byte pack checksum
+ * @return int: 0 on success, -1 on error
+ */
+int packObjects(int fd, char **hexShas, char **paths, uint32_t count, const PackOptions *options,
+                PackEntry **outEntries, uint32_t *outCount, unsigned char *outPackSha) {
+    PackCandidate *objects = calloc(count ? count : 1, sizeof(PackCandidate));
+    if (!objects) {
+        fprintf(stderr, "Error: Out of memory listing %u objects\n", count);
+        return -1;
+    }
+
+    // Only the headers: sorting needs the type and size, the data is read once, below
+    for (uint32_t i = 0; i < count; i++) {
+        if (odbReadObjectHeader(hexShas[i], &objects[i].type, &objects[i].size) != 0) {
+            fprintf(stderr, "Error: Object %s not found\n", hexShas[i]);
+            free(objects);
+            return -1;
+        }
+        hexToRaw(hexShas[i], objects[i].sha);
+        objects[i].nameHash = packNameHash(paths ? paths[i] : NULL);
+        objects[i].order = i;
+    }
+
+    // Drop duplicates (keep the first occurrence)
+    qsort(objects, count, sizeof(PackCandidate), compareCandidateShas);
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (unique > 0 && memcmp(objects[unique - 1].sha, objects[i].sha, 20) == 0) {
+            if (objects[i].order < objects[unique - 1].order) objects[unique - 1] = objects[i];
+            continue;
+        }
+        objects[unique++] = objects[i];
+    }
+    qsort(objects, unique, sizeof(PackCandidate), compareCandidates);
+
+    int windowSize = options->window > 0 ? options->window : 0;
+    PackEntry *entries = calloc(unique ? unique : 1, sizeof(PackEntry));
+    PackWriter *writer = calloc(1, sizeof(PackWriter));
+    WindowSlot *window = calloc(windowSize ? windowSize : 1, sizeof(WindowSlot));
+    if (!entries || !writer || !window) {
+        fprintf(stderr, "Error: Out of memory packing %u objects\n", unique);
+        free(entries);
+        free(writer);
+        free(window);
+        free(objects);
+        return -1;
+    }
+    writer->fd = fd;
+    sha1Init(&writer->hash);
+
+    unsigned char header[12];
+    memcpy(header, "PACK", 4);
+    uint32_t version = htonl(2);
+    uint32_t objectCount = htonl(unique);
+    memcpy(header + 4, &version, 4);
+    memcpy(header + 8, &objectCount, 4);
+    packWrite(writer, header, sizeof(header));
+
+    int nextSlot = 0;
+    int result = 0;
+
+    for (uint32_t i = 0; i < unique && result == 0; i++) {
+        PackCandidate *object = &objects[i];
+        char hexSha[41];
+        rawToHex(object->sha, hexSha);
+
+        ObjectType type;
+        unsigned char *data;
+        size_t size;
+        if (odbReadObject(hexSha, &type, &data, &size) != 0) {
+            fprintf(stderr, "Error: Object %s not found\n", hexSha);
+            result = -1;
+            break;
+        }
+        if (type != object->type || size != object->size) {
+            fprintf(stderr, "Error: Object %s does not match its header\n", hexSha);
+            free(data);
+            result = -1;
+            break;
+        }
+
+        PackEntry *entry = &entries[i];
+        memcpy(entry->sha, object->sha, 20);
+        entry->type = entry->realType = object->type;
+        entry->size = object->size;
+        entry->offset = object->offset = writer->offset;
+
+        size_t deltaSize = 0;
+        int baseSlot = -1;
+        unsigned char *delta = findBestDelta(window, windowSize, object, data, options->depth, &deltaSize, &baseSlot);
+        if (delta) {
+            const PackCandidate *base = window[baseSlot].object;
+            object->depth = base->depth + 1;
+            entry->type = OBJ_OFS_DELTA;
+            entry->baseoffset = base->offset;
+            result = writePackEntry(writer, entry, OBJ_OFS_DELTA, base->offset, delta, deltaSize);
+            free(delta);
+        } else {
+            result = writePackEntry(writer, entry, object->type, 0, data, size);
+        }
+
+        if (windowSize > 0) {
+            free(window[nextSlot].data);
+            freeDeltaIndex(window[nextSlot].index);
+            window[nextSlot].object = object;
+            window[nextSlot].data = data;
+            window[nextSlot].index = NULL;
+            nextSlot = (nextSlot + 1) % windowSize;
+        } else {
+            free(data);
+        }
+    }
+
+    for (int i = 0; i < windowSize; i++) {
+        free(window[i].data);
+        freeDeltaIndex(window[i].index);
+    }
+    free(window);
+
+    if (result == 0) {
+        packFlush(writer);
+        sha1Final(&writer->hash, outPackSha);
+        writeAll(writer, outPackSha, SHA_DIGEST_LENGTH);
+        result = writer->failed ? -1 : 0;
+    }
+
+    free(writer);
+    free(objects);
+
+    if (result != 0) {
+        free(entries);
+        return -1;
+    }
+    *outEntries = entries;
+    *outCount = unique;
+    return 0;
+}
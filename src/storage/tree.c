@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "object.h"
+#include "../utils/utils.h"
+
+/*
+Tree object format:
+entries, sorted in git's tree order (a directory sorts as "name/"):
+    "<octal mode> <name>\0<20-byte SHA>"
+The iterator below walks them where they lie: name and SHA point into the tree's
+content (the name is already NUL-terminated there), so nothing is copied.
+*/
+
+/**
+ * @brief Start iterating over a tree's entries
+ *
+ * @param it: iterator to set up
+ * @param content: tree content (must outlive the iterator)
+ * @param size: content size
+ */
+void treeIteratorInit(TreeIterator *it, const unsigned char *content, size_t size) {
+    memset(it, 0, sizeof(*it));
+    it->ptr = content;
+    it->end = content + size;
+}
+
+/**
+ * @brief Move to the next entry
+ *
+ * @return int: 1 if an entry was read into it->name/nameLen/mode/sha, 0 at the end,
+ *              -1 if the tree is malformed (reported)
+ */
+int treeIteratorNext(TreeIterator *it) {
+    if (it->ptr >= it->end) return 0;
+
+    uint32_t mode = 0;
+    const unsigned char *ptr = it->ptr;
+    while (ptr < it->end && *ptr >= '0' && *ptr <= '7') {
+        mode = (mode << 3) | (*ptr++ - '0');
+    }
+    const unsigned char *name = ptr + 1;
+    const unsigned char *nul = ptr < it->end && *ptr == ' ' && ptr > it->ptr ? memchr(name, '\0', it->end - name) : NULL;
+    if (!nul || nul == name || it->end - nul - 1 < 20) {
+        fprintf(stderr, "Error: Malformed tree entry\n");
+        return -1;
+    }
+
+    it->mode = mode;
+    it->name = (const char *)name;
+    it->nameLen = nul - name;
+    it->sha = nul + 1;
+    it->ptr = nul + 21;
+    return 1;
+}
+
+/**
+ * @brief Read a tree object by raw SHA
+ *
+ * @param sha: 20-byte SHA
+ * @param outSize: OUTPUT - content size
+ * @return unsigned char*: tree content (caller frees), NULL if missing or not a tree
+ */
+unsigned char* readTreeObject(const unsigned char *sha, size_t *outSize) {
+    char hexSha[41];
+    rawToHex(sha, hexSha);
+
+    ObjectType type;
+    unsigned char *content;
+    if (odbReadObject(hexSha, &type, &content, outSize) != 0) {
+        fprintf(stderr, "Error: Could not read tree %s\n", hexSha);
+        return NULL;
+    }
+    if (type != OBJ_TREE) {
+        fprintf(stderr, "Error: %s is not a tree\n", hexSha);
+        free(content);
+        return NULL;
+    }
+    return content;
+}
+
+/**
+ * @brief Find the tree of a commit (or accept a tree as is)
+ *
+ * @param hexSha: 40-char hex SHA of a commit or tree
+ * @param outTree: OUTPUT - 20-byte tree SHA
+ * @return int: 0 on success, -1 if it is neither
+ */
+int peelToTree(const char *hexSha, unsigned char *outTree) {
+    ObjectType type;
+    unsigned char *content;
+    size_t size;
+    if (odbReadObject(hexSha, &type, &content, &size) != 0) {
+        fprintf(stderr, "Error: Could not read object %s\n", hexSha);
+        return -1;
+    }
+
+    int result = -1;
+    if (type == OBJ_TREE) {
+        result = hexToRaw(hexSha, outTree);
+    } else if (type == OBJ_COMMIT && size >= 45 && memcmp(content, "tree ", 5) == 0) {
+        char treeHex[41];
+        memcpy(treeHex, content + 5, 40);
+        treeHex[40] = '\0';
+        result = hexToRaw(treeHex, outTree);
+    }
+    if (result != 0) {
+        fprintf(stderr, "Error: %s is not a tree or commit\n", hexSha);
+    }
+    free(content);
+    return result;
+}
@@ -4,12 +4,33 @@
 #include "../storage/object.h"
 
 /**
- * @brief Compare two Entry structs by name for qsort
- * 
+ * @brief Compare two tree entry names in git's tree order
+ *
+ * @note A directory sorts as if its name ended in '/', so "foo.c" comes
+ *       before the directory "foo" (git fsck rejects trees in any other order).
+ *
+ * @return int: < 0, 0 or > 0 like strcmp
+ */
+int compareTreeNames(const char *a, size_t aLen, int aIsDir, const char *b, size_t bLen, int bIsDir) {
+    size_t len = aLen < bLen ? aLen : bLen;
+    int cmp = memcmp(a, b, len);
+    if (cmp) return cmp;
+
+    unsigned char aNext = aLen > len ? (unsigned char)a[len] : (aIsDir ? '/' : '\0');
+    unsigned char bNext = bLen > len ? (unsigned char)b[len] : (bIsDir ? '/' : '\0');
+    return aNext - bNext;
+}
+
+/**
+ * @brief Compare two Entry structs by name for qsort, in git's tree order
+ *
  * @param a 
  * @param b 
  * @return int 
  */
 int compareEntries(const void *a, const void *b) {
-    return strcmp(((Entry *)a)->name, ((Entry *)b)->name);
-}
\ No newline at end of file
+    const Entry *x = a;
+    const Entry *y = b;
+    return compareTreeNames(x->name, strlen(x->name), strcmp(x->mode, "40000") == 0,
+                            y->name, strlen(y->name), strcmp(y->mode, "40000") == 0);
+}
@@ -1,11 +1,20 @@
 #include "utils.h"
 #include <errno.h>
-#include <openssl/sha.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 
+static const char hexDigits[] = "0123456789abcdef";
+
+// Hex digit value + 1 per input byte, 0 (the default) for anything that is not a hex digit
+static const unsigned char hexValues[256] = {
+    ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+    ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
 /**
  * @brief Compute SHA-1 hash of data
  * 
@@ -16,14 +25,9 @@
  */
 char* hash(const char *data, size_t length, char *outHash) {
     unsigned char hash[SHA_DIGEST_LENGTH]; // SHA1 produces a 20-byte hash
-    SHA1((unsigned char *)data, length, hash); // From OPENSSL; compute SHA1 hash
-
-    for (int i = 0; i < SHA_DIGEST_LENGTH; i++) {
-        sprintf(&outHash[i * 2], "%02x", hash[i]);
-    }
-    outHash[SHA_DIGEST_LENGTH * 2] = '\0'; // Null terminate the string
-
-    return 0;
+    sha1(data, length, hash);
+    rawToHex(hash, outHash);
+    return outHash;
 }
 
 /**
@@ -31,11 +35,17 @@ char* hash(const char *data, size_t length, char *outHash) {
  * 
  * @param hex: 40-char hex SHA-1 string
  * @param raw: OUTPUT - 20-byte raw SHA-1
+ * @return int: 0 on success, -1 if hex contains a non-hex character
  */
-void hexToRaw(const char *hex, unsigned char *raw) {
+int hexToRaw(const char *hex, unsigned char *raw) {
     for (int i = 0; i < 20; i++) {
-        sscanf(hex + (i * 2), "%2hhx", &raw[i]);
+        int high = hexValues[(unsigned char)hex[2 * i]] - 1;
+        if (high < 0) return -1; // also stops at a NUL in a short string
+        int low = hexValues[(unsigned char)hex[2 * i + 1]] - 1;
+        if (low < 0) return -1;
+        raw[i] = (unsigned char)(high << 4 | low);
     }
+    return 0;
 }
 
 /**
@@ -46,7 +56,8 @@ void hexToRaw(const char *hex, unsigned char *raw) {
  */
 void rawToHex(const unsigned char *raw, char *hex) {
     for (int i = 0; i < 20; i++) {
-        sprintf(&hex[i * 2], "%02x", raw[i]);
+        hex[2 * i] = hexDigits[raw[i] >> 4];
+        hex[2 * i + 1] = hexDigits[raw[i] & 0x0F];
     }
     hex[40] = '\0'; // Null terminate
-}
\ No newline at end of file
+}
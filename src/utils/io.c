@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "utils.h"
+
+/**
+ * @brief Read a whole stream (e.g. stdin) into memory
+ *
+ * @param file: stream to read until EOF
+ * @param outSize: OUTPUT - number of bytes read
+ * @return unsigned char*: data read (caller must free)
+ */
+unsigned char* readStream(FILE *file, size_t *outSize) {
+    size_t capacity = 1 << 16;
+    size_t size = 0;
+    unsigned char *data = malloc(capacity);
+
+    size_t n;
+    while ((n = fread(data + size, 1, capacity - size, file)) > 0) {
+        size += n;
+        if (size == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+    }
+
+    *outSize = size;
+    return data;
+}
+
+/**
+ * @brief Read a whole regular file into memory
+ *
+ * @param path: file to read
+ * @param outSize: OUTPUT - file size
+ * @return unsigned char*: file content (caller must free), NULL if it can't be read
+ */
+unsigned char* readFile(const char *path, size_t *outSize) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = st.st_size;
+    unsigned char *data = malloc(size ? size : 1);
+    size_t filled = 0;
+    while (filled < size) {
+        ssize_t n = read(fd, data + filled, size - filled);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            free(data);
+            close(fd);
+            return NULL;
+        }
+        filled += n;
+    }
+    close(fd);
+
+    *outSize = size;
+    return data;
+}
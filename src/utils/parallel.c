@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "utils.h"
+
+/**
+ * @brief shared state of one parallelFor() run
+ */
+typedef struct {
+    atomic_size_t next;  // next item to hand out
+    size_t count;
+    void (*fn)(size_t index, void *arg);
+    void *arg;
+} ParallelJob;
+
+/**
+ * @brief Number of CPUs currently online (at least 1)
+ *
+ * @return int: CPU count
+ */
+int onlineCpus(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/**
+ * @brief Worker loop: keep claiming the next unprocessed item until none are left
+ */
+static void* parallelWorker(void *arg) {
+    ParallelJob *job = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count) {
+        job->fn(i, job->arg);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Run fn(i, arg) for every i in [0, count) on a pool of worker threads
+ *
+ * @note Items are handed out dynamically, so uneven items balance across
+ *       workers. The calling thread works too; with threads <= 1 everything
+ *       runs inline, in index order.
+ *
+ * @param threads: number of threads to use (0 = one per online CPU)
+ * @param count: number of items
+ * @param fn: function to run for each item
+ * @param arg: passed through to fn
+ */
+void parallelFor(int threads, size_t count, void (*fn)(size_t index, void *arg), void *arg) {
+    if (threads <= 0) threads = onlineCpus();
+    if ((size_t)threads > count) threads = count ? (int)count : 1;
+
+    ParallelJob job = { .count = count, .fn = fn, .arg = arg };
+    atomic_init(&job.next, 0);
+
+    pthread_t *workers = malloc(sizeof(pthread_t) * threads);
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started], NULL, parallelWorker, &job) != 0) {
+            fprintf(stderr, "Warning: Could not start worker thread, continuing with %d\n", started + 1);
+            break;
+        }
+        started++;
+    }
+
+    parallelWorker(&job);
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+}
+
+/**
+ * @brief queued task of a WorkPool
+ */
+typedef struct {
+    void (*fn)(void *arg);
+    void *arg;
+} WorkItem;
+
+/**
+ * @brief one worker's task queue: the owner pushes and pops at the tail (newest
+ *        first, depth-first), thieves take from the head (oldest, usually biggest)
+ */
+typedef struct {
+    pthread_mutex_t lock;
+    WorkItem *items;
+    size_t head, tail, capacity;
+} WorkDeque;
+
+struct WorkPool {
+    int threads;           // deques; deque 0 belongs to the thread in workPoolWait
+    WorkDeque *deques;
+    pthread_t *workers;
+    int started;
+    pthread_mutex_t lock;  // guards queued, pending, stopping
+    pthread_cond_t wake;   // work was queued, or the pool is stopping
+    pthread_cond_t idle;   // pending dropped to zero
+    size_t queued;         // items sitting in deques
+    size_t pending;        // items queued or running
+    int stopping;
+};
+
+/**
+ * @brief pool and deque the current thread works for (NULL outside any pool)
+ */
+static _Thread_local WorkPool *currentPool;
+static _Thread_local int currentSlot;
+
+static void dequePush(WorkDeque *deque, WorkItem item) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->tail == deque->capacity) {
+        if (deque->head > 0) {
+            memmove(deque->items, deque->items + deque->head, (deque->tail - deque->head) * sizeof(WorkItem));
+            deque->tail -= deque->head;
+            deque->head = 0;
+        } else {
+            deque->capacity = deque->capacity ? deque->capacity * 2 : 64;
+            deque->items = realloc(deque->items, deque->capacity * sizeof(WorkItem));
+        }
+    }
+    deque->items[deque->tail++] = item;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static int dequeTake(WorkDeque *deque, int steal, WorkItem *out) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *out = steal ? deque->items[deque->head++] : deque->items[--deque->tail];
+        if (deque->head == deque->tail) deque->head = deque->tail = 0;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/**
+ * @brief Run tasks on behalf of slot until the pool stops, or (untilIdle) until nothing is pending
+ */
+static void workPoolRun(WorkPool *pool, int slot, int untilIdle) {
+    currentPool = pool;
+    currentSlot = slot;
+
+    for (;;) {
+        WorkItem item;
+        int found = dequeTake(&pool->deques[slot], 0, &item);
+        for (int i = 1; !found && i < pool->threads; i++) {
+            found = dequeTake(&pool->deques[(slot + i) % pool->threads], 1, &item);
+        }
+
+        if (found) {
+            pthread_mutex_lock(&pool->lock);
+            pool->queued--;
+            pthread_mutex_unlock(&pool->lock);
+
+            item.fn(item.arg);
+
+            pthread_mutex_lock(&pool->lock);
+            if (--pool->pending == 0) pthread_cond_broadcast(&pool->idle);
+            pthread_mutex_unlock(&pool->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->stopping && !(untilIdle && pool->pending == 0)) {
+            pthread_cond_wait(untilIdle ? &pool->idle : &pool->wake, &pool->lock);
+            if (untilIdle && pool->queued > 0) break;
+        }
+        int done = pool->queued == 0 && (pool->stopping || (untilIdle && pool->pending == 0));
+        pthread_mutex_unlock(&pool->lock);
+        if (done) break;
+    }
+
+    currentPool = NULL;
+}
+
+static void* workPoolWorker(void *arg) {
+    WorkPool *pool = ((void **)arg)[0];
+    int slot = (int)(intptr_t)((void **)arg)[1];
+    free(arg);
+    workPoolRun(pool, slot, 0);
+    return NULL;
+}
+
+/**
+ * @brief Start a work-stealing pool
+ *
+ * @note Each thread has its own queue; tasks submitted from a task go to the
+ *       submitting thread's queue, and idle threads steal from the others.
+ *       The thread in workPoolWait() works too, so threads = 1 starts no
+ *       extra threads at all.
+ *
+ * @param threads: number of threads to use (0 = one per online CPU)
+ * @return WorkPool*: the pool (free with workPoolDestroy)
+ */
+WorkPool* workPoolCreate(int threads) {
+    if (threads <= 0) threads = onlineCpus();
+
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    pool->threads = threads;
+    pool->deques = calloc(threads, sizeof(WorkDeque));
+    pool->workers = malloc(sizeof(pthread_t) * threads);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    for (int t = 1; t < threads; t++) {
+        void **arg = malloc(2 * sizeof(void *));
+        arg[0] = pool;
+        arg[1] = (void *)(intptr_t)t;
+        if (pthread_create(&pool->workers[pool->started], NULL, workPoolWorker, arg) != 0) {
+            fprintf(stderr, "Warning: Could not start worker thread, continuing with %d\n", pool->started + 1);
+            free(arg);
+            break;
+        }
+        pool->started++;
+    }
+    return pool;
+}
+
+/**
+ * @brief Queue fn(arg) on the pool
+ *
+ * @note Safe to call from inside a running task.
+ */
+void workPoolSubmit(WorkPool *pool, void (*fn)(void *arg), void *arg) {
+    int slot = currentPool == pool ? currentSlot : 0;
+
+    // Count the task before publishing it: a thief may take and finish it at once
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pool->pending++;
+    dequePush(&pool->deques[slot], (WorkItem){ fn, arg });
+    pthread_cond_signal(&pool->wake);
+    pthread_cond_broadcast(&pool->idle);  // wakes a helping workPoolWait()
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Help run tasks until every submitted task (and everything they submitted) has finished
+ */
+void workPoolWait(WorkPool *pool) {
+    workPoolRun(pool, 0, 1);
+}
+
+/**
+ * @brief Stop the workers and free the pool (after workPoolWait)
+ */
+void workPoolDestroy(WorkPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int t = 0; t < pool->started; t++) {
+        pthread_join(pool->workers[t], NULL);
+    }
+    for (int i = 0; i < pool->threads; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+        free(pool->deques[i].items);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->idle);
+    free(pool->deques);
+    free(pool->workers);
+    free(pool);
+}
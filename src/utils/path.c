@@ -7,7 +7,7 @@
  * @return char* The path to the object file
  */
 char *buildPath(const char *hash) {
-    static char path[256];
+    static _Thread_local char path[256]; // one per thread: callers run on worker pools
     snprintf(path, sizeof(path), ".git/objects/%c%c/%s", hash[0], hash[1], hash + 2);
     return path;
 }
\ No newline at end of file
@@ -0,0 +1,361 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "utils.h"
+
+/*
+SHA-1:
+sha1Init / sha1Update (any chunking) / sha1Final
+    → bytes gathered into 64-byte blocks
+    → blocks hashed by the fastest implementation this CPU has, picked once:
+        shani     x86 SHA extensions (sha1rnds4 & co.)
+        openssl   libcrypto's block function (its own SSSE3/AVX/AVX2 dispatch)
+        portable  plain C
+GIT_SHA1_IMPL=shani|openssl|portable overrides the choice (for benchmarking).
+
+Built with USE_SHA1DC, every hash goes through the sha1collisiondetection
+library instead and hashing an object that is part of a known collision
+attack is fatal, like in git.
+*/
+
+#ifdef USE_SHA1DC
+
+void sha1Init(Sha1Context *ctx) {
+    SHA1DCInit(&ctx->dc);
+}
+
+void sha1Update(Sha1Context *ctx, const void *data, size_t len) {
+    SHA1DCUpdate(&ctx->dc, data, len);
+}
+
+void sha1Final(Sha1Context *ctx, unsigned char *out) {
+    if (SHA1DCFinal(out, &ctx->dc) != 0) {
+        fprintf(stderr, "Error: SHA-1 appears to be part of a collision attack\n");
+        exit(128);
+    }
+}
+
+const char* sha1Implementation(void) {
+    return "sha1dc";
+}
+
+#else // !USE_SHA1DC
+
+#define OPENSSL_SUPPRESS_DEPRECATED // SHA1_Transform is the only block-level entry point
+#include <openssl/sha.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA1_HAVE_SHANI 1
+#endif
+
+typedef void (*Sha1BlockFn)(uint32_t state[5], const unsigned char *data, size_t blocks);
+
+static Sha1BlockFn sha1Blocks;
+static const char *sha1Name;
+static pthread_once_t sha1Once = PTHREAD_ONCE_INIT;
+
+static inline uint32_t rol32(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * @brief Reference block function
+ */
+static void sha1BlocksPortable(uint32_t state[5], const unsigned char *data, size_t blocks) {
+    while (blocks--) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)data[4 * i] << 24 | (uint32_t)data[4 * i + 1] << 16 |
+                   (uint32_t)data[4 * i + 2] << 8 | data[4 * i + 3];
+        }
+        for (int i = 16; i < 80; i++) {
+            w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+#define PORTABLE_ROUND(f, k, i) do {                          \
+            uint32_t t = rol32(a, 5) + (f) + e + (k) + w[i];  \
+            e = d;                                            \
+            d = c;                                            \
+            c = rol32(b, 30);                                 \
+            b = a;                                            \
+            a = t;                                            \
+        } while (0)
+        for (int i = 0; i < 20; i++) PORTABLE_ROUND(d ^ (b & (c ^ d)), 0x5A827999, i);
+        for (int i = 20; i < 40; i++) PORTABLE_ROUND(b ^ c ^ d, 0x6ED9EBA1, i);
+        for (int i = 40; i < 60; i++) PORTABLE_ROUND((b & c) | (d & (b | c)), 0x8F1BBCDC, i);
+        for (int i = 60; i < 80; i++) PORTABLE_ROUND(b ^ c ^ d, 0xCA62C1D6, i);
+#undef PORTABLE_ROUND
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        data += 64;
+    }
+}
+
+/**
+ * @brief Block function of libcrypto, which picks its own vectorized code path
+ */
+static void sha1BlocksOpenssl(uint32_t state[5], const unsigned char *data, size_t blocks) {
+    SHA_CTX ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.h0 = state[0];
+    ctx.h1 = state[1];
+    ctx.h2 = state[2];
+    ctx.h3 = state[3];
+    ctx.h4 = state[4];
+    while (blocks--) {
+        SHA1_Transform(&ctx, data);
+        data += 64;
+    }
+    state[0] = ctx.h0;
+    state[1] = ctx.h1;
+    state[2] = ctx.h2;
+    state[3] = ctx.h3;
+    state[4] = ctx.h4;
+}
+
+#ifdef SHA1_HAVE_SHANI
+
+// Four rounds plus the message schedule work interleaved with them
+#define SHANI_ROUNDS(func, ein, eout, mcur, mnext, mprev, mxor) \
+    ein = _mm_sha1nexte_epu32(ein, mcur);                        \
+    eout = abcd;                                                 \
+    mnext = _mm_sha1msg2_epu32(mnext, mcur);                     \
+    abcd = _mm_sha1rnds4_epu32(abcd, ein, func);                 \
+    mprev = _mm_sha1msg1_epu32(mprev, mcur);                     \
+    mxor = _mm_xor_si128(mxor, mcur)
+
+/**
+ * @brief Block function on the x86 SHA extensions
+ */
+__attribute__((target("sha,sse4.1")))
+static void sha1BlocksShaNi(uint32_t state[5], const unsigned char *data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+    __m128i e1, m0, m1, m2, m3;
+
+    while (blocks--) {
+        __m128i abcdSave = abcd;
+        __m128i e0Save = e0;
+
+        // Rounds 0-15: load the message as it is needed
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 0)), byteSwap);
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)), byteSwap);
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)), byteSwap);
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)), byteSwap);
+        SHANI_ROUNDS(0, e1, e0, m3, m0, m2, m1);
+
+        // Rounds 16-67
+        SHANI_ROUNDS(0, e0, e1, m0, m1, m3, m2);
+        SHANI_ROUNDS(1, e1, e0, m1, m2, m0, m3);
+        SHANI_ROUNDS(1, e0, e1, m2, m3, m1, m0);
+        SHANI_ROUNDS(1, e1, e0, m3, m0, m2, m1);
+        SHANI_ROUNDS(1, e0, e1, m0, m1, m3, m2);
+        SHANI_ROUNDS(1, e1, e0, m1, m2, m0, m3);
+        SHANI_ROUNDS(2, e0, e1, m2, m3, m1, m0);
+        SHANI_ROUNDS(2, e1, e0, m3, m0, m2, m1);
+        SHANI_ROUNDS(2, e0, e1, m0, m1, m3, m2);
+        SHANI_ROUNDS(2, e1, e0, m1, m2, m0, m3);
+        SHANI_ROUNDS(2, e0, e1, m2, m3, m1, m0);
+        SHANI_ROUNDS(3, e1, e0, m3, m0, m2, m1);
+        SHANI_ROUNDS(3, e0, e1, m0, m1, m3, m2);
+
+        // Rounds 68-79: the schedule winds down
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        m2 = _mm_sha1msg2_epu32(m2, m1);
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+        m3 = _mm_xor_si128(m3, m1);
+
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        m3 = _mm_sha1msg2_epu32(m3, m2);
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+        e1 = _mm_sha1nexte_epu32(e1, m3);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+        data += 64;
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+
+static int cpuHasShaNi(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3)) return 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return 0;
+    return (ebx & bit_SHA) != 0;
+}
+
+#endif // SHA1_HAVE_SHANI
+
+/**
+ * @brief Pick the block function once per process
+ */
+static void chooseSha1Implementation(void) {
+    const char *forced = getenv("GIT_SHA1_IMPL");
+    if (forced && !*forced) forced = NULL;
+
+#ifdef SHA1_HAVE_SHANI
+    if ((!forced || strcmp(forced, "shani") == 0) && cpuHasShaNi()) {
+        sha1Blocks = sha1BlocksShaNi;
+        sha1Name = "shani";
+        return;
+    }
+#endif
+    if (forced && strcmp(forced, "portable") == 0) {
+        sha1Blocks = sha1BlocksPortable;
+        sha1Name = "portable";
+        return;
+    }
+    sha1Blocks = sha1BlocksOpenssl;
+    sha1Name = "openssl";
+}
+
+/**
+ * @brief name of the block implementation in use ("shani", "openssl", "portable" or "sha1dc")
+ */
+const char* sha1Implementation(void) {
+    pthread_once(&sha1Once, chooseSha1Implementation);
+    return sha1Name;
+}
+
+/**
+ * @brief start a SHA-1 computation
+ *
+ * @param ctx: context to initialize
+ */
+void sha1Init(Sha1Context *ctx) {
+    pthread_once(&sha1Once, chooseSha1Implementation);
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+}
+
+/**
+ * @brief hash more bytes
+ *
+ * @param ctx: context from sha1Init
+ * @param data: bytes to add
+ * @param len: number of bytes
+ */
+void sha1Update(Sha1Context *ctx, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    size_t buffered = ctx->length % 64;
+    ctx->length += len;
+
+    if (buffered > 0) {
+        size_t take = 64 - buffered < len ? 64 - buffered : len;
+        memcpy(ctx->buffer + buffered, bytes, take);
+        bytes += take;
+        len -= take;
+        if (buffered + take < 64) return;
+        sha1Blocks(ctx->state, ctx->buffer, 1);
+    }
+
+    // Whole blocks straight from the caller's buffer
+    if (len >= 64) {
+        sha1Blocks(ctx->state, bytes, len / 64);
+        bytes += len - len % 64;
+        len %= 64;
+    }
+    memcpy(ctx->buffer, bytes, len);
+}
+
+/**
+ * @brief finish a SHA-1 computation
+ *
+ * @param ctx: context from sha1Init (must be re-initialized before reuse)
+ * @param out: OUTPUT - 20-byte digest
+ */
+void sha1Final(Sha1Context *ctx, unsigned char *out) {
+    uint64_t bits = ctx->length * 8;
+    size_t buffered = ctx->length % 64;
+
+    // Padding: 0x80, zeros up to 56 mod 64, then the bit length big-endian
+    ctx->buffer[buffered++] = 0x80;
+    if (buffered > 56) {
+        memset(ctx->buffer + buffered, 0, 64 - buffered);
+        sha1Blocks(ctx->state, ctx->buffer, 1);
+        buffered = 0;
+    }
+    memset(ctx->buffer + buffered, 0, 56 - buffered);
+    for (int i = 0; i < 8; i++) {
+        ctx->buffer[56 + i] = (unsigned char)(bits >> (56 - 8 * i));
+    }
+    sha1Blocks(ctx->state, ctx->buffer, 1);
+
+    for (int i = 0; i < 5; i++) {
+        out[4 * i] = (unsigned char)(ctx->state[i] >> 24);
+        out[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+        out[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+        out[4 * i + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+#endif // USE_SHA1DC
+
+/**
+ * @brief one-shot SHA-1 of a buffer
+ *
+ * @param data: bytes to hash
+ * @param len: number of bytes
+ * @param out: OUTPUT - 20-byte digest
+ */
+void sha1(const void *data, size_t len, unsigned char *out) {
+    Sha1Context ctx;
+    sha1Init(&ctx);
+    sha1Update(&ctx, data, len);
+    sha1Final(&ctx, out);
+}
+
+/**
+ * @brief SHA-1 of a git object: "<type> <size>\0" followed by the content, without joining them
+ *
+ * @param type: "blob", "tree", "commit" or "tag"
+ * @param content: object content
+ * @param size: size of content
+ * @param out: OUTPUT - 20-byte object name
+ */
+void hashObjectContent(const char *type, const unsigned char *content, size_t size, unsigned char *out) {
+    char header[64];
+    int headerLength = snprintf(header, sizeof(header), "%s %zu", type, size) + 1;
+
+    Sha1Context ctx;
+    sha1Init(&ctx);
+    sha1Update(&ctx, header, headerLength);
+    sha1Update(&ctx, content, size);
+    sha1Final(&ctx, out);
+}
@@ -2,13 +2,51 @@
 #define UTILS_H
 
 #include <stddef.h> 
+#include <stdio.h>
+#include <stdint.h>
+#ifdef USE_SHA1DC
+#include <sha1dc/sha1.h>
+#endif
 
 #define SHA_DIGEST_LENGTH 20
 
+/**
+ * @brief streaming SHA-1 state (see sha1.c)
+ */
+typedef struct {
+#ifdef USE_SHA1DC
+    SHA1_CTX dc;
+#else
+    uint32_t state[5];
+    uint64_t length;  // bytes hashed so far
+    unsigned char buffer[64];
+#endif
+} Sha1Context;
+
+void sha1Init(Sha1Context *ctx);
+void sha1Update(Sha1Context *ctx, const void *data, size_t len);
+void sha1Final(Sha1Context *ctx, unsigned char *out);
+void sha1(const void *data, size_t len, unsigned char *out);
+void hashObjectContent(const char *type, const unsigned char *content, size_t size, unsigned char *out);
+const char* sha1Implementation(void);
+
 char* hash(const char *data, size_t length, char *outHash);
-void hexToRaw(const char *hex, unsigned char *raw);
+int hexToRaw(const char *hex, unsigned char *raw);
 void rawToHex(const unsigned char *raw, char *hex);
 char* buildPath(const char *hash);
 int compareEntries(const void *a, const void *b);
+int compareTreeNames(const char *a, size_t aLen, int aIsDir, const char *b, size_t bLen, int bIsDir);
+int onlineCpus(void);
+unsigned char* readStream(FILE *file, size_t *outSize);
+unsigned char* readFile(const char *path, size_t *outSize);
+void parallelFor(int threads, size_t count, void (*fn)(size_t index, void *arg), void *arg);
+
+// Work-stealing thread pool for tasks that spawn more tasks (see parallel.c)
+typedef struct WorkPool WorkPool;
+
+WorkPool* workPoolCreate(int threads);
+void workPoolSubmit(WorkPool *pool, void (*fn)(void *arg), void *arg);
+void workPoolWait(WorkPool *pool);
+void workPoolDestroy(WorkPool *pool);
 
 #endif // UTILS_H
\ No newline at end of file